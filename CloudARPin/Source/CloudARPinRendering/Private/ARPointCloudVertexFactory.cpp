@@ -0,0 +1,153 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARPointCloudVertexFactory.h"
+#include "MaterialShared.h"
+#include "MeshBatch.h"
+#include "ShaderParameterUtils.h"
+
+void FARPointCloudCornerVertexBuffer::InitRHI()
+{
+	FRHIResourceCreateInfo CreateInfo;
+	void* Data = nullptr;
+	VertexBufferRHI = RHICreateAndLockVertexBuffer(sizeof(FVector2D) * 4, BUF_Static, CreateInfo, Data);
+
+	// Texture coordinates of the corners; the vertex shader maps them to
+	// offsets from the point, with V pointing down the screen.
+	FVector2D* Corners = static_cast<FVector2D*>(Data);
+	Corners[0] = FVector2D(0.0f, 1.0f);
+	Corners[1] = FVector2D(1.0f, 1.0f);
+	Corners[2] = FVector2D(1.0f, 0.0f);
+	Corners[3] = FVector2D(0.0f, 0.0f);
+
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+}
+
+void FARPointCloudIndexBuffer::InitRHI()
+{
+	FRHIResourceCreateInfo CreateInfo;
+	void* Data = nullptr;
+	IndexBufferRHI = RHICreateAndLockIndexBuffer(sizeof(uint16), sizeof(uint16) * NumIndices, BUF_Static, CreateInfo, Data);
+
+	uint16* Indices = static_cast<uint16*>(Data);
+	Indices[0] = 0;
+	Indices[1] = 2;
+	Indices[2] = 1;
+	Indices[3] = 0;
+	Indices[4] = 3;
+	Indices[5] = 2;
+
+	RHIUnlockIndexBuffer(IndexBufferRHI);
+}
+
+FARPointCloudInstanceBuffer::FARPointCloudInstanceBuffer()
+	: NumPoints(0)
+	, Capacity(0)
+{
+}
+
+void FARPointCloudInstanceBuffer::Update_RenderThread(const TArray<FVector4>& Points)
+{
+	check(IsInRenderingThread());
+	check(IsInitialized());
+
+	NumPoints = Points.Num();
+	if (NumPoints == 0)
+	{
+		return;
+	}
+
+	if (NumPoints > Capacity)
+	{
+		Capacity = FMath::Max(NumPoints, Capacity + Capacity / 2);
+		UpdateRHI();
+	}
+
+	const uint32 Size = NumPoints * sizeof(FVector4);
+	void* Data = RHILockVertexBuffer(VertexBufferRHI, 0, Size, RLM_WriteOnly);
+	FMemory::Memcpy(Data, Points.GetData(), Size);
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+}
+
+void FARPointCloudInstanceBuffer::InitRHI()
+{
+	if (Capacity > 0)
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		VertexBufferRHI = RHICreateVertexBuffer(Capacity * sizeof(FVector4), BUF_Dynamic, CreateInfo);
+	}
+}
+
+class FARPointCloudVertexFactoryShaderParameters : public FVertexFactoryShaderParameters
+{
+public:
+	virtual void Bind(const FShaderParameterMap& ParameterMap) override
+	{
+		PointColor.Bind(ParameterMap, TEXT("PointCloudColor"));
+		PointSize.Bind(ParameterMap, TEXT("PointCloudSize"));
+	}
+
+	virtual void Serialize(FArchive& Ar) override
+	{
+		Ar << PointColor;
+		Ar << PointSize;
+	}
+
+	virtual void SetMesh(FRHICommandList& RHICmdList, FShader* Shader, const FVertexFactory* VertexFactory, const FSceneView& View, const FMeshBatchElement& BatchElement, uint32 DataFlags) const override
+	{
+		const FARPointCloudBatchParameters* Parameters = static_cast<const FARPointCloudBatchParameters*>(BatchElement.UserData);
+		check(Parameters != nullptr);
+		SetShaderValue(RHICmdList, Shader->GetVertexShader(), PointColor, Parameters->PointColor);
+		SetShaderValue(RHICmdList, Shader->GetVertexShader(), PointSize, Parameters->PointSize);
+	}
+
+	virtual uint32 GetSize() const override
+	{
+		return sizeof(*this);
+	}
+
+private:
+	FShaderParameter PointColor;
+	FShaderParameter PointSize;
+};
+
+FARPointCloudVertexFactory::FARPointCloudVertexFactory(ERHIFeatureLevel::Type InFeatureLevel, const FARPointCloudCornerVertexBuffer* InCornerBuffer, const FARPointCloudInstanceBuffer* InInstanceBuffer)
+	: FVertexFactory(InFeatureLevel)
+	, CornerBuffer(InCornerBuffer)
+	, InstanceBuffer(InInstanceBuffer)
+{
+}
+
+bool FARPointCloudVertexFactory::ShouldCompilePermutation(EShaderPlatform Platform, const FMaterial* Material, const FShaderType* ShaderType)
+{
+	// Instancing needs ES3.1; the default materials are always compiled so
+	// that there is something to fall back to.
+	return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::ES3_1)
+		&& (Material->IsUsedWithParticleSprites() || Material->IsSpecialEngineMaterial());
+}
+
+FVertexFactoryShaderParameters* FARPointCloudVertexFactory::ConstructShaderParameters(EShaderFrequency ShaderFrequency)
+{
+	return ShaderFrequency == SF_Vertex ? new FARPointCloudVertexFactoryShaderParameters() : nullptr;
+}
+
+void FARPointCloudVertexFactory::InitRHI()
+{
+	FVertexDeclarationElementList Elements;
+	Elements.Add(AccessStreamComponent(FVertexStreamComponent(CornerBuffer, 0, sizeof(FVector2D), VET_Float2), 0));
+	Elements.Add(AccessStreamComponent(FVertexStreamComponent(InstanceBuffer, 0, sizeof(FVector4), VET_Float4, EVertexStreamUsage::Instancing), 1));
+	InitDeclaration(Elements);
+}
+
+IMPLEMENT_VERTEX_FACTORY_TYPE(FARPointCloudVertexFactory, "/CloudARPin/Private/ARPointCloudVertexFactory.ush", true, false, true, false, false);
@@ -0,0 +1,34 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CoreMinimal.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "ShaderCore.h"
+
+/**
+ * Shader types of the sample. Loaded in the PostConfigInit phase, before the
+ * shader types are gathered, and maps the project's Shaders directory to the
+ * /CloudARPin virtual shader path.
+ */
+class FCloudARPinRenderingModule : public IModuleInterface
+{
+public:
+	virtual void StartupModule() override
+	{
+		AddShaderSourceDirectoryMapping(TEXT("/CloudARPin"), FPaths::Combine(FPaths::ProjectDir(), TEXT("Shaders")));
+	}
+};
+
+IMPLEMENT_MODULE(FCloudARPinRenderingModule, CloudARPinRendering);
@@ -0,0 +1,107 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderResource.h"
+#include "VertexFactory.h"
+
+/**
+ * Per-batch parameters of FARPointCloudVertexFactory. A mesh batch drawn with
+ * the factory points FMeshBatchElement::UserData at one of these.
+ */
+struct FARPointCloudBatchParameters
+{
+	/** The color of the points. The alpha is multiplied by each point's confidence. */
+	FLinearColor PointColor;
+
+	/** The size of the points in pixels. */
+	float PointSize;
+};
+
+/** The four corners of a point's quad, shared by all points. */
+class CLOUDARPINRENDERING_API FARPointCloudCornerVertexBuffer : public FVertexBuffer
+{
+public:
+	virtual void InitRHI() override;
+};
+
+/** The two triangles of a point's quad. */
+class CLOUDARPINRENDERING_API FARPointCloudIndexBuffer : public FIndexBuffer
+{
+public:
+	static const uint32 NumIndices = 6;
+
+	virtual void InitRHI() override;
+};
+
+/**
+ * One FVector4 per point, with the world space position in XYZ and the
+ * confidence in W, read once per instance by FARPointCloudVertexFactory.
+ */
+class CLOUDARPINRENDERING_API FARPointCloudInstanceBuffer : public FVertexBuffer
+{
+public:
+	FARPointCloudInstanceBuffer();
+
+	/**
+	 * Uploads the points with a single lock of the buffer. The buffer grows
+	 * geometrically and is never shrunk, so a cloud of a steady size does not
+	 * recreate it. Must be called on the render thread once the buffer is
+	 * initialized.
+	 */
+	void Update_RenderThread(const TArray<FVector4>& Points);
+
+	/** Returns the number of points uploaded by the last update. */
+	int32 GetNumPoints() const { return NumPoints; }
+
+	/** Returns the size of the buffer in bytes. */
+	uint32 GetAllocatedSize() const { return Capacity * sizeof(FVector4); }
+
+	virtual void InitRHI() override;
+
+private:
+	int32 NumPoints;
+	int32 Capacity;
+};
+
+/**
+ * Draws every point of an FARPointCloudInstanceBuffer as an instance of the
+ * corner quad. The vertex shader expands the quad to face the camera and to
+ * be PointSize pixels wide, like DrawDebugPoint(), so the CPU only ever
+ * touches the points themselves.
+ *
+ * The material sees the point color in Vertex Color, with the confidence
+ * multiplied into the alpha, the corner of the quad in UV0 and the confidence
+ * in the first channel of UV1. Materials must be flagged as used with
+ * particle sprites.
+ */
+class CLOUDARPINRENDERING_API FARPointCloudVertexFactory : public FVertexFactory
+{
+	DECLARE_VERTEX_FACTORY_TYPE(FARPointCloudVertexFactory);
+
+public:
+	FARPointCloudVertexFactory(ERHIFeatureLevel::Type InFeatureLevel, const FARPointCloudCornerVertexBuffer* InCornerBuffer, const FARPointCloudInstanceBuffer* InInstanceBuffer);
+
+	static bool ShouldCompilePermutation(EShaderPlatform Platform, const class FMaterial* Material, const class FShaderType* ShaderType);
+
+	static FVertexFactoryShaderParameters* ConstructShaderParameters(EShaderFrequency ShaderFrequency);
+
+	virtual void InitRHI() override;
+
+private:
+	const FARPointCloudCornerVertexBuffer* CornerBuffer;
+	const FARPointCloudInstanceBuffer* InstanceBuffer;
+};
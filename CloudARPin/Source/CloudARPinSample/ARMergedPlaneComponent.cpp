@@ -0,0 +1,353 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARMergedPlaneComponent.h"
+#include "DynamicMeshBuilder.h"
+#include "LocalVertexFactory.h"
+#include "Materials/Material.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+#include "StaticMeshResources.h"
+
+/** One vertex of the merged mesh as the render thread needs it. */
+struct FARMergedPlaneVertex
+{
+	FVector Position;
+	FVector Normal;
+	FVector2D UV0;
+	FVector2D UV1;
+	FColor Color;
+};
+
+/** The vertices of the dirty ranges, packed one range after the other. */
+struct FARMergedPlaneDynamicData
+{
+	TArray<UARMergedPlaneComponent::FVertexRange> Ranges;
+	TArray<FARMergedPlaneVertex> Vertices;
+};
+
+static FARMergedPlaneVertex GetMergedPlaneVertex(const UARMergedPlaneComponent* Component, int32 Index)
+{
+	const PlaneMeshBuilder::FPlaneMeshBuffers& Buffers = Component->GetBuffers();
+	FARMergedPlaneVertex Vertex;
+	Vertex.Position = Buffers.Vertices[Index];
+	Vertex.Normal = Buffers.Normals[Index];
+	Vertex.UV0 = Buffers.UVs[Index];
+	Vertex.UV1 = Component->GetUV1s()[Index];
+	// Like UProceduralMeshComponent, without a gamma conversion.
+	Vertex.Color = Buffers.VertexColors[Index].ToFColor(false);
+	return Vertex;
+}
+
+// Copies one range of a vertex buffer's CPU data to the GPU.
+static void UploadVertexRange(FVertexBufferRHIParamRef VertexBufferRHI, const void* Data, uint32 Stride, int32 FirstVertex, int32 NumVertices)
+{
+	const uint32 Offset = FirstVertex * Stride;
+	const uint32 Size = NumVertices * Stride;
+	void* LockedData = RHILockVertexBuffer(VertexBufferRHI, Offset, Size, RLM_WriteOnly);
+	FMemory::Memcpy(LockedData, static_cast<const uint8*>(Data) + Offset, Size);
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+}
+
+class FARMergedPlaneSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+	FARMergedPlaneSceneProxy(UARMergedPlaneComponent* Component)
+		: FPrimitiveSceneProxy(Component)
+		, VertexFactory(GetScene().GetFeatureLevel(), "FARMergedPlaneSceneProxy")
+		, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+	{
+		Material = Component->GetMaterial(0);
+		if (Material == nullptr)
+		{
+			Material = UMaterial::GetDefaultMaterial(MD_Surface);
+		}
+
+		const PlaneMeshBuilder::FPlaneMeshBuffers& Buffers = Component->GetBuffers();
+		NumVertices = Buffers.Vertices.Num();
+		NumIndices = Buffers.Indices.Num();
+		if (NumVertices == 0 || NumIndices == 0)
+		{
+			return;
+		}
+
+		TArray<FDynamicMeshVertex> Vertices;
+		Vertices.SetNumUninitialized(NumVertices);
+		for (int32 Index = 0; Index < NumVertices; Index++)
+		{
+			const FARMergedPlaneVertex Vertex = GetMergedPlaneVertex(Component, Index);
+			FVector TangentX;
+			FVector TangentY;
+			Vertex.Normal.FindBestAxisVectors(TangentX, TangentY);
+			Vertices[Index] = FDynamicMeshVertex(Vertex.Position, TangentX, Vertex.Normal, Vertex.UV0, Vertex.Color);
+			Vertices[Index].TextureCoordinate[1] = Vertex.UV1;
+		}
+		VertexBuffers.InitFromDynamicVertex(&VertexFactory, Vertices, 2);
+
+		IndexBuffer.Indices.SetNumUninitialized(NumIndices);
+		FMemory::Memcpy(IndexBuffer.Indices.GetData(), Buffers.Indices.GetData(), NumIndices * sizeof(uint32));
+
+		BeginInitResource(&VertexBuffers.PositionVertexBuffer);
+		BeginInitResource(&VertexBuffers.StaticMeshVertexBuffer);
+		BeginInitResource(&VertexBuffers.ColorVertexBuffer);
+		BeginInitResource(&IndexBuffer);
+		BeginInitResource(&VertexFactory);
+	}
+
+	virtual ~FARMergedPlaneSceneProxy()
+	{
+		VertexBuffers.PositionVertexBuffer.ReleaseResource();
+		VertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
+		VertexBuffers.ColorVertexBuffer.ReleaseResource();
+		IndexBuffer.ReleaseResource();
+		VertexFactory.ReleaseResource();
+	}
+
+	/** Writes the dirty ranges into the vertex buffers and uploads only those ranges. */
+	void SetDynamicData_RenderThread(FARMergedPlaneDynamicData* NewData)
+	{
+		check(IsInRenderingThread());
+		if (NumIndices == 0)
+		{
+			delete NewData;
+			return;
+		}
+
+		FPositionVertexBuffer& PositionBuffer = VertexBuffers.PositionVertexBuffer;
+		FStaticMeshVertexBuffer& StaticMeshBuffer = VertexBuffers.StaticMeshVertexBuffer;
+		FColorVertexBuffer& ColorBuffer = VertexBuffers.ColorVertexBuffer;
+		const uint32 TangentStride = StaticMeshBuffer.GetTangentSize() / StaticMeshBuffer.GetNumVertices();
+		const uint32 TexCoordStride = StaticMeshBuffer.GetTexCoordSize() / StaticMeshBuffer.GetNumVertices();
+
+		const FARMergedPlaneVertex* Vertex = NewData->Vertices.GetData();
+		for (const UARMergedPlaneComponent::FVertexRange& Range : NewData->Ranges)
+		{
+			check(Range.FirstVertex + Range.NumVertices <= NumVertices);
+			for (int32 Index = Range.FirstVertex; Index < Range.FirstVertex + Range.NumVertices; Index++, Vertex++)
+			{
+				FVector TangentX;
+				FVector TangentY;
+				Vertex->Normal.FindBestAxisVectors(TangentX, TangentY);
+				PositionBuffer.VertexPosition(Index) = Vertex->Position;
+				StaticMeshBuffer.SetVertexTangents(Index, TangentX, TangentY, Vertex->Normal);
+				StaticMeshBuffer.SetVertexUV(Index, 0, Vertex->UV0);
+				StaticMeshBuffer.SetVertexUV(Index, 1, Vertex->UV1);
+				ColorBuffer.VertexColor(Index) = Vertex->Color;
+			}
+
+			UploadVertexRange(PositionBuffer.VertexBufferRHI, PositionBuffer.GetVertexData(), PositionBuffer.GetStride(), Range.FirstVertex, Range.NumVertices);
+			UploadVertexRange(StaticMeshBuffer.TangentsVertexBuffer.VertexBufferRHI, StaticMeshBuffer.GetTangentData(), TangentStride, Range.FirstVertex, Range.NumVertices);
+			UploadVertexRange(StaticMeshBuffer.TexCoordVertexBuffer.VertexBufferRHI, StaticMeshBuffer.GetTexCoordData(), TexCoordStride, Range.FirstVertex, Range.NumVertices);
+			UploadVertexRange(ColorBuffer.VertexBufferRHI, ColorBuffer.GetVertexData(), ColorBuffer.GetStride(), Range.FirstVertex, Range.NumVertices);
+		}
+
+		delete NewData;
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		if (NumIndices == 0)
+		{
+			return;
+		}
+
+		const FMaterialRenderProxy* MaterialProxy = Material->GetRenderProxy(false);
+
+		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+		{
+			if ((VisibilityMap & (1 << ViewIndex)) == 0)
+			{
+				continue;
+			}
+
+			FMeshBatch& Mesh = Collector.AllocateMesh();
+			Mesh.VertexFactory = &VertexFactory;
+			Mesh.MaterialRenderProxy = MaterialProxy;
+			Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+			Mesh.Type = PT_TriangleList;
+			Mesh.DepthPriorityGroup = SDPG_World;
+			Mesh.bCanApplyViewModeOverrides = false;
+
+			FMeshBatchElement& BatchElement = Mesh.Elements[0];
+			BatchElement.IndexBuffer = &IndexBuffer;
+			BatchElement.FirstIndex = 0;
+			BatchElement.NumPrimitives = NumIndices / 3;
+			BatchElement.MinVertexIndex = 0;
+			BatchElement.MaxVertexIndex = NumVertices - 1;
+			BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
+
+			Collector.AddMesh(ViewIndex, Mesh);
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View);
+		Result.bShadowRelevance = IsShadowCast(View);
+		Result.bDynamicRelevance = true;
+		Result.bRenderInMainPass = ShouldRenderInMainPass();
+		Result.bRenderCustomDepth = ShouldRenderCustomDepth();
+		MaterialRelevance.SetPrimitiveViewRelevance(Result);
+		return Result;
+	}
+
+	virtual bool CanBeOccluded() const override
+	{
+		return !MaterialRelevance.bDisableDepthTest;
+	}
+
+	virtual uint32 GetMemoryFootprint() const override
+	{
+		return sizeof(*this) + GetAllocatedSize();
+	}
+
+	uint32 GetAllocatedSize() const
+	{
+		return FPrimitiveSceneProxy::GetAllocatedSize() + IndexBuffer.Indices.GetAllocatedSize();
+	}
+
+private:
+	FStaticMeshVertexBuffers VertexBuffers;
+	FDynamicMeshIndexBuffer32 IndexBuffer;
+	FLocalVertexFactory VertexFactory;
+	int32 NumVertices;
+	int32 NumIndices;
+
+	UMaterialInterface* Material;
+	FMaterialRelevance MaterialRelevance;
+};
+
+UARMergedPlaneComponent::UARMergedPlaneComponent()
+	: MeshBounds(ForceInit)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	CastShadow = false;
+	bUseAsOccluder = false;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+}
+
+void UARMergedPlaneComponent::MarkVerticesDirty(int32 FirstVertex, int32 NumVertices)
+{
+	check(FirstVertex >= 0 && FirstVertex + NumVertices <= Buffers.Vertices.Num());
+	if (NumVertices <= 0)
+	{
+		return;
+	}
+
+	FVertexRange& Range = DirtyRanges[DirtyRanges.AddUninitialized()];
+	Range.FirstVertex = FirstVertex;
+	Range.NumVertices = NumVertices;
+
+	const FBox OldBounds = MeshBounds;
+	for (int32 Index = FirstVertex; Index < FirstVertex + NumVertices; Index++)
+	{
+		MeshBounds += Buffers.Vertices[Index];
+	}
+	if (!(MeshBounds == OldBounds))
+	{
+		UpdateBounds();
+		MarkRenderTransformDirty();
+	}
+	MarkRenderDynamicDataDirty();
+}
+
+void UARMergedPlaneComponent::MarkLayoutDirty()
+{
+	DirtyRanges.Reset();
+	MeshBounds.Init();
+	for (const FVector& Vertex : Buffers.Vertices)
+	{
+		MeshBounds += Vertex;
+	}
+	UpdateBounds();
+	MarkRenderStateDirty();
+}
+
+FPrimitiveSceneProxy* UARMergedPlaneComponent::CreateSceneProxy()
+{
+	// The new proxy is built from the whole mesh.
+	DirtyRanges.Reset();
+	return new FARMergedPlaneSceneProxy(this);
+}
+
+int32 UARMergedPlaneComponent::GetNumMaterials() const
+{
+	return 1;
+}
+
+FBoxSphereBounds UARMergedPlaneComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	// The mesh is in world space already.
+	if (!MeshBounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
+	}
+	return FBoxSphereBounds(MeshBounds);
+}
+
+void UARMergedPlaneComponent::SendRenderDynamicData_Concurrent()
+{
+	Super::SendRenderDynamicData_Concurrent();
+
+	if (SceneProxy == nullptr || DirtyRanges.Num() == 0)
+	{
+		DirtyRanges.Reset();
+		return;
+	}
+
+	// Merge overlapping and adjacent ranges, so that every vertex is sent
+	// and locked once, and neighbouring slots share one lock.
+	DirtyRanges.Sort([](const FVertexRange& A, const FVertexRange& B)
+	{
+		return A.FirstVertex < B.FirstVertex;
+	});
+
+	FARMergedPlaneDynamicData* NewData = new FARMergedPlaneDynamicData;
+	for (const FVertexRange& Range : DirtyRanges)
+	{
+		FVertexRange* Last = NewData->Ranges.Num() > 0 ? &NewData->Ranges.Last() : nullptr;
+		if (Last != nullptr && Range.FirstVertex <= Last->FirstVertex + Last->NumVertices)
+		{
+			Last->NumVertices = FMath::Max(Last->NumVertices, Range.FirstVertex + Range.NumVertices - Last->FirstVertex);
+		}
+		else
+		{
+			NewData->Ranges.Add(Range);
+		}
+	}
+	DirtyRanges.Reset();
+
+	int32 NumDirtyVertices = 0;
+	for (const FVertexRange& Range : NewData->Ranges)
+	{
+		NumDirtyVertices += Range.NumVertices;
+	}
+	NewData->Vertices.Reserve(NumDirtyVertices);
+	for (const FVertexRange& Range : NewData->Ranges)
+	{
+		for (int32 Index = Range.FirstVertex; Index < Range.FirstVertex + Range.NumVertices; Index++)
+		{
+			NewData->Vertices.Add(GetMergedPlaneVertex(this, Index));
+		}
+	}
+
+	FARMergedPlaneSceneProxy* MergedPlaneSceneProxy = static_cast<FARMergedPlaneSceneProxy*>(SceneProxy);
+	ENQUEUE_RENDER_COMMAND(FSendARMergedPlaneDynamicData)(
+		[MergedPlaneSceneProxy, NewData](FRHICommandListImmediate& RHICmdList)
+		{
+			MergedPlaneSceneProxy->SetDynamicData_RenderThread(NewData);
+		});
+}
@@ -0,0 +1,88 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/MeshComponent.h"
+#include "PlaneMeshBuilder.h"
+
+#include "ARMergedPlaneComponent.generated.h"
+
+/**
+ * Draws the merged plane mesh of AARPlaneRenderer in world space, with UV1
+ * next to the buffers of PlaneMeshBuilder.
+ *
+ * The owner writes the mesh directly into GetBuffers() and GetUV1s() and
+ * then marks what it changed. Vertices marked with MarkVerticesDirty() are
+ * sent to the render thread once per frame, and only those ranges of the
+ * GPU vertex buffers are locked and rewritten. MarkLayoutDirty() recreates
+ * the buffers for a new vertex count or new triangles.
+ */
+UCLASS(ClassGroup = Rendering)
+class CLOUDARPINSAMPLE_API UARMergedPlaneComponent : public UMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	UARMergedPlaneComponent();
+
+	/** The mesh in world space. Mark any change with MarkVerticesDirty() or MarkLayoutDirty(). */
+	PlaneMeshBuilder::FPlaneMeshBuffers& GetBuffers() { return Buffers; }
+	const PlaneMeshBuilder::FPlaneMeshBuffers& GetBuffers() const { return Buffers; }
+
+	/** The second texture coordinate of every vertex, next to GetBuffers(). */
+	TArray<FVector2D>& GetUV1s() { return UV1s; }
+	const TArray<FVector2D>& GetUV1s() const { return UV1s; }
+
+	/** Uploads vertices [FirstVertex, FirstVertex + NumVertices) at the end of the frame. */
+	void MarkVerticesDirty(int32 FirstVertex, int32 NumVertices);
+
+	/** Recreates the GPU buffers from the whole mesh at the end of the frame. */
+	void MarkLayoutDirty();
+
+	//~ Begin UPrimitiveComponent Interface.
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual int32 GetNumMaterials() const override;
+	//~ End UPrimitiveComponent Interface.
+
+	//~ Begin USceneComponent Interface.
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	//~ End USceneComponent Interface.
+
+	/** A range of vertices to upload. */
+	struct FVertexRange
+	{
+		int32 FirstVertex;
+		int32 NumVertices;
+	};
+
+protected:
+	//~ Begin UActorComponent Interface.
+	virtual void SendRenderDynamicData_Concurrent() override;
+	//~ End UActorComponent Interface.
+
+private:
+	PlaneMeshBuilder::FPlaneMeshBuffers Buffers;
+	TArray<FVector2D> UV1s;
+
+	/** Ranges marked since the vertices were last sent, in no particular order. */
+	TArray<FVertexRange> DirtyRanges;
+
+	/**
+	 * World space bounds of the vertices. Dirty ranges only grow them; they
+	 * are recomputed when the layout changes.
+	 */
+	FBox MeshBounds;
+};
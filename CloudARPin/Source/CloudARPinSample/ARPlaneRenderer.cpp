@@ -13,8 +13,39 @@
 // limitations under the License.
 
 #include "ARPlaneRenderer.h"
+#include "ARMergedPlaneComponent.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "ARBlueprintLibrary.h"
+#include "ARTrackableNotifyComponent.h"
+#include "Misc/Crc.h"
+#include "Engine/Engine.h"
+#include "Engine/GameViewportClient.h"
+#include "Kismet/GameplayStatics.h"
+#include "Camera/PlayerCameraManager.h"
+#include "CloudARPinSample.h"
+#include "DynamicMeshBuilder.h"
+
+DECLARE_CYCLE_STAT(TEXT("Plane Renderer Tick"), STAT_PlaneRendererTick, STATGROUP_CloudARPinSample);
+DECLARE_CYCLE_STAT(TEXT("Plane Renderer Rebuild"), STAT_PlaneRendererRebuild, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Planes Visited"), STAT_PlanesVisited, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Planes Skipped"), STAT_PlanesSkipped, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Planes Updated"), STAT_PlanesUpdated, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Planes Rebuilt"), STAT_PlanesRebuilt, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Vertices Generated"), STAT_PlaneVerticesGenerated, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Indices Generated"), STAT_PlaneIndicesGenerated, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Bytes Allocated"), STAT_PlaneBytesAllocated, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Rebuilds Pending"), STAT_NumPendingPlaneRebuilds, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Rebuild Staleness (frames)"), STAT_MaxPlaneRebuildStaleness, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Rebuilds Forced"), STAT_NumPlaneRebuildsForced, STATGROUP_CloudARPinSample);
+
+// Merged plane slots hold a multiple of this many boundary vertices, so
+// that a growing boundary does not need a new slot every few frames.
+static const int32 MergedSlotGranularity = 8;
+
+// Free merged slots are compacted away once they hold more than this share
+// of the merged vertices, and at least MinMergedCompactionVertices.
+static const float MaxMergedSlotWaste = 0.5f;
+static const int32 MinMergedCompactionVertices = 1024;
 
 // Sets default values
 AARPlaneRenderer::AARPlaneRenderer()
@@ -22,6 +53,43 @@ AARPlaneRenderer::AARPlaneRenderer()
 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 	EdgeFeatheringDistance = 10.0f;
+	BoundaryChangeTolerance = 0.5f;
+	PlanePoolWarmSize = 8;
+	PlanePoolMaxSize = 32;
+	NumPlanePoolHits = 0;
+	NumPlanePoolMisses = 0;
+	NumPlaneObjectsRecycled = 0;
+	NumPlaneObjectBytesRecycled = 0;
+	bSimplifyBoundaries = false;
+	BoundaryPixelTolerance = 2.0f;
+	MinSimplifyTolerance = 0.5f;
+	NumSourceBoundaryVertices = 0;
+	NumDrawnBoundaryVertices = 0;
+	NumSourcePlaneTriangles = 0;
+	NumDrawnPlaneTriangles = 0;
+	bHasViewpoint = false;
+	ViewLocation = FVector::ZeroVector;
+	ViewDirection = FVector::ForwardVector;
+	SimplificationWorldUnitsPerPixel = 0.0f;
+	RebuildBudgetMs = 0.0f;
+	MaxRebuildDeferFrames = 8;
+	NumPendingPlaneRebuilds = 0;
+	MaxPlaneRebuildStaleness = 0;
+	NumPlaneRebuildsForced = 0;
+	PlaneRebuildTimeMs = 0.0f;
+	RebuildFrame = 0;
+	bUseTrackableNotifications = false;
+	TrackableNotifyComponent = nullptr;
+	NumLivePlanes = 0;
+	NumChangedPlanes = 0;
+	bMergePlanes = false;
+	MergedPlaneMaterial = nullptr;
+	MergedMeshComponent = nullptr;
+	NumFreeMergedVertices = 0;
+	bMergedLayoutDirty = false;
+	NumPlanesSkipped = 0;
+	NumPlanesUpdated = 0;
+	NumPlanesRebuilt = 0;
 	NewPlaneIndex = 0.0f;
 }
 
@@ -29,26 +97,130 @@ AARPlaneRenderer::AARPlaneRenderer()
 void AARPlaneRenderer::BeginPlay()
 {
 	Super::BeginPlay();
+
+	if (bMergePlanes)
+	{
+		// The merged mesh is in world space.
+		MergedMeshComponent = NewObject<UARMergedPlaneComponent>(this);
+		MergedMeshComponent->RegisterComponent();
+		MergedMeshComponent->SetWorldTransform(FTransform::Identity);
+		MergedMeshComponent->SetMaterial(0, MergedPlaneMaterial != nullptr ? MergedPlaneMaterial : PlaneMaterial);
+	}
+	else
+	{
+		const int32 WarmSize = FMath::Min(PlanePoolWarmSize, PlanePoolMaxSize);
+		while (PlaneComponentPool.Num() < WarmSize)
+		{
+			PlaneComponentPool.Add(CreatePlaneComponent());
+		}
+	}
+
+	if (bUseTrackableNotifications)
+	{
+		TrackableNotifyComponent = NewObject<UARTrackableNotifyComponent>(this);
+		TrackableNotifyComponent->OnAddTrackedPlane.AddDynamic(this, &AARPlaneRenderer::OnTrackedPlaneAdded);
+		TrackableNotifyComponent->OnUpdateTrackedPlane.AddDynamic(this, &AARPlaneRenderer::OnTrackedPlaneUpdated);
+		TrackableNotifyComponent->OnRemoveTrackedPlane.AddDynamic(this, &AARPlaneRenderer::OnTrackedPlaneRemoved);
+		TrackableNotifyComponent->RegisterComponent();
+
+		// Planes found before this actor was spawned were announced already.
+		for (UARTrackedGeometry* Geometry : UARBlueprintLibrary::GetAllGeometries())
+		{
+			if (UARPlaneGeometry* PlaneGeometry = Cast<UARPlaneGeometry>(Geometry))
+			{
+				OnTrackedPlaneAdded(PlaneGeometry);
+			}
+		}
+	}
 }
 
 // Called every frame
 void AARPlaneRenderer::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	CLOUDARPIN_SCOPED_STAT(PlaneRendererTick);
+#if CLOUDARPIN_STATS_ENABLED
+	const SIZE_T BufferBytes = GetMeshBufferBytes();
+#endif
+	NumPlanesSkipped = 0;
+	NumPlanesUpdated = 0;
+	NumPlanesRebuilt = 0;
+	NumSourceBoundaryVertices = 0;
+	NumDrawnBoundaryVertices = 0;
+	NumSourcePlaneTriangles = 0;
+	NumDrawnPlaneTriangles = 0;
+	UpdateViewpoint();
+	NumChangedPlanes = 0;
 	if (UARBlueprintLibrary::GetTrackingQuality() == EARTrackingQuality::OrientationAndPosition)
 	{
-		TArray<UARTrackedGeometry*> AllGeometries = UARBlueprintLibrary::GetAllGeometries();
-		for (UARTrackedGeometry* Geometry : AllGeometries)
+		if (TrackableNotifyComponent != nullptr)
 		{
-			if (Geometry->IsA(UARPlaneGeometry::StaticClass()))
+			// Only planes the AR system reported since the last frame; the
+			// others have not changed. Without tracking they stay queued.
+			for (UARPlaneGeometry* PlaneGeometry : ChangedPlanes)
 			{
-				UARPlaneGeometry* PlaneGeometry = Cast<UARPlaneGeometry>(Geometry);
-				UpdatePlane(PlaneGeometry);
+				UpdateChangedPlane(PlaneGeometry);
 			}
+			NumChangedPlanes = ChangedPlanes.Num();
+			ChangedPlanes.Reset();
 		}
+		else
+		{
+			TArray<UARTrackedGeometry*> AllGeometries = UARBlueprintLibrary::GetAllGeometries();
+			for (UARTrackedGeometry* Geometry : AllGeometries)
+			{
+				if (Geometry->IsA(UARPlaneGeometry::StaticClass()))
+				{
+					UpdateChangedPlane(Cast<UARPlaneGeometry>(Geometry));
+					NumChangedPlanes++;
+				}
+			}
+		}
+	}
+	NumLivePlanes = TrackableNotifyComponent != nullptr ? LivePlanes.Num() : PlaneMeshMap.Num() + MergedPlanes.Num();
+
+	ProcessPendingRebuilds();
+
+	if (MergedMeshComponent != nullptr)
+	{
+		UpdateMergedMesh();
+	}
+
+#if CLOUDARPIN_STATS_ENABLED
+	// The build buffers never shrink, so any growth was allocated this frame.
+	const SIZE_T NewBufferBytes = GetMeshBufferBytes();
+	CLOUDARPIN_INC_STAT(PlaneBytesAllocated, NewBufferBytes > BufferBytes ? NewBufferBytes - BufferBytes : 0);
+	CLOUDARPIN_SET_STAT(PlanesVisited, NumChangedPlanes);
+	CLOUDARPIN_SET_STAT(PlanesSkipped, NumPlanesSkipped);
+	CLOUDARPIN_SET_STAT(PlanesUpdated, NumPlanesUpdated);
+	CLOUDARPIN_SET_STAT(PlanesRebuilt, NumPlanesRebuilt);
+#endif
+}
+
+void AARPlaneRenderer::UpdateChangedPlane(UARPlaneGeometry* PlaneGeometry)
+{
+	if (MergedMeshComponent != nullptr)
+	{
+		UpdateMergedPlane(PlaneGeometry);
+	}
+	else
+	{
+		UpdatePlane(PlaneGeometry);
 	}
 }
 
+FColor AARPlaneRenderer::GetNextPlaneColor()
+{
+	FColor Color = FColor::White;
+	if (PlaneColors.Num() != 0)
+	{
+		int ColorIndex = NewPlaneIndex % PlaneColors.Num();
+		Color = PlaneColors[ColorIndex];
+	}
+	NewPlaneIndex++;
+	return Color;
+}
+
 void AARPlaneRenderer::UpdatePlane(UARPlaneGeometry* ARCorePlaneObject)
 {
 	UProceduralMeshComponent* PlanePolygonMeshComponent = nullptr;
@@ -59,23 +231,15 @@ void AARPlaneRenderer::UpdatePlane(UARPlaneGeometry* ARCorePlaneObject)
 			return;
 		}
 
-		PlanePolygonMeshComponent = NewObject<UProceduralMeshComponent>(this);
-		PlanePolygonMeshComponent->RegisterComponent();
-		PlanePolygonMeshComponent->AttachToComponent(this->GetRootComponent(), FAttachmentTransformRules::KeepWorldTransform);
+		PlanePolygonMeshComponent = AcquirePlaneComponent();
 
-		UMaterialInstanceDynamic* DynMaterial = UMaterialInstanceDynamic::Create(PlaneMaterial, this);
-		FColor Color = FColor::White;
-		if (PlaneColors.Num() != 0)
-		{
-			int ColorIndex = NewPlaneIndex % PlaneColors.Num();
-			Color = PlaneColors[ColorIndex];
-		}
+		UMaterialInstanceDynamic* DynMaterial = Cast<UMaterialInstanceDynamic>(PlanePolygonMeshComponent->GetMaterial(0));
+		FColor Color = GetNextPlaneColor();
 		DynMaterial->SetScalarParameterValue(FName(TEXT("TextureRotationAngle")), FMath::FRandRange(0.0f, 1.0f));
 		DynMaterial->SetVectorParameterValue(FName(TEXT("PlaneTint")), FLinearColor(Color));
 
-		PlanePolygonMeshComponent->SetMaterial(0, DynMaterial);
 		PlaneMeshMap.Add(ARCorePlaneObject, PlanePolygonMeshComponent);
-		NewPlaneIndex++;
+		PlaneMeshStates.Add(ARCorePlaneObject);
 	}
 	else
 	{
@@ -89,7 +253,7 @@ void AARPlaneRenderer::UpdatePlane(UARPlaneGeometry* ARCorePlaneObject)
 		{
 			PlanePolygonMeshComponent->SetVisibility(true, true);
 		}
-		UpdatePlaneMesh(ARCorePlaneObject, PlanePolygonMeshComponent);
+		UpdatePlaneMesh(ARCorePlaneObject, PlanePolygonMeshComponent, PlaneMeshStates.FindOrAdd(ARCorePlaneObject));
 	}
 	else if (PlanePolygonMeshComponent->bVisible)
 	{
@@ -98,98 +262,649 @@ void AARPlaneRenderer::UpdatePlane(UARPlaneGeometry* ARCorePlaneObject)
 	
 	if(ARCorePlaneObject->GetSubsumedBy() != nullptr || ARCorePlaneObject->GetTrackingState() == EARTrackingState::StoppedTracking)
 	{
-		PlanePolygonMeshComponent = *PlaneMeshMap.Find(ARCorePlaneObject);
-		if(PlanePolygonMeshComponent != nullptr)
+		RemovePlane(ARCorePlaneObject);
+	}
+}
+
+void AARPlaneRenderer::RemovePlane(UARPlaneGeometry* ARCorePlaneObject)
+{
+	if (UProceduralMeshComponent** PlanePolygonMeshComponent = PlaneMeshMap.Find(ARCorePlaneObject))
+	{
+		ReleasePlaneComponent(*PlanePolygonMeshComponent);
+		CancelRebuild(ARCorePlaneObject, *PlaneMeshStates.Find(ARCorePlaneObject));
+		PlaneMeshMap.Remove(ARCorePlaneObject);
+		PlaneMeshStates.Remove(ARCorePlaneObject);
+	}
+
+	if (FMergedPlane* MergedPlane = MergedPlanes.Find(ARCorePlaneObject))
+	{
+		if (MergedPlane->SlotIndex != INDEX_NONE)
 		{
-			PlanePolygonMeshComponent->DestroyComponent(true);
-			PlaneMeshMap.Remove(ARCorePlaneObject);
+			FreeMergedSlot(MergedPlane->SlotIndex);
 		}
+		CancelRebuild(ARCorePlaneObject, MergedPlane->MeshState);
+		MergedPlanes.Remove(ARCorePlaneObject);
+		MergedPlaneObjects.Remove(ARCorePlaneObject);
 	}
 }
 
-void AARPlaneRenderer::UpdatePlaneMesh(UARPlaneGeometry* ARCorePlaneObject, UProceduralMeshComponent* PlanePolygonMeshComponent)
+void AARPlaneRenderer::OnTrackedPlaneAdded(UARPlaneGeometry* ARCorePlaneObject)
 {
-	// Update polygon mesh vertex indices, using triangle fan due to its convex.
-	TArray<FVector> BoundaryVertices;
-	BoundaryVertices = ARCorePlaneObject->GetBoundaryPolygonInLocalSpace();
+	LivePlanes.Add(ARCorePlaneObject);
+	ChangedPlanes.Add(ARCorePlaneObject);
+}
+
+void AARPlaneRenderer::OnTrackedPlaneUpdated(UARPlaneGeometry* ARCorePlaneObject)
+{
+	// Updates can arrive for planes that were added before this actor subscribed.
+	LivePlanes.Add(ARCorePlaneObject);
+	ChangedPlanes.Add(ARCorePlaneObject);
+}
+
+void AARPlaneRenderer::OnTrackedPlaneRemoved(UARPlaneGeometry* ARCorePlaneObject)
+{
+	LivePlanes.Remove(ARCorePlaneObject);
+	ChangedPlanes.Remove(ARCorePlaneObject);
+	RemovePlane(ARCorePlaneObject);
+}
+
+UProceduralMeshComponent* AARPlaneRenderer::CreatePlaneComponent()
+{
+	UProceduralMeshComponent* PlanePolygonMeshComponent = NewObject<UProceduralMeshComponent>(this);
+	PlanePolygonMeshComponent->RegisterComponent();
+	PlanePolygonMeshComponent->AttachToComponent(this->GetRootComponent(), FAttachmentTransformRules::KeepWorldTransform);
+	PlanePolygonMeshComponent->SetVisibility(false, true);
+
+	UMaterialInstanceDynamic* DynMaterial = UMaterialInstanceDynamic::Create(PlaneMaterial, this);
+	PlanePolygonMeshComponent->SetMaterial(0, DynMaterial);
+	return PlanePolygonMeshComponent;
+}
+
+UProceduralMeshComponent* AARPlaneRenderer::AcquirePlaneComponent()
+{
+	UProceduralMeshComponent* PlanePolygonMeshComponent = nullptr;
+	if (PlaneComponentPool.Num() > 0)
+	{
+		PlanePolygonMeshComponent = PlaneComponentPool.Pop(false);
+		NumPlanePoolHits++;
+		CountRecycledPlaneObjects(PlanePolygonMeshComponent);
+	}
+	else
+	{
+		PlanePolygonMeshComponent = CreatePlaneComponent();
+		NumPlanePoolMisses++;
+		CLOUDARPIN_INC_STAT(PlaneBytesAllocated, PlanePolygonMeshComponent->GetClass()->GetStructureSize() + UMaterialInstanceDynamic::StaticClass()->GetStructureSize());
+	}
+
+	// Pooled components are hidden; UpdatePlane() shows them once the plane is tracking.
+	return PlanePolygonMeshComponent;
+}
+
+void AARPlaneRenderer::ReleasePlaneComponent(UProceduralMeshComponent* PlanePolygonMeshComponent)
+{
+	if (PlaneComponentPool.Num() >= PlanePoolMaxSize)
+	{
+		PlanePolygonMeshComponent->DestroyComponent(true);
+		return;
+	}
+
+	// Keep the component registered and its material instance assigned; only drop the mesh.
+	PlanePolygonMeshComponent->ClearAllMeshSections();
+	if (PlanePolygonMeshComponent->bVisible)
+	{
+		PlanePolygonMeshComponent->SetVisibility(false, true);
+	}
+	PlaneComponentPool.Add(PlanePolygonMeshComponent);
+	CountRecycledPlaneObjects(PlanePolygonMeshComponent);
+}
+
+void AARPlaneRenderer::CountRecycledPlaneObjects(UProceduralMeshComponent* PlanePolygonMeshComponent)
+{
+	NumPlaneObjectsRecycled += 2;
+	NumPlaneObjectBytesRecycled += PlanePolygonMeshComponent->GetClass()->GetStructureSize();
+	if (UMaterialInterface* Material = PlanePolygonMeshComponent->GetMaterial(0))
+	{
+		NumPlaneObjectBytesRecycled += Material->GetClass()->GetStructureSize();
+	}
+}
+
+void AARPlaneRenderer::UpdatePlaneMesh(UARPlaneGeometry* ARCorePlaneObject, UProceduralMeshComponent* PlanePolygonMeshComponent, FPlaneMeshState& MeshState)
+{
+	// The mesh is built in plane space, so a plane that only moved needs a new transform and nothing else.
+	PlanePolygonMeshComponent->SetWorldTransform(ARCorePlaneObject->GetLocalToWorldTransform());
+
+	uint32 BoundaryHash = 0;
+	const TArray<FVector>& BoundaryVertices = GetDrawnBoundary(ARCorePlaneObject, MeshState, BoundaryHash);
+
+	if (IsBoundaryUnchanged(BoundaryVertices, BoundaryHash, MeshState))
+	{
+		// A plane that changed back while waiting does not need its rebuild any more.
+		CancelRebuild(ARCorePlaneObject, MeshState);
+		NumPlanesSkipped++;
+		return;
+	}
+
+	QueueRebuild(ARCorePlaneObject, MeshState, BoundaryVertices, BoundaryHash);
+}
+
+void AARPlaneRenderer::RebuildPlaneMesh(UProceduralMeshComponent* PlanePolygonMeshComponent, FPlaneMeshState& MeshState)
+{
+	const bool bTopologyChanged = MeshState.PendingBoundaryVertices.Num() != MeshState.BoundaryVertices.Num();
+	Exchange(MeshState.BoundaryVertices, MeshState.PendingBoundaryVertices);
+	MeshState.BoundaryHash = MeshState.PendingBoundaryHash;
+	MeshState.EdgeFeatheringDistance = EdgeFeatheringDistance;
+	MeshState.PendingSinceFrame = INDEX_NONE;
+
+	const TArray<FVector>& BoundaryVertices = MeshState.BoundaryVertices;
 	int BoundaryVerticesNum = BoundaryVertices.Num();
 
 	if (BoundaryVerticesNum < 3)
 	{
 		PlanePolygonMeshComponent->ClearMeshSection(0);
+		NumPlanesRebuilt++;
+		return;
+	}
+
+	if (!bTopologyChanged && PlanePolygonMeshComponent->GetNumSections() > 0)
+	{
+		// Same vertex count means the same triangles; only positions and UVs move.
+		PlaneMeshBuilder::BuildVertices(BoundaryVertices, EdgeFeatheringDistance, MeshBuffers);
+		PlanePolygonMeshComponent->UpdateMeshSection_LinearColor(0, MeshBuffers.Vertices, TArray<FVector>(), MeshBuffers.UVs, TArray<FLinearColor>(), TArray<FProcMeshTangent>());
+		CLOUDARPIN_INC_STAT(PlaneVerticesGenerated, MeshBuffers.Vertices.Num());
+		NumPlanesUpdated++;
+		return;
+	}
+
+	// The mesh is in plane space, where the plane normal is always up.
+	PlaneMeshBuilder::Build(BoundaryVertices, EdgeFeatheringDistance, FVector::UpVector, MeshBuffers);
+
+	// No need to fill tangents.
+	PlanePolygonMeshComponent->CreateMeshSection_LinearColor(0, MeshBuffers.Vertices, MeshBuffers.Indices, MeshBuffers.Normals, MeshBuffers.UVs, MeshBuffers.VertexColors, TArray<FProcMeshTangent>(), false);
+	CLOUDARPIN_INC_STAT(PlaneVerticesGenerated, MeshBuffers.Vertices.Num());
+	CLOUDARPIN_INC_STAT(PlaneIndicesGenerated, MeshBuffers.Indices.Num());
+	CLOUDARPIN_INC_STAT(PlaneBytesAllocated, MeshBuffers.Vertices.Num() * sizeof(FProcMeshVertex) + MeshBuffers.Indices.Num() * sizeof(uint32));
+	NumPlanesRebuilt++;
+}
+
+void AARPlaneRenderer::QueueRebuild(UARPlaneGeometry* ARCorePlaneObject, FPlaneMeshState& MeshState, const TArray<FVector>& BoundaryVertices, uint32 BoundaryHash)
+{
+	// A plane that changes again while waiting keeps its place and only gets the newer boundary.
+	MeshState.PendingBoundaryVertices = BoundaryVertices;
+	MeshState.PendingBoundaryHash = BoundaryHash;
+	if (MeshState.PendingSinceFrame == INDEX_NONE)
+	{
+		MeshState.PendingSinceFrame = RebuildFrame;
+		PendingRebuildPlanes.Add(ARCorePlaneObject);
+	}
+}
+
+void AARPlaneRenderer::CancelRebuild(UARPlaneGeometry* ARCorePlaneObject, FPlaneMeshState& MeshState)
+{
+	if (MeshState.PendingSinceFrame != INDEX_NONE)
+	{
+		PendingRebuildPlanes.RemoveSingleSwap(ARCorePlaneObject, false);
+		MeshState.PendingSinceFrame = INDEX_NONE;
+	}
+}
+
+void AARPlaneRenderer::ProcessPendingRebuilds()
+{
+	CLOUDARPIN_SCOPED_STAT(PlaneRendererRebuild);
+	NumPlaneRebuildsForced = 0;
+	MaxPlaneRebuildStaleness = 0;
+	PlaneRebuildTimeMs = 0.0f;
+
+	RebuildQueue.Reset(PendingRebuildPlanes.Num());
+	for (UARPlaneGeometry* ARCorePlaneObject : PendingRebuildPlanes)
+	{
+		const FPlaneMeshState& MeshState = MergedMeshComponent != nullptr
+			? MergedPlanes.Find(ARCorePlaneObject)->MeshState
+			: *PlaneMeshStates.Find(ARCorePlaneObject);
+
+		FPendingRebuild PendingRebuild;
+		PendingRebuild.Plane = ARCorePlaneObject;
+		PendingRebuild.FramesWaiting = RebuildFrame - MeshState.PendingSinceFrame;
+		PendingRebuild.Distance = GetPlaneViewDistance(ARCorePlaneObject, PendingRebuild.bInView);
+		RebuildQueue.Add(PendingRebuild);
+		MaxPlaneRebuildStaleness = FMath::Max(MaxPlaneRebuildStaleness, PendingRebuild.FramesWaiting);
+	}
+	PendingRebuildPlanes.Reset();
+
+	// Planes that waited too long come first, then planes in view, then the
+	// nearest ones; waiting makes a plane count as nearer.
+	const int32 MaxFramesWaiting = MaxRebuildDeferFrames;
+	auto HasPriority = [MaxFramesWaiting](const FPendingRebuild& A, const FPendingRebuild& B)
+	{
+		const bool bAStarved = A.FramesWaiting >= MaxFramesWaiting;
+		const bool bBStarved = B.FramesWaiting >= MaxFramesWaiting;
+		if (bAStarved != bBStarved)
+		{
+			return bAStarved;
+		}
+		if (A.bInView != B.bInView)
+		{
+			return A.bInView;
+		}
+		return A.Distance / (1 + A.FramesWaiting) < B.Distance / (1 + B.FramesWaiting);
+	};
+	RebuildQueue.Heapify(HasPriority);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double BudgetSeconds = RebuildBudgetMs * 0.001;
+	while (RebuildQueue.Num() > 0)
+	{
+		FPendingRebuild PendingRebuild;
+		RebuildQueue.HeapPop(PendingRebuild, HasPriority, false);
+
+		const bool bStarved = PendingRebuild.FramesWaiting >= MaxRebuildDeferFrames;
+		const bool bOverBudget = BudgetSeconds > 0.0 && FPlatformTime::Seconds() - StartTime >= BudgetSeconds;
+		if (bOverBudget && !bStarved)
+		{
+			// Starved planes come first, so none of the rest has to be rebuilt now.
+			PendingRebuildPlanes.Add(PendingRebuild.Plane);
+			for (const FPendingRebuild& Deferred : RebuildQueue)
+			{
+				PendingRebuildPlanes.Add(Deferred.Plane);
+			}
+			RebuildQueue.Reset();
+			break;
+		}
+		if (bOverBudget)
+		{
+			NumPlaneRebuildsForced++;
+		}
+
+		if (MergedMeshComponent != nullptr)
+		{
+			RebuildMergedPlane(*MergedPlanes.Find(PendingRebuild.Plane));
+		}
+		else
+		{
+			RebuildPlaneMesh(*PlaneMeshMap.Find(PendingRebuild.Plane), *PlaneMeshStates.Find(PendingRebuild.Plane));
+		}
+	}
+
+	RebuildFrame++;
+	NumPendingPlaneRebuilds = PendingRebuildPlanes.Num();
+	PlaneRebuildTimeMs = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	CLOUDARPIN_SET_STAT(NumPendingPlaneRebuilds, NumPendingPlaneRebuilds);
+	CLOUDARPIN_SET_STAT(MaxPlaneRebuildStaleness, MaxPlaneRebuildStaleness);
+	CLOUDARPIN_SET_STAT(NumPlaneRebuildsForced, NumPlaneRebuildsForced);
+}
+
+void AARPlaneRenderer::UpdateViewpoint()
+{
+	bHasViewpoint = false;
+	SimplificationWorldUnitsPerPixel = 0.0f;
+
+	APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0);
+	if (CameraManager == nullptr)
+	{
 		return;
 	}
+	bHasViewpoint = true;
+	ViewLocation = CameraManager->GetCameraLocation();
+	ViewDirection = CameraManager->GetCameraRotation().Vector();
 
-	int PolygonMeshVerticesNum = BoundaryVerticesNum * 2;
-	// Triangle number is interior(n-2 for convex polygon) plus perimeter (EdgeNum * 2);
-	int TriangleNum = BoundaryVerticesNum - 2 + BoundaryVerticesNum * 2;
+	if (bSimplifyBoundaries)
+	{
+		FVector2D ViewportSize(1920.0f, 1080.0f);
+		if (GEngine->GameViewport != nullptr)
+		{
+			GEngine->GameViewport->GetViewportSize(ViewportSize);
+		}
+		SimplificationWorldUnitsPerPixel = PlaneBoundarySimplifier::GetWorldUnitsPerPixel(CameraManager->GetFOVAngle(), ViewportSize.X);
+	}
+}
 
-	TArray<FVector> PolygonMeshVertices;
-	TArray<FLinearColor> PolygonMeshVertexColors;
-	TArray<int> PolygonMeshIndices;
-	TArray<FVector> PolygonMeshNormals;
-	TArray<FVector2D> PolygonMeshUVs;
+float AARPlaneRenderer::GetPlaneViewDistance(UARPlaneGeometry* ARCorePlaneObject, bool& bOutInView) const
+{
+	bOutInView = true;
+	if (!bHasViewpoint)
+	{
+		return 0.0f;
+	}
 
-	PolygonMeshVertices.Empty(PolygonMeshVerticesNum);
-	PolygonMeshVertexColors.Empty(PolygonMeshVerticesNum);
-	PolygonMeshIndices.Empty(TriangleNum * 3);
-	PolygonMeshNormals.Empty(PolygonMeshVerticesNum);
+	// Measure to the nearest point the plane could have, so that a large
+	// plane the camera stands on counts as near, and as in view if any of
+	// it can be in front of the camera.
+	const FVector ToPlane = ARCorePlaneObject->GetLocalToWorldTransform().GetLocation() - ViewLocation;
+	const float Extent = ARCorePlaneObject->GetExtent().Size();
+	bOutInView = FVector::DotProduct(ToPlane, ViewDirection) > -Extent;
+	return FMath::Max(ToPlane.Size() - Extent, 0.0f);
+}
+
+const TArray<FVector>& AARPlaneRenderer::GetDrawnBoundary(UARPlaneGeometry* ARCorePlaneObject, FPlaneMeshState& MeshState, uint32& OutBoundaryHash)
+{
+	// GetBoundaryPolygonInLocalSpace() returns a copy; keep it alive for the caller.
+	MeshState.SourceBoundaryVertices = ARCorePlaneObject->GetBoundaryPolygonInLocalSpace();
+	const TArray<FVector>& SourceBoundary = MeshState.SourceBoundaryVertices;
+	const uint32 SourceHash = FCrc::MemCrc32(SourceBoundary.GetData(), SourceBoundary.Num() * sizeof(FVector));
 
-	FVector PlaneNormal = ARCorePlaneObject->GetLocalToWorldTransform().GetRotation().GetUpVector();
-	for (int i = 0; i < BoundaryVerticesNum; i++)
+	int32 LOD = 0;
+	if (SimplificationWorldUnitsPerPixel > 0.0f)
 	{
-		FVector BoundaryPoint = BoundaryVertices[i];
-		float BoundaryToCenterDist = BoundaryPoint.Size();
-		float FeatheringDist = FMath::Min(BoundaryToCenterDist, EdgeFeatheringDistance);
-		FVector InteriorPoint = BoundaryPoint - BoundaryPoint.GetUnsafeNormal() * FeatheringDist;
+		bool bInView = false;
+		const float Distance = GetPlaneViewDistance(ARCorePlaneObject, bInView);
+		LOD = PlaneBoundarySimplifier::GetLOD(Distance, SimplificationWorldUnitsPerPixel, BoundaryPixelTolerance, MinSimplifyTolerance,
+			MeshState.SimplifiedBoundary.LastLOD);
+	}
 
-		PolygonMeshVertices.Add(BoundaryPoint);
-		PolygonMeshVertices.Add(InteriorPoint);
+	const TArray<FVector>& DrawnBoundary = PlaneBoundarySimplifier::GetBoundary(
+		MeshState.SimplifiedBoundary, SourceBoundary, SourceHash, LOD, MinSimplifyTolerance, SimplificationScratch);
+	OutBoundaryHash = &DrawnBoundary == &SourceBoundary
+		? SourceHash
+		: FCrc::MemCrc32(DrawnBoundary.GetData(), DrawnBoundary.Num() * sizeof(FVector));
 
-		PolygonMeshUVs.Add(FVector2D(BoundaryPoint.X, BoundaryPoint.Y));
-		PolygonMeshUVs.Add(FVector2D(InteriorPoint.X, InteriorPoint.Y));
+	NumSourceBoundaryVertices += SourceBoundary.Num();
+	NumDrawnBoundaryVertices += DrawnBoundary.Num();
+	NumSourcePlaneTriangles += PlaneMeshBuilder::GetNumIndices(SourceBoundary.Num()) / 3;
+	NumDrawnPlaneTriangles += PlaneMeshBuilder::GetNumIndices(DrawnBoundary.Num()) / 3;
+	return DrawnBoundary;
+}
 
-		PolygonMeshNormals.Add(PlaneNormal);
-		PolygonMeshNormals.Add(PlaneNormal);
+bool AARPlaneRenderer::IsBoundaryUnchanged(const TArray<FVector>& BoundaryVertices, uint32 BoundaryHash, const FPlaneMeshState& MeshState) const
+{
+	if (BoundaryVertices.Num() != MeshState.BoundaryVertices.Num() || EdgeFeatheringDistance != MeshState.EdgeFeatheringDistance)
+	{
+		return false;
+	}
+	if (BoundaryHash == MeshState.BoundaryHash)
+	{
+		return true;
+	}
 
-		PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 0.f));
-		PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 1.f));
+	// The boundary jitters slightly from frame to frame; ignore moves below the tolerance.
+	const float ToleranceSquared = BoundaryChangeTolerance * BoundaryChangeTolerance;
+	for (int i = 0; i < BoundaryVertices.Num(); i++)
+	{
+		if (FVector::DistSquared(BoundaryVertices[i], MeshState.BoundaryVertices[i]) > ToleranceSquared)
+		{
+			return false;
+		}
 	}
+	return true;
+}
 
-	// Generate triangle indices
+void AARPlaneRenderer::UpdateMergedPlane(UARPlaneGeometry* ARCorePlaneObject)
+{
+	const bool bRemoved = ARCorePlaneObject->GetSubsumedBy() != nullptr || ARCorePlaneObject->GetTrackingState() == EARTrackingState::StoppedTracking;
 
-	// Perimeter triangles
-	for (int i = 0; i < BoundaryVerticesNum - 1; i++)
+	FMergedPlane* MergedPlane = MergedPlanes.Find(ARCorePlaneObject);
+	if (MergedPlane == nullptr)
 	{
-		PolygonMeshIndices.Add(i * 2);
-		PolygonMeshIndices.Add(i * 2 + 2);
-		PolygonMeshIndices.Add(i * 2 + 1);
+		if (bRemoved)
+		{
+			return;
+		}
+
+		MergedPlane = &MergedPlanes.Add(ARCorePlaneObject);
+		MergedPlaneObjects.Add(ARCorePlaneObject);
+		MergedPlane->Tint = FLinearColor(GetNextPlaneColor());
+		MergedPlane->TextureRotationAngle = FMath::FRandRange(0.0f, 1.0f);
+	}
 
-		PolygonMeshIndices.Add(i * 2 + 1);
-		PolygonMeshIndices.Add(i * 2 + 2);
-		PolygonMeshIndices.Add(i * 2 + 3);
+	if (bRemoved)
+	{
+		RemovePlane(ARCorePlaneObject);
+		return;
 	}
 
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2);
-	PolygonMeshIndices.Add(0);
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
+	uint32 BoundaryHash = 0;
+	const TArray<FVector>& BoundaryVertices = GetDrawnBoundary(ARCorePlaneObject, MergedPlane->MeshState, BoundaryHash);
+	if (ARCorePlaneObject->GetTrackingState() != EARTrackingState::Tracking || BoundaryVertices.Num() < 3)
+	{
+		CancelRebuild(ARCorePlaneObject, MergedPlane->MeshState);
+		if (MergedPlane->bVisible)
+		{
+			CollapseMergedSlot(MergedPlane->SlotIndex);
+			MergedPlane->bVisible = false;
+		}
+		return;
+	}
 
+	// The merged mesh is in world space, so a plane that moved has to be rewritten as well.
+	const FTransform LocalToWorld = ARCorePlaneObject->GetLocalToWorldTransform();
+	if (MergedPlane->bVisible
+		&& LocalToWorld.Equals(MergedPlane->LocalToWorld)
+		&& IsBoundaryUnchanged(BoundaryVertices, BoundaryHash, MergedPlane->MeshState))
+	{
+		CancelRebuild(ARCorePlaneObject, MergedPlane->MeshState);
+		NumPlanesSkipped++;
+		return;
+	}
 
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
-	PolygonMeshIndices.Add(0);
-	PolygonMeshIndices.Add(1);
+	MergedPlane->PendingLocalToWorld = LocalToWorld;
+	QueueRebuild(ARCorePlaneObject, MergedPlane->MeshState, BoundaryVertices, BoundaryHash);
+}
 
-	// interior triangles
-	for (int i = 3; i < PolygonMeshVerticesNum - 1; i += 2)
+void AARPlaneRenderer::RebuildMergedPlane(FMergedPlane& MergedPlane)
+{
+	FPlaneMeshState& MeshState = MergedPlane.MeshState;
+	const int32 NumBoundaryVertices = MeshState.PendingBoundaryVertices.Num();
+	if (MergedPlane.SlotIndex == INDEX_NONE || MergedSlots[MergedPlane.SlotIndex].Capacity < NumBoundaryVertices)
 	{
-		PolygonMeshIndices.Add(1);
-		PolygonMeshIndices.Add(i);
-		PolygonMeshIndices.Add(i + 2);
+		if (MergedPlane.SlotIndex != INDEX_NONE)
+		{
+			FreeMergedSlot(MergedPlane.SlotIndex);
+		}
+		MergedPlane.SlotIndex = AllocateMergedSlot(NumBoundaryVertices);
+		NumPlanesRebuilt++;
+	}
+	else
+	{
+		NumPlanesUpdated++;
 	}
 
-	// No need to fill uv and tangent;
-	PlanePolygonMeshComponent->CreateMeshSection_LinearColor(0, PolygonMeshVertices, PolygonMeshIndices, PolygonMeshNormals, PolygonMeshUVs, PolygonMeshVertexColors, TArray<FProcMeshTangent>(), false);
+	Exchange(MeshState.BoundaryVertices, MeshState.PendingBoundaryVertices);
+	MeshState.BoundaryHash = MeshState.PendingBoundaryHash;
+	MeshState.EdgeFeatheringDistance = EdgeFeatheringDistance;
+	MeshState.PendingSinceFrame = INDEX_NONE;
+	MergedPlane.LocalToWorld = MergedPlane.PendingLocalToWorld;
+	MergedPlane.bVisible = true;
+	WriteMergedPlane(MergedPlane, MeshState.BoundaryVertices);
+}
 
-	// Set the component transform to Plane's transform.
-	PlanePolygonMeshComponent->SetWorldTransform(ARCorePlaneObject->GetLocalToWorldTransform());
+void AARPlaneRenderer::UpdateMergedMesh()
+{
+	const int32 NumMergedVertices = MergedMeshComponent->GetBuffers().Vertices.Num();
+	if (NumFreeMergedVertices >= MinMergedCompactionVertices && NumFreeMergedVertices > NumMergedVertices * MaxMergedSlotWaste)
+	{
+		CompactMergedSlots();
+	}
+
+	// Changed vertices were marked as they were written, and the component
+	// uploads only those ranges. New triangles recreate its buffers.
+	if (bMergedLayoutDirty)
+	{
+		const PlaneMeshBuilder::FPlaneMeshBuffers& MergedBuffers = MergedMeshComponent->GetBuffers();
+		MergedMeshComponent->MarkLayoutDirty();
+		CLOUDARPIN_INC_STAT(PlaneBytesAllocated, MergedBuffers.Vertices.Num() * sizeof(FDynamicMeshVertex) + MergedBuffers.Indices.Num() * sizeof(uint32));
+		bMergedLayoutDirty = false;
+	}
+}
+
+int32 AARPlaneRenderer::AllocateMergedSlot(int32 NumBoundaryVertices)
+{
+	const int32 Capacity = Align(NumBoundaryVertices, MergedSlotGranularity);
+
+	// Reuse the smallest free slot that fits, unless it would waste more than half of it.
+	int32 BestFreeIndex = INDEX_NONE;
+	for (int32 FreeIndex = 0; FreeIndex < FreeMergedSlots.Num(); FreeIndex++)
+	{
+		const int32 FreeCapacity = MergedSlots[FreeMergedSlots[FreeIndex]].Capacity;
+		if (FreeCapacity >= NumBoundaryVertices && FreeCapacity <= Capacity * 2
+			&& (BestFreeIndex == INDEX_NONE || FreeCapacity < MergedSlots[FreeMergedSlots[BestFreeIndex]].Capacity))
+		{
+			BestFreeIndex = FreeIndex;
+		}
+	}
+	if (BestFreeIndex != INDEX_NONE)
+	{
+		const int32 SlotIndex = FreeMergedSlots[BestFreeIndex];
+		FreeMergedSlots.RemoveAtSwap(BestFreeIndex);
+		NumFreeMergedVertices -= PlaneMeshBuilder::GetNumVertices(MergedSlots[SlotIndex].Capacity);
+		return SlotIndex;
+	}
+
+	// Append a new slot. Its triangles are written once here and only
+	// change when the slots are compacted.
+	PlaneMeshBuilder::FPlaneMeshBuffers& MergedBuffers = MergedMeshComponent->GetBuffers();
+	TArray<FVector2D>& MergedUV1s = MergedMeshComponent->GetUV1s();
+	FMergedPlaneSlot Slot;
+	Slot.FirstVertex = MergedBuffers.Vertices.Num();
+	Slot.Capacity = Capacity;
+
+	const int32 NumVertices = PlaneMeshBuilder::GetNumVertices(Capacity);
+	MergedBuffers.Vertices.AddUninitialized(NumVertices);
+	MergedBuffers.UVs.AddUninitialized(NumVertices);
+	MergedBuffers.VertexColors.AddUninitialized(NumVertices);
+	MergedBuffers.Normals.AddUninitialized(NumVertices);
+	MergedUV1s.AddUninitialized(NumVertices);
+
+	const int32 NumIndices = PlaneMeshBuilder::GetNumIndices(Capacity);
+	const int32 FirstIndex = MergedBuffers.Indices.AddUninitialized(NumIndices);
+	int32* Indices = MergedBuffers.Indices.GetData() + FirstIndex;
+	PlaneMeshBuilder::WriteIndices(Capacity, Indices);
+	for (int32 Index = 0; Index < NumIndices; Index++)
+	{
+		Indices[Index] += Slot.FirstVertex;
+	}
+	CLOUDARPIN_INC_STAT(PlaneIndicesGenerated, NumIndices);
+
+	bMergedLayoutDirty = true;
+	return MergedSlots.Add(Slot);
+}
+
+void AARPlaneRenderer::FreeMergedSlot(int32 SlotIndex)
+{
+	CollapseMergedSlot(SlotIndex);
+	FreeMergedSlots.Add(SlotIndex);
+	NumFreeMergedVertices += PlaneMeshBuilder::GetNumVertices(MergedSlots[SlotIndex].Capacity);
 }
+
+void AARPlaneRenderer::WriteMergedPlane(const FMergedPlane& MergedPlane, const TArray<FVector>& BoundaryVertices)
+{
+	const FMergedPlaneSlot& Slot = MergedSlots[MergedPlane.SlotIndex];
+	const int32 NumBoundaryVertices = BoundaryVertices.Num();
+	PlaneMeshBuilder::FPlaneMeshBuffers& MergedBuffers = MergedMeshComponent->GetBuffers();
+
+	// Pad the boundary to the slot capacity by repeating its last vertex.
+	PaddedBoundaryVertices.SetNumUninitialized(Slot.Capacity, false);
+	FMemory::Memcpy(PaddedBoundaryVertices.GetData(), BoundaryVertices.GetData(), NumBoundaryVertices * sizeof(FVector));
+	for (int32 Index = NumBoundaryVertices; Index < Slot.Capacity; Index++)
+	{
+		PaddedBoundaryVertices[Index] = BoundaryVertices[NumBoundaryVertices - 1];
+	}
+
+	FVector* Vertices = MergedBuffers.Vertices.GetData() + Slot.FirstVertex;
+	FLinearColor* VertexColors = MergedBuffers.VertexColors.GetData() + Slot.FirstVertex;
+	FVector2D* UV1s = MergedMeshComponent->GetUV1s().GetData() + Slot.FirstVertex;
+	PlaneMeshBuilder::WriteVertices(PaddedBoundaryVertices.GetData(), Slot.Capacity, EdgeFeatheringDistance, Vertices, MergedBuffers.UVs.GetData() + Slot.FirstVertex);
+	PlaneMeshBuilder::WriteVertexColors(Slot.Capacity, VertexColors);
+	PlaneMeshBuilder::WriteNormals(Slot.Capacity, MergedPlane.LocalToWorld.GetRotation().GetUpVector(), MergedBuffers.Normals.GetData() + Slot.FirstVertex);
+
+	// UV0 stays in plane space so that the texture does not swim as the plane moves.
+	const FVector2D UV1(MergedPlane.TextureRotationAngle, 0.0f);
+	const int32 NumVertices = PlaneMeshBuilder::GetNumVertices(Slot.Capacity);
+	for (int32 Index = 0; Index < NumVertices; Index++)
+	{
+		Vertices[Index] = MergedPlane.LocalToWorld.TransformPosition(Vertices[Index]);
+		VertexColors[Index] = FLinearColor(MergedPlane.Tint.R, MergedPlane.Tint.G, MergedPlane.Tint.B, VertexColors[Index].A);
+		UV1s[Index] = UV1;
+	}
+	CLOUDARPIN_INC_STAT(PlaneVerticesGenerated, NumVertices);
+
+	MergedMeshComponent->MarkVerticesDirty(Slot.FirstVertex, NumVertices);
+}
+
+void AARPlaneRenderer::CollapseMergedSlot(int32 SlotIndex)
+{
+	// Moving all vertices onto one point hides the slot without touching its triangles.
+	const FMergedPlaneSlot& Slot = MergedSlots[SlotIndex];
+	FVector* Vertices = MergedMeshComponent->GetBuffers().Vertices.GetData() + Slot.FirstVertex;
+	const int32 NumVertices = PlaneMeshBuilder::GetNumVertices(Slot.Capacity);
+	for (int32 Index = 1; Index < NumVertices; Index++)
+	{
+		Vertices[Index] = Vertices[0];
+	}
+	MergedMeshComponent->MarkVerticesDirty(Slot.FirstVertex, NumVertices);
+}
+
+void AARPlaneRenderer::CompactMergedSlots()
+{
+	PlaneMeshBuilder::FPlaneMeshBuffers& MergedBuffers = MergedMeshComponent->GetBuffers();
+	TArray<FVector2D>& MergedUV1s = MergedMeshComponent->GetUV1s();
+
+	TArray<int32> NewSlotIndices;
+	NewSlotIndices.Init(0, MergedSlots.Num());
+	for (int32 SlotIndex : FreeMergedSlots)
+	{
+		NewSlotIndices[SlotIndex] = INDEX_NONE;
+	}
+
+	// The used slots keep their order, so every slot moves towards the
+	// front and never onto data that has not been moved yet.
+	int32 NumSlots = 0;
+	int32 NumVertices = 0;
+	int32 NumIndices = 0;
+	for (int32 SlotIndex = 0; SlotIndex < MergedSlots.Num(); SlotIndex++)
+	{
+		if (NewSlotIndices[SlotIndex] == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FMergedPlaneSlot Slot = MergedSlots[SlotIndex];
+		const int32 SlotVertices = PlaneMeshBuilder::GetNumVertices(Slot.Capacity);
+		const int32 SlotIndices = PlaneMeshBuilder::GetNumIndices(Slot.Capacity);
+		if (Slot.FirstVertex != NumVertices)
+		{
+			FMemory::Memmove(&MergedBuffers.Vertices[NumVertices], &MergedBuffers.Vertices[Slot.FirstVertex], SlotVertices * sizeof(FVector));
+			FMemory::Memmove(&MergedBuffers.UVs[NumVertices], &MergedBuffers.UVs[Slot.FirstVertex], SlotVertices * sizeof(FVector2D));
+			FMemory::Memmove(&MergedBuffers.VertexColors[NumVertices], &MergedBuffers.VertexColors[Slot.FirstVertex], SlotVertices * sizeof(FLinearColor));
+			FMemory::Memmove(&MergedBuffers.Normals[NumVertices], &MergedBuffers.Normals[Slot.FirstVertex], SlotVertices * sizeof(FVector));
+			FMemory::Memmove(&MergedUV1s[NumVertices], &MergedUV1s[Slot.FirstVertex], SlotVertices * sizeof(FVector2D));
+			Slot.FirstVertex = NumVertices;
+		}
+
+		int32* Indices = MergedBuffers.Indices.GetData() + NumIndices;
+		PlaneMeshBuilder::WriteIndices(Slot.Capacity, Indices);
+		for (int32 Index = 0; Index < SlotIndices; Index++)
+		{
+			Indices[Index] += Slot.FirstVertex;
+		}
+
+		NewSlotIndices[SlotIndex] = NumSlots;
+		MergedSlots[NumSlots++] = Slot;
+		NumVertices += SlotVertices;
+		NumIndices += SlotIndices;
+	}
+
+	MergedSlots.SetNum(NumSlots, false);
+	MergedBuffers.Vertices.SetNum(NumVertices, false);
+	MergedBuffers.UVs.SetNum(NumVertices, false);
+	MergedBuffers.VertexColors.SetNum(NumVertices, false);
+	MergedBuffers.Normals.SetNum(NumVertices, false);
+	MergedBuffers.Indices.SetNum(NumIndices, false);
+	MergedUV1s.SetNum(NumVertices, false);
+	FreeMergedSlots.Reset();
+	NumFreeMergedVertices = 0;
+
+	for (TPair<UARPlaneGeometry*, FMergedPlane>& MergedPlane : MergedPlanes)
+	{
+		if (MergedPlane.Value.SlotIndex != INDEX_NONE)
+		{
+			MergedPlane.Value.SlotIndex = NewSlotIndices[MergedPlane.Value.SlotIndex];
+		}
+	}
+
+	bMergedLayoutDirty = true;
+}
+
+SIZE_T AARPlaneRenderer::GetMeshBufferBytes() const
+{
+	return MeshBuffers.GetAllocatedSize()
+		+ (MergedMeshComponent != nullptr ? MergedMeshComponent->GetBuffers().GetAllocatedSize() : 0);
+}
+
@@ -17,6 +17,8 @@
 #include "ProceduralMeshComponent.h"
 #include "GameFramework/Actor.h"
 #include "ARTrackable.h"
+#include "PlaneBoundarySimplifier.h"
+#include "PlaneMeshBuilder.h"
 
 #include "ARPlaneRenderer.generated.h"
 
@@ -47,13 +49,289 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FColor> PlaneColors;
 
+	/** Boundary vertices that moved less than this, in cm, do not update the plane mesh. */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadWrite)
+	float BoundaryChangeTolerance;
+
+	/**
+	 * Only update the planes the AR system reported as added, updated or
+	 * removed since the last frame, instead of going through all tracked
+	 * geometry every frame. Set before play.
+	 *
+	 * A plane keeps its boundary LOD until its next update.
+	 */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadOnly)
+	bool bUseTrackableNotifications;
+
+	/** Planes tracked at the end of the last frame. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumLivePlanes;
+
+	/** Planes looked at in the last frame: the changed ones, or all of them without bUseTrackableNotifications. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumChangedPlanes;
+
+	/**
+	 * Draw all planes with one component and one draw call instead of a
+	 * component and material instance per plane. Set before play.
+	 *
+	 * The planes are baked into a single world space mesh, so the plane
+	 * tint moves into the vertex color RGB (the edge fade stays in alpha)
+	 * and the texture rotation into UV1.x. MergedPlaneMaterial must read
+	 * them from there instead of the PlaneTint and TextureRotationAngle
+	 * parameters.
+	 */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadOnly)
+	bool bMergePlanes;
+
+	/** The material for merged planes, see bMergePlanes. */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bMergePlanes"))
+	UMaterialInterface* MergedPlaneMaterial;
+
+	/** Hidden plane components, each with its material instance, created in BeginPlay so that the first planes do not create any. */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "0"))
+	int32 PlanePoolWarmSize;
+
+	/** The most hidden plane components kept for reuse. Components released beyond it are destroyed. */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "0"))
+	int32 PlanePoolMaxSize;
+
+	/** New planes that got a pooled component. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPlanePoolHits;
+
+	/** New planes that had to create a component and material instance because the pool was empty. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPlanePoolMisses;
+
+	/** Objects neither created nor left for garbage collection thanks to the pool: two per hit and two per pooled release. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPlaneObjectsRecycled;
+
+	/** The UObject memory of the recycled objects, in bytes. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int64 NumPlaneObjectBytesRecycled;
+
+	/**
+	 * Simplify plane boundaries before meshing them, more coarsely the
+	 * farther a plane is from the camera. See BoundaryPixelTolerance.
+	 */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadWrite)
+	bool bSimplifyBoundaries;
+
+	/** The most a simplified boundary may deviate from the real one, in screen pixels. */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bSimplifyBoundaries", ClampMin = "0"))
+	float BoundaryPixelTolerance;
+
+	/** Boundaries are not simplified where BoundaryPixelTolerance is less than this many cm. */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bSimplifyBoundaries", ClampMin = "0.01"))
+	float MinSimplifyTolerance;
+
+	/** Boundary vertices of the planes drawn in the last frame, before simplification. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumSourceBoundaryVertices;
+
+	/** Boundary vertices of the planes drawn in the last frame, after simplification. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumDrawnBoundaryVertices;
+
+	/** Triangles the planes drawn in the last frame would have without simplification. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumSourcePlaneTriangles;
+
+	/** Triangles of the planes drawn in the last frame. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumDrawnPlaneTriangles;
+
+	/**
+	 * The most time to spend rebuilding plane meshes per frame, in
+	 * milliseconds. Rebuilds that do not fit wait for a later frame, planes
+	 * in view and near the camera first. 0 rebuilds every changed plane in
+	 * the frame it changed.
+	 */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float RebuildBudgetMs;
+
+	/** A plane waits for at most this many frames for its rebuild, whatever the budget. */
+	UPROPERTY(Category = ARPlaneRenderer, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	int32 MaxRebuildDeferFrames;
+
+	/** Planes still waiting for a rebuild after the last frame. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPendingPlaneRebuilds;
+
+	/** The most frames a plane rebuilt or still waiting in the last frame has waited. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 MaxPlaneRebuildStaleness;
+
+	/** Planes rebuilt in the last frame over the budget because they had waited MaxRebuildDeferFrames. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPlaneRebuildsForced;
+
+	/** Time spent rebuilding plane meshes in the last frame, in milliseconds. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	float PlaneRebuildTimeMs;
+
+	/** Planes whose boundary did not change in the last frame; only their transform was updated. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPlanesSkipped;
+
+	/** Planes whose boundary vertices moved in the last frame, updated in place. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPlanesUpdated;
+
+	/** Planes whose boundary vertex count changed in the last frame, rebuilt from scratch. */
+	UPROPERTY(Category = ARPlaneRenderer, VisibleInstanceOnly, BlueprintReadOnly, Transient)
+	int32 NumPlanesRebuilt;
 
 private:
+	/** The boundary a plane mesh was last built from. */
+	struct FPlaneMeshState
+	{
+		TArray<FVector> BoundaryVertices;
+		uint32 BoundaryHash = 0;
+		float EdgeFeatheringDistance = 0.0f;
+
+		/** The plane's boundary in the current frame. */
+		TArray<FVector> SourceBoundaryVertices;
+
+		/** The simplified boundary, if bSimplifyBoundaries is set. */
+		PlaneBoundarySimplifier::FCache SimplifiedBoundary;
+
+		/** The boundary waiting for a rebuild, and the frame it started waiting in, or INDEX_NONE. */
+		TArray<FVector> PendingBoundaryVertices;
+		uint32 PendingBoundaryHash = 0;
+		int32 PendingSinceFrame = INDEX_NONE;
+	};
+
+	/** A plane in the rebuild queue, see RebuildBudgetMs. */
+	struct FPendingRebuild
+	{
+		UARPlaneGeometry* Plane;
+		int32 FramesWaiting;
+		float Distance;
+		bool bInView;
+	};
+
+	void UpdateChangedPlane(UARPlaneGeometry* PlaneGeometry);
 	void UpdatePlane(UARPlaneGeometry* ARCorePlaneObject);
-	void UpdatePlaneMesh(UARPlaneGeometry* ARCorePlaneObject, UProceduralMeshComponent* PlanePolygonMeshComponent);
+	void RemovePlane(UARPlaneGeometry* ARCorePlaneObject);
+
+	UFUNCTION()
+	void OnTrackedPlaneAdded(UARPlaneGeometry* ARCorePlaneObject);
+
+	UFUNCTION()
+	void OnTrackedPlaneUpdated(UARPlaneGeometry* ARCorePlaneObject);
+
+	UFUNCTION()
+	void OnTrackedPlaneRemoved(UARPlaneGeometry* ARCorePlaneObject);
+	UProceduralMeshComponent* CreatePlaneComponent();
+	UProceduralMeshComponent* AcquirePlaneComponent();
+	void ReleasePlaneComponent(UProceduralMeshComponent* PlanePolygonMeshComponent);
+	void CountRecycledPlaneObjects(UProceduralMeshComponent* PlanePolygonMeshComponent);
+	void UpdatePlaneMesh(UARPlaneGeometry* ARCorePlaneObject, UProceduralMeshComponent* PlanePolygonMeshComponent, FPlaneMeshState& MeshState);
+	void RebuildPlaneMesh(UProceduralMeshComponent* PlanePolygonMeshComponent, FPlaneMeshState& MeshState);
+	bool IsBoundaryUnchanged(const TArray<FVector>& BoundaryVertices, uint32 BoundaryHash, const FPlaneMeshState& MeshState) const;
+	void QueueRebuild(UARPlaneGeometry* ARCorePlaneObject, FPlaneMeshState& MeshState, const TArray<FVector>& BoundaryVertices, uint32 BoundaryHash);
+	void CancelRebuild(UARPlaneGeometry* ARCorePlaneObject, FPlaneMeshState& MeshState);
+	void ProcessPendingRebuilds();
+	void UpdateViewpoint();
+	float GetPlaneViewDistance(UARPlaneGeometry* ARCorePlaneObject, bool& bOutInView) const;
+	const TArray<FVector>& GetDrawnBoundary(UARPlaneGeometry* ARCorePlaneObject, FPlaneMeshState& MeshState, uint32& OutBoundaryHash);
 
 	UPROPERTY()
 	TMap<UARPlaneGeometry*, UProceduralMeshComponent*> PlaneMeshMap;
 
+	UPROPERTY()
+	class UARTrackableNotifyComponent* TrackableNotifyComponent;
+
+	/** Planes the AR system added and has not removed yet, only kept with bUseTrackableNotifications. */
+	UPROPERTY()
+	TSet<UARPlaneGeometry*> LivePlanes;
+
+	/** Planes added or updated since the last frame. */
+	UPROPERTY()
+	TSet<UARPlaneGeometry*> ChangedPlanes;
+
+	/** Hidden, registered components ready for new planes; each keeps its material instance. */
+	UPROPERTY()
+	TArray<UProceduralMeshComponent*> PlaneComponentPool;
+
+	/** Keyed like PlaneMeshMap, which keeps the planes alive. */
+	TMap<UARPlaneGeometry*, FPlaneMeshState> PlaneMeshStates;
+
 	int NewPlaneIndex;
+
+	/** Reused for every plane. */
+	PlaneMeshBuilder::FPlaneMeshBuffers MeshBuffers;
+
+	// The camera that boundary LODs and rebuild priorities are chosen for, updated every frame.
+	bool bHasViewpoint;
+	FVector ViewLocation;
+	FVector ViewDirection;
+	float SimplificationWorldUnitsPerPixel;
+	PlaneBoundarySimplifier::FScratch SimplificationScratch;
+
+	/** Planes with a PendingSinceFrame, kept alive by PlaneMeshMap or MergedPlaneObjects. */
+	TArray<UARPlaneGeometry*> PendingRebuildPlanes;
+	TArray<FPendingRebuild> RebuildQueue;
+	int32 RebuildFrame;
+
+	/**
+	 * A range of the merged mesh reserved for one plane. The triangles of
+	 * a slot never change: boundaries with fewer vertices than the slot
+	 * capacity repeat their last vertex, which only adds empty triangles.
+	 * So a plane that changes shape within its slot only rewrites and
+	 * uploads its own vertices. Slots only move when free slots are
+	 * compacted away.
+	 */
+	struct FMergedPlaneSlot
+	{
+		int32 FirstVertex;
+		int32 Capacity;
+	};
+
+	struct FMergedPlane
+	{
+		int32 SlotIndex = INDEX_NONE;
+		FLinearColor Tint;
+		float TextureRotationAngle = 0.0f;
+		FPlaneMeshState MeshState;
+		FTransform LocalToWorld;
+		FTransform PendingLocalToWorld;
+		bool bVisible = false;
+	};
+
+	void UpdateMergedPlane(UARPlaneGeometry* ARCorePlaneObject);
+	void RebuildMergedPlane(FMergedPlane& MergedPlane);
+	void UpdateMergedMesh();
+	int32 AllocateMergedSlot(int32 NumBoundaryVertices);
+	void FreeMergedSlot(int32 SlotIndex);
+	void WriteMergedPlane(const FMergedPlane& MergedPlane, const TArray<FVector>& BoundaryVertices);
+	void CollapseMergedSlot(int32 SlotIndex);
+	void CompactMergedSlots();
+	FColor GetNextPlaneColor();
+
+	/** Returns the memory held by the mesh build buffers, in bytes. */
+	SIZE_T GetMeshBufferBytes() const;
+
+	/** Draws the merged mesh and owns its buffers, see UARMergedPlaneComponent. */
+	UPROPERTY()
+	class UARMergedPlaneComponent* MergedMeshComponent;
+
+	/** Keeps the merged planes alive while they are in MergedPlanes. */
+	UPROPERTY()
+	TSet<UARPlaneGeometry*> MergedPlaneObjects;
+
+	TMap<UARPlaneGeometry*, FMergedPlane> MergedPlanes;
+	TArray<FMergedPlaneSlot> MergedSlots;
+	TArray<int32> FreeMergedSlots;
+
+	/** The vertices held by FreeMergedSlots. */
+	int32 NumFreeMergedVertices;
+
+	TArray<FVector> PaddedBoundaryVertices;
+
+	/** Slots were added or compacted, so the triangles changed and the GPU buffers have to be recreated. */
+	bool bMergedLayoutDirty;
 };
@@ -0,0 +1,272 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARPointCloudComponent.h"
+#include "ARPointCloudVertexFactory.h"
+#include "Engine/Engine.h"
+#include "Materials/Material.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+
+static FARPointCloudBatchParameters GetBatchParameters(const UARPointCloudComponent* Component)
+{
+	FARPointCloudBatchParameters BatchParameters;
+	// Like the vertex colors of the CPU-built quads this replaces, the color
+	// reaches the material without a gamma conversion.
+	BatchParameters.PointColor = Component->PointColor.ReinterpretAsLinear();
+	BatchParameters.PointSize = Component->PointSize;
+	return BatchParameters;
+}
+
+class FARPointCloudSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+	FARPointCloudSceneProxy(UARPointCloudComponent* Component, const TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe>& InPoints)
+		: FPrimitiveSceneProxy(Component)
+		, VertexFactory(GetScene().GetFeatureLevel(), &CornerBuffer, &InstanceBuffer)
+		, PendingPoints(InPoints)
+		, BatchParameters(GetBatchParameters(Component))
+		, bIsSupported(GetScene().GetFeatureLevel() >= ERHIFeatureLevel::ES3_1)
+	{
+		// The vertex factory is only compiled for materials used with
+		// particle sprites, and for the default materials.
+		Material = Component->GetMaterial(0);
+		if (Material == nullptr || !Material->CheckMaterialUsage_Concurrent(MATUSAGE_ParticleSprites))
+		{
+			Material = GEngine->VertexColorMaterial;
+			if (!Material->CheckMaterialUsage_Concurrent(MATUSAGE_ParticleSprites))
+			{
+				Material = UMaterial::GetDefaultMaterial(MD_Surface);
+			}
+		}
+		MaterialRelevance = Material->GetRelevance_Concurrent(GetScene().GetFeatureLevel());
+	}
+
+	virtual ~FARPointCloudSceneProxy()
+	{
+		VertexFactory.ReleaseResource();
+		InstanceBuffer.ReleaseResource();
+		IndexBuffer.ReleaseResource();
+		CornerBuffer.ReleaseResource();
+	}
+
+	virtual void CreateRenderThreadResources() override
+	{
+		CornerBuffer.InitResource();
+		IndexBuffer.InitResource();
+		InstanceBuffer.InitResource();
+		VertexFactory.InitResource();
+
+		SetDynamicData_RenderThread(PendingPoints, BatchParameters);
+		PendingPoints.Reset();
+	}
+
+	/** Uploads NewPoints, if set, and takes the new color and size. */
+	void SetDynamicData_RenderThread(const TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe>& NewPoints, const FARPointCloudBatchParameters& NewBatchParameters)
+	{
+		check(IsInRenderingThread());
+		if (NewPoints.IsValid())
+		{
+			InstanceBuffer.Update_RenderThread(*NewPoints);
+		}
+		BatchParameters = NewBatchParameters;
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		if (!bIsSupported || InstanceBuffer.GetNumPoints() == 0)
+		{
+			return;
+		}
+
+		const FMaterialRenderProxy* MaterialProxy = Material->GetRenderProxy(false);
+
+		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+		{
+			if ((VisibilityMap & (1 << ViewIndex)) == 0)
+			{
+				continue;
+			}
+
+			// All points go out as a single batch with one instance per point.
+			FMeshBatch& Mesh = Collector.AllocateMesh();
+			Mesh.VertexFactory = &VertexFactory;
+			Mesh.MaterialRenderProxy = MaterialProxy;
+			Mesh.Type = PT_TriangleList;
+			Mesh.DepthPriorityGroup = SDPG_World;
+			Mesh.bDisableBackfaceCulling = true;
+			Mesh.bCanApplyViewModeOverrides = false;
+
+			FMeshBatchElement& BatchElement = Mesh.Elements[0];
+			BatchElement.IndexBuffer = &IndexBuffer;
+			BatchElement.FirstIndex = 0;
+			BatchElement.NumPrimitives = FARPointCloudIndexBuffer::NumIndices / 3;
+			BatchElement.MinVertexIndex = 0;
+			BatchElement.MaxVertexIndex = 3;
+			BatchElement.NumInstances = InstanceBuffer.GetNumPoints();
+			BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
+			BatchElement.UserData = &BatchParameters;
+
+			Collector.AddMesh(ViewIndex, Mesh);
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View);
+		Result.bShadowRelevance = IsShadowCast(View);
+		Result.bDynamicRelevance = true;
+		Result.bRenderInMainPass = ShouldRenderInMainPass();
+		Result.bRenderCustomDepth = ShouldRenderCustomDepth();
+		MaterialRelevance.SetPrimitiveViewRelevance(Result);
+		return Result;
+	}
+
+	virtual bool CanBeOccluded() const override
+	{
+		return !MaterialRelevance.bDisableDepthTest;
+	}
+
+	virtual uint32 GetMemoryFootprint() const override
+	{
+		return sizeof(*this) + GetAllocatedSize();
+	}
+
+	uint32 GetAllocatedSize() const
+	{
+		return FPrimitiveSceneProxy::GetAllocatedSize();
+	}
+
+private:
+	FARPointCloudCornerVertexBuffer CornerBuffer;
+	FARPointCloudIndexBuffer IndexBuffer;
+	FARPointCloudInstanceBuffer InstanceBuffer;
+	FARPointCloudVertexFactory VertexFactory;
+
+	/** Points to upload once the buffers are created on the render thread. */
+	TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe> PendingPoints;
+
+	FARPointCloudBatchParameters BatchParameters;
+	bool bIsSupported;
+
+	UMaterialInterface* Material;
+	FMaterialRelevance MaterialRelevance;
+};
+
+UARPointCloudComponent::UARPointCloudComponent()
+	: PointColor(FColor::White)
+	, PointSize(5.0f)
+	, bPointsDirty(false)
+	, PointBounds(ForceInit)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	CastShadow = false;
+	bUseAsOccluder = false;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+}
+
+void UARPointCloudComponent::SetPoints(const TArray<FVector4>& InPoints)
+{
+	if (GetNumPoints() == 0 && InPoints.Num() == 0)
+	{
+		return;
+	}
+
+	// The only copy of the points: a new snapshot rather than an update in
+	// place, since the render thread may still be uploading the previous one.
+	FBox Bounds(ForceInit);
+	for (const FVector4& Point : InPoints)
+	{
+		Bounds += FVector(Point);
+	}
+	SetPoints(MakeShared<TArray<FVector4>, ESPMode::ThreadSafe>(InPoints), Bounds);
+}
+
+void UARPointCloudComponent::SetPoints(const TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe>& InPoints, const FBox& InBounds)
+{
+	const int32 NumPoints = InPoints.IsValid() ? InPoints->Num() : 0;
+	if (GetNumPoints() == 0 && NumPoints == 0)
+	{
+		return;
+	}
+
+	Points = InPoints;
+	bPointsDirty = true;
+	PointBounds = NumPoints > 0 ? InBounds : FBox(ForceInit);
+
+	UpdateBounds();
+	MarkRenderTransformDirty();
+	MarkRenderDynamicDataDirty();
+}
+
+void UARPointCloudComponent::SetPointAppearance(FColor InPointColor, float InPointSize)
+{
+	if (PointColor == InPointColor && PointSize == InPointSize)
+	{
+		return;
+	}
+
+	PointColor = InPointColor;
+	PointSize = InPointSize;
+	MarkRenderDynamicDataDirty();
+}
+
+FPrimitiveSceneProxy* UARPointCloudComponent::CreateSceneProxy()
+{
+	bPointsDirty = false;
+	return new FARPointCloudSceneProxy(this, Points);
+}
+
+int32 UARPointCloudComponent::GetNumMaterials() const
+{
+	return 1;
+}
+
+FBoxSphereBounds UARPointCloudComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	// The points are in world space already.
+	if (!PointBounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
+	}
+	return FBoxSphereBounds(PointBounds);
+}
+
+void UARPointCloudComponent::SendRenderDynamicData_Concurrent()
+{
+	Super::SendRenderDynamicData_Concurrent();
+
+	if (SceneProxy == nullptr)
+	{
+		return;
+	}
+
+	// Changing only the color or size leaves the instance buffer alone.
+	TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe> NewPoints;
+	if (bPointsDirty)
+	{
+		NewPoints = Points;
+		bPointsDirty = false;
+	}
+	const FARPointCloudBatchParameters NewBatchParameters = GetBatchParameters(this);
+
+	FARPointCloudSceneProxy* PointCloudSceneProxy = static_cast<FARPointCloudSceneProxy*>(SceneProxy);
+	ENQUEUE_RENDER_COMMAND(FSendARPointCloudDynamicData)(
+		[PointCloudSceneProxy, NewPoints, NewBatchParameters](FRHICommandListImmediate& RHICmdList)
+		{
+			PointCloudSceneProxy->SetDynamicData_RenderThread(NewPoints, NewBatchParameters);
+		});
+}
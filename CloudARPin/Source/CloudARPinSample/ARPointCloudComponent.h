@@ -0,0 +1,98 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/MeshComponent.h"
+
+#include "ARPointCloudComponent.generated.h"
+
+/**
+ * Draws a point cloud as camera-facing quads in a single instanced draw call.
+ *
+ * Points are handed over as one array whenever they change and uploaded once
+ * into a GPU instance buffer; the vertex shader of FARPointCloudVertexFactory
+ * expands every point into a quad sized in screen pixels like
+ * DrawDebugPoint(). The material sees PointColor in Vertex Color with the
+ * point's confidence multiplied into the alpha, and the confidence again in
+ * the first channel of UV1, so it can fade or tint points by confidence.
+ *
+ * A material must be flagged as used with particle sprites; otherwise the
+ * engine's vertex color material is used.
+ */
+UCLASS(ClassGroup = Rendering, meta = (BlueprintSpawnableComponent))
+class CLOUDARPINSAMPLE_API UARPointCloudComponent : public UMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	UARPointCloudComponent();
+
+	/** The color of the points. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer")
+	FColor PointColor;
+
+	/** The size of the points in pixels. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer")
+	float PointSize;
+
+	/**
+	 * Replaces the points drawn by this component. Each element holds a
+	 * world space position in XYZ and the point's confidence in W.
+	 */
+	void SetPoints(const TArray<FVector4>& InPoints);
+
+	/**
+	 * Replaces the points drawn by this component with an array that is
+	 * never modified again, without copying it. InBounds are the world
+	 * space bounds of its positions.
+	 */
+	void SetPoints(const TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe>& InPoints, const FBox& InBounds);
+
+	/** Sets the color and size of the points. Does nothing if neither changed. */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCore|PointCloudRenderer")
+	void SetPointAppearance(FColor InPointColor, float InPointSize);
+
+	/** Returns the number of points currently drawn. */
+	UFUNCTION(BlueprintPure, Category = "GoogleARCore|PointCloudRenderer")
+	int32 GetNumPoints() const { return Points.IsValid() ? Points->Num() : 0; }
+
+	//~ Begin UPrimitiveComponent Interface.
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual int32 GetNumMaterials() const override;
+	//~ End UPrimitiveComponent Interface.
+
+	//~ Begin USceneComponent Interface.
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	//~ End USceneComponent Interface.
+
+protected:
+	//~ Begin UActorComponent Interface.
+	virtual void SendRenderDynamicData_Concurrent() override;
+	//~ End UActorComponent Interface.
+
+private:
+	/**
+	 * World space positions and confidences. Never modified once created, so
+	 * the scene proxy shares it instead of copying it.
+	 */
+	TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe> Points;
+
+	/** Whether Points changed since they were last sent to the scene proxy. */
+	bool bPointsDirty;
+
+	/** World space bounds of Points. */
+	FBox PointBounds;
+};
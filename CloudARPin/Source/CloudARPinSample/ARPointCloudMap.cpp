@@ -0,0 +1,406 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARPointCloudMap.h"
+#include "CloudARPinSample.h"
+#include "Async/Async.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/ScopeLock.h"
+
+DECLARE_CYCLE_STAT(TEXT("Point Cloud Fusion"), STAT_PointCloudFusion, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Cloud Points Fused"), STAT_PointCloudPointsFused, STATGROUP_CloudARPinSample);
+
+// Points with a lower confidence still count a little, so that a voxel
+// seen only by low confidence points is not stuck at zero weight.
+static const float MinPointWeight = 0.05f;
+
+struct FARPointCloudVoxel
+{
+	FIntVector Key;
+	FVector Position;
+	float Weight;
+	double LastSeenTime;
+
+	// Neighbours in the least recently observed list.
+	int32 Newer;
+	int32 Older;
+};
+
+/**
+ * State shared between the map and its fusion task. Only the fusion task
+ * touches the voxels; the game thread sees them through the snapshot.
+ */
+struct FARPointCloudMap::FState
+{
+	FSettings Settings;
+	int32 MaxVoxels = 0;
+
+	/** Points added since the last fusion, guarded by PendingLock. */
+	FCriticalSection PendingLock;
+	TArray<FVector4> PendingPoints;
+	TArray<double> PendingTimes;
+	TArray<int32> PendingFrameEnds;
+
+	/** 1 while a fusion task is scheduled or running. */
+	FThreadSafeCounter FusionScheduled;
+	FThreadSafeCounter ResetRequested;
+
+	FThreadSafeCounter NumEvictedVoxels;
+	FThreadSafeCounter NumDroppedFrames;
+
+	// Owned by the fusion task.
+	TArray<FARPointCloudVoxel> Voxels;
+	TMap<FIntVector, int32> VoxelIndices;
+	int32 Newest = INDEX_NONE;
+	int32 Oldest = INDEX_NONE;
+	TArray<FVector4> FusingPoints;
+	TArray<double> FusingTimes;
+	TArray<int32> FusingFrameEnds;
+
+	/**
+	 * The latest fused points and their bounds, guarded by SnapshotLock. A
+	 * snapshot is never modified once published, so callers share it.
+	 */
+	mutable FCriticalSection SnapshotLock;
+	TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe> Snapshot;
+	FBox SnapshotBounds = FBox(ForceInit);
+	uint32 SnapshotVersion = 0;
+
+	void Unlink(int32 Index)
+	{
+		FARPointCloudVoxel& Voxel = Voxels[Index];
+		if (Voxel.Newer != INDEX_NONE)
+		{
+			Voxels[Voxel.Newer].Older = Voxel.Older;
+		}
+		else
+		{
+			Newest = Voxel.Older;
+		}
+		if (Voxel.Older != INDEX_NONE)
+		{
+			Voxels[Voxel.Older].Newer = Voxel.Newer;
+		}
+		else
+		{
+			Oldest = Voxel.Newer;
+		}
+		Voxel.Newer = INDEX_NONE;
+		Voxel.Older = INDEX_NONE;
+	}
+
+	void LinkAsNewest(int32 Index)
+	{
+		FARPointCloudVoxel& Voxel = Voxels[Index];
+		Voxel.Newer = INDEX_NONE;
+		Voxel.Older = Newest;
+		if (Newest != INDEX_NONE)
+		{
+			Voxels[Newest].Newer = Index;
+		}
+		Newest = Index;
+		if (Oldest == INDEX_NONE)
+		{
+			Oldest = Index;
+		}
+	}
+
+	// Removes a voxel by moving the last voxel into its slot, so that the
+	// voxels stay packed for building the snapshot.
+	void Evict(int32 Index)
+	{
+		Unlink(Index);
+		VoxelIndices.Remove(Voxels[Index].Key);
+
+		const int32 LastIndex = Voxels.Num() - 1;
+		if (Index != LastIndex)
+		{
+			const FARPointCloudVoxel& Moved = Voxels[LastIndex];
+			if (Moved.Newer != INDEX_NONE)
+			{
+				Voxels[Moved.Newer].Older = Index;
+			}
+			else
+			{
+				Newest = Index;
+			}
+			if (Moved.Older != INDEX_NONE)
+			{
+				Voxels[Moved.Older].Newer = Index;
+			}
+			else
+			{
+				Oldest = Index;
+			}
+			VoxelIndices.Add(Moved.Key, Index);
+			Voxels[Index] = Moved;
+		}
+		Voxels.RemoveAt(LastIndex, 1, false);
+		NumEvictedVoxels.Increment();
+	}
+
+	void ClearVoxels()
+	{
+		Voxels.Reset();
+		VoxelIndices.Reset();
+		Newest = INDEX_NONE;
+		Oldest = INDEX_NONE;
+	}
+
+	void FusePoint(const FVector4& Point, double Time)
+	{
+		const FVector Position(Point);
+		const FIntVector Key(
+			FMath::FloorToInt(Position.X / Settings.VoxelSize),
+			FMath::FloorToInt(Position.Y / Settings.VoxelSize),
+			FMath::FloorToInt(Position.Z / Settings.VoxelSize));
+		const float PointWeight = FMath::Max(Point.W, MinPointWeight);
+
+		if (const int32* ExistingIndex = VoxelIndices.Find(Key))
+		{
+			const int32 Index = *ExistingIndex;
+			FARPointCloudVoxel& Voxel = Voxels[Index];
+			Voxel.Position = (Voxel.Position * Voxel.Weight + Position * PointWeight) / (Voxel.Weight + PointWeight);
+			Voxel.Weight = FMath::Min(Voxel.Weight + PointWeight, Settings.SaturationWeight);
+			Voxel.LastSeenTime = Time;
+			if (Index != Newest)
+			{
+				Unlink(Index);
+				LinkAsNewest(Index);
+			}
+			return;
+		}
+
+		if (Voxels.Num() >= MaxVoxels)
+		{
+			Evict(Oldest);
+		}
+
+		const int32 Index = Voxels.AddUninitialized();
+		FARPointCloudVoxel& Voxel = Voxels[Index];
+		Voxel.Key = Key;
+		Voxel.Position = Position;
+		Voxel.Weight = FMath::Min(PointWeight, Settings.SaturationWeight);
+		Voxel.LastSeenTime = Time;
+		LinkAsNewest(Index);
+		VoxelIndices.Add(Key, Index);
+	}
+
+	void EvictExpired(double Time)
+	{
+		if (Settings.MaxAgeSeconds <= 0.0f)
+		{
+			return;
+		}
+		while (Oldest != INDEX_NONE && Time - Voxels[Oldest].LastSeenTime > Settings.MaxAgeSeconds)
+		{
+			Evict(Oldest);
+		}
+	}
+
+	void PublishSnapshot()
+	{
+		// A new array rather than a recycled one, since the renderer and the
+		// render thread may still hold the previous snapshot.
+		TSharedRef<TArray<FVector4>, ESPMode::ThreadSafe> NewSnapshot = MakeShared<TArray<FVector4>, ESPMode::ThreadSafe>();
+		NewSnapshot->Reserve(Voxels.Num());
+		FBox NewBounds(ForceInit);
+		const float InvSaturationWeight = 1.0f / Settings.SaturationWeight;
+		for (const FARPointCloudVoxel& Voxel : Voxels)
+		{
+			NewSnapshot->Emplace(Voxel.Position, Voxel.Weight * InvSaturationWeight);
+			NewBounds += Voxel.Position;
+		}
+
+		FScopeLock ScopeLock(&SnapshotLock);
+		Snapshot = NewSnapshot;
+		SnapshotBounds = NewBounds;
+		SnapshotVersion++;
+	}
+
+	// Fuses queued frames until none are left. Only one fusion task runs at
+	// a time; a frame queued while the task is finishing reschedules it.
+	static void FusePendingPoints(TSharedRef<FState, ESPMode::ThreadSafe> State)
+	{
+		do
+		{
+			while (true)
+			{
+				bool bReset = false;
+				{
+					FScopeLock ScopeLock(&State->PendingLock);
+					Exchange(State->FusingPoints, State->PendingPoints);
+					Exchange(State->FusingTimes, State->PendingTimes);
+					Exchange(State->FusingFrameEnds, State->PendingFrameEnds);
+					bReset = State->ResetRequested.Set(0) != 0;
+				}
+
+				if (bReset)
+				{
+					State->ClearVoxels();
+				}
+				if (State->FusingFrameEnds.Num() == 0)
+				{
+					if (bReset)
+					{
+						State->PublishSnapshot();
+					}
+					break;
+				}
+
+				CLOUDARPIN_SCOPED_STAT(PointCloudFusion);
+				CLOUDARPIN_INC_STAT(PointCloudPointsFused, State->FusingPoints.Num());
+
+				int32 PointIndex = 0;
+				for (int32 FrameIndex = 0; FrameIndex < State->FusingFrameEnds.Num(); FrameIndex++)
+				{
+					const double Time = State->FusingTimes[FrameIndex];
+					for (; PointIndex < State->FusingFrameEnds[FrameIndex]; PointIndex++)
+					{
+						State->FusePoint(State->FusingPoints[PointIndex], Time);
+					}
+					State->EvictExpired(Time);
+				}
+				State->FusingPoints.Reset();
+				State->FusingTimes.Reset();
+				State->FusingFrameEnds.Reset();
+
+				State->PublishSnapshot();
+			}
+			State->FusionScheduled.Set(0);
+		}
+		while (State->HasPendingWork() && State->FusionScheduled.Set(1) == 0);
+	}
+
+	bool HasPendingWork()
+	{
+		FScopeLock ScopeLock(&PendingLock);
+		return PendingFrameEnds.Num() > 0 || ResetRequested.GetValue() != 0;
+	}
+
+	static void ScheduleFusion(const TSharedPtr<FState, ESPMode::ThreadSafe>& State)
+	{
+		if (State->FusionScheduled.Set(1) == 0)
+		{
+			TSharedRef<FState, ESPMode::ThreadSafe> StateRef = State.ToSharedRef();
+			AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [StateRef]()
+			{
+				FusePendingPoints(StateRef);
+			});
+		}
+	}
+};
+
+FARPointCloudMap::FARPointCloudMap(const FSettings& InSettings)
+	: Settings(InSettings)
+{
+	Settings.VoxelSize = FMath::Max(Settings.VoxelSize, 0.1f);
+	Settings.SaturationWeight = FMath::Max(Settings.SaturationWeight, MinPointWeight);
+	Settings.MaxPendingPoints = static_cast<int32>(FMath::Clamp<int64>(Settings.MaxPendingPoints, 1, Settings.MemoryBudgetBytes / 2 / GetBytesPerPendingPoint()));
+
+	const int64 PendingBytes = static_cast<int64>(Settings.MaxPendingPoints) * GetBytesPerPendingPoint();
+	MaxVoxels = static_cast<int32>(FMath::Clamp<int64>((Settings.MemoryBudgetBytes - PendingBytes) / GetBytesPerVoxel(), 1, MAX_int32));
+
+	State = MakeShared<FState, ESPMode::ThreadSafe>();
+	State->Settings = Settings;
+	State->MaxVoxels = MaxVoxels;
+
+	// Allocate everything up front so that the map never grows past its budget.
+	State->Voxels.Reserve(MaxVoxels);
+	State->VoxelIndices.Reserve(MaxVoxels);
+	State->PendingPoints.Reserve(Settings.MaxPendingPoints);
+	State->FusingPoints.Reserve(Settings.MaxPendingPoints);
+}
+
+bool FARPointCloudMap::AddPoints(const TArray<FVector4>& Points, double Time)
+{
+	if (Points.Num() == 0)
+	{
+		return true;
+	}
+
+	{
+		FScopeLock ScopeLock(&State->PendingLock);
+		if (State->PendingPoints.Num() + Points.Num() > Settings.MaxPendingPoints)
+		{
+			State->NumDroppedFrames.Increment();
+			return false;
+		}
+		State->PendingPoints.Append(Points);
+		State->PendingTimes.Add(Time);
+		State->PendingFrameEnds.Add(State->PendingPoints.Num());
+	}
+
+	FState::ScheduleFusion(State);
+	return true;
+}
+
+bool FARPointCloudMap::GetFusedPoints(TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe>& OutPoints, FBox& OutBounds, uint32& InOutVersion) const
+{
+	FScopeLock ScopeLock(&State->SnapshotLock);
+	if (State->SnapshotVersion == InOutVersion)
+	{
+		return false;
+	}
+	OutPoints = State->Snapshot;
+	OutBounds = State->SnapshotBounds;
+	InOutVersion = State->SnapshotVersion;
+	return true;
+}
+
+void FARPointCloudMap::Reset()
+{
+	{
+		FScopeLock ScopeLock(&State->PendingLock);
+		State->PendingPoints.Reset();
+		State->PendingTimes.Reset();
+		State->PendingFrameEnds.Reset();
+		State->ResetRequested.Set(1);
+	}
+
+	FState::ScheduleFusion(State);
+}
+
+int32 FARPointCloudMap::GetNumVoxels() const
+{
+	FScopeLock ScopeLock(&State->SnapshotLock);
+	return State->Snapshot.IsValid() ? State->Snapshot->Num() : 0;
+}
+
+int32 FARPointCloudMap::GetNumEvictedVoxels() const
+{
+	return State->NumEvictedVoxels.GetValue();
+}
+
+int32 FARPointCloudMap::GetNumDroppedFrames() const
+{
+	return State->NumDroppedFrames.GetValue();
+}
+
+int32 FARPointCloudMap::GetBytesPerVoxel()
+{
+	// The voxel, its hash entry (key, index, next id and bucket), and the
+	// fused point in the snapshot being built, the published one the point
+	// cloud component shares, the previous one the render thread may still
+	// be uploading, and the component's instance buffer.
+	return sizeof(FARPointCloudVoxel)
+		+ sizeof(FIntVector) + 3 * sizeof(int32)
+		+ 4 * sizeof(FVector4);
+}
+
+int32 FARPointCloudMap::GetBytesPerPendingPoint()
+{
+	// The pending and the fusing batch are swapped, so both reach the limit.
+	return 2 * sizeof(FVector4);
+}
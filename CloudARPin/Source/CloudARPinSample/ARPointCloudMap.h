@@ -0,0 +1,117 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Accumulates feature points over a session in a hash of fixed-size voxels.
+ *
+ * Every point that lands in a voxel is fused into the voxel's position as a
+ * running average weighted by the point's confidence. The fused confidence
+ * grows with the accumulated weight and saturates at 1, after which old
+ * observations fade out so that the map follows tracking corrections.
+ *
+ * Voxels are kept in least recently observed order. When the map is full
+ * the voxel that was observed longest ago is evicted to make room, and
+ * voxels not observed for MaxAgeSeconds are dropped as well, so memory use
+ * is bounded by MemoryBudgetBytes however long the session runs.
+ *
+ * AddPoints() only copies the frame's points; fusion runs on a background
+ * task, which publishes a snapshot of the fused points when it is done.
+ */
+class CLOUDARPINSAMPLE_API FARPointCloudMap
+{
+public:
+	struct FSettings
+	{
+		/** Edge length of a voxel in centimeters. */
+		float VoxelSize = 5.0f;
+
+		/**
+		 * The most memory the map may use, counting every copy of the fused
+		 * points down to the renderer (see GetBytesPerVoxel()) and the points
+		 * waiting to be fused.
+		 */
+		int64 MemoryBudgetBytes = 8 * 1024 * 1024;
+
+		/** Voxels not observed for this many seconds are removed. 0 keeps them until the map is full. */
+		float MaxAgeSeconds = 0.0f;
+
+		/** Accumulated confidence at which a voxel is fully trusted. */
+		float SaturationWeight = 4.0f;
+
+		/**
+		 * The most points waiting to be fused. Frames arriving beyond this are
+		 * dropped. Clamped so that they take at most half of the budget.
+		 */
+		int32 MaxPendingPoints = 64 * 1024;
+	};
+
+	explicit FARPointCloudMap(const FSettings& InSettings);
+
+	/**
+	 * Queues one frame of world space points, with the confidence of each
+	 * point in W, for fusion on a background task.
+	 *
+	 * @param Time	The time the points were observed, in seconds.
+	 * @return False if the frame was dropped because fusion is too far behind.
+	 */
+	bool AddPoints(const TArray<FVector4>& Points, double Time);
+
+	/**
+	 * Returns the latest fused points, positions in XYZ and confidence in W,
+	 * and their bounds if they changed since InOutVersion. The points are
+	 * shared, not copied, and never modified once returned.
+	 *
+	 * @return True if OutPoints and OutBounds were updated.
+	 */
+	bool GetFusedPoints(TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe>& OutPoints, FBox& OutBounds, uint32& InOutVersion) const;
+
+	/** Removes all points. Frames queued before the call are discarded. */
+	void Reset();
+
+	const FSettings& GetSettings() const { return Settings; }
+
+	/** The most voxels that fit into the memory budget once the pending points are set aside. */
+	int32 GetMaxVoxels() const { return MaxVoxels; }
+
+	/** The number of voxels in the latest snapshot. */
+	int32 GetNumVoxels() const;
+
+	int32 GetNumEvictedVoxels() const;
+	int32 GetNumDroppedFrames() const;
+
+	/**
+	 * Bytes used per voxel at the peak: the voxel and its hash entry, plus
+	 * four copies of its fused point. Those are the snapshot being built,
+	 * the published one shared with the point cloud component, the previous
+	 * one the render thread may still be uploading, and the instance buffer
+	 * the component uploads it to.
+	 */
+	static int32 GetBytesPerVoxel();
+
+	/** Bytes used per point waiting to be fused, in the pending and the fusing batch. */
+	static int32 GetBytesPerPendingPoint();
+
+	struct FState;
+
+private:
+	FSettings Settings;
+	int32 MaxVoxels;
+
+	/** Shared with the fusion task, which keeps it alive until it finishes. */
+	TSharedPtr<FState, ESPMode::ThreadSafe> State;
+};
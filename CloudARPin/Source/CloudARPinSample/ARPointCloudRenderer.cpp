@@ -14,7 +14,12 @@
 
 #include "ARPointCloudRenderer.h"
 #include "ARBlueprintLibrary.h"
-#include "DrawDebugHelpers.h"
+#include "ARPointCloudComponent.h"
+#include "ARPointCloudMap.h"
+#include "ARPointStreamActor.h"
+#include "CloudARPinSample.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
 
 #if PLATFORM_ANDROID
 #include "GoogleARCoreFunctionLibrary.h"
@@ -24,6 +29,12 @@
 #include "AppleARKitBlueprintLibrary.h"
 #endif
 
+DECLARE_CYCLE_STAT(TEXT("Point Cloud Renderer Tick"), STAT_PointCloudRendererTick, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Cloud Points Acquired"), STAT_PointCloudPointsAcquired, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Cloud Points Drawn"), STAT_PointCloudPointsDrawn, STATGROUP_CloudARPinSample);
+
+// Without a point map, a client draws at most this many of the latest streamed points.
+static const int32 MaxReceivedPoints = 8192;
 
 // Sets default values
 AARPointCloudRenderer::AARPointCloudRenderer()
@@ -31,13 +42,59 @@ AARPointCloudRenderer::AARPointCloudRenderer()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	bAccumulatePoints = false;
+	VoxelSize = 5.0f;
+	PointMapBudgetMB = 8.0f;
+	MaxPointAgeSeconds = 0.0f;
+	FusedPointsVersion = 0;
+
+	bStreamToClients = false;
+	bRenderHostStream = true;
+	StreamKBPerSecond = 16.0f;
+	StreamRange = 1000.0f;
+	StreamCellSize = 2.0f;
+	StreamResendSeconds = 10.0f;
+	bHasStreamAnchor = false;
+
+	// Every device spawns its own renderer; the stream goes through an
+	// AARPointStreamActor the server spawns instead.
+	bReplicates = false;
+
+	PointCloudComponent = CreateDefaultSubobject<UARPointCloudComponent>(TEXT("PointCloudComponent"));
+	RootComponent = PointCloudComponent;
 }
 
 // Called when the game starts or when spawned
 void AARPointCloudRenderer::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	if (bAccumulatePoints)
+	{
+		FARPointCloudMap::FSettings Settings;
+		Settings.VoxelSize = VoxelSize;
+		Settings.MemoryBudgetBytes = static_cast<int64>(PointMapBudgetMB * 1024.0f * 1024.0f);
+		Settings.MaxAgeSeconds = MaxPointAgeSeconds;
+		PointMap = MakeShared<FARPointCloudMap, ESPMode::ThreadSafe>(Settings);
+		FusedPointsVersion = 0;
+	}
+}
+
+void AARPointCloudRenderer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Only the server's renderer spawned a stream actor; a client's one was replicated.
+	if (PointStream.IsValid() && PointStream->HasAuthority())
+	{
+		PointStream->Destroy();
+	}
+	PointStream.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AARPointCloudRenderer::SetStreamAnchor(const FTransform& AnchorToWorld)
+{
+	StreamAnchor = AnchorToWorld;
+	bHasStreamAnchor = true;
 }
 
 // Called every frame
@@ -49,25 +106,32 @@ void AARPointCloudRenderer::Tick(float DeltaTime)
 
 void AARPointCloudRenderer::RenderPointCloud()
 {
-	UWorld* World = GetWorld();
+	CLOUDARPIN_SCOPED_STAT(PointCloudRendererTick);
+
 	if (!ARSystem.IsValid())
 	{
 		ARSystem = StaticCastSharedPtr<FARSystemBase>(GEngine->XRSystem);
 	}
 
+	// Points are gathered into one array and handed to the component in a
+	// single copy. Nothing is drawn while tracking is lost.
+	Points.Reset();
+
 	if (UARBlueprintLibrary::GetTrackingQuality() == EARTrackingQuality::OrientationAndPosition)
 	{
 #if PLATFORM_ANDROID
 		UGoogleARCorePointCloud* LatestPointCloud = nullptr;
 		EGoogleARCoreFunctionStatus Status = UGoogleARCoreFrameFunctionLibrary::GetPointCloud(LatestPointCloud);
-		if (Status == EGoogleARCoreFunctionStatus::Success && LatestPointCloud != nullptr && LatestPointCloud->GetPointNum() > 0)
+		if (Status == EGoogleARCoreFunctionStatus::Success && LatestPointCloud != nullptr)
 		{
-			for (int i = 0; i < LatestPointCloud->GetPointNum(); i++)
+			const int32 PointNum = LatestPointCloud->GetPointNum();
+			Points.Reserve(PointNum);
+			for (int i = 0; i < PointNum; i++)
 			{
 				FVector PointPosition = FVector::ZeroVector;
 				float PointConfidence = 0;
 				LatestPointCloud->GetPoint(i, PointPosition, PointConfidence);
-				DrawDebugPoint(World, PointPosition, PointSize, PointColor, false);
+				Points.Emplace(PointPosition, PointConfidence);
 			}
 		}
 #endif
@@ -80,16 +144,121 @@ void AARPointCloudRenderer::RenderPointCloud()
 			{
 				ARFrame* RawARKitFrame = reinterpret_cast<ARFrame*>(CurrentFrame.NativeFrame);
 				ARPointCloud* PointCloud = RawARKitFrame.rawFeaturePoints;
+				const FTransform TrackingToWorld = ARSystem->GetAlignmentTransform() * ARSystem->GetTrackingToWorldTransform();
+				Points.Reserve(PointCloud.count);
 				for (int i = 0; i < PointCloud.count; i++)
 				{
 					const vector_float3* RawPosition = PointCloud.points + i;
 					FVector PointTrackingPosition = FVector(-RawPosition->z, RawPosition->x, RawPosition->y) * 100;
-					FVector PointPosition = (ARSystem->GetAlignmentTransform() * ARSystem->GetTrackingToWorldTransform()).TransformPosition(PointTrackingPosition);
-					DrawDebugPoint(World, PointPosition, PointSize, PointColor, false);
+					FVector PointPosition = TrackingToWorld.TransformPosition(PointTrackingPosition);
+					// ARKit does not report a confidence for feature points.
+					Points.Emplace(PointPosition, 1.0f);
 				}
 			}
 		}
 #endif
+
+#if !PLATFORM_ANDROID && !PLATFORM_IOS
+		// Other AR systems, e.g. FSimulatedARSystem, report tracking space
+		// points through the common interface, without confidences.
+		if (ARSystem.IsValid())
+		{
+			const FTransform TrackingToWorld = ARSystem->GetAlignmentTransform() * ARSystem->GetTrackingToWorldTransform();
+			const TArray<FVector> PointCloud = UARBlueprintLibrary::GetPointCloud();
+			Points.Reserve(PointCloud.Num());
+			for (const FVector& PointTrackingPosition : PointCloud)
+			{
+				Points.Emplace(TrackingToWorld.TransformPosition(PointTrackingPosition), 1.0f);
+			}
+		}
+#endif
 	}
+
+	CLOUDARPIN_INC_STAT(PointCloudPointsAcquired, Points.Num());
+	StreamPoints();
+	PointCloudComponent->SetPointAppearance(PointColor, PointSize);
+	if (PointMap.IsValid())
+	{
+		// The map fuses in the background; draw its latest snapshot whenever
+		// a new one is ready.
+		PointMap->AddPoints(Points, GetWorld()->GetRealTimeSeconds());
+		TSharedPtr<const TArray<FVector4>, ESPMode::ThreadSafe> FusedPoints;
+		FBox FusedBounds(ForceInit);
+		if (PointMap->GetFusedPoints(FusedPoints, FusedBounds, FusedPointsVersion))
+		{
+			PointCloudComponent->SetPoints(FusedPoints, FusedBounds);
+		}
+	}
+	else
+	{
+		PointCloudComponent->SetPoints(Points);
+	}
+	CLOUDARPIN_SET_STAT(PointCloudPointsDrawn, PointCloudComponent->GetNumPoints());
 }
 
+
+AARPointStreamActor* AARPointCloudRenderer::GetPointStream()
+{
+	if (PointStream.IsValid())
+	{
+		return PointStream.Get();
+	}
+
+	const ENetMode NetMode = GetNetMode();
+	if (NetMode == NM_Client && bRenderHostStream)
+	{
+		// Replicated from the server, maybe not yet.
+		for (TActorIterator<AARPointStreamActor> It(GetWorld()); It; ++It)
+		{
+			PointStream = *It;
+			break;
+		}
+	}
+	else if ((NetMode == NM_ListenServer || NetMode == NM_DedicatedServer) && bStreamToClients)
+	{
+		FARPointStreamSettings Settings;
+		Settings.Range = StreamRange;
+		Settings.SuppressionCellSize = StreamCellSize;
+		Settings.ResendSeconds = StreamResendSeconds;
+		Settings.MaxBytesPerSecond = StreamKBPerSecond * 1024.0f;
+		PointStream = GetWorld()->SpawnActor<AARPointStreamActor>();
+		if (PointStream.IsValid())
+		{
+			PointStream->SetStreamSettings(Settings);
+		}
+	}
+	return PointStream.Get();
+}
+
+void AARPointCloudRenderer::StreamPoints()
+{
+	if (!bHasStreamAnchor)
+	{
+		return;
+	}
+
+	AARPointStreamActor* Stream = GetPointStream();
+	if (Stream == nullptr)
+	{
+		return;
+	}
+
+	if (Stream->HasAuthority())
+	{
+		Stream->SendPoints(Points, StreamAnchor);
+	}
+	else
+	{
+		Stream->ReadReceivedPoints(StreamAnchor, ReceivedPoints);
+		Points.Append(ReceivedPoints);
+		if (PointMap.IsValid())
+		{
+			// The map keeps them from here on.
+			ReceivedPoints.Reset();
+		}
+		else if (ReceivedPoints.Num() > MaxReceivedPoints)
+		{
+			ReceivedPoints.RemoveAt(0, ReceivedPoints.Num() - MaxReceivedPoints, false);
+		}
+	}
+}
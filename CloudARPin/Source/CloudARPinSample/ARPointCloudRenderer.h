@@ -19,6 +19,10 @@
 #include "ARSystem.h"
 #include "ARPointCloudRenderer.generated.h"
 
+class AARPointStreamActor;
+class FARPointCloudMap;
+class UARPointCloudComponent;
+
 UCLASS()
 class CLOUDARPINSAMPLE_API AARPointCloudRenderer : public AActor
 {
@@ -36,9 +40,76 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCore|PointCloudRenderer")
 	float PointSize;
 
+	/**
+	 * Accumulate points over the session in a voxel map and draw the fused
+	 * map instead of only the latest point cloud.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer")
+	bool bAccumulatePoints;
+
+	/** Edge length of a map voxel in centimeters. Points in the same voxel are fused into one. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer", meta = (EditCondition = "bAccumulatePoints", ClampMin = "0.1"))
+	float VoxelSize;
+
+	/**
+	 * The most memory the point map may use, in megabytes, counting every
+	 * copy of the fused points down to the GPU and the points waiting to be
+	 * fused. The least recently seen voxels are evicted beyond it.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer", meta = (EditCondition = "bAccumulatePoints", ClampMin = "0.1"))
+	float PointMapBudgetMB;
+
+	/** Voxels not seen for this many seconds are removed from the map. 0 keeps them until the budget is used up. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer", meta = (EditCondition = "bAccumulatePoints", ClampMin = "0"))
+	float MaxPointAgeSeconds;
+
+	/**
+	 * On the host, send the points to the clients in the session, relative
+	 * to the anchor set with SetStreamAnchor, through an AARPointStreamActor
+	 * the host spawns. The renderer itself is not replicated; every device
+	 * spawns its own.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer|Streaming")
+	bool bStreamToClients;
+
+	/** On a client, draw the points streamed by the host along with its own. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer|Streaming")
+	bool bRenderHostStream;
+
+	/** The most bytes per second the host sends, in kilobytes. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer|Streaming", meta = (EditCondition = "bStreamToClients", ClampMin = "1"))
+	float StreamKBPerSecond;
+
+	/**
+	 * Points farther than this from the anchor on any axis, in centimeters,
+	 * are not sent. Positions are sent in steps of 2 * StreamRange / 65535.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer|Streaming", meta = (EditCondition = "bStreamToClients", ClampMin = "1"))
+	float StreamRange;
+
+	/** Only one point per cell of this size, in centimeters, is sent every StreamResendSeconds. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer|Streaming", meta = (EditCondition = "bStreamToClients", ClampMin = "0.1"))
+	float StreamCellSize;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer|Streaming", meta = (EditCondition = "bStreamToClients", ClampMin = "0"))
+	float StreamResendSeconds;
+
+	/**
+	 * Sets the anchor that streamed points are relative to, e.g. the pin
+	 * the host hosted and the clients resolved. Call it on every device;
+	 * nothing is sent or drawn from the stream until then.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCore|PointCloudRenderer|Streaming")
+	void SetStreamAnchor(const FTransform& AnchorToWorld);
+
+	/** Draws all points in one batch. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GoogleARCore|PointCloudRenderer")
+	UARPointCloudComponent* PointCloudComponent;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
@@ -47,7 +118,27 @@ public:
 private:
 	void RenderPointCloud();
 
+	void StreamPoints();
+
+	/** Spawns the stream on the server, or finds the replicated one on a client. Null without a stream. */
+	AARPointStreamActor* GetPointStream();
+
 	TSharedPtr<FARSystemBase, ESPMode::ThreadSafe> ARSystem;
-	
-	
+
+	/** World positions and confidences of the latest point cloud, reused every frame. */
+	TArray<FVector4> Points;
+
+	TSharedPtr<FARPointCloudMap, ESPMode::ThreadSafe> PointMap;
+	uint32 FusedPointsVersion;
+
+	FTransform StreamAnchor;
+	bool bHasStreamAnchor;
+
+	TWeakObjectPtr<AARPointStreamActor> PointStream;
+
+	/**
+	 * Points received from the host. With a point map they are fused and
+	 * cleared every frame; otherwise the latest ones are kept and drawn.
+	 */
+	TArray<FVector4> ReceivedPoints;
 };
@@ -0,0 +1,194 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARPointStream.h"
+
+// A chunk is a 2 byte sequence number, a 2 byte point count and the 4 byte
+// range, followed by 3 x 2 byte positions and 1 byte confidence per point,
+// all little endian.
+static const int32 ChunkHeaderBytes = 8;
+static const int32 BytesPerPoint = 7;
+
+static FORCEINLINE uint16 QuantizeAxis(float Value, float Range)
+{
+	return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt((Value / Range * 0.5f + 0.5f) * 65535.0f), 0, 65535));
+}
+
+static FORCEINLINE float DequantizeAxis(uint16 Value, float Range)
+{
+	return (Value / 65535.0f * 2.0f - 1.0f) * Range;
+}
+
+static FORCEINLINE void WriteUInt16(uint8* Out, uint16 Value)
+{
+	Out[0] = static_cast<uint8>(Value);
+	Out[1] = static_cast<uint8>(Value >> 8);
+}
+
+static FORCEINLINE uint16 ReadUInt16(const uint8* In)
+{
+	return static_cast<uint16>(In[0] | (In[1] << 8));
+}
+
+FARPointStreamSender::FARPointStreamSender(const FARPointStreamSettings& InSettings)
+	: Settings(InSettings)
+	, LastPruneTime(0.0)
+	, ByteBudget(0.0)
+	, LastBudgetTime(-1.0)
+	, NextSequence(0)
+	, NumPointsSuppressed(0)
+	, NumPointsDropped(0)
+	, NumPointsSent(0)
+	, NumBytesSent(0)
+{
+	Settings.Range = FMath::Max(Settings.Range, 1.0f);
+	Settings.SuppressionCellSize = FMath::Max(Settings.SuppressionCellSize, 0.01f);
+	Settings.MaxPointsPerChunk = FMath::Clamp(Settings.MaxPointsPerChunk, 1, 65535);
+}
+
+void FARPointStreamSender::AddPoints(const TArray<FVector4>& WorldPoints, const FTransform& AnchorToWorld, double Time)
+{
+	// Forget cells once in a while, so that the map does not grow with the session.
+	if (Time - LastPruneTime >= Settings.ResendSeconds)
+	{
+		for (auto It = SentCells.CreateIterator(); It; ++It)
+		{
+			if (Time - It.Value() >= Settings.ResendSeconds)
+			{
+				It.RemoveCurrent();
+			}
+		}
+		LastPruneTime = Time;
+	}
+
+	const float InvCellSize = 1.0f / Settings.SuppressionCellSize;
+	for (const FVector4& WorldPoint : WorldPoints)
+	{
+		const FVector LocalPoint = AnchorToWorld.InverseTransformPosition(FVector(WorldPoint));
+		if (FMath::Abs(LocalPoint.X) > Settings.Range || FMath::Abs(LocalPoint.Y) > Settings.Range || FMath::Abs(LocalPoint.Z) > Settings.Range)
+		{
+			NumPointsDropped++;
+			continue;
+		}
+
+		const FIntVector Cell(FMath::FloorToInt(LocalPoint.X * InvCellSize), FMath::FloorToInt(LocalPoint.Y * InvCellSize), FMath::FloorToInt(LocalPoint.Z * InvCellSize));
+		double& CellTime = SentCells.FindOrAdd(Cell, -Settings.ResendSeconds);
+		if (Time - CellTime < Settings.ResendSeconds)
+		{
+			NumPointsSuppressed++;
+			continue;
+		}
+		CellTime = Time;
+
+		FQueuedPoint& Point = Queue.AddDefaulted_GetRef();
+		Point.Position[0] = QuantizeAxis(LocalPoint.X, Settings.Range);
+		Point.Position[1] = QuantizeAxis(LocalPoint.Y, Settings.Range);
+		Point.Position[2] = QuantizeAxis(LocalPoint.Z, Settings.Range);
+		Point.Confidence = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(WorldPoint.W * 255.0f), 0, 255));
+		Point.Time = Time;
+	}
+
+	if (Queue.Num() > Settings.MaxQueuedPoints)
+	{
+		const int32 NumDropped = Queue.Num() - Settings.MaxQueuedPoints;
+		Queue.RemoveAt(0, NumDropped, false);
+		NumPointsDropped += NumDropped;
+	}
+}
+
+bool FARPointStreamSender::GetNextChunk(double Now, TArray<uint8>& OutChunk, double& OutCaptureTime)
+{
+	// The budget refills continuously and holds at most a tenth of a second, or one full chunk.
+	const double MaxBudget = FMath::Max(Settings.MaxBytesPerSecond * 0.1, static_cast<double>(ChunkHeaderBytes + Settings.MaxPointsPerChunk * BytesPerPoint));
+	if (LastBudgetTime >= 0.0)
+	{
+		ByteBudget = FMath::Min(ByteBudget + (Now - LastBudgetTime) * Settings.MaxBytesPerSecond, MaxBudget);
+	}
+	LastBudgetTime = Now;
+
+	const int32 NumPoints = FMath::Min(Queue.Num(), Settings.MaxPointsPerChunk);
+	const int32 NumBytes = ChunkHeaderBytes + NumPoints * BytesPerPoint;
+	if (NumPoints == 0 || ByteBudget < NumBytes)
+	{
+		return false;
+	}
+
+	OutChunk.SetNumUninitialized(NumBytes, false);
+	uint8* Out = OutChunk.GetData();
+	WriteUInt16(Out, NextSequence++);
+	WriteUInt16(Out + 2, static_cast<uint16>(NumPoints));
+	FMemory::Memcpy(Out + 4, &Settings.Range, sizeof(float));
+	Out += ChunkHeaderBytes;
+	for (int32 Index = 0; Index < NumPoints; Index++, Out += BytesPerPoint)
+	{
+		const FQueuedPoint& Point = Queue[Index];
+		WriteUInt16(Out, Point.Position[0]);
+		WriteUInt16(Out + 2, Point.Position[1]);
+		WriteUInt16(Out + 4, Point.Position[2]);
+		Out[6] = Point.Confidence;
+	}
+
+	OutCaptureTime = Queue[0].Time;
+	Queue.RemoveAt(0, NumPoints, false);
+	ByteBudget -= NumBytes;
+	NumPointsSent += NumPoints;
+	NumBytesSent += NumBytes;
+	return true;
+}
+
+FARPointStreamReceiver::FARPointStreamReceiver()
+	: LastSequence(INDEX_NONE)
+	, NumChunksReceived(0)
+	, NumChunksLost(0)
+	, NumPointsReceived(0)
+{
+}
+
+bool FARPointStreamReceiver::ReadChunk(const TArray<uint8>& Chunk, const FTransform& AnchorToWorld, TArray<FVector4>& OutWorldPoints)
+{
+	if (Chunk.Num() < ChunkHeaderBytes)
+	{
+		return false;
+	}
+	const uint8* In = Chunk.GetData();
+	const uint16 Sequence = ReadUInt16(In);
+	const int32 NumPoints = ReadUInt16(In + 2);
+	float Range = 0.0f;
+	FMemory::Memcpy(&Range, In + 4, sizeof(float));
+	if (Chunk.Num() != ChunkHeaderBytes + NumPoints * BytesPerPoint || !(Range > 0.0f))
+	{
+		return false;
+	}
+
+	// Unreliable chunks may be lost, or arrive late after a gap was counted.
+	// A late chunk is still drawn but must not move the sequence back, or
+	// the chunks after it would be counted as lost again.
+	const uint16 Gap = LastSequence != INDEX_NONE ? static_cast<uint16>(Sequence - LastSequence - 1) : 0;
+	if (Gap < 0x8000)
+	{
+		NumChunksLost += Gap;
+		LastSequence = Sequence;
+	}
+	NumChunksReceived++;
+	NumPointsReceived += NumPoints;
+
+	In += ChunkHeaderBytes;
+	OutWorldPoints.Reserve(OutWorldPoints.Num() + NumPoints);
+	for (int32 Index = 0; Index < NumPoints; Index++, In += BytesPerPoint)
+	{
+		const FVector LocalPoint(DequantizeAxis(ReadUInt16(In), Range), DequantizeAxis(ReadUInt16(In + 2), Range), DequantizeAxis(ReadUInt16(In + 4), Range));
+		OutWorldPoints.Emplace(AnchorToWorld.TransformPosition(LocalPoint), In[6] / 255.0f);
+	}
+	return true;
+}
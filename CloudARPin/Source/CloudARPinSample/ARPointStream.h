@@ -0,0 +1,134 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Settings shared by FARPointStreamSender and FARPointStreamReceiver. */
+struct FARPointStreamSettings
+{
+	/**
+	 * Points are sent relative to a shared anchor, as 16 bit fixed point
+	 * within +-Range cm on each axis. Points farther away are not sent.
+	 * The default gives a resolution of 0.03 cm.
+	 */
+	float Range = 1000.0f;
+
+	/** Only the first point in a cell of this size, in cm, is sent until ResendSeconds have passed. */
+	float SuppressionCellSize = 2.0f;
+	float ResendSeconds = 10.0f;
+
+	int32 MaxPointsPerChunk = 200;
+
+	/** The most bytes sent per second. */
+	float MaxBytesPerSecond = 16.0f * 1024.0f;
+
+	/** The most points waiting for the byte budget. The oldest points are dropped beyond it. */
+	int32 MaxQueuedPoints = 4096;
+};
+
+/**
+ * Turns a device's feature points into a stream of compact chunks for
+ * other devices: 7 bytes per point instead of 16, at most one point per
+ * suppression cell every ResendSeconds, and no more than
+ * MaxBytesPerSecond.
+ *
+ * Points are relative to an anchor that every device knows, e.g. a Cloud
+ * Anchor, so that each receiver can place them in its own world space.
+ */
+class CLOUDARPINSAMPLE_API FARPointStreamSender
+{
+public:
+	explicit FARPointStreamSender(const FARPointStreamSettings& InSettings);
+
+	/**
+	 * Queues the new points of a frame: world space positions in XYZ and
+	 * confidences in W.
+	 *
+	 * @param Time	The time the points were observed, in seconds.
+	 */
+	void AddPoints(const TArray<FVector4>& WorldPoints, const FTransform& AnchorToWorld, double Time);
+
+	/**
+	 * Writes the next chunk of queued points if the byte budget allows.
+	 * Call it until it returns false.
+	 *
+	 * @param OutCaptureTime	When the oldest point of the chunk was observed.
+	 */
+	bool GetNextChunk(double Now, TArray<uint8>& OutChunk, double& OutCaptureTime);
+
+	/** Points not sent because a point in the same cell was. */
+	int64 GetNumPointsSuppressed() const { return NumPointsSuppressed; }
+
+	/** Points dropped because the queue was full, or out of range. */
+	int64 GetNumPointsDropped() const { return NumPointsDropped; }
+
+	int64 GetNumPointsSent() const { return NumPointsSent; }
+	int64 GetNumBytesSent() const { return NumBytesSent; }
+	int32 GetNumQueuedPoints() const { return Queue.Num(); }
+
+private:
+	struct FQueuedPoint
+	{
+		uint16 Position[3];
+		uint8 Confidence;
+		double Time;
+	};
+
+	FARPointStreamSettings Settings;
+
+	TArray<FQueuedPoint> Queue;
+
+	/** When each suppression cell last had a point queued. */
+	TMap<FIntVector, double> SentCells;
+	double LastPruneTime;
+
+	/** Bytes that may be sent now. */
+	double ByteBudget;
+	double LastBudgetTime;
+
+	uint16 NextSequence;
+
+	int64 NumPointsSuppressed;
+	int64 NumPointsDropped;
+	int64 NumPointsSent;
+	int64 NumBytesSent;
+};
+
+/** Reads the chunks of an FARPointStreamSender. */
+class CLOUDARPINSAMPLE_API FARPointStreamReceiver
+{
+public:
+	FARPointStreamReceiver();
+
+	/**
+	 * Appends the points of Chunk to OutWorldPoints, placed relative to
+	 * this device's AnchorToWorld. Returns false if the chunk is malformed.
+	 */
+	bool ReadChunk(const TArray<uint8>& Chunk, const FTransform& AnchorToWorld, TArray<FVector4>& OutWorldPoints);
+
+	int64 GetNumChunksReceived() const { return NumChunksReceived; }
+
+	/** Chunks missing from the sequence, e.g. lost as unreliable RPCs. */
+	int64 GetNumChunksLost() const { return NumChunksLost; }
+
+	int64 GetNumPointsReceived() const { return NumPointsReceived; }
+
+private:
+	int32 LastSequence;
+	int64 NumChunksReceived;
+	int64 NumChunksLost;
+	int64 NumPointsReceived;
+};
@@ -0,0 +1,111 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARPointStreamActor.h"
+#include "CloudARPinSample.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Stream Bytes Sent"), STAT_PointStreamBytesSent, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Stream Points Sent"), STAT_PointStreamPointsSent, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Stream Points Suppressed"), STAT_PointStreamPointsSuppressed, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Stream Points Dropped"), STAT_PointStreamPointsDropped, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Stream Bytes Received"), STAT_PointStreamBytesReceived, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Stream Chunks Lost"), STAT_PointStreamChunksLost, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Point Stream Latency (ms)"), STAT_PointStreamLatencyMs, STATGROUP_CloudARPinSample);
+
+// A client keeps at most this many unread chunks; older ones are dropped.
+static const int32 MaxReceivedChunks = 64;
+
+static double GetServerWorldTime(const UWorld* World)
+{
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState != nullptr ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+AARPointStreamActor::AARPointStreamActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// Only the point stream is replicated, to every client.
+	bReplicates = true;
+	bReplicateMovement = false;
+	bAlwaysRelevant = true;
+}
+
+void AARPointStreamActor::SetStreamSettings(const FARPointStreamSettings& InSettings)
+{
+	check(HasAuthority());
+	StreamSender = MakeUnique<FARPointStreamSender>(InSettings);
+}
+
+void AARPointStreamActor::SendPoints(const TArray<FVector4>& WorldPoints, const FTransform& AnchorToWorld)
+{
+	if (!StreamSender.IsValid())
+	{
+		return;
+	}
+
+	const int64 NumSuppressed = StreamSender->GetNumPointsSuppressed();
+	const int64 NumDropped = StreamSender->GetNumPointsDropped();
+	const int64 NumSent = StreamSender->GetNumPointsSent();
+	StreamSender->AddPoints(WorldPoints, AnchorToWorld, GetServerWorldTime(GetWorld()));
+
+	double CaptureTime = 0.0;
+	while (StreamSender->GetNextChunk(GetWorld()->GetRealTimeSeconds(), StreamChunk, CaptureTime))
+	{
+		CLOUDARPIN_INC_STAT(PointStreamBytesSent, StreamChunk.Num());
+		MulticastPointChunk(StreamChunk, CaptureTime);
+	}
+	CLOUDARPIN_INC_STAT(PointStreamPointsSuppressed, StreamSender->GetNumPointsSuppressed() - NumSuppressed);
+	CLOUDARPIN_INC_STAT(PointStreamPointsDropped, StreamSender->GetNumPointsDropped() - NumDropped);
+	CLOUDARPIN_INC_STAT(PointStreamPointsSent, StreamSender->GetNumPointsSent() - NumSent);
+}
+
+void AARPointStreamActor::ReadReceivedPoints(const FTransform& AnchorToWorld, TArray<FVector4>& OutWorldPoints)
+{
+	if (!StreamReceiver.IsValid())
+	{
+		StreamReceiver = MakeUnique<FARPointStreamReceiver>();
+	}
+
+	const int64 NumLost = StreamReceiver->GetNumChunksLost();
+	for (const TArray<uint8>& Chunk : ReceivedChunks)
+	{
+		if (!StreamReceiver->ReadChunk(Chunk, AnchorToWorld, OutWorldPoints))
+		{
+			UE_LOG(LogCloudARPinSample, Warning, TEXT("Dropped a malformed point stream chunk of %d bytes."), Chunk.Num());
+			continue;
+		}
+		CLOUDARPIN_INC_STAT(PointStreamBytesReceived, Chunk.Num());
+	}
+	CLOUDARPIN_INC_STAT(PointStreamChunksLost, StreamReceiver->GetNumChunksLost() - NumLost);
+	ReceivedChunks.Reset();
+}
+
+void AARPointStreamActor::MulticastPointChunk_Implementation(const TArray<uint8>& Chunk, double CaptureTime)
+{
+	// A listen server runs its own multicasts too.
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	if (ReceivedChunks.Num() >= MaxReceivedChunks)
+	{
+		ReceivedChunks.RemoveAt(0, 1, false);
+	}
+	ReceivedChunks.Add(Chunk);
+	CLOUDARPIN_SET_STAT(PointStreamLatencyMs, FMath::Max(0.0, (GetServerWorldTime(GetWorld()) - CaptureTime) * 1000.0));
+}
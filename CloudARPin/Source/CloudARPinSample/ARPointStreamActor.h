@@ -0,0 +1,61 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ARPointStream.h"
+#include "ARPointStreamActor.generated.h"
+
+/**
+ * Carries the host's point stream to the clients. The server spawns one,
+ * it is replicated to every client, and each device's own, unreplicated
+ * AARPointCloudRenderer hands it points or takes the received ones.
+ */
+UCLASS()
+class CLOUDARPINSAMPLE_API AARPointStreamActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AARPointStreamActor();
+
+	/** On the server, before the first SendPoints(). */
+	void SetStreamSettings(const FARPointStreamSettings& InSettings);
+
+	/**
+	 * On the server, queues a frame of world space points, relative to
+	 * the anchor every device shares, and sends what the budget allows.
+	 */
+	void SendPoints(const TArray<FVector4>& WorldPoints, const FTransform& AnchorToWorld);
+
+	/**
+	 * On a client, appends the points received since the last call to
+	 * OutWorldPoints, placed relative to this device's AnchorToWorld.
+	 */
+	void ReadReceivedPoints(const FTransform& AnchorToWorld, TArray<FVector4>& OutWorldPoints);
+
+private:
+	/** A chunk of the host's point stream. Chunks may be lost; CaptureTime is in server world time. */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastPointChunk(const TArray<uint8>& Chunk, double CaptureTime);
+
+	TUniquePtr<FARPointStreamSender> StreamSender;
+	TUniquePtr<FARPointStreamReceiver> StreamReceiver;
+	TArray<uint8> StreamChunk;
+
+	/** Chunks received on a client and not read yet, oldest first. */
+	TArray<TArray<uint8>> ReceivedChunks;
+};
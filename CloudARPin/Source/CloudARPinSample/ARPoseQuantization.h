@@ -0,0 +1,386 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+/**
+ * Compact bit encoding of anchor and pin poses for replication.
+ *
+ * Locations are rounded to whole millimeters. Rotations use the
+ * "smallest three" encoding: the largest quaternion component is dropped
+ * and rebuilt from the other three, which then fit in a smaller range.
+ *
+ * A pose can be written against a baseline pose the receiver already
+ * has. Every location axis then takes 2 bits plus a short delta, and an
+ * unchanged rotation takes 1 bit, so a refined anchor that moved a few
+ * millimeters costs about a quarter of a full pose.
+ *
+ * WriteVersioned() and ReadVersioned() add what replication needs on top:
+ * a version per distinct pose, so that the receiver can find the baseline
+ * among the last few poses it received, and a full "keyframe" every few
+ * seconds, so that a receiver that missed its baseline catches up.
+ *
+ * Only depends on Core, so the PinReplicationBenchmark commandlet can run
+ * it without a network driver.
+ */
+namespace ARPoseQuantization
+{
+	/** Location units per centimeter, i.e. millimeters. */
+	static const float LocationScale = 10.0f;
+
+	/** Bits per absolute location axis, covering +-2 km. */
+	static const int32 LocationBits = 22;
+
+	/** Bits per delta location axis in the small and medium delta classes, covering +-6.4 cm and +-4 m. */
+	static const int32 SmallDeltaBits = 7;
+	static const int32 MediumDeltaBits = 13;
+
+	/** Bits per quaternion component, after the 2 bit index of the dropped one. */
+	static const int32 RotationComponentBits = 15;
+
+	/** A pose rounded to what the encoding can represent. */
+	struct FQuantizedPose
+	{
+		FIntVector Location = FIntVector::ZeroValue;
+
+		/** The index of the dropped largest quaternion component. */
+		uint32 LargestComponent = 3;
+
+		/** The other three components, in order, mapped to [0, 2^RotationComponentBits). */
+		uint32 Components[3] = { 0, 0, 0 };
+
+		bool operator==(const FQuantizedPose& Other) const
+		{
+			return Location == Other.Location
+				&& LargestComponent == Other.LargestComponent
+				&& Components[0] == Other.Components[0]
+				&& Components[1] == Other.Components[1]
+				&& Components[2] == Other.Components[2];
+		}
+
+		bool operator!=(const FQuantizedPose& Other) const
+		{
+			return !(*this == Other);
+		}
+
+		bool HasSameRotation(const FQuantizedPose& Other) const
+		{
+			return LargestComponent == Other.LargestComponent
+				&& Components[0] == Other.Components[0]
+				&& Components[1] == Other.Components[1]
+				&& Components[2] == Other.Components[2];
+		}
+	};
+
+	/** The size of a pose written without a baseline. */
+	static const int32 MaxPoseBits = 3 * LocationBits + 2 + 3 * RotationComponentBits;
+
+	/** The size of the same pose as two full precision FVector and FQuat properties. */
+	static const int32 FullPrecisionPoseBits = (3 + 4) * 32;
+
+	// The three smaller components of a unit quaternion lie within +-1/sqrt(2).
+	static const float RotationComponentRange = 0.70710678f;
+
+	FORCEINLINE uint32 ZigZag(int32 Value)
+	{
+		return (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	}
+
+	FORCEINLINE int32 UnZigZag(uint32 Value)
+	{
+		return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+	}
+
+	FORCEINLINE void WriteBits(FBitWriter& Writer, uint32 Value, int32 NumBits)
+	{
+		Writer.SerializeBits(&Value, NumBits);
+	}
+
+	FORCEINLINE uint32 ReadBits(FBitReader& Reader, int32 NumBits)
+	{
+		uint32 Value = 0;
+		Reader.SerializeBits(&Value, NumBits);
+		return Value;
+	}
+
+	inline FQuantizedPose Quantize(const FVector& Location, const FQuat& Rotation)
+	{
+		FQuantizedPose Pose;
+		const int32 MaxLocation = (1 << (LocationBits - 1)) - 1;
+		Pose.Location.X = FMath::Clamp(FMath::RoundToInt(Location.X * LocationScale), -MaxLocation, MaxLocation);
+		Pose.Location.Y = FMath::Clamp(FMath::RoundToInt(Location.Y * LocationScale), -MaxLocation, MaxLocation);
+		Pose.Location.Z = FMath::Clamp(FMath::RoundToInt(Location.Z * LocationScale), -MaxLocation, MaxLocation);
+
+		FQuat Normalized = Rotation.GetNormalized();
+		const float Values[4] = { Normalized.X, Normalized.Y, Normalized.Z, Normalized.W };
+		uint32 Largest = 0;
+		for (uint32 Index = 1; Index < 4; Index++)
+		{
+			if (FMath::Abs(Values[Index]) > FMath::Abs(Values[Largest]))
+			{
+				Largest = Index;
+			}
+		}
+
+		// q and -q are the same rotation; flip so that the dropped component is positive.
+		const float Sign = Values[Largest] < 0.0f ? -1.0f : 1.0f;
+		const float MaxComponent = static_cast<float>((1 << RotationComponentBits) - 1);
+		Pose.LargestComponent = Largest;
+		int32 Out = 0;
+		for (uint32 Index = 0; Index < 4; Index++)
+		{
+			if (Index != Largest)
+			{
+				const float Normalized01 = (Values[Index] * Sign / RotationComponentRange + 1.0f) * 0.5f;
+				Pose.Components[Out++] = static_cast<uint32>(FMath::Clamp(FMath::RoundToInt(Normalized01 * MaxComponent), 0, static_cast<int32>(MaxComponent)));
+			}
+		}
+		return Pose;
+	}
+
+	inline FVector DequantizeLocation(const FQuantizedPose& Pose)
+	{
+		return FVector(Pose.Location.X, Pose.Location.Y, Pose.Location.Z) / LocationScale;
+	}
+
+	inline FQuat DequantizeRotation(const FQuantizedPose& Pose)
+	{
+		const float MaxComponent = static_cast<float>((1 << RotationComponentBits) - 1);
+		float Values[4];
+		float SumSquares = 0.0f;
+		int32 In = 0;
+		for (uint32 Index = 0; Index < 4; Index++)
+		{
+			if (Index != Pose.LargestComponent)
+			{
+				Values[Index] = (Pose.Components[In++] / MaxComponent * 2.0f - 1.0f) * RotationComponentRange;
+				SumSquares += Values[Index] * Values[Index];
+			}
+		}
+		Values[Pose.LargestComponent] = FMath::Sqrt(FMath::Max(1.0f - SumSquares, 0.0f));
+		return FQuat(Values[0], Values[1], Values[2], Values[3]).GetNormalized();
+	}
+
+	/** Writes Pose, as a delta against Baseline if it is not null. Read() needs the same baseline. */
+	inline void Write(FBitWriter& Writer, const FQuantizedPose& Pose, const FQuantizedPose* Baseline)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			const int32 Value = Pose.Location[Axis];
+			if (Baseline == nullptr)
+			{
+				WriteBits(Writer, ZigZag(Value), LocationBits);
+				continue;
+			}
+
+			// A 2 bit class per axis: unchanged, small delta, medium delta or absolute.
+			const int32 Delta = Value - Baseline->Location[Axis];
+			if (Delta == 0)
+			{
+				WriteBits(Writer, 0, 2);
+			}
+			else if (FMath::Abs(Delta) < (1 << (SmallDeltaBits - 1)))
+			{
+				WriteBits(Writer, 1, 2);
+				WriteBits(Writer, ZigZag(Delta), SmallDeltaBits);
+			}
+			else if (FMath::Abs(Delta) < (1 << (MediumDeltaBits - 1)))
+			{
+				WriteBits(Writer, 2, 2);
+				WriteBits(Writer, ZigZag(Delta), MediumDeltaBits);
+			}
+			else
+			{
+				WriteBits(Writer, 3, 2);
+				WriteBits(Writer, ZigZag(Value), LocationBits);
+			}
+		}
+
+		if (Baseline != nullptr)
+		{
+			const bool bRotationChanged = !Pose.HasSameRotation(*Baseline);
+			Writer.WriteBit(bRotationChanged ? 1 : 0);
+			if (!bRotationChanged)
+			{
+				return;
+			}
+		}
+		WriteBits(Writer, Pose.LargestComponent, 2);
+		for (int32 Index = 0; Index < 3; Index++)
+		{
+			WriteBits(Writer, Pose.Components[Index], RotationComponentBits);
+		}
+	}
+
+	/** Reads a pose written by Write() with the same baseline. */
+	inline void Read(FBitReader& Reader, FQuantizedPose& OutPose, const FQuantizedPose* Baseline)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (Baseline == nullptr)
+			{
+				OutPose.Location[Axis] = UnZigZag(ReadBits(Reader, LocationBits));
+				continue;
+			}
+
+			switch (ReadBits(Reader, 2))
+			{
+			case 0:
+				OutPose.Location[Axis] = Baseline->Location[Axis];
+				break;
+			case 1:
+				OutPose.Location[Axis] = Baseline->Location[Axis] + UnZigZag(ReadBits(Reader, SmallDeltaBits));
+				break;
+			case 2:
+				OutPose.Location[Axis] = Baseline->Location[Axis] + UnZigZag(ReadBits(Reader, MediumDeltaBits));
+				break;
+			default:
+				OutPose.Location[Axis] = UnZigZag(ReadBits(Reader, LocationBits));
+				break;
+			}
+		}
+
+		if (Baseline != nullptr && Reader.ReadBit() == 0)
+		{
+			OutPose.LargestComponent = Baseline->LargestComponent;
+			OutPose.Components[0] = Baseline->Components[0];
+			OutPose.Components[1] = Baseline->Components[1];
+			OutPose.Components[2] = Baseline->Components[2];
+			return;
+		}
+		OutPose.LargestComponent = ReadBits(Reader, 2);
+		for (int32 Index = 0; Index < 3; Index++)
+		{
+			OutPose.Components[Index] = ReadBits(Reader, RotationComponentBits);
+		}
+	}
+
+	/** How many received poses a receiver keeps as baselines. Must be a power of two. */
+	static const uint32 NumReceivedPoses = 8;
+
+	/** Bits of the version number that identifies each distinct pose. */
+	static const int32 VersionBits = 16;
+
+	/** What a sender assumes one receiver holds. */
+	struct FBaseline
+	{
+		uint32 Version = 0;
+		FQuantizedPose Pose;
+
+		/** When the sender last wrote a full pose to this receiver. */
+		double KeyframeTime = 0.0;
+	};
+
+	/**
+	 * Writes version Version of a pose for a receiver that is assumed to
+	 * hold Baseline, or nothing if Baseline is null. Writes a full pose if
+	 * there is no usable baseline or the last keyframe is KeyframeSeconds
+	 * old, otherwise a delta.
+	 *
+	 * Returns false without writing anything if the receiver is up to date.
+	 */
+	inline bool WriteVersioned(
+		FBitWriter& Writer,
+		uint32 Version,
+		const FQuantizedPose& Pose,
+		const FBaseline* Baseline,
+		double Now,
+		double KeyframeSeconds,
+		FBaseline& OutNewBaseline)
+	{
+		const bool bKeyframe = Baseline == nullptr || Now - Baseline->KeyframeTime >= KeyframeSeconds;
+		if (!bKeyframe && Baseline->Version == Version)
+		{
+			return false;
+		}
+
+		const uint32 VersionMask = (1u << VersionBits) - 1;
+		const uint32 BaselineDistance = bKeyframe ? 0 : (Version - Baseline->Version) & VersionMask;
+		const bool bDelta = BaselineDistance > 0 && BaselineDistance < NumReceivedPoses;
+
+		WriteBits(Writer, Version & VersionMask, VersionBits);
+		Writer.WriteBit(bDelta ? 1 : 0);
+		if (bDelta)
+		{
+			WriteBits(Writer, BaselineDistance, FMath::FloorLog2(NumReceivedPoses));
+		}
+		Write(Writer, Pose, bDelta ? &Baseline->Pose : nullptr);
+
+		OutNewBaseline.Version = Version & VersionMask;
+		OutNewBaseline.Pose = Pose;
+		OutNewBaseline.KeyframeTime = bKeyframe ? Now : Baseline->KeyframeTime;
+		return true;
+	}
+
+	/** The last few poses a receiver got, by version. */
+	struct FReceivedPoses
+	{
+		uint32 Versions[NumReceivedPoses];
+		FQuantizedPose Poses[NumReceivedPoses];
+		bool bValid[NumReceivedPoses] = {};
+
+		const FQuantizedPose* Find(uint32 Version) const
+		{
+			const uint32 Slot = Version % NumReceivedPoses;
+			return bValid[Slot] && Versions[Slot] == Version ? &Poses[Slot] : nullptr;
+		}
+
+		void Add(uint32 Version, const FQuantizedPose& Pose)
+		{
+			const uint32 Slot = Version % NumReceivedPoses;
+			Versions[Slot] = Version;
+			Poses[Slot] = Pose;
+			bValid[Slot] = true;
+		}
+
+		void Reset()
+		{
+			FMemory::Memzero(bValid, sizeof(bValid));
+		}
+	};
+
+	/**
+	 * Reads a pose written by WriteVersioned(). Returns false if it is a
+	 * delta against a pose this receiver does not have; the bits are still
+	 * consumed, and the next keyframe brings the receiver up to date.
+	 */
+	inline bool ReadVersioned(FBitReader& Reader, FReceivedPoses& Received, uint32& OutVersion, FQuantizedPose& OutPose)
+	{
+		const uint32 VersionMask = (1u << VersionBits) - 1;
+		OutVersion = ReadBits(Reader, VersionBits);
+		const FQuantizedPose* Baseline = nullptr;
+		bool bHasBaseline = true;
+		if (Reader.ReadBit())
+		{
+			const uint32 BaselineDistance = ReadBits(Reader, FMath::FloorLog2(NumReceivedPoses));
+			Baseline = Received.Find((OutVersion - BaselineDistance) & VersionMask);
+			bHasBaseline = Baseline != nullptr;
+		}
+
+		// Without its baseline a delta still has to be read to skip it.
+		FQuantizedPose Pose;
+		Read(Reader, Pose, bHasBaseline ? Baseline : &Pose);
+		if (!bHasBaseline || Reader.IsError())
+		{
+			return false;
+		}
+		OutPose = Pose;
+		Received.Add(OutVersion, Pose);
+		return true;
+	}
+}
@@ -0,0 +1,247 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "ARPoseQuantization.h"
+
+/**
+ * Simulates one host replicating refining pin poses to many clients and
+ * counts the bytes each client receives, for full precision properties
+ * and for ARPoseQuantization. Only depends on Core, so it runs headless,
+ * e.g. from the PinReplicationBenchmark commandlet on a Linux build
+ * machine.
+ *
+ * Each client connection follows the engine's custom delta replication:
+ * the sender's baseline is the last pose it sent, and reverts to the
+ * baseline it had before a lost packet once the loss is reported one
+ * round trip later.
+ */
+namespace ARPoseReplicationBenchmark
+{
+	struct FSettings
+	{
+		int32 NumPins = 64;
+		int32 NumClients = 32;
+		float UpdateHz = 10.0f;
+		float Seconds = 60.0f;
+
+		/** Fraction of packets lost, in [0, 1). */
+		float PacketLoss = 0.05f;
+
+		/** Round trip time, in updates. */
+		int32 RoundTripUpdates = 2;
+
+		/** Pins and clients are spread over a square of this size, in cm. */
+		float AreaSize = 4000.0f;
+
+		/** Clients only receive pins within this distance, in cm. 0 for all pins. */
+		float RelevancyDistance = 1500.0f;
+
+		double KeyframeSeconds = 2.0;
+		int32 Seed = 1;
+	};
+
+	struct FResult
+	{
+		/** Every changed pose to every client as an FVector and an FQuat. */
+		double FullPrecisionBytesPerClientPerSecond = 0.0;
+
+		/** Every changed pose to relevant clients as a full quantized pose. */
+		double QuantizedBytesPerClientPerSecond = 0.0;
+
+		/** What WriteVersioned() sends to relevant clients. */
+		double DeltaBytesPerClientPerSecond = 0.0;
+
+		int32 NumDeltasWithoutBaseline = 0;
+
+		/** Decoded poses that differ from what the host sent. Must be 0. */
+		int32 NumMismatches = 0;
+
+		float MaxLocationError = 0.0f;
+		float MaxRotationErrorDegrees = 0.0f;
+	};
+
+	struct FPacket
+	{
+		int32 ArrivalUpdate = 0;
+		bool bLost = false;
+		bool bHadBaseline = false;
+		ARPoseQuantization::FBaseline PreviousBaseline;
+		TArray<uint8> Data;
+		int64 NumBits = 0;
+	};
+
+	/** One client's view of one pin. */
+	struct FConnection
+	{
+		bool bRelevant = false;
+		bool bHasBaseline = false;
+		ARPoseQuantization::FBaseline Baseline;
+		TArray<FPacket> InFlight;
+		ARPoseQuantization::FReceivedPoses Received;
+	};
+
+	inline FResult Run(const FSettings& Settings)
+	{
+		FRandomStream RandomStream(Settings.Seed);
+		const float HalfArea = Settings.AreaSize * 0.5f;
+		auto RandomLocation = [&]()
+		{
+			return FVector(RandomStream.FRandRange(-HalfArea, HalfArea), RandomStream.FRandRange(-HalfArea, HalfArea), RandomStream.FRandRange(-50.0f, 50.0f));
+		};
+
+		TArray<FVector> PinLocations;
+		TArray<FQuat> PinRotations;
+		TArray<TArray<ARPoseQuantization::FQuantizedPose>> PinVersions;
+		for (int32 Pin = 0; Pin < Settings.NumPins; Pin++)
+		{
+			PinLocations.Add(RandomLocation());
+			PinRotations.Add(FQuat(FVector::UpVector, RandomStream.FRandRange(-PI, PI)));
+			PinVersions.AddDefaulted();
+			PinVersions[Pin].Add(ARPoseQuantization::Quantize(PinLocations[Pin], PinRotations[Pin]));
+		}
+
+		TArray<FVector> ClientLocations;
+		for (int32 Client = 0; Client < Settings.NumClients; Client++)
+		{
+			ClientLocations.Add(RandomLocation());
+		}
+
+		FResult Result;
+		TArray<FConnection> Connections;
+		Connections.SetNum(Settings.NumClients * Settings.NumPins);
+		int64 FullPrecisionBits = 0;
+		int64 QuantizedBits = 0;
+		int64 DeltaBits = 0;
+
+		const int32 NumUpdates = FMath::Max(FMath::RoundToInt(Settings.Seconds * Settings.UpdateHz), 1);
+		for (int32 Update = 0; Update < NumUpdates; Update++)
+		{
+			const double Now = Update / Settings.UpdateHz;
+
+			// ARCore refines anchors by a few millimeters at a time, and only now and then turns them.
+			TArray<uint8> PinChanged;
+			PinChanged.SetNumZeroed(Settings.NumPins);
+			for (int32 Pin = 0; Pin < Settings.NumPins; Pin++)
+			{
+				if (RandomStream.FRand() < 0.5f)
+				{
+					PinLocations[Pin] += RandomStream.GetUnitVector() * RandomStream.FRandRange(0.0f, 0.5f);
+					PinChanged[Pin] = 1;
+				}
+				if (RandomStream.FRand() < 0.1f)
+				{
+					PinRotations[Pin] = FQuat(RandomStream.GetUnitVector(), FMath::DegreesToRadians(RandomStream.FRandRange(-0.5f, 0.5f))) * PinRotations[Pin];
+					PinChanged[Pin] = 1;
+				}
+
+				const ARPoseQuantization::FQuantizedPose Pose = ARPoseQuantization::Quantize(PinLocations[Pin], PinRotations[Pin]);
+				if (Pose != PinVersions[Pin].Last())
+				{
+					PinVersions[Pin].Add(Pose);
+				}
+				Result.MaxLocationError = FMath::Max(Result.MaxLocationError, FVector::Dist(ARPoseQuantization::DequantizeLocation(Pose), PinLocations[Pin]));
+				Result.MaxRotationErrorDegrees = FMath::Max(Result.MaxRotationErrorDegrees, FMath::RadiansToDegrees(ARPoseQuantization::DequantizeRotation(Pose).AngularDistance(PinRotations[Pin])));
+			}
+
+			for (int32 Client = 0; Client < Settings.NumClients; Client++)
+			{
+				for (int32 Pin = 0; Pin < Settings.NumPins; Pin++)
+				{
+					FConnection& Connection = Connections[Client * Settings.NumPins + Pin];
+
+					// Packets that arrived or were reported lost by now.
+					while (Connection.InFlight.Num() > 0 && Connection.InFlight[0].ArrivalUpdate <= Update)
+					{
+						FPacket& Packet = Connection.InFlight[0];
+						if (Packet.bLost)
+						{
+							if (Packet.bHadBaseline)
+							{
+								Connection.Baseline = Packet.PreviousBaseline;
+							}
+						}
+						else
+						{
+							FBitReader Reader(Packet.Data.GetData(), Packet.NumBits);
+							uint32 Version = 0;
+							ARPoseQuantization::FQuantizedPose Pose;
+							if (!ARPoseQuantization::ReadVersioned(Reader, Connection.Received, Version, Pose))
+							{
+								Result.NumDeltasWithoutBaseline++;
+							}
+							else if (!PinVersions[Pin].IsValidIndex(Version) || Pose != PinVersions[Pin][Version])
+							{
+								Result.NumMismatches++;
+							}
+						}
+						Connection.InFlight.RemoveAt(0, 1, false);
+					}
+
+					const bool bRelevant = Settings.RelevancyDistance <= 0.0f
+						|| FVector::DistSquared(ClientLocations[Client], PinLocations[Pin]) <= FMath::Square(Settings.RelevancyDistance);
+					if (!bRelevant)
+					{
+						// Like a closed actor channel, the client forgets the pin.
+						if (Connection.bRelevant)
+						{
+							Connection = FConnection();
+						}
+						if (PinChanged[Pin])
+						{
+							FullPrecisionBits += ARPoseQuantization::FullPrecisionPoseBits;
+						}
+						continue;
+					}
+
+					const bool bNewlyRelevant = !Connection.bRelevant;
+					Connection.bRelevant = true;
+					if (PinChanged[Pin] || bNewlyRelevant)
+					{
+						FullPrecisionBits += ARPoseQuantization::FullPrecisionPoseBits;
+						QuantizedBits += ARPoseQuantization::MaxPoseBits;
+					}
+
+					const int32 Version = PinVersions[Pin].Num() - 1;
+					FBitWriter Writer(256, true);
+					ARPoseQuantization::FBaseline NewBaseline;
+					if (!ARPoseQuantization::WriteVersioned(Writer, Version, PinVersions[Pin][Version], Connection.bHasBaseline ? &Connection.Baseline : nullptr, Now, Settings.KeyframeSeconds, NewBaseline))
+					{
+						continue;
+					}
+					DeltaBits += Writer.GetNumBits();
+
+					FPacket& Packet = Connection.InFlight.AddDefaulted_GetRef();
+					Packet.ArrivalUpdate = Update + Settings.RoundTripUpdates;
+					Packet.bLost = RandomStream.FRand() < Settings.PacketLoss;
+					Packet.bHadBaseline = Connection.bHasBaseline;
+					Packet.PreviousBaseline = Connection.Baseline;
+					Packet.Data = *Writer.GetBuffer();
+					Packet.NumBits = Writer.GetNumBits();
+					Connection.Baseline = NewBaseline;
+					Connection.bHasBaseline = true;
+				}
+			}
+		}
+
+		const double ClientSeconds = FMath::Max(Settings.NumClients, 1) * (NumUpdates / Settings.UpdateHz);
+		Result.FullPrecisionBytesPerClientPerSecond = FullPrecisionBits / 8.0 / ClientSeconds;
+		Result.QuantizedBytesPerClientPerSecond = QuantizedBits / 8.0 / ClientSeconds;
+		Result.DeltaBytesPerClientPerSecond = DeltaBits / 8.0 / ClientSeconds;
+		return Result;
+	}
+}
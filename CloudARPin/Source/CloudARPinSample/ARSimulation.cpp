@@ -0,0 +1,312 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARSimulation.h"
+
+// Horizontal planes are found at these heights, so that planes found on
+// the same floor or table overlap and merge.
+static const float PlaneHeights[] = { -120.0f, -45.0f, -30.0f };
+
+// Walls are at most this high from their center, in cm.
+static const float MaxWallExtent = 120.0f;
+
+// Fraction of the feature points not on a plane.
+static const float ClutterPointRatio = 0.1f;
+
+// Moving bright rectangles in the camera image.
+static const int32 NumImageRects = 6;
+
+FARSimulation::FARSimulation(const FARSimulationSettings& InSettings)
+	: Settings(InSettings)
+	, RandomStream(InSettings.Seed)
+	, NextPlaneId(0)
+	, SpawnAccumulator(0.0)
+	, TrackingQuality(ETrackingQuality::NotTracking)
+	, bTrackingQualityChanged(false)
+	, TrackingCycleTime(0.0)
+	, ForcedLostSeconds(0.0)
+	, CameraImageFrameNumber(MAX_uint32)
+	, FrameNumber(0)
+	, Timestamp(0.0)
+{
+	Settings.RoomExtent = FMath::Max(Settings.RoomExtent, 10.0f);
+	Settings.MaxPlanes = FMath::Max(Settings.MaxPlanes, 0);
+	Settings.PlaneBoundaryVertices = FMath::Max(Settings.PlaneBoundaryVertices, 3);
+	Settings.PointsPerFrame = FMath::Max(Settings.PointsPerFrame, 0);
+	Settings.CameraImageWidth = FMath::Max(Settings.CameraImageWidth, 0);
+	Settings.CameraImageHeight = FMath::Max(Settings.CameraImageHeight, 0);
+
+	Planes.Reserve(Settings.MaxPlanes);
+	Points.Reserve(Settings.PointsPerFrame);
+}
+
+void FARSimulation::Tick(double DeltaSeconds)
+{
+	FrameNumber++;
+	Timestamp += DeltaSeconds;
+	RemovedPlanes.Reset();
+	for (FPlane& Plane : Planes)
+	{
+		Plane.bAdded = false;
+		Plane.bChanged = false;
+	}
+
+	UpdateTracking(DeltaSeconds);
+
+	// Without full tracking the session learns nothing new about the planes.
+	if (TrackingQuality == ETrackingQuality::OrientationAndPosition)
+	{
+		SpawnAccumulator += DeltaSeconds * Settings.PlaneSpawnRate;
+		while (SpawnAccumulator >= 1.0)
+		{
+			SpawnAccumulator -= 1.0;
+			if (Planes.Num() < Settings.MaxPlanes)
+			{
+				SpawnPlane();
+			}
+		}
+
+		for (FPlane& Plane : Planes)
+		{
+			GrowPlane(Plane, static_cast<float>(DeltaSeconds));
+		}
+		MergePlanes();
+	}
+
+	UpdatePointCloud();
+
+	const float OrbitAngle = static_cast<float>(Timestamp) * 0.2f;
+	const FVector CameraLocation(FMath::Cos(OrbitAngle) * Settings.RoomExtent * 0.5f, FMath::Sin(OrbitAngle) * Settings.RoomExtent * 0.5f, 0.0f);
+	CameraPose = FTransform(FQuat(FVector(0.0f, 0.0f, 1.0f), OrbitAngle + PI), CameraLocation);
+}
+
+void FARSimulation::LoseTracking(float Seconds)
+{
+	ForcedLostSeconds = FMath::Max(ForcedLostSeconds, static_cast<double>(Seconds));
+}
+
+void FARSimulation::UpdateTracking(double DeltaSeconds)
+{
+	ETrackingQuality NewQuality = ETrackingQuality::OrientationAndPosition;
+	if (ForcedLostSeconds > 0.0)
+	{
+		ForcedLostSeconds -= DeltaSeconds;
+		NewQuality = ETrackingQuality::NotTracking;
+	}
+	else
+	{
+		const double CycleSeconds = Settings.TrackingSeconds + Settings.LimitedSeconds + Settings.LostSeconds;
+		if (Settings.LimitedSeconds + Settings.LostSeconds > 0.0f && CycleSeconds > 0.0)
+		{
+			TrackingCycleTime = FMath::Fmod(TrackingCycleTime + DeltaSeconds, CycleSeconds);
+			if (TrackingCycleTime >= Settings.TrackingSeconds + Settings.LimitedSeconds)
+			{
+				NewQuality = ETrackingQuality::NotTracking;
+			}
+			else if (TrackingCycleTime >= Settings.TrackingSeconds)
+			{
+				NewQuality = ETrackingQuality::OrientationOnly;
+			}
+		}
+	}
+
+	bTrackingQualityChanged = NewQuality != TrackingQuality;
+	TrackingQuality = NewQuality;
+}
+
+void FARSimulation::SpawnPlane()
+{
+	FPlane& Plane = Planes.AddDefaulted_GetRef();
+	Plane.Id = NextPlaneId++;
+	Plane.bVertical = RandomStream.FRand() < Settings.VerticalPlaneRatio;
+	Plane.SubsumedById = INDEX_NONE;
+	Plane.bAdded = true;
+	Plane.bChanged = true;
+	Plane.Extent = FVector2D(RandomStream.FRandRange(10.0f, 30.0f), RandomStream.FRandRange(10.0f, 30.0f));
+
+	const float Range = Settings.RoomExtent * 0.8f;
+	if (Plane.bVertical)
+	{
+		// On one of the four walls, the plane's Z facing into the room and its X pointing down.
+		const int32 Wall = RandomStream.RandRange(0, 3);
+		const float Yaw = Wall * HALF_PI;
+		const FQuat Rotation = FQuat(FVector(0.0f, 0.0f, 1.0f), Yaw + PI) * FQuat(FVector(0.0f, 1.0f, 0.0f), HALF_PI);
+		const FVector Normal(FMath::Cos(Yaw), FMath::Sin(Yaw), 0.0f);
+		const FVector Along(-Normal.Y, Normal.X, 0.0f);
+		const FVector Location = Normal * Settings.RoomExtent + Along * RandomStream.FRandRange(-Range, Range) + FVector(0.0f, 0.0f, RandomStream.FRandRange(-40.0f, 40.0f));
+		Plane.LocalToTracking = FTransform(Rotation, Location);
+	}
+	else
+	{
+		const float Height = PlaneHeights[RandomStream.RandRange(0, ARRAY_COUNT(PlaneHeights) - 1)] + RandomStream.FRandRange(-1.0f, 1.0f);
+		const FVector Location(RandomStream.FRandRange(-Range, Range), RandomStream.FRandRange(-Range, Range), Height);
+		Plane.LocalToTracking = FTransform(FQuat(FVector(0.0f, 0.0f, 1.0f), RandomStream.FRandRange(0.0f, 2.0f * PI)), Location);
+	}
+	UpdateBoundary(Plane);
+}
+
+void FARSimulation::GrowPlane(FPlane& Plane, float DeltaSeconds)
+{
+	const float MaxExtentX = Plane.bVertical ? FMath::Min(Settings.MaxPlaneExtent, MaxWallExtent) : Settings.MaxPlaneExtent;
+	const FVector2D OldExtent = Plane.Extent;
+	Plane.Extent.X = FMath::Min(Plane.Extent.X + Settings.PlaneGrowthRate * DeltaSeconds * RandomStream.FRandRange(0.5f, 1.5f), MaxExtentX);
+	Plane.Extent.Y = FMath::Min(Plane.Extent.Y + Settings.PlaneGrowthRate * DeltaSeconds * RandomStream.FRandRange(0.5f, 1.5f), Settings.MaxPlaneExtent);
+	if (Plane.Extent.X != OldExtent.X || Plane.Extent.Y != OldExtent.Y)
+	{
+		Plane.bChanged = true;
+		UpdateBoundary(Plane);
+	}
+}
+
+void FARSimulation::MergePlanes()
+{
+	for (int32 Index = 0; Index < Planes.Num(); Index++)
+	{
+		FPlane& Plane = Planes[Index];
+		if (Plane.bVertical)
+		{
+			continue;
+		}
+
+		for (int32 OtherIndex = Index + 1; OtherIndex < Planes.Num(); OtherIndex++)
+		{
+			FPlane& Other = Planes[OtherIndex];
+			const FVector Offset = Other.LocalToTracking.GetLocation() - Plane.LocalToTracking.GetLocation();
+			const float Radius = FMath::Max(Plane.Extent.X, Plane.Extent.Y);
+			const float OtherRadius = FMath::Max(Other.Extent.X, Other.Extent.Y);
+			const float Distance = FMath::Sqrt(Offset.X * Offset.X + Offset.Y * Offset.Y);
+			if (Other.bVertical || FMath::Abs(Offset.Z) > Settings.MergeHeightTolerance || Distance > (Radius + OtherRadius) * 0.7f)
+			{
+				continue;
+			}
+
+			// The larger plane grows over the smaller one and keeps tracking.
+			const bool bPlaneSurvives = Plane.Extent.X * Plane.Extent.Y >= Other.Extent.X * Other.Extent.Y;
+			FPlane& Survivor = bPlaneSurvives ? Plane : Other;
+			FPlane& Subsumed = bPlaneSurvives ? Other : Plane;
+			const float CoveredExtent = FMath::Min(Distance + FMath::Max(Subsumed.Extent.X, Subsumed.Extent.Y), Settings.MaxPlaneExtent);
+			Survivor.Extent.X = FMath::Max(Survivor.Extent.X, CoveredExtent);
+			Survivor.Extent.Y = FMath::Max(Survivor.Extent.Y, CoveredExtent);
+			Survivor.bChanged = true;
+			UpdateBoundary(Survivor);
+
+			Subsumed.SubsumedById = Survivor.Id;
+			Subsumed.bChanged = true;
+			RemovedPlanes.Add(MoveTemp(Subsumed));
+			if (bPlaneSurvives)
+			{
+				Planes.RemoveAt(OtherIndex, 1, false);
+				OtherIndex--;
+			}
+			else
+			{
+				Planes.RemoveAt(Index, 1, false);
+				Index--;
+				break;
+			}
+		}
+	}
+}
+
+void FARSimulation::UpdateBoundary(FPlane& Plane)
+{
+	// A lumpy ellipse whose shape stays the same as the plane grows.
+	const int32 NumVertices = Settings.PlaneBoundaryVertices;
+	Plane.Boundary.SetNumUninitialized(NumVertices, false);
+	for (int32 Index = 0; Index < NumVertices; Index++)
+	{
+		const float Angle = 2.0f * PI * Index / NumVertices;
+		const float Scale = 0.85f + 0.15f * FMath::Sin(3.0f * Angle + Plane.Id * 1.7f);
+		Plane.Boundary[Index] = FVector(FMath::Cos(Angle) * Plane.Extent.X * Scale, FMath::Sin(Angle) * Plane.Extent.Y * Scale, 0.0f);
+	}
+}
+
+void FARSimulation::UpdatePointCloud()
+{
+	Points.Reset();
+	if (TrackingQuality != ETrackingQuality::OrientationAndPosition)
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < Settings.PointsPerFrame; Index++)
+	{
+		// Roughly normal noise from the sum of three uniform samples.
+		const float Noise = (RandomStream.FRand() + RandomStream.FRand() + RandomStream.FRand() - 1.5f) * 2.0f * Settings.PointNoise;
+		if (Planes.Num() == 0 || RandomStream.FRand() < ClutterPointRatio)
+		{
+			const float Range = Settings.RoomExtent;
+			Points.Add(FVector(RandomStream.FRandRange(-Range, Range), RandomStream.FRandRange(-Range, Range), RandomStream.FRandRange(-120.0f, 120.0f)));
+			continue;
+		}
+
+		const FPlane& Plane = Planes[RandomStream.RandRange(0, Planes.Num() - 1)];
+		const float Angle = RandomStream.FRandRange(0.0f, 2.0f * PI);
+		const float Radius = FMath::Sqrt(RandomStream.FRand()) * 0.8f;
+		const FVector LocalPoint(FMath::Cos(Angle) * Plane.Extent.X * Radius, FMath::Sin(Angle) * Plane.Extent.Y * Radius, Noise);
+		Points.Add(Plane.LocalToTracking.TransformPosition(LocalPoint));
+	}
+}
+
+const TArray<uint8>& FARSimulation::GetCameraImage()
+{
+	if (CameraImageFrameNumber != FrameNumber)
+	{
+		UpdateCameraImage();
+		CameraImageFrameNumber = FrameNumber;
+	}
+	return CameraImage;
+}
+
+void FARSimulation::UpdateCameraImage()
+{
+	const int32 Width = Settings.CameraImageWidth;
+	const int32 Height = Settings.CameraImageHeight;
+	if (Width == 0 || Height == 0)
+	{
+		return;
+	}
+
+	// Every pixel is drawn below.
+	CameraImage.SetNumUninitialized(Width * Height, false);
+
+	// A gradient that pans with the camera, under rectangles that move at
+	// different speeds, so that the image has edges and changes every frame.
+	const int32 Pan = static_cast<int32>(Timestamp * 40.0);
+	uint8* Pixels = CameraImage.GetData();
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		uint8* Row = Pixels + Y * Width;
+		const int32 RowBase = (Y * 96) / Height + 32;
+		for (int32 X = 0; X < Width; X++)
+		{
+			Row[X] = static_cast<uint8>(RowBase + (((X + Pan) >> 3) & 31));
+		}
+	}
+
+	for (int32 Rect = 0; Rect < NumImageRects; Rect++)
+	{
+		const float Speed = 0.3f + Rect * 0.17f;
+		const float Phase = static_cast<float>(Timestamp) * Speed + Rect * 1.3f;
+		const int32 RectWidth = Width / 8 + Rect * Width / 64;
+		const int32 RectHeight = Height / 8 + Rect * Height / 64;
+		const int32 Left = FMath::Clamp(static_cast<int32>((FMath::Sin(Phase) * 0.5f + 0.5f) * (Width - RectWidth)), 0, FMath::Max(Width - RectWidth, 0));
+		const int32 Top = FMath::Clamp(static_cast<int32>((FMath::Cos(Phase * 0.7f) * 0.5f + 0.5f) * (Height - RectHeight)), 0, FMath::Max(Height - RectHeight, 0));
+		const uint8 Value = static_cast<uint8>(160 + Rect * 15);
+		for (int32 Y = Top; Y < FMath::Min(Top + RectHeight, Height); Y++)
+		{
+			FMemory::Memset(Pixels + Y * Width + Left, Value, FMath::Min(RectWidth, Width - Left));
+		}
+	}
+}
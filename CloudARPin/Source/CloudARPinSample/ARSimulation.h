@@ -0,0 +1,181 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+
+/** Settings of an FARSimulation. Every run with the same settings produces the same frames. */
+struct FARSimulationSettings
+{
+	int32 Seed = 1;
+
+	/** Half the size of the simulated room, in cm. Planes and points stay inside it. */
+	float RoomExtent = 400.0f;
+
+	/** New planes found per second of tracking, until MaxPlanes are tracked. */
+	float PlaneSpawnRate = 1.0f;
+	int32 MaxPlanes = 16;
+
+	/** Fraction of the new planes that are walls rather than floors and tables. */
+	float VerticalPlaneRatio = 0.3f;
+
+	/** How fast a plane grows, in cm per second, up to MaxPlaneExtent. */
+	float PlaneGrowthRate = 15.0f;
+	float MaxPlaneExtent = 250.0f;
+
+	int32 PlaneBoundaryVertices = 24;
+
+	/**
+	 * Horizontal planes closer in height than this, in cm, are merged when
+	 * they overlap: the larger one grows over the smaller, which is
+	 * subsumed and stops tracking.
+	 */
+	float MergeHeightTolerance = 4.0f;
+
+	/** Feature points per frame, most of them on planes. */
+	int32 PointsPerFrame = 200;
+
+	/** Standard deviation of the feature points off their surfaces, in cm. */
+	float PointNoise = 0.5f;
+
+	/**
+	 * Tracking cycles through TrackingSeconds of full tracking,
+	 * LimitedSeconds of orientation only tracking and LostSeconds without
+	 * tracking. 0 for both LimitedSeconds and LostSeconds never loses it.
+	 */
+	float TrackingSeconds = 20.0f;
+	float LimitedSeconds = 1.0f;
+	float LostSeconds = 1.0f;
+
+	/** Size of the synthetic luminance camera image. 0 for no image. */
+	int32 CameraImageWidth = 640;
+	int32 CameraImageHeight = 480;
+};
+
+/**
+ * Generates what an AR session reports frame by frame, without a device:
+ * planes that are found, grow and are subsumed by others, feature points
+ * on them, tracking that comes and goes, and camera images with moving
+ * edges.
+ *
+ * It only uses Core, so that headless tools and FSimulatedARSystem share
+ * it. Buffers are reused between frames.
+ */
+class CLOUDARPINSAMPLE_API FARSimulation
+{
+public:
+	enum class ETrackingQuality : uint8
+	{
+		NotTracking,
+		OrientationOnly,
+		OrientationAndPosition,
+	};
+
+	struct FPlane
+	{
+		int32 Id;
+
+		/** Plane space to tracking space. The plane lies in its local XY plane. */
+		FTransform LocalToTracking;
+
+		/** Half the size of the plane along its local X and Y, in cm. */
+		FVector2D Extent;
+
+		/** Vertices around the center in local space, Z = 0. */
+		TArray<FVector> Boundary;
+
+		bool bVertical;
+
+		/** The id of the plane that merged this one, or INDEX_NONE. */
+		int32 SubsumedById;
+
+		/** Found or changed in the latest frame. */
+		bool bAdded;
+		bool bChanged;
+	};
+
+	explicit FARSimulation(const FARSimulationSettings& InSettings);
+
+	/** Simulates the next frame, DeltaSeconds after the previous one. */
+	void Tick(double DeltaSeconds);
+
+	/** Forces tracking to be lost for Seconds, e.g. from a script, then resumes the cycle. */
+	void LoseTracking(float Seconds);
+
+	/** The planes being tracked. Their tracking pauses while tracking is lost. */
+	const TArray<FPlane>& GetPlanes() const { return Planes; }
+
+	/** The planes subsumed by another one this frame. */
+	const TArray<FPlane>& GetRemovedPlanes() const { return RemovedPlanes; }
+
+	/** This frame's feature points in tracking space, empty without full tracking. */
+	const TArray<FVector>& GetPointCloud() const { return Points; }
+
+	ETrackingQuality GetTrackingQuality() const { return TrackingQuality; }
+
+	/** True if the tracking quality changed this frame. */
+	bool HasTrackingQualityChanged() const { return bTrackingQualityChanged; }
+
+	/** The camera's pose in tracking space, orbiting the room. */
+	const FTransform& GetCameraPose() const { return CameraPose; }
+
+	/**
+	 * One byte of luminance per pixel, row by row. The image is only drawn
+	 * on the first call in a frame, so a run that never looks at it, e.g.
+	 * a renderer benchmark, does not pay for it.
+	 */
+	const TArray<uint8>& GetCameraImage();
+	int32 GetCameraImageWidth() const { return Settings.CameraImageWidth; }
+	int32 GetCameraImageHeight() const { return Settings.CameraImageHeight; }
+
+	uint32 GetFrameNumber() const { return FrameNumber; }
+	double GetTimestamp() const { return Timestamp; }
+
+	const FARSimulationSettings& GetSettings() const { return Settings; }
+
+private:
+	void UpdateTracking(double DeltaSeconds);
+	void SpawnPlane();
+	void GrowPlane(FPlane& Plane, float DeltaSeconds);
+	void MergePlanes();
+	void UpdateBoundary(FPlane& Plane);
+	void UpdatePointCloud();
+	void UpdateCameraImage();
+
+	FARSimulationSettings Settings;
+	FRandomStream RandomStream;
+
+	TArray<FPlane> Planes;
+	TArray<FPlane> RemovedPlanes;
+	int32 NextPlaneId;
+	double SpawnAccumulator;
+
+	TArray<FVector> Points;
+
+	ETrackingQuality TrackingQuality;
+	bool bTrackingQualityChanged;
+	double TrackingCycleTime;
+	double ForcedLostSeconds;
+
+	FTransform CameraPose;
+	TArray<uint8> CameraImage;
+
+	/** The frame CameraImage was drawn for. */
+	uint32 CameraImageFrameNumber;
+
+	uint32 FrameNumber;
+	double Timestamp;
+};
@@ -0,0 +1,137 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "ARSimulationBenchmark.h"
+#include "CloudARPinSample.h"
+#include "ARPlaneRenderer.h"
+#include "ARPointCloudRenderer.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "SimulatedARSystem.h"
+
+namespace
+{
+	/** Advances the simulation and ticks a world of its own frame by frame. */
+	ARSimulationBenchmark::FRunResult RunOnce(const ARSimulationBenchmark::FSettings& Settings, bool bSpawnRenderers)
+	{
+		TSharedRef<FSimulatedARSystem, ESPMode::ThreadSafe> ARSystem = FSimulatedARSystem::Install(Settings.Simulation);
+
+		UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("ARSimulationBenchmark"));
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+
+		if (bSpawnRenderers)
+		{
+			World->SpawnActor<AARPointCloudRenderer>();
+			AARPlaneRenderer* PlaneRenderer = World->SpawnActorDeferred<AARPlaneRenderer>(AARPlaneRenderer::StaticClass(), FTransform::Identity);
+			PlaneRenderer->bMergePlanes = Settings.bMergePlanes;
+			PlaneRenderer->FinishSpawning(FTransform::Identity);
+		}
+
+		const float DeltaSeconds = 1.0f / 30.0f;
+		const int32 NumWarmupFrames = 30;
+		const int32 NumFrames = FMath::Max(FMath::CeilToInt(Settings.Seconds * 30.0f), 1);
+		FApp::SetDeltaTime(DeltaSeconds);
+
+		ARSimulationBenchmark::FRunResult Result;
+		TArray<double> FrameTimes;
+		FrameTimes.Reserve(NumFrames);
+		int64 MemoryGrowth = 0;
+		for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; Frame++)
+		{
+			const bool bMeasured = Frame >= NumWarmupFrames;
+			ARSystem->AdvanceFrame(DeltaSeconds);
+
+			// Reading the memory stats may be slow, so it stays out of the frame time.
+			const uint64 UsedMemoryBefore = bMeasured ? FPlatformMemory::GetStats().UsedPhysical : 0;
+			const double StartTime = FPlatformTime::Seconds();
+			World->Tick(LEVELTICK_All, DeltaSeconds);
+			const double EndTime = FPlatformTime::Seconds();
+			GFrameCounter++;
+			if (bMeasured)
+			{
+				FrameTimes.Add((EndTime - StartTime) * 1000.0);
+				MemoryGrowth += static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - static_cast<int64>(UsedMemoryBefore);
+			}
+
+			const FARSimulation& Simulation = ARSystem->GetSimulation();
+			for (const FARSimulation::FPlane& Plane : Simulation.GetPlanes())
+			{
+				Result.NumPlanesFound += Plane.bAdded ? 1 : 0;
+			}
+			Result.NumPlanesSubsumed += Simulation.GetRemovedPlanes().Num();
+			Result.NumTrackingChanges += Simulation.HasTrackingQualityChanged() ? 1 : 0;
+		}
+
+		FrameTimes.Sort();
+		Result.MedianFrameMs = FrameTimes[FrameTimes.Num() / 2];
+		Result.P95FrameMs = FrameTimes[FMath::Min(FrameTimes.Num() * 95 / 100, FrameTimes.Num() - 1)];
+		Result.BytesPerFrame = static_cast<double>(MemoryGrowth) / NumFrames;
+
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		FSimulatedARSystem::Uninstall(ARSystem);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		return Result;
+	}
+
+	void LogRunResult(const TCHAR* Name, const ARSimulationBenchmark::FRunResult& Result)
+	{
+		UE_LOG(LogCloudARPinSample, Display, TEXT("  %-18s %8.3f %8.3f %12.0f"),
+			Name, Result.MedianFrameMs, Result.P95FrameMs, Result.BytesPerFrame);
+	}
+}
+
+namespace ARSimulationBenchmark
+{
+	FResult Run(const FSettings& Settings)
+	{
+		// Both runs see the same frames, since the simulation is deterministic.
+		FResult Result;
+		Result.Baseline = RunOnce(Settings, false);
+		Result.WithRenderers = RunOnce(Settings, true);
+		return Result;
+	}
+
+	TArray<FString> FResult::GetBudgetErrors(const FBudget& Budget) const
+	{
+		const double AddedP95FrameMs = WithRenderers.P95FrameMs - Baseline.P95FrameMs;
+		const double AddedBytesPerFrame = WithRenderers.BytesPerFrame - Baseline.BytesPerFrame;
+
+		TArray<FString> Errors;
+		if (AddedP95FrameMs > Budget.MaxFrameMs)
+		{
+			Errors.Add(FString::Printf(TEXT("The renderers add %.3f ms to the 95th percentile frame, more than the budget of %.3f ms."), AddedP95FrameMs, Budget.MaxFrameMs));
+		}
+		if (AddedBytesPerFrame > Budget.MaxBytesPerFrame)
+		{
+			Errors.Add(FString::Printf(TEXT("The renderers grow used memory by %.0f more bytes per frame, more than the budget of %.0f."), AddedBytesPerFrame, Budget.MaxBytesPerFrame));
+		}
+		return Errors;
+	}
+
+	void FResult::Log(const FSettings& Settings) const
+	{
+		UE_LOG(LogCloudARPinSample, Display, TEXT("Simulated AR, %.0f s, up to %d planes, %d points per frame%s:"),
+			Settings.Seconds, Settings.Simulation.MaxPlanes, Settings.Simulation.PointsPerFrame, Settings.bMergePlanes ? TEXT(", merged planes") : TEXT(""));
+		UE_LOG(LogCloudARPinSample, Display, TEXT("  %d planes found, %d subsumed, %d tracking changes."),
+			WithRenderers.NumPlanesFound, WithRenderers.NumPlanesSubsumed, WithRenderers.NumTrackingChanges);
+		UE_LOG(LogCloudARPinSample, Display, TEXT("  %-18s %8s %8s %12s"), TEXT(""), TEXT("p50 ms"), TEXT("p95 ms"), TEXT("bytes/frame"));
+		LogRunResult(TEXT("Simulation only"), Baseline);
+		LogRunResult(TEXT("With renderers"), WithRenderers);
+	}
+}
@@ -0,0 +1,85 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ARSimulation.h"
+
+/**
+ * Ticks AARPlaneRenderer and AARPointCloudRenderer in a world of their
+ * own against an FSimulatedARSystem, without a device or a GPU, and
+ * measures their per-frame time and memory growth.
+ *
+ * The same simulation runs twice, once without the renderers, so that the
+ * budgets only cover what the renderers add. Memory is measured as the
+ * growth of the process's used memory around each world tick, so it
+ * covers all threads, including the point map's background fusion,
+ * without replacing the engine's allocator.
+ *
+ * The CloudARPin.ARSimulation automation test checks the default budgets;
+ * the ARSimulationBenchmark commandlet runs it with other settings.
+ */
+namespace ARSimulationBenchmark
+{
+	struct FSettings
+	{
+		FARSimulationSettings Simulation;
+
+		/** Simulated time, at 30 frames per second, after one second of warm-up. */
+		float Seconds = 30.0f;
+
+		/** Draw the planes with AARPlaneRenderer's merged mesh. */
+		bool bMergePlanes = false;
+	};
+
+	struct FBudget
+	{
+		/** The most the renderers may add to the 95th percentile frame time. */
+		float MaxFrameMs = 4.0f;
+
+		/** The most the renderers may add to the average growth of used memory per frame, in bytes. */
+		float MaxBytesPerFrame = 16384.0f;
+	};
+
+	struct FRunResult
+	{
+		double MedianFrameMs = 0.0;
+		double P95FrameMs = 0.0;
+
+		/** Average growth of the process's used physical memory per world tick. */
+		double BytesPerFrame = 0.0;
+		int32 NumPlanesFound = 0;
+		int32 NumPlanesSubsumed = 0;
+		int32 NumTrackingChanges = 0;
+	};
+
+	struct FResult
+	{
+		/** The simulation alone. */
+		FRunResult Baseline;
+
+		/** The same simulation with the renderers. */
+		FRunResult WithRenderers;
+
+		/** Returns a message for every budget the renderers go over. */
+		TArray<FString> GetBudgetErrors(const FBudget& Budget) const;
+
+		/** Logs both runs as a table. */
+		void Log(const FSettings& Settings) const;
+	};
+
+	/** Runs the simulation without and with the renderers. Needs GEngine. */
+	FResult Run(const FSettings& Settings);
+}
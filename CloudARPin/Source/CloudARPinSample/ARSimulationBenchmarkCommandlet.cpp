@@ -0,0 +1,55 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "ARSimulationBenchmarkCommandlet.h"
+#include "CloudARPinSample.h"
+#include "ARSimulationBenchmark.h"
+#include "Misc/Parse.h"
+
+UARSimulationBenchmarkCommandlet::UARSimulationBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UARSimulationBenchmarkCommandlet::Main(const FString& Params)
+{
+	ARSimulationBenchmark::FSettings Settings;
+	FParse::Value(*Params, TEXT("Seconds="), Settings.Seconds);
+	FParse::Value(*Params, TEXT("Planes="), Settings.Simulation.MaxPlanes);
+	FParse::Value(*Params, TEXT("PlaneSpawnRate="), Settings.Simulation.PlaneSpawnRate);
+	FParse::Value(*Params, TEXT("PointsPerFrame="), Settings.Simulation.PointsPerFrame);
+	Settings.bMergePlanes = FParse::Param(*Params, TEXT("MergePlanes"));
+
+	ARSimulationBenchmark::FBudget Budget;
+	FParse::Value(*Params, TEXT("MaxFrameMs="), Budget.MaxFrameMs);
+	FParse::Value(*Params, TEXT("MaxBytesPerFrame="), Budget.MaxBytesPerFrame);
+
+	if (Settings.Seconds <= 0.0f || Settings.Simulation.MaxPlanes < 0 || Settings.Simulation.PointsPerFrame < 0)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("Seconds must be positive, Planes and PointsPerFrame at least 0."));
+		return 1;
+	}
+
+	const ARSimulationBenchmark::FResult Result = ARSimulationBenchmark::Run(Settings);
+	Result.Log(Settings);
+
+	const TArray<FString> Errors = Result.GetBudgetErrors(Budget);
+	for (const FString& Error : Errors)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("%s"), *Error);
+	}
+	return Errors.Num() == 0 ? 0 : 1;
+}
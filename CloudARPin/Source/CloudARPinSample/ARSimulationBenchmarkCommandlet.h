@@ -0,0 +1,47 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "ARSimulationBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs ARSimulationBenchmark with settings from the command line, without
+ * a device or a GPU, and checks the renderers against budgets:
+ *
+ *   UE4Editor-Cmd CloudARPinSample.uproject -run=ARSimulationBenchmark -nullrhi
+ *
+ * Options:
+ *   -Seconds=30			Simulated time, at 30 frames per second, after one second of warm-up.
+ *   -Planes=16				The most planes tracked at once.
+ *   -PlaneSpawnRate=1		New planes per second.
+ *   -PointsPerFrame=200	Feature points per frame.
+ *   -MergePlanes			Draw the planes with AARPlaneRenderer's merged mesh.
+ *   -MaxFrameMs=4			Budget for the 95th percentile frame time the renderers add.
+ *   -MaxBytesPerFrame=16384	Budget for the average memory growth per frame the renderers add.
+ *
+ * Returns 1 if the renderers go over a budget.
+ */
+UCLASS()
+class UARSimulationBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UARSimulationBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
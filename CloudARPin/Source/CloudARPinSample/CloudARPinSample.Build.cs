@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class CloudARPinSample : ModuleRules
@@ -22,14 +23,22 @@ public class CloudARPinSample : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
 
+		// Header-only code shared between the samples, e.g. PlaneMeshBuilder.h.
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "..", "..", "..", "Shared"));
+
 		PrivateDependencyModuleNames.AddRange(new string[] {
 			"Sockets",
+			"RenderCore",
+			"RHI",
+			"CloudARPinRendering",
 			"AugmentedReality",
 			"ProceduralMeshComponent",
 			"OnlineSubsystem",
 			"OnlineSubsystemUtils",
 			"AugmentedReality",
+			"HeadMountedDisplay",
 			"GoogleARCoreBase",
+			"GoogleARCoreServices",
 			"AppleARKit"
 		});
 
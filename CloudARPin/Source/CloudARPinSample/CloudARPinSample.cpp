@@ -15,4 +15,8 @@
 #include "CloudARPinSample.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogCloudARPinSample);
+
+CSV_DEFINE_CATEGORY(CloudARPinSample, true);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, CloudARPinSample, "CloudARPinSample" );
@@ -16,4 +16,34 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogCloudARPinSample, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("CloudARPinSample"), STATGROUP_CloudARPinSample, STATCAT_Advanced);
+CSV_DECLARE_CATEGORY_EXTERN(CloudARPinSample);
+
+/** True in builds that keep either stats or CSV stats, i.e. everything but Shipping. */
+#define CLOUDARPIN_STATS_ENABLED (STATS || CSV_PROFILER)
+
+/**
+ * Times the enclosing scope as the cycle stat STAT_<Name>, the CSV
+ * profiler stat CloudARPinSample/<Name> and a named event for external
+ * profilers. Stats are only compiled into Debug and Development builds,
+ * CSV stats and named events into Test builds as well.
+ */
+#define CLOUDARPIN_SCOPED_STAT(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_##Name); \
+	CSV_SCOPED_TIMING_STAT(CloudARPinSample, Name); \
+	SCOPED_NAMED_EVENT(Name, FColor::Orange)
+
+/** Adds Value to the per-frame counter stat STAT_<Name> and the CSV profiler stat CloudARPinSample/<Name>. */
+#define CLOUDARPIN_INC_STAT(Name, Value) \
+	INC_DWORD_STAT_BY(STAT_##Name, Value); \
+	CSV_CUSTOM_STAT(CloudARPinSample, Name, static_cast<int32>(Value), ECsvCustomStatOp::Accumulate)
+
+/** Sets the per-frame counter stat STAT_<Name> and the CSV profiler stat CloudARPinSample/<Name> to Value. */
+#define CLOUDARPIN_SET_STAT(Name, Value) \
+	SET_DWORD_STAT(STAT_##Name, Value); \
+	CSV_CUSTOM_STAT(CloudARPinSample, Name, static_cast<int32>(Value), ECsvCustomStatOp::Set)
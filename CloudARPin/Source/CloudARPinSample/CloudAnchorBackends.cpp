@@ -0,0 +1,134 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "CloudAnchorBackends.h"
+#include "CloudARPinSample.h"
+#include "GoogleARCoreServicesFunctionLibrary.h"
+#include "GoogleARCoreServicesTypes.h"
+
+ECloudAnchorOperationState FARCoreCloudAnchorBackend::StartOperation(int32 OperationId, ECloudAnchorOperationType Type, UARPin* Pin, const FString& CloudId, double Now, FString& OutCloudId, UARPin*& OutPin)
+{
+	UCloudARPin* CloudPin = nullptr;
+	const EARPinCloudTaskResult Result = Type == ECloudAnchorOperationType::Host
+		? UGoogleARCoreServicesFunctionLibrary::CreateAndHostCloudARPin(Pin, CloudPin)
+		: UGoogleARCoreServicesFunctionLibrary::CreateAndResolveCloudARPin(CloudId, CloudPin);
+	if (Result != EARPinCloudTaskResult::Success || CloudPin == nullptr)
+	{
+		// ARCore refuses to start while it is not tracking, which usually passes.
+		UE_LOG(LogCloudARPinSample, Verbose, TEXT("Cloud Anchor operation %d did not start: %d"), OperationId, static_cast<int32>(Result));
+		return ECloudAnchorOperationState::RetryableError;
+	}
+
+	Operations.Add(OperationId, CloudPin);
+	return ECloudAnchorOperationState::InProgress;
+}
+
+ECloudAnchorOperationState FARCoreCloudAnchorBackend::PollOperation(int32 OperationId, double Now, FString& OutCloudId, UARPin*& OutPin)
+{
+	UCloudARPin* CloudPin = Operations.FindRef(OperationId).Get();
+	if (CloudPin == nullptr)
+	{
+		return ECloudAnchorOperationState::Failed;
+	}
+
+	switch (CloudPin->GetARPinCloudState())
+	{
+	case ECloudARPinCloudState::InProgress:
+		return ECloudAnchorOperationState::InProgress;
+	case ECloudARPinCloudState::Success:
+		OutCloudId = CloudPin->GetCloudID();
+		OutPin = CloudPin;
+		return ECloudAnchorOperationState::Success;
+	case ECloudARPinCloudState::ErrorServiceUnavailable:
+	case ECloudARPinCloudState::ErrorResourceExhausted:
+		// The pin is done for, the retry creates a new one.
+		UGoogleARCoreServicesFunctionLibrary::RemoveCloudARPin(CloudPin);
+		return ECloudAnchorOperationState::RetryableError;
+	default:
+		UE_LOG(LogCloudARPinSample, Warning, TEXT("Cloud Anchor operation %d failed: %d"), OperationId, static_cast<int32>(CloudPin->GetARPinCloudState()));
+		UGoogleARCoreServicesFunctionLibrary::RemoveCloudARPin(CloudPin);
+		return ECloudAnchorOperationState::Failed;
+	}
+}
+
+void FARCoreCloudAnchorBackend::CancelOperation(int32 OperationId)
+{
+	TWeakObjectPtr<UCloudARPin> CloudPin;
+	if (Operations.RemoveAndCopyValue(OperationId, CloudPin) && CloudPin.IsValid()
+		&& CloudPin->GetARPinCloudState() == ECloudARPinCloudState::InProgress)
+	{
+		UGoogleARCoreServicesFunctionLibrary::RemoveCloudARPin(CloudPin.Get());
+	}
+}
+
+FMockCloudAnchorBackend::FMockCloudAnchorBackend(const FSettings& InSettings)
+	: Settings(InSettings)
+	, RandomStream(InSettings.Seed)
+	, NumHosted(0)
+	, MaxOperationsInFlight(0)
+{
+}
+
+ECloudAnchorOperationState FMockCloudAnchorBackend::StartOperation(int32 OperationId, ECloudAnchorOperationType Type, UARPin* Pin, const FString& CloudId, double Now, FString& OutCloudId, UARPin*& OutPin)
+{
+	FMockOperation& Operation = Operations.Add(OperationId);
+	if (Type == ECloudAnchorOperationType::Host)
+	{
+		Operation.CloudId = FString::Printf(TEXT("mock-anchor-%d"), NumHosted++);
+	}
+	else
+	{
+		Operation.CloudId = CloudId;
+		NumResolvesStarted.FindOrAdd(CloudId)++;
+	}
+	Operation.FinishTime = Now + RandomStream.FRandRange(Settings.MinLatency, FMath::Max(Settings.MinLatency, Settings.MaxLatency));
+
+	const float Outcome = RandomStream.FRand();
+	if (Outcome < Settings.FatalFailureRate)
+	{
+		Operation.Outcome = ECloudAnchorOperationState::Failed;
+	}
+	else if (Outcome < Settings.FatalFailureRate + Settings.RetryableFailureRate)
+	{
+		Operation.Outcome = ECloudAnchorOperationState::RetryableError;
+	}
+	else
+	{
+		Operation.Outcome = ECloudAnchorOperationState::Success;
+	}
+
+	MaxOperationsInFlight = FMath::Max(MaxOperationsInFlight, Operations.Num());
+	return ECloudAnchorOperationState::InProgress;
+}
+
+ECloudAnchorOperationState FMockCloudAnchorBackend::PollOperation(int32 OperationId, double Now, FString& OutCloudId, UARPin*& OutPin)
+{
+	const FMockOperation* Operation = Operations.Find(OperationId);
+	if (Operation == nullptr)
+	{
+		return ECloudAnchorOperationState::Failed;
+	}
+	if (Now < Operation->FinishTime)
+	{
+		return ECloudAnchorOperationState::InProgress;
+	}
+
+	OutCloudId = Operation->CloudId;
+	OutPin = nullptr;
+	return Operation->Outcome;
+}
+
+void FMockCloudAnchorBackend::CancelOperation(int32 OperationId)
+{
+	Operations.Remove(OperationId);
+}
@@ -0,0 +1,88 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "UObject/WeakObjectPtr.h"
+#include "CloudAnchorQueue.h"
+
+class UCloudARPin;
+
+/** Hosts and resolves Cloud Anchors with the ARCore Cloud Anchor service. Needs a running ARCore session. */
+class CLOUDARPINSAMPLE_API FARCoreCloudAnchorBackend : public ICloudAnchorBackend
+{
+public:
+	virtual ECloudAnchorOperationState StartOperation(int32 OperationId, ECloudAnchorOperationType Type, UARPin* Pin, const FString& CloudId, double Now, FString& OutCloudId, UARPin*& OutPin) override;
+	virtual ECloudAnchorOperationState PollOperation(int32 OperationId, double Now, FString& OutCloudId, UARPin*& OutPin) override;
+	virtual void CancelOperation(int32 OperationId) override;
+
+private:
+	TMap<int32, TWeakObjectPtr<UCloudARPin>> Operations;
+};
+
+/**
+ * A stand-in for the Cloud Anchor service that needs no device and no
+ * network: every operation takes a random time between MinLatency and
+ * MaxLatency and then fails at the configured rates, so that the queue
+ * can be tested and benchmarked on a Linux machine.
+ *
+ * Resolved operations succeed without a pin, as there is no AR session
+ * to put it in.
+ */
+class CLOUDARPINSAMPLE_API FMockCloudAnchorBackend : public ICloudAnchorBackend
+{
+public:
+	struct FSettings
+	{
+		/** Seconds an operation takes, picked uniformly per attempt. */
+		float MinLatency = 1.0f;
+		float MaxLatency = 4.0f;
+
+		/** Fraction of attempts that end with a retryable error, e.g. the service being busy. */
+		float RetryableFailureRate = 0.1f;
+
+		/** Fraction of attempts that fail for good, e.g. an unknown id. */
+		float FatalFailureRate = 0.0f;
+
+		int32 Seed = 0;
+	};
+
+	explicit FMockCloudAnchorBackend(const FSettings& InSettings);
+
+	virtual ECloudAnchorOperationState StartOperation(int32 OperationId, ECloudAnchorOperationType Type, UARPin* Pin, const FString& CloudId, double Now, FString& OutCloudId, UARPin*& OutPin) override;
+	virtual ECloudAnchorOperationState PollOperation(int32 OperationId, double Now, FString& OutCloudId, UARPin*& OutPin) override;
+	virtual void CancelOperation(int32 OperationId) override;
+
+	/** The most operations that ran at the same time. */
+	int32 GetMaxOperationsInFlight() const { return MaxOperationsInFlight; }
+
+	/** Operations started per id, to check that repeated resolves were merged. */
+	const TMap<FString, int32>& GetNumResolvesStarted() const { return NumResolvesStarted; }
+
+private:
+	struct FMockOperation
+	{
+		FString CloudId;
+		double FinishTime;
+		ECloudAnchorOperationState Outcome;
+	};
+
+	FSettings Settings;
+	FRandomStream RandomStream;
+	TMap<int32, FMockOperation> Operations;
+	TMap<FString, int32> NumResolvesStarted;
+	int32 NumHosted;
+	int32 MaxOperationsInFlight;
+};
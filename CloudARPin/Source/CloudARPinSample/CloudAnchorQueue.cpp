@@ -0,0 +1,261 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "CloudAnchorQueue.h"
+#include "CloudARPinSample.h"
+#include "ARPin.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cloud Anchor Operations Started"), STAT_CloudAnchorOperationsStarted, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cloud Anchor Retries"), STAT_CloudAnchorRetries, STATGROUP_CloudARPinSample);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cloud Anchor Operations In Flight"), STAT_CloudAnchorOperationsInFlight, STATGROUP_CloudARPinSample);
+
+FCloudAnchorQueue::FCloudAnchorQueue(ICloudAnchorBackend& InBackend, const FSettings& InSettings)
+	: Backend(InBackend)
+	, Settings(InSettings)
+	, RandomStream(0)
+	, NextOperationId(1)
+	, NextRequestId(1)
+	, NumInFlight(0)
+	, NumStarted(0)
+	, NumRetries(0)
+{
+	Settings.MaxConcurrentOperations = FMath::Max(Settings.MaxConcurrentOperations, 1);
+	Settings.MaxAttempts = FMath::Max(Settings.MaxAttempts, 1);
+}
+
+FCloudAnchorQueue::~FCloudAnchorQueue()
+{
+	// Whoever bound OnRequestComplete may be gone already, so only stop the backend.
+	for (const TPair<int32, FOperation>& Pair : Operations)
+	{
+		if (Pair.Value.State == ECloudAnchorOperationState::InProgress)
+		{
+			Backend.CancelOperation(Pair.Key);
+		}
+	}
+}
+
+int32 FCloudAnchorQueue::Host(UARPin* Pin)
+{
+	const int32 OperationId = AddOperation(ECloudAnchorOperationType::Host, Pin, FString());
+	const int32 RequestId = NextRequestId++;
+	Operations[OperationId].RequestIds.Add(RequestId);
+	RequestToOperation.Add(RequestId, OperationId);
+	return RequestId;
+}
+
+int32 FCloudAnchorQueue::Resolve(const FString& CloudId)
+{
+	int32 OperationId = INDEX_NONE;
+	if (const int32* ExistingOperationId = ResolveOperations.Find(CloudId))
+	{
+		OperationId = *ExistingOperationId;
+	}
+	else
+	{
+		OperationId = AddOperation(ECloudAnchorOperationType::Resolve, nullptr, CloudId);
+		ResolveOperations.Add(CloudId, OperationId);
+	}
+
+	const int32 RequestId = NextRequestId++;
+	Operations[OperationId].RequestIds.Add(RequestId);
+	RequestToOperation.Add(RequestId, OperationId);
+	return RequestId;
+}
+
+int32 FCloudAnchorQueue::AddOperation(ECloudAnchorOperationType Type, UARPin* Pin, const FString& CloudId)
+{
+	const int32 OperationId = NextOperationId++;
+	FOperation& Operation = Operations.Add(OperationId);
+	Operation.Type = Type;
+	Operation.Pin = Pin;
+	Operation.CloudId = CloudId;
+	OperationOrder.Add(OperationId);
+	return OperationId;
+}
+
+bool FCloudAnchorQueue::Cancel(int32 RequestId)
+{
+	int32 OperationId = INDEX_NONE;
+	if (!RequestToOperation.RemoveAndCopyValue(RequestId, OperationId))
+	{
+		return false;
+	}
+
+	FOperation& Operation = Operations[OperationId];
+	const ECloudAnchorOperationType Type = Operation.Type;
+	Operation.RequestIds.Remove(RequestId);
+	if (Operation.RequestIds.Num() == 0)
+	{
+		if (Operation.State == ECloudAnchorOperationState::InProgress)
+		{
+			Backend.CancelOperation(OperationId);
+			NumInFlight--;
+		}
+		if (Operation.Type == ECloudAnchorOperationType::Resolve)
+		{
+			ResolveOperations.Remove(Operation.CloudId);
+		}
+		Operations.Remove(OperationId);
+		OperationOrder.Remove(OperationId);
+	}
+
+	FCloudAnchorResult Result;
+	Result.Type = Type;
+	Result.State = ECloudAnchorOperationState::Cancelled;
+	OnRequestComplete.ExecuteIfBound(RequestId, Result);
+	return true;
+}
+
+void FCloudAnchorQueue::CancelAll()
+{
+	TArray<int32> RequestIds;
+	RequestToOperation.GenerateKeyArray(RequestIds);
+	for (int32 RequestId : RequestIds)
+	{
+		Cancel(RequestId);
+	}
+}
+
+void FCloudAnchorQueue::Tick(double Now)
+{
+	// Completing a request may queue or cancel others, so callbacks wait until the queue is consistent again.
+	Completions.Reset();
+
+	for (TPair<int32, FOperation>& Pair : Operations)
+	{
+		if (Pair.Value.State == ECloudAnchorOperationState::InProgress)
+		{
+			FString CloudId;
+			UARPin* Pin = nullptr;
+			const ECloudAnchorOperationState State = Backend.PollOperation(Pair.Key, Now, CloudId, Pin);
+			HandleOperationState(Pair.Key, Pair.Value, State, Now, CloudId, Pin);
+		}
+	}
+
+	// Earlier operations first, so that retries do not starve new requests for long.
+	for (int32 OperationId : OperationOrder)
+	{
+		if (NumInFlight >= Settings.MaxConcurrentOperations)
+		{
+			break;
+		}
+		FOperation& Operation = Operations[OperationId];
+		if (Operation.State == ECloudAnchorOperationState::Pending && Operation.NextAttemptTime <= Now)
+		{
+			StartOperation(OperationId, Operation, Now);
+		}
+	}
+
+	for (int32 Index = OperationOrder.Num() - 1; Index >= 0; Index--)
+	{
+		const int32 OperationId = OperationOrder[Index];
+		const FOperation& Operation = Operations[OperationId];
+		if (Operation.State != ECloudAnchorOperationState::Pending && Operation.State != ECloudAnchorOperationState::InProgress)
+		{
+			Operations.Remove(OperationId);
+			OperationOrder.RemoveAt(Index, 1, false);
+		}
+	}
+
+	CLOUDARPIN_SET_STAT(CloudAnchorOperationsInFlight, NumInFlight);
+
+	TArray<TPair<int32, FCloudAnchorResult>> CompletedRequests = MoveTemp(Completions);
+	for (const TPair<int32, FCloudAnchorResult>& Completion : CompletedRequests)
+	{
+		OnRequestComplete.ExecuteIfBound(Completion.Key, Completion.Value);
+	}
+}
+
+void FCloudAnchorQueue::StartOperation(int32 OperationId, FOperation& Operation, double Now)
+{
+	UARPin* Pin = Operation.Pin.Get();
+	if (Operation.Type == ECloudAnchorOperationType::Host && Pin == nullptr)
+	{
+		CompleteOperation(Operation, ECloudAnchorOperationState::Failed, FString(), nullptr);
+		return;
+	}
+
+	Operation.State = ECloudAnchorOperationState::InProgress;
+	Operation.NumAttempts++;
+	NumInFlight++;
+	NumStarted++;
+	CLOUDARPIN_INC_STAT(CloudAnchorOperationsStarted, 1);
+
+	FString CloudId;
+	UARPin* ResultPin = nullptr;
+	const ECloudAnchorOperationState State = Backend.StartOperation(OperationId, Operation.Type, Pin, Operation.CloudId, Now, CloudId, ResultPin);
+	if (State != ECloudAnchorOperationState::InProgress)
+	{
+		HandleOperationState(OperationId, Operation, State, Now, CloudId, ResultPin);
+	}
+}
+
+void FCloudAnchorQueue::HandleOperationState(int32 OperationId, FOperation& Operation, ECloudAnchorOperationState State, double Now, const FString& CloudId, UARPin* Pin)
+{
+	if (State == ECloudAnchorOperationState::InProgress || State == ECloudAnchorOperationState::Pending)
+	{
+		return;
+	}
+
+	Backend.CancelOperation(OperationId);
+	NumInFlight--;
+
+	if (State == ECloudAnchorOperationState::RetryableError)
+	{
+		if (Operation.NumAttempts >= Settings.MaxAttempts)
+		{
+			if (Operation.Type == ECloudAnchorOperationType::Host)
+			{
+				UE_LOG(LogCloudARPinSample, Log, TEXT("Hosting a Cloud Anchor failed after %d attempts."), Operation.NumAttempts);
+			}
+			else
+			{
+				UE_LOG(LogCloudARPinSample, Log, TEXT("Resolving Cloud Anchor %s failed after %d attempts."), *Operation.CloudId, Operation.NumAttempts);
+			}
+			CompleteOperation(Operation, ECloudAnchorOperationState::Failed, CloudId, nullptr);
+			return;
+		}
+
+		const float Delay = FMath::Min(Settings.InitialRetryDelay * static_cast<float>(1 << FMath::Min(Operation.NumAttempts - 1, 30)), Settings.MaxRetryDelay);
+		Operation.NextAttemptTime = Now + Delay * RandomStream.FRandRange(1.0f - Settings.RetryJitter, 1.0f);
+		Operation.State = ECloudAnchorOperationState::Pending;
+		NumRetries++;
+		CLOUDARPIN_INC_STAT(CloudAnchorRetries, 1);
+		return;
+	}
+
+	CompleteOperation(Operation, State, CloudId, Pin);
+}
+
+void FCloudAnchorQueue::CompleteOperation(FOperation& Operation, ECloudAnchorOperationState State, const FString& CloudId, UARPin* Pin)
+{
+	Operation.State = State;
+	if (Operation.Type == ECloudAnchorOperationType::Resolve)
+	{
+		ResolveOperations.Remove(Operation.CloudId);
+	}
+
+	FCloudAnchorResult Result;
+	Result.Type = Operation.Type;
+	Result.State = State;
+	Result.CloudId = State == ECloudAnchorOperationState::Success ? CloudId : Operation.CloudId;
+	Result.Pin = Pin;
+	Result.NumAttempts = Operation.NumAttempts;
+	for (int32 RequestId : Operation.RequestIds)
+	{
+		RequestToOperation.Remove(RequestId);
+		Completions.Emplace(RequestId, Result);
+	}
+	Operation.RequestIds.Reset();
+}
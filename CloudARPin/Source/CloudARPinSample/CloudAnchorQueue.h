@@ -0,0 +1,179 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "UObject/WeakObjectPtr.h"
+
+#include "CloudAnchorQueue.generated.h"
+
+class UARPin;
+
+UENUM(BlueprintType)
+enum class ECloudAnchorOperationType : uint8
+{
+	Host,
+	Resolve
+};
+
+UENUM(BlueprintType)
+enum class ECloudAnchorOperationState : uint8
+{
+	/** Waiting for a free slot or for its retry delay to pass. */
+	Pending,
+	InProgress,
+	Success,
+	/** Failed in a way that may go away, e.g. the service was busy or the pin had too few features yet. */
+	RetryableError,
+	/** Failed for good, e.g. the Cloud Anchor id does not exist. */
+	Failed,
+	Cancelled
+};
+
+/** Hosts or resolves Cloud Anchors for FCloudAnchorQueue: ARCore on a device, FMockCloudAnchorBackend offline. */
+class ICloudAnchorBackend
+{
+public:
+	virtual ~ICloudAnchorBackend() {}
+
+	/**
+	 * Starts hosting Pin or resolving CloudId. Returns InProgress, or the
+	 * final state if the operation finished or failed right away, with the
+	 * hosted or resolved pin as PollOperation() would.
+	 */
+	virtual ECloudAnchorOperationState StartOperation(int32 OperationId, ECloudAnchorOperationType Type, UARPin* Pin, const FString& CloudId, double Now, FString& OutCloudId, UARPin*& OutPin) = 0;
+
+	/** Returns the state of a started operation, with the hosted or resolved pin once it succeeded. */
+	virtual ECloudAnchorOperationState PollOperation(int32 OperationId, double Now, FString& OutCloudId, UARPin*& OutPin) = 0;
+
+	/** Stops a started operation and forgets it. Also called after an operation finished. */
+	virtual void CancelOperation(int32 OperationId) = 0;
+};
+
+/** The outcome of one Host() or Resolve() request. */
+struct FCloudAnchorResult
+{
+	ECloudAnchorOperationType Type = ECloudAnchorOperationType::Resolve;
+	ECloudAnchorOperationState State = ECloudAnchorOperationState::Pending;
+	FString CloudId;
+	UARPin* Pin = nullptr;
+
+	/** Backend operations it took, including retries. */
+	int32 NumAttempts = 0;
+};
+
+DECLARE_DELEGATE_TwoParams(FOnCloudAnchorRequestComplete, int32 /*RequestId*/, const FCloudAnchorResult& /*Result*/);
+
+/**
+ * Hosts and resolves Cloud Anchors through an ICloudAnchorBackend with at
+ * most MaxConcurrentOperations in flight, retrying retryable errors with
+ * exponential backoff.
+ *
+ * Resolve requests for an id that is already queued or in flight join
+ * that operation instead of starting another one; each request still
+ * completes on its own and can be cancelled on its own. An operation is
+ * only cancelled in the backend once all of its requests are.
+ *
+ * Not thread safe; call everything from the game thread and Tick() once
+ * per frame.
+ */
+class CLOUDARPINSAMPLE_API FCloudAnchorQueue
+{
+public:
+	struct FSettings
+	{
+		int32 MaxConcurrentOperations = 4;
+
+		/** Backend operations per request, including the first one. */
+		int32 MaxAttempts = 5;
+
+		/** The delay before the first retry, in seconds. It doubles with every retry up to MaxRetryDelay. */
+		float InitialRetryDelay = 1.0f;
+		float MaxRetryDelay = 16.0f;
+
+		/** Each retry waits a random fraction of its delay between 1 - RetryJitter and 1, so that failed requests do not retry in lockstep. */
+		float RetryJitter = 0.5f;
+	};
+
+	FCloudAnchorQueue(ICloudAnchorBackend& InBackend, const FSettings& InSettings);
+	~FCloudAnchorQueue();
+
+	/** Queues hosting Pin. Returns the request id passed to OnRequestComplete. */
+	int32 Host(UARPin* Pin);
+
+	/** Queues resolving CloudId, sharing the operation of any other queued or in flight resolve of it. */
+	int32 Resolve(const FString& CloudId);
+
+	/** Cancels a request; OnRequestComplete is called with Cancelled. Returns false if it already completed. */
+	bool Cancel(int32 RequestId);
+
+	/** Cancels all requests. */
+	void CancelAll();
+
+	/** Polls the operations in flight, completes finished requests and starts queued operations. */
+	void Tick(double Now);
+
+	/** Requests that have not completed. */
+	int32 GetNumPendingRequests() const { return RequestToOperation.Num(); }
+
+	/** Operations currently running in the backend. */
+	int32 GetNumOperationsInFlight() const { return NumInFlight; }
+
+	/** Operations started in the backend so far, including retries. */
+	int32 GetNumOperationsStarted() const { return NumStarted; }
+
+	int32 GetNumRetries() const { return NumRetries; }
+
+	/** Called once for every request, from Tick() or Cancel(). */
+	FOnCloudAnchorRequestComplete OnRequestComplete;
+
+private:
+	struct FOperation
+	{
+		ECloudAnchorOperationType Type;
+		TWeakObjectPtr<UARPin> Pin;
+		FString CloudId;
+		TArray<int32> RequestIds;
+		ECloudAnchorOperationState State = ECloudAnchorOperationState::Pending;
+		int32 NumAttempts = 0;
+		double NextAttemptTime = 0.0;
+	};
+
+	int32 AddOperation(ECloudAnchorOperationType Type, UARPin* Pin, const FString& CloudId);
+	void StartOperation(int32 OperationId, FOperation& Operation, double Now);
+	void HandleOperationState(int32 OperationId, FOperation& Operation, ECloudAnchorOperationState State, double Now, const FString& CloudId, UARPin* Pin);
+	void CompleteOperation(FOperation& Operation, ECloudAnchorOperationState State, const FString& CloudId, UARPin* Pin);
+
+	ICloudAnchorBackend& Backend;
+	FSettings Settings;
+	FRandomStream RandomStream;
+
+	TMap<int32, FOperation> Operations;
+
+	/** Operation ids in the order they were queued, so that earlier requests start first. */
+	TArray<int32> OperationOrder;
+
+	TMap<int32, int32> RequestToOperation;
+	TMap<FString, int32> ResolveOperations;
+
+	/** Requests completed during Tick(), reported at its end. */
+	TArray<TPair<int32, FCloudAnchorResult>> Completions;
+
+	int32 NextOperationId;
+	int32 NextRequestId;
+	int32 NumInFlight;
+	int32 NumStarted;
+	int32 NumRetries;
+};
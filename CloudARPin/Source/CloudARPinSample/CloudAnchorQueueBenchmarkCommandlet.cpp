@@ -0,0 +1,217 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "CloudAnchorQueueBenchmarkCommandlet.h"
+#include "CloudARPinSample.h"
+#include "CloudAnchorBackends.h"
+#include "CloudAnchorQueue.h"
+#include "Math/RandomStream.h"
+#include "Misc/Parse.h"
+
+namespace
+{
+	struct FRunResult
+	{
+		/** Simulated seconds until the last request completed. */
+		double Seconds = 0.0;
+
+		int32 NumSucceeded = 0;
+		int32 NumFailed = 0;
+		int32 NumCancelled = 0;
+		int32 NumIncomplete = 0;
+
+		int32 NumOperationsStarted = 0;
+		int32 NumRetries = 0;
+		int32 MaxOperationsInFlight = 0;
+		int32 MaxResolvesStartedPerId = 0;
+
+		/** Seconds from request to success. */
+		double MedianLatency = 0.0;
+		double P95Latency = 0.0;
+	};
+
+	FRunResult RunQueue(
+		const FMockCloudAnchorBackend::FSettings& MockSettings,
+		const FCloudAnchorQueue::FSettings& QueueSettings,
+		int32 NumPins,
+		int32 NumRepeats,
+		float CancelRate,
+		bool bOneAtATime)
+	{
+		FMockCloudAnchorBackend Backend(MockSettings);
+		FCloudAnchorQueue Queue(Backend, QueueSettings);
+
+		// Repeats of an id are spread over the requests, like clients joining one after another.
+		FRandomStream RandomStream(MockSettings.Seed + 1);
+		const int32 NumRequests = NumPins * NumRepeats;
+		TArray<FString> CloudIds;
+		TArray<double> CancelTimes;
+		for (int32 Index = 0; Index < NumRequests; Index++)
+		{
+			CloudIds.Add(FString::Printf(TEXT("anchor-%d"), Index % NumPins));
+			CancelTimes.Add(RandomStream.FRand() < CancelRate ? RandomStream.FRandRange(0.0f, 5.0f) : -1.0);
+		}
+
+		FRunResult Result;
+		TMap<int32, int32> RequestIndices;
+		TArray<double> RequestTimes;
+		TArray<int32> RequestIds;
+		TArray<double> Latencies;
+		double Now = 0.0;
+		bool bWaiting = false;
+		Queue.OnRequestComplete.BindLambda([&](int32 RequestId, const FCloudAnchorResult& RequestResult)
+		{
+			const int32 Index = RequestIndices.FindChecked(RequestId);
+			switch (RequestResult.State)
+			{
+			case ECloudAnchorOperationState::Success:
+				Result.NumSucceeded++;
+				Latencies.Add(Now - RequestTimes[Index]);
+				break;
+			case ECloudAnchorOperationState::Cancelled:
+				Result.NumCancelled++;
+				break;
+			default:
+				Result.NumFailed++;
+				break;
+			}
+			CancelTimes[Index] = -1.0;
+			bWaiting = false;
+		});
+
+		const double TimeStep = 1.0 / 30.0;
+		const double MaxSeconds = 3600.0;
+		while (Now < MaxSeconds)
+		{
+			while (RequestIds.Num() < NumRequests && !(bOneAtATime && bWaiting))
+			{
+				const int32 RequestId = Queue.Resolve(CloudIds[RequestIds.Num()]);
+				RequestIndices.Add(RequestId, RequestIds.Num());
+				RequestTimes.Add(Now);
+				RequestIds.Add(RequestId);
+				bWaiting = true;
+			}
+
+			for (int32 Index = 0; Index < RequestIds.Num(); Index++)
+			{
+				if (CancelTimes[Index] >= 0.0 && RequestTimes[Index] + CancelTimes[Index] <= Now)
+				{
+					Queue.Cancel(RequestIds[Index]);
+				}
+			}
+
+			Queue.Tick(Now);
+			if (RequestIds.Num() == NumRequests && Queue.GetNumPendingRequests() == 0)
+			{
+				break;
+			}
+			Now += TimeStep;
+		}
+
+		Result.Seconds = Now;
+		Result.NumIncomplete = NumRequests - RequestIds.Num() + Queue.GetNumPendingRequests();
+		Result.NumOperationsStarted = Queue.GetNumOperationsStarted();
+		Result.NumRetries = Queue.GetNumRetries();
+		Result.MaxOperationsInFlight = Backend.GetMaxOperationsInFlight();
+		for (const TPair<FString, int32>& Pair : Backend.GetNumResolvesStarted())
+		{
+			Result.MaxResolvesStartedPerId = FMath::Max(Result.MaxResolvesStartedPerId, Pair.Value);
+		}
+
+		Latencies.Sort();
+		if (Latencies.Num() > 0)
+		{
+			Result.MedianLatency = Latencies[Latencies.Num() / 2];
+			Result.P95Latency = Latencies[FMath::Min(Latencies.Num() * 95 / 100, Latencies.Num() - 1)];
+		}
+		return Result;
+	}
+
+	void LogRunResult(const TCHAR* Name, const FRunResult& Result)
+	{
+		UE_LOG(LogCloudARPinSample, Display, TEXT("  %-14s %8.1f %9d %6d %9d %8d %7d %9d %8.1f %8.1f"),
+			Name, Result.Seconds, Result.NumSucceeded, Result.NumFailed, Result.NumCancelled,
+			Result.NumOperationsStarted, Result.NumRetries, Result.MaxOperationsInFlight, Result.MedianLatency, Result.P95Latency);
+	}
+}
+
+UCloudAnchorQueueBenchmarkCommandlet::UCloudAnchorQueueBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UCloudAnchorQueueBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 NumPins = 50;
+	int32 NumRepeats = 3;
+	float CancelRate = 0.05f;
+	FParse::Value(*Params, TEXT("Pins="), NumPins);
+	FParse::Value(*Params, TEXT("Repeats="), NumRepeats);
+	FParse::Value(*Params, TEXT("CancelRate="), CancelRate);
+
+	FMockCloudAnchorBackend::FSettings MockSettings;
+	FParse::Value(*Params, TEXT("MinLatency="), MockSettings.MinLatency);
+	FParse::Value(*Params, TEXT("MaxLatency="), MockSettings.MaxLatency);
+	FParse::Value(*Params, TEXT("FailureRate="), MockSettings.RetryableFailureRate);
+	FParse::Value(*Params, TEXT("FatalRate="), MockSettings.FatalFailureRate);
+
+	FCloudAnchorQueue::FSettings QueueSettings;
+	FParse::Value(*Params, TEXT("Concurrency="), QueueSettings.MaxConcurrentOperations);
+
+	if (NumPins <= 0 || NumRepeats <= 0 || QueueSettings.MaxConcurrentOperations <= 0)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("Pins, Repeats and Concurrency must be positive."));
+		return 1;
+	}
+	if (MockSettings.MinLatency < 0.0f || MockSettings.MaxLatency < MockSettings.MinLatency)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("MinLatency must be at least 0 and MaxLatency at least MinLatency."));
+		return 1;
+	}
+
+	// The Blueprint flow resolves one id after another and gives up on the first error.
+	FCloudAnchorQueue::FSettings OneAtATimeSettings;
+	OneAtATimeSettings.MaxConcurrentOperations = 1;
+	OneAtATimeSettings.MaxAttempts = 1;
+	const FRunResult OneAtATime = RunQueue(MockSettings, OneAtATimeSettings, NumPins, NumRepeats, CancelRate, true);
+	const FRunResult Queued = RunQueue(MockSettings, QueueSettings, NumPins, NumRepeats, CancelRate, false);
+
+	UE_LOG(LogCloudARPinSample, Display, TEXT("Cloud Anchor resolve, %d ids x %d requests, %.1f-%.1f s latency, %.0f%% retryable and %.0f%% fatal errors, %.0f%% cancelled:"),
+		NumPins, NumRepeats, MockSettings.MinLatency, MockSettings.MaxLatency,
+		MockSettings.RetryableFailureRate * 100.0f, MockSettings.FatalFailureRate * 100.0f, CancelRate * 100.0f);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  %-14s %8s %9s %6s %9s %8s %7s %9s %8s %8s"),
+		TEXT(""), TEXT("Seconds"), TEXT("Succeeded"), TEXT("Failed"), TEXT("Cancelled"), TEXT("Started"), TEXT("Retries"), TEXT("InFlight"), TEXT("p50 s"), TEXT("p95 s"));
+	LogRunResult(TEXT("One at a time"), OneAtATime);
+	LogRunResult(TEXT("Queued"), Queued);
+
+	bool bPassed = true;
+	if (Queued.MaxOperationsInFlight > QueueSettings.MaxConcurrentOperations)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("%d operations ran at once, more than the %d allowed."), Queued.MaxOperationsInFlight, QueueSettings.MaxConcurrentOperations);
+		bPassed = false;
+	}
+	if (Queued.MaxResolvesStartedPerId > QueueSettings.MaxAttempts)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("An id was resolved %d times, repeated requests were not merged."), Queued.MaxResolvesStartedPerId);
+		bPassed = false;
+	}
+	if (OneAtATime.NumIncomplete > 0 || Queued.NumIncomplete > 0)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("%d requests did not complete."), OneAtATime.NumIncomplete + Queued.NumIncomplete);
+		bPassed = false;
+	}
+	return bPassed ? 0 : 1;
+}
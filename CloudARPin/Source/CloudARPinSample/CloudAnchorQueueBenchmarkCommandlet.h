@@ -0,0 +1,52 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "CloudAnchorQueueBenchmarkCommandlet.generated.h"
+
+/**
+ * Resolves many Cloud Anchors through FCloudAnchorQueue and the mock
+ * backend on a simulated clock, once one request at a time without
+ * retries like the Blueprint flow and once all at once through the
+ * queue, without a device or network access:
+ *
+ *   UE4Editor-Cmd CloudARPinSample.uproject -run=CloudAnchorQueueBenchmark -nullrhi
+ *
+ * Options:
+ *   -Pins=50				Distinct Cloud Anchor ids.
+ *   -Repeats=3				Resolve requests per id, as from several clients.
+ *   -Concurrency=4			Operations in flight at once.
+ *   -MinLatency=1			Seconds per mock operation, picked uniformly.
+ *   -MaxLatency=4
+ *   -FailureRate=0.1		Fraction of mock operations with a retryable error.
+ *   -FatalRate=0			Fraction of mock operations that fail for good.
+ *   -CancelRate=0.05		Fraction of requests cancelled within their first 5 seconds.
+ *
+ * Returns 1 if the queue ran more operations at once than allowed,
+ * started more than one operation per id at a time, or left a request
+ * without completion.
+ */
+UCLASS()
+class UCloudAnchorQueueBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCloudAnchorQueueBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
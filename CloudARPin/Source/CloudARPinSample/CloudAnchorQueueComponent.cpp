@@ -0,0 +1,114 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "CloudAnchorQueueComponent.h"
+#include "CloudARPinSample.h"
+#include "CloudAnchorBackends.h"
+
+UCloudAnchorQueueComponent::UCloudAnchorQueueComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+
+	MaxConcurrentOperations = 4;
+	MaxAttempts = 5;
+	InitialRetryDelay = 1.0f;
+	MaxRetryDelay = 16.0f;
+
+	bUseMockBackend = false;
+	MockMinLatency = 1.0f;
+	MockMaxLatency = 4.0f;
+	MockRetryableFailureRate = 0.1f;
+	MockFatalFailureRate = 0.0f;
+}
+
+void UCloudAnchorQueueComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bUseMockBackend)
+	{
+		FMockCloudAnchorBackend::FSettings MockSettings;
+		MockSettings.MinLatency = MockMinLatency;
+		MockSettings.MaxLatency = MockMaxLatency;
+		MockSettings.RetryableFailureRate = MockRetryableFailureRate;
+		MockSettings.FatalFailureRate = MockFatalFailureRate;
+		Backend = MakeUnique<FMockCloudAnchorBackend>(MockSettings);
+	}
+	else
+	{
+		Backend = MakeUnique<FARCoreCloudAnchorBackend>();
+	}
+
+	FCloudAnchorQueue::FSettings Settings;
+	Settings.MaxConcurrentOperations = MaxConcurrentOperations;
+	Settings.MaxAttempts = MaxAttempts;
+	Settings.InitialRetryDelay = InitialRetryDelay;
+	Settings.MaxRetryDelay = MaxRetryDelay;
+	Queue = MakeUnique<FCloudAnchorQueue>(*Backend, Settings);
+	Queue->OnRequestComplete.BindUObject(this, &UCloudAnchorQueueComponent::HandleRequestComplete);
+}
+
+void UCloudAnchorQueueComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The queue stops its operations in the backend, so it goes first.
+	Queue.Reset();
+	Backend.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCloudAnchorQueueComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// Real time, since the service keeps working while the game is paused.
+	if (Queue.IsValid())
+	{
+		Queue->Tick(FPlatformTime::Seconds());
+	}
+}
+
+int32 UCloudAnchorQueueComponent::HostPin(UARPin* Pin)
+{
+	if (!Queue.IsValid())
+	{
+		UE_LOG(LogCloudARPinSample, Warning, TEXT("HostPin was called before BeginPlay."));
+		return INDEX_NONE;
+	}
+	return Queue->Host(Pin);
+}
+
+int32 UCloudAnchorQueueComponent::ResolvePin(const FString& CloudId)
+{
+	if (!Queue.IsValid())
+	{
+		UE_LOG(LogCloudARPinSample, Warning, TEXT("ResolvePin was called before BeginPlay."));
+		return INDEX_NONE;
+	}
+	return Queue->Resolve(CloudId);
+}
+
+bool UCloudAnchorQueueComponent::CancelRequest(int32 RequestId)
+{
+	return Queue.IsValid() && Queue->Cancel(RequestId);
+}
+
+int32 UCloudAnchorQueueComponent::GetNumPendingRequests() const
+{
+	return Queue.IsValid() ? Queue->GetNumPendingRequests() : 0;
+}
+
+void UCloudAnchorQueueComponent::HandleRequestComplete(int32 RequestId, const FCloudAnchorResult& Result)
+{
+	OnRequestComplete.Broadcast(RequestId, Result.State, Result.CloudId, Result.Pin);
+}
@@ -0,0 +1,104 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CloudAnchorQueue.h"
+
+#include "CloudAnchorQueueComponent.generated.h"
+
+class ICloudAnchorBackend;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FOnCloudAnchorRequestCompleteDynamic, int32, RequestId, ECloudAnchorOperationState, State, const FString&, CloudId, UARPin*, Pin);
+
+/**
+ * Hosts and resolves Cloud Anchors for Blueprints through an
+ * FCloudAnchorQueue, several at a time and with retries, instead of one
+ * latent action after another. The settings are read in BeginPlay.
+ */
+UCLASS(ClassGroup = AR, meta = (BlueprintSpawnableComponent))
+class CLOUDARPINSAMPLE_API UCloudAnchorQueueComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCloudAnchorQueueComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Queues hosting Pin. Returns the request id passed to OnRequestComplete, or -1 before BeginPlay. */
+	UFUNCTION(BlueprintCallable, Category = CloudAnchorQueue)
+	int32 HostPin(UARPin* Pin);
+
+	/** Queues resolving CloudId. Repeated requests for the same id share one resolve. Returns the request id, or -1 before BeginPlay. */
+	UFUNCTION(BlueprintCallable, Category = CloudAnchorQueue)
+	int32 ResolvePin(const FString& CloudId);
+
+	/** Cancels a request, which then completes as Cancelled. Returns false if it already completed. */
+	UFUNCTION(BlueprintCallable, Category = CloudAnchorQueue)
+	bool CancelRequest(int32 RequestId);
+
+	UFUNCTION(BlueprintPure, Category = CloudAnchorQueue)
+	int32 GetNumPendingRequests() const;
+
+	/** Called once for every request with Success, Failed or Cancelled. */
+	UPROPERTY(BlueprintAssignable, Category = CloudAnchorQueue)
+	FOnCloudAnchorRequestCompleteDynamic OnRequestComplete;
+
+	/** Operations the Cloud Anchor service runs at the same time. Default to 4*/
+	UPROPERTY(Category = CloudAnchorQueue, EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "1"))
+	int32 MaxConcurrentOperations;
+
+	/** Attempts per request before it fails, including the first one. Default to 5*/
+	UPROPERTY(Category = CloudAnchorQueue, EditAnywhere, BlueprintReadOnly, meta = (ClampMin = "1"))
+	int32 MaxAttempts;
+
+	/** Seconds before the first retry, doubling with every further retry up to MaxRetryDelay. Default to 1 s*/
+	UPROPERTY(Category = CloudAnchorQueue, EditAnywhere, BlueprintReadOnly)
+	float InitialRetryDelay;
+
+	/** Default to 16 s*/
+	UPROPERTY(Category = CloudAnchorQueue, EditAnywhere, BlueprintReadOnly)
+	float MaxRetryDelay;
+
+	/** Use FMockCloudAnchorBackend instead of the Cloud Anchor service, e.g. to test without a device. */
+	UPROPERTY(Category = "CloudAnchorQueue|Mock", EditAnywhere, BlueprintReadOnly)
+	bool bUseMockBackend;
+
+	/** Seconds a mock operation takes. */
+	UPROPERTY(Category = "CloudAnchorQueue|Mock", EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bUseMockBackend"))
+	float MockMinLatency;
+
+	UPROPERTY(Category = "CloudAnchorQueue|Mock", EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bUseMockBackend"))
+	float MockMaxLatency;
+
+	/** Fraction of mock operations that end with a retryable error. */
+	UPROPERTY(Category = "CloudAnchorQueue|Mock", EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bUseMockBackend", ClampMin = "0", ClampMax = "1"))
+	float MockRetryableFailureRate;
+
+	/** Fraction of mock operations that fail for good. */
+	UPROPERTY(Category = "CloudAnchorQueue|Mock", EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bUseMockBackend", ClampMin = "0", ClampMax = "1"))
+	float MockFatalFailureRate;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void HandleRequestComplete(int32 RequestId, const FCloudAnchorResult& Result);
+
+	TUniquePtr<ICloudAnchorBackend> Backend;
+	TUniquePtr<FCloudAnchorQueue> Queue;
+};
@@ -0,0 +1,64 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "PinReplicationBenchmarkCommandlet.h"
+#include "CloudARPinSample.h"
+#include "ARPoseReplicationBenchmark.h"
+#include "Misc/Parse.h"
+
+UPinReplicationBenchmarkCommandlet::UPinReplicationBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UPinReplicationBenchmarkCommandlet::Main(const FString& Params)
+{
+	ARPoseReplicationBenchmark::FSettings Settings;
+	FParse::Value(*Params, TEXT("Pins="), Settings.NumPins);
+	FParse::Value(*Params, TEXT("Clients="), Settings.NumClients);
+	FParse::Value(*Params, TEXT("UpdateHz="), Settings.UpdateHz);
+	FParse::Value(*Params, TEXT("Seconds="), Settings.Seconds);
+	FParse::Value(*Params, TEXT("PacketLoss="), Settings.PacketLoss);
+	FParse::Value(*Params, TEXT("RelevancyDistance="), Settings.RelevancyDistance);
+	if (Settings.NumPins <= 0 || Settings.NumClients <= 0 || Settings.UpdateHz <= 0.0f || Settings.Seconds <= 0.0f)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("Pins, Clients, UpdateHz and Seconds must be positive."));
+		return 1;
+	}
+	if (Settings.PacketLoss < 0.0f || Settings.PacketLoss >= 1.0f)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("PacketLoss must be in [0, 1)."));
+		return 1;
+	}
+
+	const ARPoseReplicationBenchmark::FResult Result = ARPoseReplicationBenchmark::Run(Settings);
+
+	UE_LOG(LogCloudARPinSample, Display, TEXT("Pin replication, %d pins, %d clients, %.0f Hz, %.0f s, %.0f%% loss, relevancy %.0f cm:"),
+		Settings.NumPins, Settings.NumClients, Settings.UpdateHz, Settings.Seconds, Settings.PacketLoss * 100.0f, Settings.RelevancyDistance);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  %-40s %10.1f bytes/client/s"), TEXT("Full precision, all pins"), Result.FullPrecisionBytesPerClientPerSecond);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  %-40s %10.1f bytes/client/s"), TEXT("Quantized, relevant pins"), Result.QuantizedBytesPerClientPerSecond);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  %-40s %10.1f bytes/client/s (%.1fx less)"), TEXT("Quantized delta, relevant pins"),
+		Result.DeltaBytesPerClientPerSecond, Result.FullPrecisionBytesPerClientPerSecond / FMath::Max(Result.DeltaBytesPerClientPerSecond, 1.0e-6));
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  Max error %.3f cm, %.3f degrees; %d deltas arrived without their baseline."),
+		Result.MaxLocationError, Result.MaxRotationErrorDegrees, Result.NumDeltasWithoutBaseline);
+
+	if (Result.NumMismatches > 0)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("%d decoded poses differ from the host's."), Result.NumMismatches);
+		return 1;
+	}
+	return 0;
+}
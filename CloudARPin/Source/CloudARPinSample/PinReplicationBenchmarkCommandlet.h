@@ -0,0 +1,48 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "PinReplicationBenchmarkCommandlet.generated.h"
+
+/**
+ * Simulates a host replicating pin poses to many clients and reports the
+ * bytes per client per second with full precision properties and with
+ * ARPoseQuantization's quantized delta encoding, without a device or an online
+ * subsystem:
+ *
+ *   UE4Editor-Cmd CloudARPinSample.uproject -run=PinReplicationBenchmark -nullrhi
+ *
+ * Options:
+ *   -Pins=64				Pins in the shared space.
+ *   -Clients=32			Simulated clients.
+ *   -UpdateHz=10			Replication updates per second.
+ *   -Seconds=60			Simulated time.
+ *   -PacketLoss=0.05		Fraction of packets lost.
+ *   -RelevancyDistance=1500	Clients only get pins this close, in cm. 0 for all pins.
+ *
+ * Returns 1 if a client decodes a pose that differs from the host's.
+ */
+UCLASS()
+class UPinReplicationBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPinReplicationBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,72 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "PlaneMeshBenchmarkCommandlet.h"
+#include "CloudARPinSample.h"
+#include "PlaneMeshBuilderBenchmark.h"
+#include "Misc/Parse.h"
+
+UPlaneMeshBenchmarkCommandlet::UPlaneMeshBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UPlaneMeshBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Iterations = 10000;
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	if (Iterations <= 0)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("Iterations must be positive."));
+		return 1;
+	}
+
+	TArray<int32> BoundarySizes = { 4, 8, 16, 32, 64, 128, 256, 512, 1000 };
+	int32 OnlyBoundarySize = 0;
+	if (FParse::Value(*Params, TEXT("Vertices="), OnlyBoundarySize))
+	{
+		if (OnlyBoundarySize < 3)
+		{
+			UE_LOG(LogCloudARPinSample, Error, TEXT("A plane boundary needs at least 3 vertices."));
+			return 1;
+		}
+		BoundarySizes = { OnlyBoundarySize };
+	}
+
+	UE_LOG(LogCloudARPinSample, Display, TEXT("Plane mesh build, %d iterations:"), Iterations);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  %8s %14s %14s %14s %8s"), TEXT("Vertices"), TEXT("Reference ns"), TEXT("Builder ns"), TEXT("Vertices ns"), TEXT("Speedup"));
+
+	bool bAllMatch = true;
+	for (int32 BoundarySize : BoundarySizes)
+	{
+		const PlaneMeshBuilderBenchmark::FResult Result = PlaneMeshBuilderBenchmark::Run(BoundarySize, Iterations);
+		UE_LOG(LogCloudARPinSample, Display, TEXT("  %8d %14.1f %14.1f %14.1f %7.2fx%s"),
+			Result.NumBoundaryVertices,
+			Result.ReferenceSeconds * 1.0e9,
+			Result.BuilderSeconds * 1.0e9,
+			Result.VerticesOnlySeconds * 1.0e9,
+			Result.ReferenceSeconds / Result.BuilderSeconds,
+			Result.bMatchesReference ? TEXT("") : TEXT(" MESH MISMATCH"));
+		bAllMatch &= Result.bMatchesReference;
+	}
+
+	if (!bAllMatch)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("At least one mesh did not match the reference."));
+		return 1;
+	}
+	return 0;
+}
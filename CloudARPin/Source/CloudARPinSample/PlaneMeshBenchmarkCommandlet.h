@@ -0,0 +1,43 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "PlaneMeshBenchmarkCommandlet.generated.h"
+
+/**
+ * Checks PlaneMeshBuilder against the reference mesh code and times it
+ * without a device, e.g. on a Linux build machine:
+ *
+ *   UE4Editor-Cmd CloudARPinSample.uproject -run=PlaneMeshBenchmark -nullrhi
+ *
+ * Options:
+ *   -Iterations=10000		Timed builds per boundary size.
+ *   -Vertices=1000			Only run this boundary size instead of 4 to 1000.
+ *
+ * Returns 1 if any mesh differs from the reference. The CloudARPin.PlaneMeshBuilder
+ * automation test covers the same check on more boundaries.
+ */
+UCLASS()
+class UPlaneMeshBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPlaneMeshBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,229 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "PointStreamBenchmarkCommandlet.h"
+#include "CloudARPinSample.h"
+#include "ARPointStream.h"
+#include "Math/RandomStream.h"
+#include "Misc/Parse.h"
+
+namespace
+{
+	struct FInFlightChunk
+	{
+		TArray<uint8> Chunk;
+		double CaptureTime;
+		double ArrivalTime;
+	};
+
+	/** Features on a floor and two walls of a room, in anchor space. */
+	TArray<FVector> MakeScene(int32 NumFeatures, FRandomStream& RandomStream)
+	{
+		TArray<FVector> Features;
+		Features.Reserve(NumFeatures);
+		for (int32 Index = 0; Index < NumFeatures; Index++)
+		{
+			const float U = RandomStream.FRandRange(-400.0f, 400.0f);
+			const float V = RandomStream.FRandRange(0.0f, 250.0f);
+			switch (Index % 3)
+			{
+			case 0:
+				Features.Add(FVector(U, V * 1.6f - 200.0f, -120.0f));
+				break;
+			case 1:
+				Features.Add(FVector(U, 200.0f, V - 120.0f));
+				break;
+			default:
+				Features.Add(FVector(400.0f, U * 0.5f, V - 120.0f));
+				break;
+			}
+		}
+		return Features;
+	}
+
+	/** The largest per-axis error of streaming every feature once, losslessly and without suppression. */
+	float MeasureQuantizationError(const TArray<FVector>& Features, const FTransform& HostAnchor, const FTransform& ClientAnchor, float Range)
+	{
+		FARPointStreamSettings Settings;
+		Settings.Range = Range;
+		Settings.ResendSeconds = 0.0f;
+		Settings.MaxBytesPerSecond = 1.0e9f;
+		Settings.MaxQueuedPoints = Features.Num();
+		FARPointStreamSender Sender(Settings);
+		FARPointStreamReceiver Receiver;
+
+		TArray<FVector4> WorldPoints;
+		for (const FVector& Feature : Features)
+		{
+			WorldPoints.Emplace(HostAnchor.TransformPosition(Feature), 1.0f);
+		}
+		Sender.AddPoints(WorldPoints, HostAnchor, 0.0);
+
+		TArray<uint8> Chunk;
+		double CaptureTime = 0.0;
+		TArray<FVector4> ReceivedPoints;
+		Sender.GetNextChunk(0.0, Chunk, CaptureTime);
+		for (double Now = 1.0; Sender.GetNumQueuedPoints() > 0; Now += 1.0)
+		{
+			while (Sender.GetNextChunk(Now, Chunk, CaptureTime))
+			{
+				Receiver.ReadChunk(Chunk, ClientAnchor, ReceivedPoints);
+			}
+		}
+
+		// Out of range features are not sent, and nothing reorders the rest.
+		float MaxError = ReceivedPoints.Num() == Features.Num() ? 0.0f : MAX_flt;
+		for (int32 Index = 0; Index < ReceivedPoints.Num() && Index < Features.Num(); Index++)
+		{
+			const FVector Error = ClientAnchor.InverseTransformPosition(FVector(ReceivedPoints[Index])) - Features[Index];
+			MaxError = FMath::Max(MaxError, Error.GetAbsMax());
+		}
+		return MaxError;
+	}
+}
+
+UPointStreamBenchmarkCommandlet::UPointStreamBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UPointStreamBenchmarkCommandlet::Main(const FString& Params)
+{
+	float Seconds = 30.0f;
+	int32 PointsPerFrame = 300;
+	float Noise = 0.5f;
+	float KBPerSecond = 16.0f;
+	float PacketLoss = 0.05f;
+	float LinkLatency = 0.05f;
+	FARPointStreamSettings Settings;
+	FParse::Value(*Params, TEXT("Seconds="), Seconds);
+	FParse::Value(*Params, TEXT("PointsPerFrame="), PointsPerFrame);
+	FParse::Value(*Params, TEXT("Noise="), Noise);
+	FParse::Value(*Params, TEXT("KBPerSecond="), KBPerSecond);
+	FParse::Value(*Params, TEXT("Range="), Settings.Range);
+	FParse::Value(*Params, TEXT("CellSize="), Settings.SuppressionCellSize);
+	FParse::Value(*Params, TEXT("PacketLoss="), PacketLoss);
+	FParse::Value(*Params, TEXT("LinkLatency="), LinkLatency);
+	if (Seconds <= 0.0f || PointsPerFrame <= 0 || KBPerSecond <= 0.0f || Settings.Range < 1.0f || Settings.SuppressionCellSize <= 0.0f)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("Seconds, PointsPerFrame, KBPerSecond and CellSize must be positive, and Range at least 1."));
+		return 1;
+	}
+	if (PacketLoss < 0.0f || PacketLoss >= 1.0f || LinkLatency < 0.0f)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("PacketLoss must be in [0, 1) and LinkLatency at least 0."));
+		return 1;
+	}
+	Settings.MaxBytesPerSecond = KBPerSecond * 1024.0f;
+
+	// The host and the client each track the anchor in their own world space.
+	const FTransform HostAnchor(FRotator(0.0f, 40.0f, 0.0f), FVector(120.0f, -40.0f, 10.0f));
+	const FTransform ClientAnchor(FRotator(0.0f, -70.0f, 0.0f), FVector(-500.0f, 300.0f, 0.0f));
+
+	FRandomStream RandomStream(1234);
+	const TArray<FVector> Features = MakeScene(PointsPerFrame * 20, RandomStream);
+	const float QuantizationError = MeasureQuantizationError(Features, HostAnchor, ClientAnchor, Settings.Range);
+
+	FARPointStreamSender Sender(Settings);
+	FARPointStreamReceiver Receiver;
+	TArray<FInFlightChunk> Link;
+	TArray<FVector4> FramePoints;
+	TArray<FVector4> ReceivedPoints;
+	TArray<double> Latencies;
+	TArray<uint8> Chunk;
+	int32 NumChunksDropped = 0;
+	int32 NumChunksDroppedBeforeLastDelivery = 0;
+
+	// The camera pans over the scene, seeing a window of the features each frame.
+	const double TimeStep = 1.0 / 30.0;
+	const int32 NumFrames = FMath::CeilToInt(Seconds * 30.0f);
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		const double Now = Frame * TimeStep;
+
+		FramePoints.Reset();
+		const int32 FirstFeature = (Frame * PointsPerFrame / 30) % Features.Num();
+		for (int32 Index = 0; Index < PointsPerFrame; Index++)
+		{
+			const FVector Feature = Features[(FirstFeature + Index) % Features.Num()] + RandomStream.GetUnitVector() * RandomStream.FRand() * Noise;
+			FramePoints.Emplace(HostAnchor.TransformPosition(Feature), RandomStream.FRand());
+		}
+		Sender.AddPoints(FramePoints, HostAnchor, Now);
+
+		double CaptureTime = 0.0;
+		while (Sender.GetNextChunk(Now, Chunk, CaptureTime))
+		{
+			if (RandomStream.FRand() < PacketLoss)
+			{
+				NumChunksDropped++;
+				continue;
+			}
+			FInFlightChunk& InFlight = Link.AddDefaulted_GetRef();
+			InFlight.Chunk = Chunk;
+			InFlight.CaptureTime = CaptureTime;
+			InFlight.ArrivalTime = Now + LinkLatency;
+		}
+
+		int32 NumArrived = 0;
+		while (NumArrived < Link.Num() && Link[NumArrived].ArrivalTime <= Now)
+		{
+			ReceivedPoints.Reset();
+			Receiver.ReadChunk(Link[NumArrived].Chunk, ClientAnchor, ReceivedPoints);
+			Latencies.Add(Now - Link[NumArrived].CaptureTime);
+			NumChunksDroppedBeforeLastDelivery = NumChunksDropped;
+			NumArrived++;
+		}
+		Link.RemoveAt(0, NumArrived, false);
+	}
+
+	const double NaiveBytesPerSecond = PointsPerFrame * sizeof(FVector4) * 30.0;
+	const double StreamBytesPerSecond = Sender.GetNumBytesSent() / Seconds;
+	const int64 NumPointsObserved = static_cast<int64>(NumFrames) * PointsPerFrame;
+	Latencies.Sort();
+	const double MedianLatency = Latencies.Num() > 0 ? Latencies[Latencies.Num() / 2] : 0.0;
+	const double P95Latency = Latencies.Num() > 0 ? Latencies[FMath::Min(Latencies.Num() * 95 / 100, Latencies.Num() - 1)] : 0.0;
+	const float Step = 2.0f * Settings.Range / 65535.0f;
+
+	UE_LOG(LogCloudARPinSample, Display, TEXT("Point stream, %d points per frame, %.0f s, %.1f cm noise, %.0f KB/s budget, %.0f%% loss, %.0f ms link:"),
+		PointsPerFrame, Seconds, Noise, KBPerSecond, PacketLoss * 100.0f, LinkLatency * 1000.0f);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  %-32s %10.0f bytes/s"), TEXT("Every point every frame"), NaiveBytesPerSecond);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  %-32s %10.0f bytes/s (%.1fx less)"), TEXT("Stream"), StreamBytesPerSecond, NaiveBytesPerSecond / FMath::Max(StreamBytesPerSecond, 1.0e-6));
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  Points: %lld observed, %lld sent, %lld suppressed, %lld dropped, %d still queued."),
+		NumPointsObserved, Sender.GetNumPointsSent(), Sender.GetNumPointsSuppressed(), Sender.GetNumPointsDropped(), Sender.GetNumQueuedPoints());
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  Chunks: %lld received, %lld lost; latency p50 %.0f ms, p95 %.0f ms."),
+		Receiver.GetNumChunksReceived(), Receiver.GetNumChunksLost(), MedianLatency * 1000.0, P95Latency * 1000.0);
+	UE_LOG(LogCloudARPinSample, Display, TEXT("  Max error %.4f cm per axis, quantization step %.4f cm."), QuantizationError, Step);
+
+	bool bPassed = true;
+	if (QuantizationError > Step)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("A streamed position is off by %.4f cm, more than one quantization step."), QuantizationError);
+		bPassed = false;
+	}
+	// The budget may hold a tenth of a second, or one full chunk, on top of the rate.
+	const double MaxBytes = Settings.MaxBytesPerSecond * (Seconds + 0.1) + 8 + Settings.MaxPointsPerChunk * 7;
+	if (Sender.GetNumBytesSent() > MaxBytes)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("The stream sent %lld bytes, more than the budget of %.0f."), Sender.GetNumBytesSent(), MaxBytes);
+		bPassed = false;
+	}
+	if (Receiver.GetNumChunksLost() != NumChunksDroppedBeforeLastDelivery)
+	{
+		UE_LOG(LogCloudARPinSample, Error, TEXT("The receiver counted %lld lost chunks, but %d were lost."), Receiver.GetNumChunksLost(), NumChunksDroppedBeforeLastDelivery);
+		bPassed = false;
+	}
+	return bPassed ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "PointStreamBenchmarkCommandlet.generated.h"
+
+/**
+ * Streams synthetic feature points from an FARPointStreamSender to an
+ * FARPointStreamReceiver over a simulated lossy link in the same process,
+ * the way AARPointStreamActor streams the host's points to clients,
+ * and reports the bandwidth against sending every point every frame and
+ * the latency from capture to delivery:
+ *
+ *   UE4Editor-Cmd CloudARPinSample.uproject -run=PointStreamBenchmark -nullrhi
+ *
+ * Options:
+ *   -Seconds=30			Simulated time, at 30 frames per second.
+ *   -PointsPerFrame=300	Feature points the host sees every frame.
+ *   -Noise=0.5				Standard deviation of the point positions between frames, in cm.
+ *   -KBPerSecond=16		Byte budget of the stream.
+ *   -Range=1000			Range of the quantized positions, in cm.
+ *   -CellSize=2			Suppression cell size, in cm.
+ *   -PacketLoss=0.05		Fraction of chunks lost.
+ *   -LinkLatency=0.05		One way seconds per chunk.
+ *
+ * Returns 1 if a position moves by more than one quantization step, the
+ * stream goes over its byte budget, or the receiver misses lost chunks.
+ */
+UCLASS()
+class UPointStreamBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPointStreamBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,291 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SimulatedARSystem.h"
+#include "ARTraceResult.h"
+#include "ARTrackable.h"
+#include "CloudARPinSample.h"
+#include "Engine/Engine.h"
+#include "Misc/App.h"
+
+FSimulatedARSystem::FSimulatedARSystem(const FARSimulationSettings& Settings)
+	: Simulation(Settings)
+	, bSessionRunning(true)
+	, AlignmentTransform(FTransform::Identity)
+{
+}
+
+TSharedRef<FSimulatedARSystem, ESPMode::ThreadSafe> FSimulatedARSystem::Install(const FARSimulationSettings& Settings)
+{
+	if (GEngine->XRSystem.IsValid())
+	{
+		UE_LOG(LogCloudARPinSample, Warning, TEXT("Replacing the XR system %s with a simulated AR system."), *GEngine->XRSystem->GetSystemName().ToString());
+	}
+
+	TSharedRef<FSimulatedARSystem, ESPMode::ThreadSafe> ARSystem = MakeShared<FSimulatedARSystem, ESPMode::ThreadSafe>(Settings);
+	ARSystem->InitializeARSystem();
+	GEngine->XRSystem = ARSystem;
+	return ARSystem;
+}
+
+void FSimulatedARSystem::Uninstall(const TSharedRef<FSimulatedARSystem, ESPMode::ThreadSafe>& ARSystem)
+{
+	if (GEngine->XRSystem.Get() == &ARSystem.Get())
+	{
+		GEngine->XRSystem.Reset();
+	}
+}
+
+void FSimulatedARSystem::AdvanceFrame(double DeltaSeconds)
+{
+	if (!bSessionRunning)
+	{
+		return;
+	}
+
+	Simulation.Tick(DeltaSeconds);
+
+	const EARTrackingState TrackingState = Simulation.GetTrackingQuality() == FARSimulation::ETrackingQuality::OrientationAndPosition
+		? EARTrackingState::Tracking
+		: EARTrackingState::NotTracking;
+
+	for (const FARSimulation::FPlane& Plane : Simulation.GetRemovedPlanes())
+	{
+		UARPlaneGeometry* PlaneGeometry = nullptr;
+		if (PlaneGeometries.RemoveAndCopyValue(Plane.Id, PlaneGeometry))
+		{
+			UpdatePlaneGeometry(PlaneGeometry, Plane, PlaneGeometries.FindRef(Plane.SubsumedById));
+			PlaneGeometry->SetTrackingState(EARTrackingState::StoppedTracking);
+			TrackedGeometries.RemoveSingleSwap(PlaneGeometry, false);
+			TriggerOnTrackableRemovedDelegates(PlaneGeometry);
+		}
+	}
+
+	// Like a device session, every plane is updated when tracking pauses or resumes.
+	const bool bTrackingChanged = Simulation.HasTrackingQualityChanged();
+	for (const FARSimulation::FPlane& Plane : Simulation.GetPlanes())
+	{
+		if (Plane.bAdded)
+		{
+			UARPlaneGeometry* PlaneGeometry = NewObject<UARPlaneGeometry>();
+			PlaneGeometries.Add(Plane.Id, PlaneGeometry);
+			TrackedGeometries.Add(PlaneGeometry);
+			UpdatePlaneGeometry(PlaneGeometry, Plane, nullptr);
+			PlaneGeometry->SetTrackingState(TrackingState);
+			TriggerOnTrackableAddedDelegates(PlaneGeometry);
+		}
+		else if (Plane.bChanged || bTrackingChanged)
+		{
+			UARPlaneGeometry* PlaneGeometry = PlaneGeometries.FindRef(Plane.Id);
+			if (PlaneGeometry != nullptr)
+			{
+				UpdatePlaneGeometry(PlaneGeometry, Plane, nullptr);
+				PlaneGeometry->SetTrackingState(TrackingState);
+				TriggerOnTrackableUpdatedDelegates(PlaneGeometry);
+			}
+		}
+	}
+}
+
+void FSimulatedARSystem::UpdatePlaneGeometry(UARPlaneGeometry* PlaneGeometry, const FARSimulation::FPlane& Plane, UARPlaneGeometry* SubsumedBy)
+{
+	PlaneGeometry->UpdateTrackedGeometry(
+		StaticCastSharedRef<FARSystemBase>(AsShared()),
+		Simulation.GetFrameNumber(),
+		Simulation.GetTimestamp(),
+		Plane.LocalToTracking,
+		AlignmentTransform,
+		FVector::ZeroVector,
+		FVector(Plane.Extent, 0.0f),
+		Plane.Boundary,
+		SubsumedBy);
+}
+
+FName FSimulatedARSystem::GetSystemName() const
+{
+	static const FName SystemName(TEXT("SimulatedAR"));
+	return SystemName;
+}
+
+bool FSimulatedARSystem::EnumerateTrackedDevices(TArray<int32>& OutDevices, EXRTrackedDeviceType Type)
+{
+	if (Type == EXRTrackedDeviceType::Any || Type == EXRTrackedDeviceType::HeadMountedDisplay)
+	{
+		OutDevices.Add(IXRTrackingSystem::HMDDeviceId);
+		return true;
+	}
+	return false;
+}
+
+bool FSimulatedARSystem::GetCurrentPose(int32 DeviceId, FQuat& OutOrientation, FVector& OutPosition)
+{
+	if (DeviceId != IXRTrackingSystem::HMDDeviceId)
+	{
+		return false;
+	}
+	const FTransform& CameraPose = Simulation.GetCameraPose();
+	OutOrientation = CameraPose.GetRotation();
+	OutPosition = CameraPose.GetLocation();
+	return true;
+}
+
+float FSimulatedARSystem::GetWorldToMetersScale() const
+{
+	return 100.0f;
+}
+
+bool FSimulatedARSystem::OnStartGameFrame(FWorldContext& WorldContext)
+{
+	AdvanceFrame(FApp::GetDeltaTime());
+	return true;
+}
+
+void FSimulatedARSystem::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObjects(TrackedGeometries);
+}
+
+EARTrackingQuality FSimulatedARSystem::OnGetTrackingQuality() const
+{
+	if (!bSessionRunning)
+	{
+		return EARTrackingQuality::NotTracking;
+	}
+
+	switch (Simulation.GetTrackingQuality())
+	{
+	case FARSimulation::ETrackingQuality::OrientationAndPosition:
+		return EARTrackingQuality::OrientationAndPosition;
+	case FARSimulation::ETrackingQuality::OrientationOnly:
+		return EARTrackingQuality::OrientationOnly;
+	default:
+		return EARTrackingQuality::NotTracking;
+	}
+}
+
+void FSimulatedARSystem::OnStartARSession(UARSessionConfig* SessionConfig)
+{
+	bSessionRunning = true;
+}
+
+void FSimulatedARSystem::OnPauseARSession()
+{
+	bSessionRunning = false;
+}
+
+void FSimulatedARSystem::OnStopARSession()
+{
+	bSessionRunning = false;
+	for (UARTrackedGeometry* Geometry : TrackedGeometries)
+	{
+		Geometry->SetTrackingState(EARTrackingState::StoppedTracking);
+		TriggerOnTrackableRemovedDelegates(Geometry);
+	}
+	TrackedGeometries.Reset();
+	PlaneGeometries.Reset();
+}
+
+FARSessionStatus FSimulatedARSystem::OnGetARSessionStatus() const
+{
+	return FARSessionStatus(bSessionRunning ? EARSessionStatus::Running : EARSessionStatus::NotStarted);
+}
+
+void FSimulatedARSystem::OnSetAlignmentTransform(const FTransform& InAlignmentTransform)
+{
+	// Taken up by the geometries when they are next updated.
+	AlignmentTransform = InAlignmentTransform;
+}
+
+TArray<FARTraceResult> FSimulatedARSystem::OnLineTraceTrackedObjects(const FVector2D ScreenCoord, EARLineTraceChannels TraceChannels)
+{
+	return TArray<FARTraceResult>();
+}
+
+#if ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 22
+TArray<FARTraceResult> FSimulatedARSystem::OnLineTraceTrackedObjects(const FVector Start, const FVector End, EARLineTraceChannels TraceChannels)
+{
+	return TArray<FARTraceResult>();
+}
+#endif
+
+TArray<UARTrackedGeometry*> FSimulatedARSystem::OnGetAllTrackedGeometries() const
+{
+	return TrackedGeometries;
+}
+
+TArray<UARPin*> FSimulatedARSystem::OnGetAllPins() const
+{
+	return TArray<UARPin*>();
+}
+
+bool FSimulatedARSystem::OnIsTrackingTypeSupported(EARSessionType SessionType) const
+{
+	return SessionType == EARSessionType::World;
+}
+
+UARLightEstimate* FSimulatedARSystem::OnGetCurrentLightEstimate() const
+{
+	return nullptr;
+}
+
+UARPin* FSimulatedARSystem::OnPinComponent(USceneComponent* ComponentToPin, const FTransform& PinToWorldTransform, UARTrackedGeometry* TrackedGeometry, const FName DebugName)
+{
+	return nullptr;
+}
+
+void FSimulatedARSystem::OnRemovePin(UARPin* PinToRemove)
+{
+}
+
+UARTextureCameraImage* FSimulatedARSystem::OnGetCameraImage()
+{
+	// The synthetic image is CPU only, see FARSimulation::GetCameraImage().
+	return nullptr;
+}
+
+UARTextureCameraDepth* FSimulatedARSystem::OnGetCameraDepth()
+{
+	return nullptr;
+}
+
+bool FSimulatedARSystem::OnAddManualEnvironmentCaptureProbe(FVector Location, FVector Extent)
+{
+	return false;
+}
+
+TSharedPtr<FARGetCandidateObjectAsyncTask, ESPMode::ThreadSafe> FSimulatedARSystem::OnGetCandidateObject(FVector Location, FVector Extent) const
+{
+	return nullptr;
+}
+
+TSharedPtr<FARSaveWorldAsyncTask, ESPMode::ThreadSafe> FSimulatedARSystem::OnSaveWorld() const
+{
+	return nullptr;
+}
+
+EARWorldMappingState FSimulatedARSystem::OnGetWorldMappingStatus() const
+{
+	return OnGetTrackingQuality() == EARTrackingQuality::OrientationAndPosition ? EARWorldMappingState::Mapped : EARWorldMappingState::NotAvailable;
+}
+
+TArray<FARVideoFormat> FSimulatedARSystem::OnGetSupportedVideoFormats(EARSessionType SessionType) const
+{
+	return TArray<FARVideoFormat>();
+}
+
+TArray<FVector> FSimulatedARSystem::OnGetPointCloud() const
+{
+	// Tracking space, like the device systems report them.
+	return Simulation.GetPointCloud();
+}
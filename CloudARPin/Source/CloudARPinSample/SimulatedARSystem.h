@@ -0,0 +1,107 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ARSystem.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "UObject/GCObject.h"
+#include "ARSimulation.h"
+
+class UARPlaneGeometry;
+
+/**
+ * An AR system that reports an FARSimulation instead of a device session,
+ * so that the sample actors run unchanged on desktops and with -nullrhi,
+ * e.g. in benchmarks:
+ *
+ *   TSharedRef<FSimulatedARSystem, ESPMode::ThreadSafe> ARSystem = FSimulatedARSystem::Install(Settings);
+ *
+ * Planes are reported as UARPlaneGeometry objects through
+ * UARBlueprintLibrary::GetAllGeometries() and the trackable notifications,
+ * the feature points through UARBlueprintLibrary::GetPointCloud().
+ *
+ * The simulation advances in OnStartGameFrame, or in AdvanceFrame when
+ * the caller ticks the world itself.
+ */
+class CLOUDARPINSAMPLE_API FSimulatedARSystem : public FARSystemBase, public FGCObject
+{
+public:
+	explicit FSimulatedARSystem(const FARSimulationSettings& Settings);
+
+	/** Creates a simulated AR system and makes it the engine's XR and AR system. */
+	static TSharedRef<FSimulatedARSystem, ESPMode::ThreadSafe> Install(const FARSimulationSettings& Settings);
+
+	/** Removes the system Install made the engine's XR system, if it still is. */
+	static void Uninstall(const TSharedRef<FSimulatedARSystem, ESPMode::ThreadSafe>& ARSystem);
+
+	/** Simulates the next frame and updates the planes. */
+	void AdvanceFrame(double DeltaSeconds);
+
+	FARSimulation& GetSimulation() { return Simulation; }
+	const FARSimulation& GetSimulation() const { return Simulation; }
+
+	// IXRTrackingSystem
+	virtual FName GetSystemName() const override;
+	virtual bool EnumerateTrackedDevices(TArray<int32>& OutDevices, EXRTrackedDeviceType Type = EXRTrackedDeviceType::Any) override;
+	virtual bool GetCurrentPose(int32 DeviceId, FQuat& OutOrientation, FVector& OutPosition) override;
+	virtual float GetWorldToMetersScale() const override;
+	virtual bool OnStartGameFrame(FWorldContext& WorldContext) override;
+
+	// FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+
+protected:
+	// IARSystemSupport, as of engine 4.21, the first one with the Cloud
+	// Anchor API this sample uses. The interface grows between engine
+	// versions; every function is an override, so that a signature the
+	// engine does not have fails the build instead of being ignored.
+	virtual EARTrackingQuality OnGetTrackingQuality() const override;
+	virtual void OnStartARSession(UARSessionConfig* SessionConfig) override;
+	virtual void OnPauseARSession() override;
+	virtual void OnStopARSession() override;
+	virtual FARSessionStatus OnGetARSessionStatus() const override;
+	virtual void OnSetAlignmentTransform(const FTransform& InAlignmentTransform) override;
+	virtual TArray<FARTraceResult> OnLineTraceTrackedObjects(const FVector2D ScreenCoord, EARLineTraceChannels TraceChannels) override;
+#if ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 22
+	virtual TArray<FARTraceResult> OnLineTraceTrackedObjects(const FVector Start, const FVector End, EARLineTraceChannels TraceChannels) override;
+#endif
+	virtual TArray<UARTrackedGeometry*> OnGetAllTrackedGeometries() const override;
+	virtual TArray<UARPin*> OnGetAllPins() const override;
+	virtual bool OnIsTrackingTypeSupported(EARSessionType SessionType) const override;
+	virtual UARLightEstimate* OnGetCurrentLightEstimate() const override;
+	virtual UARPin* OnPinComponent(USceneComponent* ComponentToPin, const FTransform& PinToWorldTransform, UARTrackedGeometry* TrackedGeometry = nullptr, const FName DebugName = NAME_None) override;
+	virtual void OnRemovePin(UARPin* PinToRemove) override;
+	virtual UARTextureCameraImage* OnGetCameraImage() override;
+	virtual UARTextureCameraDepth* OnGetCameraDepth() override;
+	virtual bool OnAddManualEnvironmentCaptureProbe(FVector Location, FVector Extent) override;
+	virtual TSharedPtr<FARGetCandidateObjectAsyncTask, ESPMode::ThreadSafe> OnGetCandidateObject(FVector Location, FVector Extent) const override;
+	virtual TSharedPtr<FARSaveWorldAsyncTask, ESPMode::ThreadSafe> OnSaveWorld() const override;
+	virtual EARWorldMappingState OnGetWorldMappingStatus() const override;
+	virtual TArray<FARVideoFormat> OnGetSupportedVideoFormats(EARSessionType SessionType) const override;
+	virtual TArray<FVector> OnGetPointCloud() const override;
+
+private:
+	void UpdatePlaneGeometry(UARPlaneGeometry* PlaneGeometry, const FARSimulation::FPlane& Plane, UARPlaneGeometry* SubsumedBy);
+
+	FARSimulation Simulation;
+
+	bool bSessionRunning;
+	FTransform AlignmentTransform;
+
+	/** The geometry of each tracked plane by FARSimulation::FPlane::Id. */
+	TMap<int32, UARPlaneGeometry*> PlaneGeometries;
+	TArray<UARTrackedGeometry*> TrackedGeometries;
+};
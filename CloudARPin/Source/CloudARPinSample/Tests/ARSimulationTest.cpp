@@ -0,0 +1,47 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ARSimulationBenchmark.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FARSimulationRendererBudgetTest, "CloudARPin.ARSimulation.RendererBudgets",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FARSimulationRendererBudgetTest::RunTest(const FString &Parameters)
+{
+	const ARSimulationBenchmark::FBudget Budget;
+	for (bool bMergePlanes : { false, true })
+	{
+		ARSimulationBenchmark::FSettings Settings;
+		Settings.bMergePlanes = bMergePlanes;
+		const ARSimulationBenchmark::FResult Result = ARSimulationBenchmark::Run(Settings);
+		Result.Log(Settings);
+
+		// A run that never finds planes or loses tracking checks little.
+		const TCHAR* What = bMergePlanes ? TEXT("merged planes") : TEXT("plane actors");
+		TestTrue(FString::Printf(TEXT("Planes are found (%s)"), What), Result.WithRenderers.NumPlanesFound > 0);
+		TestTrue(FString::Printf(TEXT("Tracking changes (%s)"), What), Result.WithRenderers.NumTrackingChanges > 0);
+
+		for (const FString& Error : Result.GetBudgetErrors(Budget))
+		{
+			AddError(FString::Printf(TEXT("%s (%s)"), *Error, What));
+		}
+	}
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,62 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PlaneBoundarySimplifier.h"
+#include "PlaneMeshBuilderBenchmark.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPlaneBoundarySimplifierScratchTest, "CloudARPin.PlaneBoundarySimplifier.SharedScratch",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPlaneBoundarySimplifierScratchTest::RunTest(const FString &Parameters)
+{
+	// The samples share one scratch between planes, so a boundary must
+	// simplify the same after any other. Large boundaries come first, so
+	// that the later ones run on keep flags left over from them.
+	struct FCase
+	{
+		TArray<FVector> Boundary;
+		float Tolerance;
+	};
+	TArray<FCase> Cases;
+	Cases.Add({ PlaneMeshBuilderBenchmark::MakeBoundary(1000, 1), 0.1f });
+	Cases.Add({ PlaneMeshBuilderBenchmark::MakeBoundary(64, 2), 4.0f });
+	Cases.Add({ PlaneMeshBuilderBenchmark::MakeBoundary(1000, 3), 8.0f });
+	Cases.Add({ PlaneMeshBuilderBenchmark::MakeBoundary(17, 4), 12.0f });
+	// Thinner than the tolerance, so only the widest triangle is left.
+	Cases.Add({ { FVector(0.0f, 0.0f, 0.0f), FVector(50.0f, 0.5f, 0.0f), FVector(100.0f, 0.0f, 0.0f), FVector(50.0f, -1.0f, 0.0f), FVector(25.0f, -0.2f, 0.0f) }, 5.0f });
+
+	PlaneBoundarySimplifier::FScratch SharedScratch;
+	for (int32 CaseIndex = 0; CaseIndex < Cases.Num(); CaseIndex++)
+	{
+		const FCase& Case = Cases[CaseIndex];
+		const FString What = FString::Printf(TEXT("case %d, %d vertices, tolerance %.1f"), CaseIndex, Case.Boundary.Num(), Case.Tolerance);
+
+		TArray<FVector> Expected;
+		PlaneBoundarySimplifier::FScratch FreshScratch;
+		PlaneBoundarySimplifier::Simplify(Case.Boundary, Case.Tolerance, Expected, FreshScratch);
+
+		TArray<FVector> Simplified;
+		PlaneBoundarySimplifier::Simplify(Case.Boundary, Case.Tolerance, Simplified, SharedScratch);
+		TestTrue(FString::Printf(TEXT("A shared scratch gives the same boundary as a fresh one (%s)"), *What), Simplified == Expected);
+		TestTrue(FString::Printf(TEXT("At least three vertices are kept (%s)"), *What), Simplified.Num() >= 3);
+		TestTrue(FString::Printf(TEXT("Vertices are removed (%s)"), *What), Simplified.Num() < Case.Boundary.Num());
+	}
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
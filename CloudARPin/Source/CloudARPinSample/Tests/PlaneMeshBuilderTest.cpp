@@ -0,0 +1,76 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PlaneMeshBuilderBenchmark.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPlaneMeshBuilderTest, "CloudARPin.PlaneMeshBuilder",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPlaneMeshBuilderTest::RunTest(const FString &Parameters)
+{
+	// The buffers are reused across cases in this order, so they also have
+	// to shrink. A feathering distance above the radius pulls every
+	// interior vertex to the plane center.
+	const int32 BoundarySizes[] = { 1000, 3, 64, 4, 17, 5 };
+	const float FeatheringDistances[] = { 0.0f, 10.0f, 150.0f };
+	const FVector Normal(0.0f, 0.6f, 0.8f);
+
+	PlaneMeshBuilder::FPlaneMeshBuffers Reference;
+	PlaneMeshBuilder::FPlaneMeshBuffers Buffers;
+	for (int32 BoundarySize : BoundarySizes)
+	{
+		for (float FeatheringDistance : FeatheringDistances)
+		{
+			for (int32 Seed = 0; Seed < 3; Seed++)
+			{
+				const TArray<FVector> Boundary = PlaneMeshBuilderBenchmark::MakeBoundary(BoundarySize, BoundarySize * 16 + Seed);
+				const FString What = FString::Printf(TEXT("%d vertices, feathering %.0f, seed %d"), BoundarySize, FeatheringDistance, Seed);
+
+				PlaneMeshBuilderBenchmark::BuildReference(Boundary, FeatheringDistance, Normal, Reference);
+				TestTrue(FString::Printf(TEXT("Build succeeds (%s)"), *What),
+					PlaneMeshBuilder::Build(Boundary, FeatheringDistance, Normal, Buffers));
+				TestTrue(FString::Printf(TEXT("Build matches the reference (%s)"), *What),
+					PlaneMeshBuilderBenchmark::MeshesMatch(Reference, Buffers, 0.01f));
+
+				TestTrue(FString::Printf(TEXT("BuildVertices succeeds (%s)"), *What),
+					PlaneMeshBuilder::BuildVertices(Boundary, FeatheringDistance, Buffers));
+				TestTrue(FString::Printf(TEXT("BuildVertices matches the reference (%s)"), *What),
+					PlaneMeshBuilderBenchmark::MeshesMatch(Reference, Buffers, 0.01f));
+			}
+		}
+	}
+
+	// Fewer than three vertices are not a polygon and leave no mesh behind.
+	const TArray<FVector> Segment = { FVector(100.0f, 0.0f, 0.0f), FVector(0.0f, 100.0f, 0.0f) };
+	TestFalse(TEXT("Build fails for two vertices"), PlaneMeshBuilder::Build(Segment, 10.0f, Normal, Buffers));
+	TestEqual(TEXT("No vertices for two vertices"), Buffers.Vertices.Num(), 0);
+	TestEqual(TEXT("No indices for two vertices"), Buffers.Indices.Num(), 0);
+
+	// The reference produces NaNs for a boundary vertex at the center; the
+	// builder leaves it where it is.
+	const TArray<FVector> Fan = { FVector::ZeroVector, FVector(100.0f, 0.0f, 0.0f), FVector(0.0f, 100.0f, 0.0f) };
+	TestTrue(TEXT("Build succeeds with a vertex at the center"), PlaneMeshBuilder::Build(Fan, 10.0f, Normal, Buffers));
+	for (const FVector& Vertex : Buffers.Vertices)
+	{
+		TestFalse(TEXT("No NaNs with a vertex at the center"), Vertex.ContainsNaN());
+	}
+	TestEqual(TEXT("The center vertex stays at the center"), Buffers.Vertices[1], FVector::ZeroVector);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,191 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CameraImageBufferPool.h"
+
+#include "ComputerVision.h"
+
+#include "Misc/ScopeLock.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Camera Image Bytes Allocated"), STAT_CameraImageBytesAllocated, STATGROUP_ComputerVision);
+
+FCameraImageBufferPool::FCameraImageBufferPool(int32 InMaxPooledBuffers)
+	: MaxPooledBuffers(InMaxPooledBuffers)
+{
+	IdleBuffers.Reserve(MaxPooledBuffers);
+}
+
+FCameraImageBufferPool::~FCameraImageBufferPool()
+{
+	for (FCameraImageBuffer *Buffer : IdleBuffers)
+	{
+		FreeBuffer(Buffer);
+	}
+}
+
+void FCameraImageBufferPool::SetBufferSize(int32 InBufferSize)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (InBufferSize == BufferSize)
+	{
+		return;
+	}
+
+	BufferSize = InBufferSize;
+	for (FCameraImageBuffer *Buffer : IdleBuffers)
+	{
+		FreeBuffer(Buffer);
+	}
+	IdleBuffers.Reset();
+}
+
+void FCameraImageBufferPool::SetMaxPooledBuffers(int32 InMaxPooledBuffers)
+{
+	FScopeLock ScopeLock(&Lock);
+	MaxPooledBuffers = InMaxPooledBuffers;
+	IdleBuffers.Reserve(MaxPooledBuffers);
+	while (IdleBuffers.Num() > MaxPooledBuffers)
+	{
+		FreeBuffer(IdleBuffers.Pop(false));
+	}
+}
+
+FCameraImageBuffer *FCameraImageBufferPool::Acquire()
+{
+	int32 Size = 0;
+	{
+		FScopeLock ScopeLock(&Lock);
+		Size = BufferSize;
+		if (IdleBuffers.Num() > 0)
+		{
+			NumBuffersInUse.Increment();
+			return IdleBuffers.Pop(false);
+		}
+	}
+
+	NumBuffersInUse.Increment();
+	return AllocateBuffer(Size);
+}
+
+void FCameraImageBufferPool::Release(FCameraImageBuffer *Buffer)
+{
+	if (Buffer == nullptr)
+	{
+		return;
+	}
+
+	NumBuffersInUse.Decrement();
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (Buffer->Size == BufferSize && IdleBuffers.Num() < MaxPooledBuffers)
+		{
+			IdleBuffers.Add(Buffer);
+			return;
+		}
+	}
+	FreeBuffer(Buffer);
+}
+
+void FCameraImageBufferPool::UploadToTexture(UTexture2D *Texture, FCameraImageBuffer *Buffer, int32 Width, int32 Height)
+{
+	check(Buffer->Size >= Width * Height);
+
+	Buffer->Regions.Reset();
+	Buffer->Regions.Emplace(0, 0, 0, 0, Width, Height);
+	UploadRegions(Texture, Buffer, Width);
+}
+
+int32 FCameraImageBufferPool::UploadTilesToTexture(
+	UTexture2D *Texture,
+	FCameraImageBuffer *Buffer,
+	int32 Width,
+	int32 Height,
+	int32 TileSize,
+	const uint8 *DirtyTiles)
+{
+	check(Buffer->Size >= Width * Height);
+	check(TileSize > 0);
+
+	const int32 NumTilesX = (Width + TileSize - 1) / TileSize;
+	const int32 NumTilesY = (Height + TileSize - 1) / TileSize;
+	int32 NumPixels = 0;
+	Buffer->Regions.Reset();
+	for (int32 TileY = 0; TileY < NumTilesY; TileY++)
+	{
+		const uint8 *DirtyRow = DirtyTiles + TileY * NumTilesX;
+		for (int32 TileX = 0; TileX < NumTilesX; )
+		{
+			if (!DirtyRow[TileX])
+			{
+				TileX++;
+				continue;
+			}
+			const int32 RunBegin = TileX;
+			while (TileX < NumTilesX && DirtyRow[TileX])
+			{
+				TileX++;
+			}
+
+			// The texture and the buffer share their layout, so the source
+			// of each region is where it goes.
+			const int32 X = RunBegin * TileSize;
+			const int32 Y = TileY * TileSize;
+			const int32 RegionWidth = FMath::Min(TileX * TileSize, Width) - X;
+			const int32 RegionHeight = FMath::Min(TileSize, Height - Y);
+			Buffer->Regions.Emplace(X, Y, X, Y, RegionWidth, RegionHeight);
+			NumPixels += RegionWidth * RegionHeight;
+		}
+	}
+
+	if (Buffer->Regions.Num() == 0)
+	{
+		Release(Buffer);
+		return 0;
+	}
+
+	UploadRegions(Texture, Buffer, Width);
+	return NumPixels;
+}
+
+void FCameraImageBufferPool::UploadRegions(UTexture2D *Texture, FCameraImageBuffer *Buffer, int32 Width)
+{
+	TSharedRef<FCameraImageBufferPool, ESPMode::ThreadSafe> PoolRef = AsShared();
+	auto CleanupData = [PoolRef, Buffer](uint8 *SrcData, const FUpdateTextureRegion2D *Regions)
+		{
+			PoolRef->Release(Buffer);
+		};
+
+	Texture->UpdateTextureRegions(
+		0, Buffer->Regions.Num(), Buffer->Regions.GetData(), Width, 1,
+		Buffer->Pixels,
+		CleanupData);
+}
+
+FCameraImageBuffer *FCameraImageBufferPool::AllocateBuffer(int32 InSize)
+{
+	FCameraImageBuffer *Buffer = new FCameraImageBuffer();
+	Buffer->Pixels = static_cast<uint8*>(FMemory::Malloc(InSize));
+	Buffer->Size = InSize;
+
+	NumAllocations.Increment();
+	NumAllocatedBytes.Add(sizeof(FCameraImageBuffer) + InSize);
+	COMPUTERVISION_INC_STAT(CameraImageBytesAllocated, sizeof(FCameraImageBuffer) + InSize);
+	return Buffer;
+}
+
+void FCameraImageBufferPool::FreeBuffer(FCameraImageBuffer *Buffer)
+{
+	FMemory::Free(Buffer->Pixels);
+	delete Buffer;
+}
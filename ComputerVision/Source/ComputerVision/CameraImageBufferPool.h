@@ -0,0 +1,116 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture2D.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+/**
+ * A frame buffer handed out by FCameraImageBufferPool. The upload regions
+ * live next to the pixels, and keep their capacity while the buffer is
+ * pooled, so that a texture upload needs no separate allocation once the
+ * pool is warm.
+ */
+struct FCameraImageBuffer
+{
+	/** Tightly packed 8-bit pixels. */
+	uint8 *Pixels = nullptr;
+
+	/** Size of Pixels in bytes. */
+	int32 Size = 0;
+
+	/** Regions passed to UTexture2D::UpdateTextureRegions(). */
+	TArray<FUpdateTextureRegion2D> Regions;
+};
+
+/**
+ * A small thread-safe pool of equally sized frame buffers.
+ *
+ * Buffers are allocated on the first frame and recycled afterwards.
+ * Changing the buffer size frees the pooled buffers; buffers of the old
+ * size that are still in use are freed when they are released.
+ */
+class FCameraImageBufferPool : public TSharedFromThis<FCameraImageBufferPool, ESPMode::ThreadSafe>
+{
+public:
+
+	/**
+	 * @param InMaxPooledBuffers	The number of idle buffers kept for reuse. Further released buffers are freed.
+	 */
+	explicit FCameraImageBufferPool(int32 InMaxPooledBuffers);
+
+	~FCameraImageBufferPool();
+
+	/** Sets the size of the buffers handed out by Acquire(). Does nothing if the size is unchanged. */
+	void SetBufferSize(int32 InBufferSize);
+
+	/** Sets the number of idle buffers kept for reuse. */
+	void SetMaxPooledBuffers(int32 InMaxPooledBuffers);
+
+	/** Returns an idle buffer, allocating a new one only if none is available. */
+	FCameraImageBuffer *Acquire();
+
+	/** Returns a buffer obtained from Acquire() to the pool. Can be called from any thread. */
+	void Release(FCameraImageBuffer *Buffer);
+
+	/**
+	 * Uploads a buffer to a texture and returns it to the pool once the
+	 * render thread is done with it.
+	 */
+	void UploadToTexture(UTexture2D *Texture, FCameraImageBuffer *Buffer, int32 Width, int32 Height);
+
+	/**
+	 * Like UploadToTexture(), but uploads only the tiles flagged by
+	 * CameraImageKernels::FindDirtyTiles(). Horizontally adjacent dirty
+	 * tiles are merged into one region.
+	 *
+	 * @return The number of pixels uploaded.
+	 */
+	int32 UploadTilesToTexture(
+		UTexture2D *Texture,
+		FCameraImageBuffer *Buffer,
+		int32 Width,
+		int32 Height,
+		int32 TileSize,
+		const uint8 *DirtyTiles);
+
+	/** The number of buffers allocated since the pool was created. */
+	int64 GetNumAllocations() const { return NumAllocations.GetValue(); }
+
+	/** The number of bytes allocated since the pool was created. */
+	int64 GetNumAllocatedBytes() const { return NumAllocatedBytes.GetValue(); }
+
+	/** The number of buffers currently handed out. */
+	int32 GetNumBuffersInUse() const { return NumBuffersInUse.GetValue(); }
+
+private:
+
+	/** Uploads Buffer->Regions and releases the buffer afterwards. */
+	void UploadRegions(UTexture2D *Texture, FCameraImageBuffer *Buffer, int32 Width);
+
+	FCameraImageBuffer *AllocateBuffer(int32 InSize);
+	static void FreeBuffer(FCameraImageBuffer *Buffer);
+
+	FCriticalSection Lock;
+	TArray<FCameraImageBuffer*> IdleBuffers;
+	int32 BufferSize = 0;
+	int32 MaxPooledBuffers;
+
+	FThreadSafeCounter64 NumAllocations;
+	FThreadSafeCounter64 NumAllocatedBytes;
+	FThreadSafeCounter NumBuffersInUse;
+};
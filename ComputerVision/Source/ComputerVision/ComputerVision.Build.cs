@@ -8,7 +8,7 @@ public class ComputerVision : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "GoogleARCoreBase", "AugmentedReality" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "GoogleARCoreBase", "AugmentedReality", "ComputerVisionCore" });
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
@@ -16,3 +16,7 @@
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, ComputerVision, "ComputerVision" );
+
+DEFINE_LOG_CATEGORY(LogComputerVision);
+
+CSV_DEFINE_CATEGORY(ComputerVision, true);
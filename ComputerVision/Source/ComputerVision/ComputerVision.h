@@ -15,4 +15,27 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogComputerVision, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("ComputerVision"), STATGROUP_ComputerVision, STATCAT_Advanced);
+CSV_DECLARE_CATEGORY_EXTERN(ComputerVision);
+
+/**
+ * Times the enclosing scope as the cycle stat STAT_<Name>, the CSV
+ * profiler stat ComputerVision/<Name> and a named event for external
+ * profilers. Stats are only compiled into Debug and Development builds,
+ * CSV stats and named events into Test builds as well; all three
+ * compile out in Shipping.
+ */
+#define COMPUTERVISION_SCOPED_STAT(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_##Name); \
+	CSV_SCOPED_TIMING_STAT(ComputerVision, Name); \
+	SCOPED_NAMED_EVENT(Name, FColor::Turquoise)
+
+/** Adds Value to the per-frame counter stat STAT_<Name> and the CSV profiler stat ComputerVision/<Name>. */
+#define COMPUTERVISION_INC_STAT(Name, Value) \
+	INC_DWORD_STAT_BY(STAT_##Name, Value); \
+	CSV_CUSTOM_STAT(ComputerVision, Name, static_cast<int32>(Value), ECsvCustomStatOp::Accumulate)
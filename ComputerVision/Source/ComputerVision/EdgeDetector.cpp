@@ -15,142 +15,211 @@
 #include "EdgeDetector.h"
 
 #include "ComputerVision.h"
+#include "CameraImageKernels.h"
+#include "CameraImageBufferPool.h"
+#include "CameraFrameRecording.h"
+#include "ImageFilterGraphObject.h"
 
 #include "GoogleARCoreCameraImage.h"
 #include "GoogleARCoreFunctionLibrary.h"
 
 #include "TransformCalculus2D.h"
 
-static const int SobelThreshold = 128 * 128;
+#include "Async/Async.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+DECLARE_CYCLE_STAT(TEXT("Edge Detector Acquire"), STAT_EdgeDetectorAcquire, STATGROUP_ComputerVision);
+DECLARE_CYCLE_STAT(TEXT("Edge Detector Kernel"), STAT_EdgeDetectorKernel, STATGROUP_ComputerVision);
+DECLARE_CYCLE_STAT(TEXT("Edge Detector Upload"), STAT_EdgeDetectorUpload, STATGROUP_ComputerVision);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Edge Detector Pixels"), STAT_EdgeDetectorPixels, STATGROUP_ComputerVision);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Edge Detector Pixels Uploaded"), STAT_EdgeDetectorPixelsUploaded, STATGROUP_ComputerVision);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Edge Detector Dirty Tiles"), STAT_EdgeDetectorDirtyTiles, STATGROUP_ComputerVision);
+
+/**
+ * A camera image copied for the async pipeline, together with the
+ * settings it is processed with.
+ */
+struct FEdgeDetectorJob
+{
+	FCameraImageBuffer *InputFrame = nullptr;
+	FCameraImageBuffer *OutputFrame = nullptr;
+	int32 Width = 0;
+	int32 Height = 0;
+	uint64 FrameNumber = 0;
+	TSharedPtr<const FImageFilterGraph, ESPMode::ThreadSafe> Graph;
+	int32 NumBands = 1;
+	int32 MinPixelsPerTask = 0;
+	TWeakObjectPtr<AGoogleARCoreEdgeDetector> EdgeDetector;
+};
+
+/**
+ * State shared between the game thread, the background workers of the
+ * async pipeline and the render thread. Workers hold a reference, so it
+ * stays valid if the actor is destroyed while frames are still in flight.
+ */
+struct FEdgeDetectorPipeline
+{
+	FEdgeDetectorPipeline()
+		: BufferPool(MakeShared<FCameraImageBufferPool, ESPMode::ThreadSafe>(2))
+	{
+	}
+
+	~FEdgeDetectorPipeline()
+	{
+		BufferPool->Release(PendingJob.InputFrame);
+		BufferPool->Release(PendingJob.OutputFrame);
+		BufferPool->Release(LatestFrame);
+	}
+
+	/** Frame buffers for the camera image copies, filter outputs and texture uploads. */
+	TSharedRef<FCameraImageBufferPool, ESPMode::ThreadSafe> BufferPool;
+
+	/**
+	 * Frames replaced by a newer one, either while waiting for a worker or
+	 * because the newer frame completed first.
+	 */
+	FThreadSafeCounter DroppedFrames;
+
+	/** Sequence number of the most recently acquired frame. Game thread only. */
+	uint64 NextFrameNumber = 0;
+
+	/** Guards the members below. */
+	FCriticalSection Lock;
+
+	/** Frames handed to a worker that have not completed yet. */
+	int32 FramesInFlight = 0;
+
+	/**
+	 * The newest frame waiting for a worker to become free, if its
+	 * InputFrame is set. A newer frame replaces it.
+	 */
+	FEdgeDetectorJob PendingJob;
+
+	/** The newest completed frame that has not been uploaded yet, or null. */
+	FCameraImageBuffer *LatestFrame = nullptr;
+	uint64 LatestFrameNumber = 0;
+	int32 LatestWidth = 0;
+	int32 LatestHeight = 0;
+};
+
+AGoogleARCoreEdgeDetector::AGoogleARCoreEdgeDetector()
+	: Pipeline(MakeShared<FEdgeDetectorPipeline, ESPMode::ThreadSafe>())
+{
+}
+
+int32 AGoogleARCoreEdgeDetector::GetEdgeDetectionBandCount() const
+{
+	return bUseParallelEdgeDetection ? ParallelBandCount : 1;
+}
+
 void AGoogleARCoreEdgeDetector::GoogleARCoreDoSobelEdgeDetection(
 	const uint8 *InYPlaneData,
 	uint32 YPlanePixelStride,
 	uint32 YPlaneRowStride,
 	uint8 *OutPixels,
 	int32 Width,
-	int32 Height)
+	int32 Height) const
 {
-	// We copy the image data here before running the edge detection algorithm.
-	// This is due to on some device(Exynos S8), accessing the original image
-	// buffer is extremely slow.
-	TArray<uint8> YPlaneDataCopy(InYPlaneData, YPlaneRowStride * Height);
-
-	int XKernel[3][3] = {
-		{ -1, 0, 1 },
-		{ -2, 0, 2 },
-		{ -1, 0, 1 }
-	};
+	COMPUTERVISION_SCOPED_STAT(EdgeDetectorKernel);
 
-	int YKernel[3][3] = {
-		{ -1, -2, -1 },
-		{ 0,  0,  0 },
-		{ 1,  2,  1 }
-	};
-
-	for (int32 y = 0; y < Height; y++)
+	// The kernels stream the Y plane through a small row cache rather than
+	// reading the camera buffer directly, which is extremely slow on some
+	// devices (Exynos S8).
+	TSharedPtr<const FImageFilterGraph, ESPMode::ThreadSafe> Graph = GetFilterGraph();
+	if (Graph.IsValid())
 	{
-		for (int32 x = 0; x < Width; x++)
-		{
-			int XMag = 0;
-			int YMag = 0;
-
-			for (int32 u = 0; u < 3; u++)
-			{
-				for (int32 v = 0; v < 3; v++)
-				{
-					int32 u2 = x + u - 1;
-					int32 v2 = y + v - 1;
-
-					if (u2 < 0) u2 = 0;
-					if (u2 >= Width) u2 = Width - 1;
-					if (v2 < 0) v2 = 0;
-					if (v2 >= Height) v2 = Height - 1;
+		Graph->Execute(
+			InYPlaneData, YPlanePixelStride, YPlaneRowStride, OutPixels, Width, Height,
+			static_cast<int32>(Decimation), GetEdgeDetectionBandCount(), MinPixelsPerTask);
+		return;
+	}
 
-					uint8 SourcePixel = YPlaneDataCopy[
-						u2 * YPlanePixelStride +
-							v2 * YPlaneRowStride];
+	CameraImageKernels::SobelEdgeDetectionDecimated(
+		InYPlaneData, YPlanePixelStride, YPlaneRowStride, OutPixels, Width, Height,
+		static_cast<int32>(Decimation), GetEdgeDetectionBandCount(), MinPixelsPerTask);
+}
 
-					XMag += SourcePixel * XKernel[u][v];
-					YMag += SourcePixel * YKernel[u][v];
-				}
-			}
+TSharedPtr<const FImageFilterGraph, ESPMode::ThreadSafe> AGoogleARCoreEdgeDetector::GetFilterGraph() const
+{
+	return FilterGraph ? FilterGraph->GetCompiledGraph() : nullptr;
+}
 
-			int Magnitude = XMag * XMag + YMag * YMag;
-			uint8 Output = Magnitude > SobelThreshold ? 0xFF : 0x1F;
-			OutPixels[y * Width + x] = Output;
-		}
+FIntRect AGoogleARCoreEdgeDetector::GetProcessedRegion(int32 Width, int32 Height) const
+{
+	FIntRect Region(0, 0, Width, Height);
+	if (bUseRegionOfInterest)
+	{
+		Region.Min.X = FMath::Clamp(FMath::FloorToInt(RegionOfInterest.Min.X * Width), 0, Width);
+		Region.Min.Y = FMath::Clamp(FMath::FloorToInt(RegionOfInterest.Min.Y * Height), 0, Height);
+		Region.Max.X = FMath::Clamp(FMath::CeilToInt(RegionOfInterest.Max.X * Width), Region.Min.X, Width);
+		Region.Max.Y = FMath::Clamp(FMath::CeilToInt(RegionOfInterest.Max.Y * Height), Region.Min.Y, Height);
 	}
+
+	// Cover whole decimation blocks and at least one output pixel.
+	const int32 Factor = static_cast<int32>(Decimation);
+	auto FitToBlocks = [Factor](int32 &Min, int32 &Max, int32 Size)
+	{
+		const int32 NumBlocks = FMath::Max((Max - Min) / Factor, 1);
+		Max = FMath::Min(Min + NumBlocks * Factor, Size);
+		Min = FMath::Max(Max - NumBlocks * Factor, 0);
+	};
+	FitToBlocks(Region.Min.X, Region.Max.X, Width);
+	FitToBlocks(Region.Min.Y, Region.Max.Y, Height);
+	return Region;
 }
 
 EGoogleARCoreFunctionStatus AGoogleARCoreEdgeDetector::UpdateCameraImage()
 {
+	if (Replay.IsValid())
+	{
+		return UpdateReplayedCameraImage();
+	}
+
 	EGoogleARCoreFunctionStatus AcquireStatus =
 		EGoogleARCoreFunctionStatus::NotAvailable;
 
 #if PLATFORM_ANDROID
 
 	UGoogleARCoreCameraImage *CameraImage = nullptr;
-	AcquireStatus =
-		UGoogleARCoreFrameFunctionLibrary::AcquireCameraImage(CameraImage);
+	{
+		COMPUTERVISION_SCOPED_STAT(EdgeDetectorAcquire);
+		AcquireStatus =
+			UGoogleARCoreFrameFunctionLibrary::AcquireCameraImage(CameraImage);
+	}
 	if(AcquireStatus != EGoogleARCoreFunctionStatus::Success)
 	{
 		return AcquireStatus;
 	}
 
-	int32_t Width = CameraImage->GetWidth();
-	int32_t Height = CameraImage->GetHeight();
-	int32_t planeCount = CameraImage->GetPlaneCount();
+	// The capture time of the image rather than the time we got to it, so
+	// that a recording keeps the camera's frame timing.
+	FCameraFrameView Frame;
+	Frame.Timestamp = UGoogleARCoreFrameFunctionLibrary::GetCameraTimestamp() * 1e-9;
+	Frame.Width = CameraImage->GetWidth();
+	Frame.Height = CameraImage->GetHeight();
+	Frame.NumPlanes = FMath::Min(CameraImage->GetPlaneCount(), FCameraFrameView::MaxPlanes);
 
-	if (!CameraImageTexture || CameraImageTexture->GetSizeX() != Width || CameraImageTexture->GetSizeY() != Height)
+	// Y, U and V.
+	for (int32 PlaneIndex = 0; PlaneIndex < Frame.NumPlanes; PlaneIndex++)
 	{
-		CameraImageTexture = UTexture2D::CreateTransient(Width, Height, EPixelFormat::PF_G8);
-		CameraImageTexture->UpdateResource();
+		int32_t xStride = 0;
+		int32_t yStride = 0;
+		int32_t length = 0;
+		FCameraFramePlane &Plane = Frame.Planes[PlaneIndex];
+		Plane.Data = CameraImage->GetPlaneData(PlaneIndex, xStride, yStride, length);
+		Plane.PixelStride = xStride;
+		Plane.RowStride = yStride;
+		Plane.Size = length;
 	}
 
-	uint8_t *TempRGBABuf = new uint8_t[Width * Height];
-
-	// Y
-	int32_t y_xStride = 0;
-	int32_t y_yStride = 0;
-	int32_t y_length = 0;
-	uint8_t *y_planeData = nullptr;
-	y_planeData = CameraImage->GetPlaneData(0, y_xStride, y_yStride, y_length);
-
-	// U
-	int32_t u_xStride = 0;
-	int32_t u_yStride = 0;
-	int32_t u_length = 0;
-	uint8_t *u_planeData = nullptr;
-	u_planeData = CameraImage->GetPlaneData(1, u_xStride, u_yStride, u_length);
-
-	// V
-	int32_t v_xStride = 0;
-	int32_t v_yStride = 0;
-	int32_t v_length = 0;
-	uint8_t *v_planeData = nullptr;
-	v_planeData = CameraImage->GetPlaneData(2, v_xStride, v_yStride, v_length);
-
-	GoogleARCoreDoSobelEdgeDetection(
-		y_planeData, y_xStride, y_yStride, TempRGBABuf, Width, Height);
-
-	FUpdateTextureRegion2D *Region = new FUpdateTextureRegion2D[1];
-	Region->DestX = 0;
-	Region->DestY = 0;
-	Region->SrcX = 0;
-	Region->SrcY = 0;
-	Region->Width = Width;
-	Region->Height = Height;
-
-	auto CleanupData = [](uint8_t *SrcData, const FUpdateTextureRegion2D* Regions)
-		{
-			delete[] SrcData;
-			delete[] Regions;
-		};
+	if (Recorder.IsValid())
+	{
+		Recorder->AddFrame(Frame);
+	}
 
-	CameraImageTexture->UpdateTextureRegions(
-		0, 1, Region, Width, 1,
-		reinterpret_cast<uint8_t*>(TempRGBABuf),
-		CleanupData);
+	ProcessCameraFrame(Frame);
 
 	CameraImage->Release();
 
@@ -159,8 +228,366 @@ EGoogleARCoreFunctionStatus AGoogleARCoreEdgeDetector::UpdateCameraImage()
 	return AcquireStatus;
 }
 
+EGoogleARCoreFunctionStatus AGoogleARCoreEdgeDetector::UpdateReplayedCameraImage()
+{
+	const int32 NumFrames = Replay->GetNumFrames();
+	if (NumFrames == 0)
+	{
+		return EGoogleARCoreFunctionStatus::NotAvailable;
+	}
+
+	int64 FrameNumber = NextReplayFrameNumber;
+	if (ReplayMode == EGoogleARCoreCameraReplayMode::FixedRate)
+	{
+		// Skip frames if we are called less often than the replay rate, and
+		// report no new image if we are called more often.
+		const double ElapsedSeconds = FPlatformTime::Seconds() - ReplayStartTime;
+		const int64 DueFrameNumber = static_cast<int64>(ElapsedSeconds * FMath::Max(ReplayFrameRate, 0.001f));
+		if (DueFrameNumber < NextReplayFrameNumber)
+		{
+			return EGoogleARCoreFunctionStatus::NotAvailable;
+		}
+		FrameNumber = DueFrameNumber;
+	}
+
+	if (FrameNumber >= NumFrames && !bLoopReplay)
+	{
+		return EGoogleARCoreFunctionStatus::NotAvailable;
+	}
+	NextReplayFrameNumber = FrameNumber + 1;
+
+	FCameraFrameView Frame;
+	{
+		COMPUTERVISION_SCOPED_STAT(EdgeDetectorAcquire);
+		if (!Replay->GetFrame(static_cast<int32>(FrameNumber % NumFrames), Frame))
+		{
+			return EGoogleARCoreFunctionStatus::NotAvailable;
+		}
+	}
+
+	// The frame points straight into the mapped recording.
+	ProcessCameraFrame(Frame);
+	NumReplayedFrames++;
+	return EGoogleARCoreFunctionStatus::Success;
+}
+
+void AGoogleARCoreEdgeDetector::ProcessCameraFrame(const FCameraFrameView &Frame)
+{
+	if (Frame.NumPlanes < 1)
+	{
+		return;
+	}
+
+	const FIntRect Region = GetProcessedRegion(Frame.Width, Frame.Height);
+	const int32 Factor = static_cast<int32>(Decimation);
+	const int32 OutputWidth = Region.Width() / Factor;
+	const int32 OutputHeight = Region.Height() / Factor;
+
+	// The pool keeps its buffers until the output size changes. Every
+	// frame in flight or waiting for a worker needs an input and an output
+	// buffer, plus the frames that are waiting for or being uploaded.
+	Pipeline->BufferPool->SetBufferSize(OutputWidth * OutputHeight);
+	Pipeline->BufferPool->SetMaxPooledBuffers(2 * (MaxFramesInFlight + 1) + 3);
+
+	COMPUTERVISION_INC_STAT(EdgeDetectorPixels, Region.Area());
+
+	const FCameraFramePlane &YPlane = Frame.Planes[0];
+	const uint8 *RegionData = YPlane.Data + Region.Min.Y * YPlane.RowStride + Region.Min.X * YPlane.PixelStride;
+
+	if (bProcessCameraImageAsync)
+	{
+		ProcessCameraImageAsync(RegionData, YPlane.PixelStride, YPlane.RowStride, Region.Width(), Region.Height());
+	}
+	else
+	{
+		FCameraImageBuffer *OutputFrame = Pipeline->BufferPool->Acquire();
+
+		GoogleARCoreDoSobelEdgeDetection(
+			RegionData, YPlane.PixelStride, YPlane.RowStride, OutputFrame->Pixels, Region.Width(), Region.Height());
+
+		UploadCameraImage(OutputFrame, OutputWidth, OutputHeight);
+	}
+}
+
+bool AGoogleARCoreEdgeDetector::StartRecording(const FString &Filename)
+{
+	StopRecording();
+
+	TSharedPtr<FCameraFrameRecorder> NewRecorder = MakeShared<FCameraFrameRecorder>();
+	if (!NewRecorder->Open(GetCameraRecordingPath(Filename)))
+	{
+		return false;
+	}
+	Recorder = NewRecorder;
+	return true;
+}
+
+void AGoogleARCoreEdgeDetector::StopRecording()
+{
+	if (Recorder.IsValid())
+	{
+		UE_LOG(LogComputerVision, Log, TEXT("Recorded %d camera frames, %d dropped"),
+			Recorder->GetNumFramesWritten(), Recorder->GetNumFramesDropped());
+		Recorder.Reset();
+	}
+}
+
+bool AGoogleARCoreEdgeDetector::StartReplay(const FString &Filename, EGoogleARCoreCameraReplayMode Mode)
+{
+	StopReplay();
+
+	TSharedPtr<FCameraFrameReplay> NewReplay = MakeShared<FCameraFrameReplay>();
+	if (!NewReplay->Open(GetCameraRecordingPath(Filename)))
+	{
+		return false;
+	}
+	Replay = NewReplay;
+	ReplayMode = Mode;
+	ReplayStartTime = FPlatformTime::Seconds();
+	NextReplayFrameNumber = 0;
+	NumReplayedFrames = 0;
+	return true;
+}
+
+void AGoogleARCoreEdgeDetector::StopReplay()
+{
+	Replay.Reset();
+}
+
+bool AGoogleARCoreEdgeDetector::IsReplaying() const
+{
+	return Replay.IsValid();
+}
+
+int32 AGoogleARCoreEdgeDetector::GetNumReplayedFrames() const
+{
+	return NumReplayedFrames;
+}
+
+FString AGoogleARCoreEdgeDetector::GetCameraRecordingPath(const FString &Filename)
+{
+	if (FPaths::IsRelative(Filename))
+	{
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CameraRecordings"), Filename);
+	}
+	return Filename;
+}
+
+void AGoogleARCoreEdgeDetector::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Flush the recording so that it ends on a complete frame.
+	StopRecording();
+	StopReplay();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGoogleARCoreEdgeDetector::ProcessCameraImageAsync(
+	const uint8 *InYPlaneData,
+	uint32 YPlanePixelStride,
+	uint32 YPlaneRowStride,
+	int32 Width,
+	int32 Height)
+{
+	// The camera image is released as soon as UpdateCameraImage() returns,
+	// so the worker gets its own packed, already decimated copy of the Y
+	// plane. Both buffers are taken here so they match the size set for
+	// this frame.
+	const int32 Factor = static_cast<int32>(Decimation);
+	FEdgeDetectorJob Job;
+	Job.Width = Width / Factor;
+	Job.Height = Height / Factor;
+	Job.InputFrame = Pipeline->BufferPool->Acquire();
+	Job.OutputFrame = Pipeline->BufferPool->Acquire();
+	{
+		COMPUTERVISION_SCOPED_STAT(EdgeDetectorAcquire);
+		CameraImageKernels::DownsamplePlane(
+			InYPlaneData, YPlanePixelStride, YPlaneRowStride, Width, Height, Factor, Job.InputFrame->Pixels);
+	}
+	Job.FrameNumber = ++Pipeline->NextFrameNumber;
+	Job.Graph = GetFilterGraph();
+	Job.NumBands = GetEdgeDetectionBandCount();
+	Job.MinPixelsPerTask = MinPixelsPerTask;
+	Job.EdgeDetector = this;
+
+	// While all workers are busy, only the newest frame waits for the next
+	// one to become free.
+	FEdgeDetectorJob ReplacedJob;
+	{
+		FScopeLock ScopeLock(&Pipeline->Lock);
+		if (Pipeline->FramesInFlight < MaxFramesInFlight)
+		{
+			Pipeline->FramesInFlight++;
+		}
+		else
+		{
+			ReplacedJob = Pipeline->PendingJob;
+			Pipeline->PendingJob = Job;
+			Job = FEdgeDetectorJob();
+		}
+	}
+
+	if (ReplacedJob.InputFrame != nullptr)
+	{
+		Pipeline->BufferPool->Release(ReplacedJob.InputFrame);
+		Pipeline->BufferPool->Release(ReplacedJob.OutputFrame);
+		Pipeline->DroppedFrames.Increment();
+	}
+
+	if (Job.InputFrame != nullptr)
+	{
+		RunJobAsync(Pipeline, Job);
+	}
+}
+
+void AGoogleARCoreEdgeDetector::RunJobAsync(TSharedPtr<FEdgeDetectorPipeline, ESPMode::ThreadSafe> Pipeline, const FEdgeDetectorJob &Job)
+{
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Pipeline, Job]()
+	{
+		{
+			COMPUTERVISION_SCOPED_STAT(EdgeDetectorKernel);
+			if (Job.Graph.IsValid())
+			{
+				Job.Graph->Execute(
+					Job.InputFrame->Pixels, 1, Job.Width, Job.OutputFrame->Pixels, Job.Width, Job.Height,
+					1, Job.NumBands, Job.MinPixelsPerTask);
+			}
+			else
+			{
+				CameraImageKernels::SobelEdgeDetectionPacked(
+					Job.InputFrame->Pixels, Job.OutputFrame->Pixels, Job.Width, Job.Height, Job.NumBands, Job.MinPixelsPerTask);
+			}
+		}
+		Pipeline->BufferPool->Release(Job.InputFrame);
+
+		FCameraImageBuffer *OutputFrame = Job.OutputFrame;
+		FEdgeDetectorJob NextJob;
+		{
+			FScopeLock ScopeLock(&Pipeline->Lock);
+			if (Job.FrameNumber > Pipeline->LatestFrameNumber)
+			{
+				if (Pipeline->LatestFrame != nullptr)
+				{
+					// A newer frame replaces one that was never uploaded.
+					Pipeline->BufferPool->Release(Pipeline->LatestFrame);
+					Pipeline->DroppedFrames.Increment();
+				}
+				Pipeline->LatestFrame = OutputFrame;
+				Pipeline->LatestFrameNumber = Job.FrameNumber;
+				Pipeline->LatestWidth = Job.Width;
+				Pipeline->LatestHeight = Job.Height;
+				OutputFrame = nullptr;
+			}
+
+			if (Pipeline->PendingJob.InputFrame != nullptr)
+			{
+				NextJob = Pipeline->PendingJob;
+				Pipeline->PendingJob = FEdgeDetectorJob();
+			}
+			else
+			{
+				Pipeline->FramesInFlight--;
+			}
+		}
+
+		if (OutputFrame != nullptr)
+		{
+			// A newer frame finished first, so this one is already stale.
+			Pipeline->BufferPool->Release(OutputFrame);
+			Pipeline->DroppedFrames.Increment();
+		}
+
+		if (NextJob.InputFrame != nullptr)
+		{
+			RunJobAsync(Pipeline, NextJob);
+		}
+
+		TWeakObjectPtr<AGoogleARCoreEdgeDetector> WeakEdgeDetector = Job.EdgeDetector;
+		AsyncTask(ENamedThreads::GameThread, [WeakEdgeDetector]()
+		{
+			if (AGoogleARCoreEdgeDetector *EdgeDetector = WeakEdgeDetector.Get())
+			{
+				EdgeDetector->PublishCompletedFrame();
+			}
+		});
+	});
+}
+
+void AGoogleARCoreEdgeDetector::PublishCompletedFrame()
+{
+	FCameraImageBuffer *Frame = nullptr;
+	int32 Width = 0;
+	int32 Height = 0;
+	{
+		FScopeLock ScopeLock(&Pipeline->Lock);
+		Frame = Pipeline->LatestFrame;
+		Width = Pipeline->LatestWidth;
+		Height = Pipeline->LatestHeight;
+		Pipeline->LatestFrame = nullptr;
+	}
+
+	if (Frame != nullptr)
+	{
+		UploadCameraImage(Frame, Width, Height);
+	}
+}
+
+void AGoogleARCoreEdgeDetector::UploadCameraImage(FCameraImageBuffer *Frame, int32 Width, int32 Height)
+{
+	COMPUTERVISION_SCOPED_STAT(EdgeDetectorUpload);
+
+	if (!CameraImageTexture || CameraImageTexture->GetSizeX() != Width || CameraImageTexture->GetSizeY() != Height)
+	{
+		CameraImageTexture = UTexture2D::CreateTransient(Width, Height, EPixelFormat::PF_G8);
+		CameraImageTexture->UpdateResource();
+		UploadedPixels.Reset();
+	}
+
+	// The frame goes back to the pool once the render thread has copied it,
+	// so it is diffed and copied before it is handed over.
+	if (bUploadChangedTilesOnly && UploadedPixels.Num() == Width * Height)
+	{
+		const int32 TileSize = FMath::Max(UploadTileSize, 8);
+		const int32 NumTiles = ((Width + TileSize - 1) / TileSize) * ((Height + TileSize - 1) / TileSize);
+		DirtyTiles.SetNumUninitialized(NumTiles, false);
+		const int32 NumDirtyTiles = CameraImageKernels::FindDirtyTiles(
+			Frame->Pixels, UploadedPixels.GetData(), Width, Height, TileSize, DirtyTiles.GetData());
+		COMPUTERVISION_INC_STAT(EdgeDetectorDirtyTiles, NumDirtyTiles);
+
+		if (NumDirtyTiles <= NumTiles * MaxDirtyTileRatio)
+		{
+			CameraImageKernels::CopyDirtyTiles(
+				Frame->Pixels, UploadedPixels.GetData(), Width, Height, TileSize, DirtyTiles.GetData());
+			const int32 NumPixels = Pipeline->BufferPool->UploadTilesToTexture(
+				CameraImageTexture, Frame, Width, Height, TileSize, DirtyTiles.GetData());
+			COMPUTERVISION_INC_STAT(EdgeDetectorPixelsUploaded, NumPixels);
+			return;
+		}
+	}
+
+	if (bUploadChangedTilesOnly)
+	{
+		UploadedPixels.SetNumUninitialized(Width * Height, false);
+		FMemory::Memcpy(UploadedPixels.GetData(), Frame->Pixels, Width * Height);
+	}
+	else
+	{
+		UploadedPixels.Empty();
+	}
+	Pipeline->BufferPool->UploadToTexture(CameraImageTexture, Frame, Width, Height);
+	COMPUTERVISION_INC_STAT(EdgeDetectorPixelsUploaded, Width * Height);
+}
+
+int32 AGoogleARCoreEdgeDetector::GetNumDroppedFrames() const
+{
+	return Pipeline->DroppedFrames.GetValue();
+}
+
+int32 AGoogleARCoreEdgeDetector::GetNumBufferAllocations() const
+{
+	return static_cast<int32>(Pipeline->BufferPool->GetNumAllocations());
+}
+
 UTexture2D *AGoogleARCoreEdgeDetector::GetCameraImage()
 {
 	return CameraImageTexture;
 }
-
@@ -16,6 +16,41 @@
 
 #include "EdgeDetector.generated.h"
 
+struct FCameraImageBuffer;
+struct FCameraFrameView;
+struct FEdgeDetectorJob;
+struct FEdgeDetectorPipeline;
+class FCameraFrameRecorder;
+class FCameraFrameReplay;
+class FImageFilterGraph;
+class UGoogleARCoreImageFilterGraph;
+
+/**
+ * How much the camera image is scaled down before edge detection.
+ */
+UENUM(BlueprintType)
+enum class EGoogleARCoreEdgeDetectorDecimation : uint8
+{
+	/** Process the camera image at full resolution. */
+	Full = 1 UMETA(DisplayName = "Full Resolution"),
+	/** Average 2x2 pixel blocks before processing. */
+	Half = 2 UMETA(DisplayName = "Half Resolution"),
+	/** Average 4x4 pixel blocks before processing. */
+	Quarter = 4 UMETA(DisplayName = "Quarter Resolution")
+};
+
+/**
+ * How a camera recording is replayed.
+ */
+UENUM(BlueprintType)
+enum class EGoogleARCoreCameraReplayMode : uint8
+{
+	/** Replay at ReplayFrameRate, skipping frames if the game runs slower. */
+	FixedRate,
+	/** Replay the next frame on every UpdateCameraImage() call, as a throughput benchmark. */
+	AsFastAsPossible
+};
+
 /**
  * This class demonstrates how to access ARCore camera image data on
  * the CPU.
@@ -27,18 +62,25 @@ class AGoogleARCoreEdgeDetector : public AActor
 
 public:
 
+	AGoogleARCoreEdgeDetector();
+
 	/**
 	 * This function acquires a new CPU-accessible camera image, runs
 	 * a sobel edge detection filter on it on the CPU, and generates a
 	 * texture so that it can be displayed as a demonstration of CPU
 	 * image access.
+	 *
+	 * When bProcessCameraImageAsync is set, this function only copies
+	 * the camera image and hands it to a background worker. It never
+	 * blocks on the filter or on earlier frames.
 	 */
 	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
 	EGoogleARCoreFunctionStatus UpdateCameraImage();
 
 	/**
 	 * This function gets the texture generated with
-	 * UpdateCameraImage().
+	 * UpdateCameraImage(). In async mode this is the latest completed
+	 * frame.
 	 *
 	 * @return The generated texture.
 	 */
@@ -51,14 +93,214 @@ public:
 	UPROPERTY()
 	UTexture2D *CameraImageTexture = nullptr;
 
+	/**
+	 * When true, edge detection is split into horizontal bands that run
+	 * in parallel on the task graph. The output is identical to the
+	 * single-threaded path.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector")
+	bool bUseParallelEdgeDetection = true;
+
+	/**
+	 * The number of bands the image is split into. 0 uses one band per
+	 * task graph worker thread plus the game thread.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector", meta = (ClampMin = "0"))
+	int32 ParallelBandCount = 0;
+
+	/**
+	 * The minimum number of pixels each band must cover. Small images
+	 * use fewer bands so that task overhead does not dominate.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector", meta = (ClampMin = "0"))
+	int32 MinPixelsPerTask = 64 * 1024;
+
+	/**
+	 * Box-filters the camera image down before edge detection. The
+	 * generated texture shrinks by the same factor, so both CPU cost and
+	 * upload bandwidth scale with the pixels actually processed.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector")
+	EGoogleARCoreEdgeDetectorDecimation Decimation = EGoogleARCoreEdgeDetectorDecimation::Full;
+
+	/**
+	 * When true, only RegionOfInterest of the camera image is processed
+	 * and the generated texture covers just that region.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector")
+	bool bUseRegionOfInterest = false;
+
+	/**
+	 * The region of the camera image to process, in normalized [0, 1]
+	 * image coordinates. Only used when bUseRegionOfInterest is set.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector", meta = (EditCondition = "bUseRegionOfInterest"))
+	FBox2D RegionOfInterest = FBox2D(FVector2D(0.0f, 0.0f), FVector2D(1.0f, 1.0f));
+
+	/**
+	 * When true, each frame is compared with the last uploaded one in
+	 * UploadTileSize tiles and only the tiles that changed are uploaded
+	 * to the texture. Saves upload bandwidth when most of the edge map
+	 * is unchanged, at the cost of a copy of the texture on the CPU.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector")
+	bool bUploadChangedTilesOnly = false;
+
+	/** The edge length of the tiles compared, in texture pixels. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector", meta = (ClampMin = "8", EditCondition = "bUploadChangedTilesOnly"))
+	int32 UploadTileSize = 64;
+
+	/**
+	 * The fraction of changed tiles above which the whole frame is
+	 * uploaded at once instead, as many small regions then cost more
+	 * than a single full upload.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector", meta = (ClampMin = "0", ClampMax = "1", EditCondition = "bUploadChangedTilesOnly"))
+	float MaxDirtyTileRatio = 0.5f;
+
+	/**
+	 * An optional chain of filters, such as a Canny edge detector, that
+	 * replaces the built-in Sobel filter. Decimation, region of interest,
+	 * parallel bands and async processing apply to it as well.
+	 */
+	UPROPERTY(EditAnywhere, Instanced, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector")
+	UGoogleARCoreImageFilterGraph *FilterGraph = nullptr;
+
+	/**
+	 * When true, edge detection runs on a background worker and
+	 * UpdateCameraImage() returns as soon as the camera image is copied.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector")
+	bool bProcessCameraImageAsync = false;
+
+	/**
+	 * The maximum number of camera images processed at once in async
+	 * mode. While this many are in flight, the newest camera image waits
+	 * for the next free worker and replaces any older one still waiting.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector", meta = (ClampMin = "1"))
+	int32 MaxFramesInFlight = 2;
+
+	/**
+	 * The rate at which frames are replayed in FixedRate mode, in frames
+	 * per second.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector", meta = (ClampMin = "0.001"))
+	float ReplayFrameRate = 30.0f;
+
+	/** When true, a replay starts over after its last frame. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|EdgeDetector")
+	bool bLoopReplay = true;
+
+	/**
+	 * Starts appending every camera image acquired by UpdateCameraImage()
+	 * to a recording file. Relative paths are relative to
+	 * Saved/CameraRecordings. The planes are written on a background
+	 * thread; frames are dropped rather than stalling the game thread if
+	 * the storage cannot keep up.
+	 *
+	 * @return False if the file cannot be created.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	bool StartRecording(const FString &Filename);
+
+	/** Finishes writing the recording and closes it. */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	void StopRecording();
+
+	/**
+	 * Makes UpdateCameraImage() process the frames of a recording instead
+	 * of ARCore camera images. This works on any platform, including
+	 * desktop Linux. The recording is memory-mapped and its frames are
+	 * processed in place.
+	 *
+	 * @return False if the file cannot be opened.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	bool StartReplay(const FString &Filename, EGoogleARCoreCameraReplayMode Mode);
+
+	/** Returns UpdateCameraImage() to ARCore camera images. */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	void StopReplay();
+
+	UFUNCTION(BlueprintPure, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	bool IsReplaying() const;
+
+	/** Returns the number of recorded frames processed since StartReplay(). */
+	UFUNCTION(BlueprintPure, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	int32 GetNumReplayedFrames() const;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/**
+	 * Returns the number of camera images dropped in async mode, either
+	 * because a newer frame replaced them while they waited for a worker
+	 * or because a newer frame finished first.
+	 */
+	UFUNCTION(BlueprintPure, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	int32 GetNumDroppedFrames() const;
+
+	/**
+	 * Returns the number of frame buffers allocated so far. Buffers are
+	 * pooled, so this stops growing once the pool is warm and only
+	 * increases again when the camera resolution changes.
+	 */
+	UFUNCTION(BlueprintPure, Category = "GoogleARCoreSample|EdgeDetector", meta = (Keywords = "googlear arcore edgedetector"))
+	int32 GetNumBufferAllocations() const;
+
 private:
 
-	static void GoogleARCoreDoSobelEdgeDetection(
+	EGoogleARCoreFunctionStatus UpdateReplayedCameraImage();
+
+	/** Runs edge detection on a live or replayed camera image. */
+	void ProcessCameraFrame(const FCameraFrameView &Frame);
+
+	static FString GetCameraRecordingPath(const FString &Filename);
+
+	void ProcessCameraImageAsync(
 		const uint8 *InYPlaneData,
 		uint32 YPlanePixelStride,
 		uint32 YPlaneRowStride,
-		uint8 *OutPixels,
 		int32 Width,
 		int32 Height);
+
+	/**
+	 * Filters a frame on a background worker and publishes its output.
+	 * The worker then moves on to the frame waiting for it, if any, so the
+	 * number of frames in flight does not change in between.
+	 */
+	static void RunJobAsync(TSharedPtr<FEdgeDetectorPipeline, ESPMode::ThreadSafe> Pipeline, const FEdgeDetectorJob &Job);
+
+	void PublishCompletedFrame();
+
+	void UploadCameraImage(FCameraImageBuffer *Frame, int32 Width, int32 Height);
+
+	int32 GetEdgeDetectionBandCount() const;
+
+	FIntRect GetProcessedRegion(int32 Width, int32 Height) const;
+
+	/** Returns the compiled FilterGraph, or null to use the built-in Sobel filter. */
+	TSharedPtr<const FImageFilterGraph, ESPMode::ThreadSafe> GetFilterGraph() const;
+
+	TSharedPtr<FEdgeDetectorPipeline, ESPMode::ThreadSafe> Pipeline;
+
+	/** What CameraImageTexture holds, for bUploadChangedTilesOnly. Empty when unknown. */
+	TArray<uint8> UploadedPixels;
+	TArray<uint8> DirtyTiles;
+
+	TSharedPtr<FCameraFrameRecorder> Recorder;
+	TSharedPtr<FCameraFrameReplay> Replay;
+	EGoogleARCoreCameraReplayMode ReplayMode = EGoogleARCoreCameraReplayMode::FixedRate;
+	double ReplayStartTime = 0.0;
+	int64 NextReplayFrameNumber = 0;
+	int32 NumReplayedFrames = 0;
+
+	void GoogleARCoreDoSobelEdgeDetection(
+		const uint8 *InYPlaneData,
+		uint32 YPlanePixelStride,
+		uint32 YPlaneRowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height) const;
 };
 
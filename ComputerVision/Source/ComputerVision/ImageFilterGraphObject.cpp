@@ -0,0 +1,136 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ImageFilterGraphObject.h"
+
+#include "ComputerVision.h"
+#include "CameraImageKernels.h"
+
+void UGoogleARCoreImageFilterGraph::AddStage(
+	EGoogleARCoreImageFilterOp Op,
+	int32 LowThreshold,
+	int32 HighThreshold,
+	uint8 HighValue,
+	uint8 LowValue)
+{
+	FGoogleARCoreImageFilterStage Stage;
+	Stage.Op = Op;
+	Stage.LowThreshold = LowThreshold;
+	Stage.HighThreshold = HighThreshold;
+	Stage.HighValue = HighValue;
+	Stage.LowValue = LowValue;
+	Stages.Add(Stage);
+	bCompiledGraphDirty = true;
+}
+
+void UGoogleARCoreImageFilterGraph::AddGaussianBlur()
+{
+	AddStage(EGoogleARCoreImageFilterOp::GaussianBlur, 0, 0, 0xFF, 0x00);
+}
+
+void UGoogleARCoreImageFilterGraph::AddSobel()
+{
+	AddStage(EGoogleARCoreImageFilterOp::Sobel, 0, 0, 0xFF, 0x00);
+}
+
+void UGoogleARCoreImageFilterGraph::AddNonMaxSuppression()
+{
+	AddStage(EGoogleARCoreImageFilterOp::NonMaxSuppression, 0, 0, 0xFF, 0x00);
+}
+
+void UGoogleARCoreImageFilterGraph::AddThreshold(int32 Threshold, uint8 HighValue, uint8 LowValue)
+{
+	AddStage(EGoogleARCoreImageFilterOp::Threshold, Threshold, Threshold, HighValue, LowValue);
+}
+
+void UGoogleARCoreImageFilterGraph::AddHysteresis(int32 LowThreshold, int32 HighThreshold, uint8 HighValue, uint8 LowValue)
+{
+	AddStage(EGoogleARCoreImageFilterOp::Hysteresis, LowThreshold, HighThreshold, HighValue, LowValue);
+}
+
+void UGoogleARCoreImageFilterGraph::ClearStages()
+{
+	Stages.Reset();
+	bCompiledGraphDirty = true;
+}
+
+UGoogleARCoreImageFilterGraph *UGoogleARCoreImageFilterGraph::CreateSobelEdgeDetector(UObject *Outer)
+{
+	UGoogleARCoreImageFilterGraph *Graph = NewObject<UGoogleARCoreImageFilterGraph>(Outer ? Outer : GetTransientPackage());
+	Graph->AddSobel();
+	Graph->AddThreshold(128, CameraImageKernels::SobelEdgeValue, CameraImageKernels::SobelNonEdgeValue);
+	return Graph;
+}
+
+UGoogleARCoreImageFilterGraph *UGoogleARCoreImageFilterGraph::CreateCannyEdgeDetector(UObject *Outer, int32 LowThreshold, int32 HighThreshold)
+{
+	UGoogleARCoreImageFilterGraph *Graph = NewObject<UGoogleARCoreImageFilterGraph>(Outer ? Outer : GetTransientPackage());
+	Graph->AddGaussianBlur();
+	Graph->AddSobel();
+	Graph->AddNonMaxSuppression();
+	Graph->AddHysteresis(LowThreshold, HighThreshold);
+	return Graph;
+}
+
+TSharedPtr<const FImageFilterGraph, ESPMode::ThreadSafe> UGoogleARCoreImageFilterGraph::GetCompiledGraph()
+{
+	if (!bCompiledGraphDirty)
+	{
+		return CompiledGraph;
+	}
+	bCompiledGraphDirty = false;
+
+	TSharedRef<FImageFilterGraph, ESPMode::ThreadSafe> Graph = MakeShared<FImageFilterGraph, ESPMode::ThreadSafe>();
+	for (const FGoogleARCoreImageFilterStage &Stage : Stages)
+	{
+		switch (Stage.Op)
+		{
+		case EGoogleARCoreImageFilterOp::GaussianBlur:
+			Graph->AddStage(FImageFilterStage::GaussianBlur());
+			break;
+		case EGoogleARCoreImageFilterOp::Sobel:
+			Graph->AddStage(FImageFilterStage::Sobel());
+			break;
+		case EGoogleARCoreImageFilterOp::NonMaxSuppression:
+			Graph->AddStage(FImageFilterStage::NonMaxSuppression());
+			break;
+		case EGoogleARCoreImageFilterOp::Threshold:
+			Graph->AddStage(FImageFilterStage::Threshold(Stage.HighThreshold, Stage.HighValue, Stage.LowValue));
+			break;
+		case EGoogleARCoreImageFilterOp::Hysteresis:
+			Graph->AddStage(FImageFilterStage::Hysteresis(Stage.LowThreshold, Stage.HighThreshold, Stage.HighValue, Stage.LowValue));
+			break;
+		}
+	}
+
+	FString Error;
+	if (Graph->Compile(&Error))
+	{
+		CompiledGraph = Graph;
+	}
+	else
+	{
+		UE_LOG(LogComputerVision, Error, TEXT("%s: invalid filter graph. %s"), *GetName(), *Error);
+		CompiledGraph.Reset();
+	}
+	return CompiledGraph;
+}
+
+#if WITH_EDITOR
+void UGoogleARCoreImageFilterGraph::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	bCompiledGraphDirty = true;
+}
+#endif
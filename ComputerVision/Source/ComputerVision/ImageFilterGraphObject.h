@@ -0,0 +1,129 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+
+#include "ImageFilterGraph.h"
+
+#include "ImageFilterGraphObject.generated.h"
+
+/**
+ * Operations of a camera image filter graph. See EImageFilterOp.
+ */
+UENUM(BlueprintType)
+enum class EGoogleARCoreImageFilterOp : uint8
+{
+	/** 3x3 Gaussian blur. */
+	GaussianBlur,
+	/** 3x3 Sobel gradient. */
+	Sobel,
+	/** Thins Sobel gradients to one pixel wide ridges. */
+	NonMaxSuppression,
+	/** Maps values above HighThreshold to HighValue and all others to LowValue. */
+	Threshold,
+	/** Keeps weak values next to strong ones, like Canny hysteresis. */
+	Hysteresis
+};
+
+/**
+ * One stage of a camera image filter graph.
+ */
+USTRUCT(BlueprintType)
+struct FGoogleARCoreImageFilterStage
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|ImageFilter")
+	EGoogleARCoreImageFilterOp Op = EGoogleARCoreImageFilterOp::Threshold;
+
+	/** Hysteresis only: weak values at or above this are kept next to strong ones. Gradients use magnitude units. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|ImageFilter")
+	int32 LowThreshold = 0;
+
+	/** Threshold and hysteresis: the strong value threshold. Gradients use magnitude units. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|ImageFilter")
+	int32 HighThreshold = 128;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|ImageFilter")
+	uint8 LowValue = 0x00;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GoogleARCoreSample|ImageFilter")
+	uint8 HighValue = 0xFF;
+};
+
+/**
+ * A chain of filters that AGoogleARCoreEdgeDetector runs on the camera
+ * image instead of its built-in Sobel filter. The chain is compiled into
+ * fused passes the first time it is used after a change; see
+ * FImageFilterGraph.
+ */
+UCLASS(BlueprintType, EditInlineNew, DefaultToInstanced)
+class UGoogleARCoreImageFilterGraph : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/** The filter stages, applied in order to the camera image. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GoogleARCoreSample|ImageFilter")
+	TArray<FGoogleARCoreImageFilterStage> Stages;
+
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter")
+	void AddGaussianBlur();
+
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter")
+	void AddSobel();
+
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter")
+	void AddNonMaxSuppression();
+
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter")
+	void AddThreshold(int32 Threshold, uint8 HighValue = 255, uint8 LowValue = 0);
+
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter")
+	void AddHysteresis(int32 LowThreshold, int32 HighThreshold, uint8 HighValue = 255, uint8 LowValue = 0);
+
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter")
+	void ClearStages();
+
+	/** Creates a graph equivalent to the built-in Sobel edge detection. */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter", meta = (DefaultToSelf = "Outer"))
+	static UGoogleARCoreImageFilterGraph *CreateSobelEdgeDetector(UObject *Outer);
+
+	/** Creates a blur, Sobel, non-maximum suppression and hysteresis graph. */
+	UFUNCTION(BlueprintCallable, Category = "GoogleARCoreSample|ImageFilter", meta = (DefaultToSelf = "Outer"))
+	static UGoogleARCoreImageFilterGraph *CreateCannyEdgeDetector(UObject *Outer, int32 LowThreshold = 40, int32 HighThreshold = 100);
+
+	/**
+	 * Returns the compiled graph, compiling it first if the stages changed.
+	 * Returns null and logs an error if the stages are invalid. A new graph
+	 * is created on every change, so a returned graph can be executed on
+	 * any thread while the stages are edited. Game thread only.
+	 */
+	TSharedPtr<const FImageFilterGraph, ESPMode::ThreadSafe> GetCompiledGraph();
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent) override;
+#endif
+
+private:
+
+	void AddStage(EGoogleARCoreImageFilterOp Op, int32 LowThreshold, int32 HighThreshold, uint8 HighValue, uint8 LowValue);
+
+	TSharedPtr<const FImageFilterGraph, ESPMode::ThreadSafe> CompiledGraph;
+	bool bCompiledGraphDirty = true;
+};
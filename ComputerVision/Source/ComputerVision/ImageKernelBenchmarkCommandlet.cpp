@@ -0,0 +1,141 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "ImageKernelBenchmarkCommandlet.h"
+
+#include "ComputerVision.h"
+#include "ImageKernelBenchmark.h"
+#include "CameraFrameRecording.h"
+#include "CameraImageKernels.h"
+
+#include "Misc/Parse.h"
+
+UImageKernelBenchmarkCommandlet::UImageKernelBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UImageKernelBenchmarkCommandlet::RunReplay(const FString &Filename, int32 Iterations, int32 NumBands)
+{
+	FCameraFrameReplay Replay;
+	if (!Replay.Open(Filename) || Replay.GetNumFrames() == 0)
+	{
+		UE_LOG(LogComputerVision, Error, TEXT("%s holds no camera frames."), *Filename);
+		return 1;
+	}
+
+	// Replays the recording as fast as possible, straight from the mapping.
+	TArray<uint8> Output;
+	int64 NumPixels = 0;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for (int32 FrameIndex = 0; FrameIndex < Replay.GetNumFrames(); FrameIndex++)
+		{
+			FCameraFrameView Frame;
+			if (!Replay.GetFrame(FrameIndex, Frame) || Frame.NumPlanes == 0)
+			{
+				UE_LOG(LogComputerVision, Error, TEXT("Frame %d of %s has no image."), FrameIndex, *Filename);
+				return 1;
+			}
+			Output.SetNumUninitialized(Frame.Width * Frame.Height, false);
+			CameraImageKernels::SobelEdgeDetectionParallel(
+				Frame.Planes[0].Data, Frame.Planes[0].PixelStride, Frame.Planes[0].RowStride,
+				Output.GetData(), Frame.Width, Frame.Height, NumBands, 0);
+			NumPixels += static_cast<int64>(Frame.Width) * Frame.Height;
+		}
+	}
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+	const int32 NumFrames = Replay.GetNumFrames() * Iterations;
+
+	UE_LOG(LogComputerVision, Display, TEXT("Replayed %d frames of %s (%s): %.1f frames/s, %.1f Mpixel/s, %.2f ns/pixel"),
+		NumFrames, *Filename, Replay.IsMemoryMapped() ? TEXT("memory-mapped") : TEXT("loaded"),
+		NumFrames / Seconds, NumPixels / Seconds / 1.0e6, Seconds * 1.0e9 / NumPixels);
+	return 0;
+}
+
+int32 UImageKernelBenchmarkCommandlet::Main(const FString &Params)
+{
+	using namespace ImageKernelBenchmark;
+
+	int32 Width = 1920;
+	int32 Height = 1080;
+	int32 Iterations = 20;
+	int32 NumBands = 0;
+	FString FrameFilename;
+	FParse::Value(*Params, TEXT("Width="), Width);
+	FParse::Value(*Params, TEXT("Height="), Height);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Bands="), NumBands);
+	FParse::Value(*Params, TEXT("Frame="), FrameFilename);
+	if (Width <= 0 || Height <= 0 || Iterations <= 0)
+	{
+		UE_LOG(LogComputerVision, Error, TEXT("Width, Height and Iterations must be positive."));
+		return 1;
+	}
+
+	FString ReplayFilename;
+	if (FParse::Value(*Params, TEXT("Replay="), ReplayFilename))
+	{
+		return RunReplay(ReplayFilename, Iterations, NumBands);
+	}
+
+	FSuiteSettings Settings;
+	Settings.Iterations = Iterations;
+	Settings.NumBands = NumBands;
+	Settings.bIncludeReference = !FParse::Param(*Params, TEXT("NoReference"));
+	const bool bWarmOnly = FParse::Param(*Params, TEXT("WarmOnly"));
+
+	bool bAllMatch = true;
+	for (int32 PixelStride : { 1, 2 })
+	{
+		for (int32 RowStride : { Width * PixelStride, GetPaddedRowStride(Width, PixelStride) })
+		{
+			FTestFrame Frame;
+			if (FrameFilename.IsEmpty())
+			{
+				Frame = MakeSyntheticFrame(Width, Height, PixelStride, RowStride);
+			}
+			else if (!LoadFrame(FrameFilename, Width, Height, PixelStride, RowStride, Frame))
+			{
+				return 1;
+			}
+
+			for (bool bColdCache : { false, true })
+			{
+				if (bColdCache && bWarmOnly)
+				{
+					continue;
+				}
+
+				Settings.bColdCache = bColdCache;
+				const TArray<FKernelResult> Results = RunKernelSuite(Frame, Settings);
+				LogKernelSuite(Frame, Settings, Results);
+				for (const FKernelResult &Result : Results)
+				{
+					bAllMatch &= Result.bMatchesReference;
+				}
+			}
+		}
+	}
+
+	if (!bAllMatch)
+	{
+		UE_LOG(LogComputerVision, Error, TEXT("At least one kernel did not match the reference output."));
+		return 1;
+	}
+	return 0;
+}
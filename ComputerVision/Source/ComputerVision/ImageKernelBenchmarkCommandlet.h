@@ -0,0 +1,54 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "ImageKernelBenchmarkCommandlet.generated.h"
+
+/**
+ * Benchmarks the camera image kernels without a device, e.g. on a Linux
+ * build machine:
+ *
+ *   UE4Editor-Cmd ComputerVision.uproject -run=ImageKernelBenchmark -nullrhi
+ *
+ * Every kernel runs on pixel stride 1 and 2 frames with tight and padded
+ * row strides, first with warm and then with cold caches, and the results
+ * are logged in Mpixel/s and ns/pixel.
+ *
+ * Options:
+ *   -Width=1920 -Height=1080	Frame size.
+ *   -Iterations=20				Timed calls per kernel.
+ *   -Bands=0					Parallel bands, 0 for one per worker.
+ *   -Frame=<file>				Raw YUV file (I420, NV12 or NV21) to use instead of a synthetic frame.
+ *   -Replay=<file>				Camera recording to run Sobel on as fast as possible instead; see FCameraFrameRecorder.
+ *   -NoReference				Skip the slow scalar reference kernel.
+ *   -WarmOnly					Skip the cold cache runs.
+ */
+UCLASS()
+class UImageKernelBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UImageKernelBenchmarkCommandlet();
+
+	virtual int32 Main(const FString &Params) override;
+
+private:
+
+	int32 RunReplay(const FString &Filename, int32 Iterations, int32 NumBands);
+};
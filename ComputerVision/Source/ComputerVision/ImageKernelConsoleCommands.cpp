@@ -0,0 +1,155 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ComputerVision.h"
+#include "CameraImageKernels.h"
+#include "ImageKernelBenchmark.h"
+
+#include "HAL/IConsoleManager.h"
+
+using namespace ImageKernelBenchmark;
+
+namespace
+{
+	void BenchmarkSobelRowCache(const TArray<FString>& Args)
+	{
+		const int32 Width = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1920;
+		const int32 Height = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1080;
+		const int32 Iterations = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 20;
+		if (Width <= 0 || Height <= 0 || Iterations <= 0)
+		{
+			UE_LOG(LogComputerVision, Warning, TEXT("Usage: ComputerVision.BenchmarkSobelRowCache [Width] [Height] [Iterations]"));
+			return;
+		}
+
+		UE_LOG(LogComputerVision, Display, TEXT("Sobel row cache report: %dx%d, %d iterations, single-threaded"),
+			Width, Height, Iterations);
+
+		for (int32 PixelStride : { 1, 2 })
+		{
+			// Pad the rows the way camera HALs usually do.
+			const int32 RowStride = GetPaddedRowStride(Width, PixelStride);
+			const FTestFrame Frame = MakeSyntheticFrame(Width, Height, PixelStride, RowStride);
+			const uint8 *YPlane = Frame.GetPlaneData();
+
+			TArray<uint8> PlaneCopy;
+			PlaneCopy.SetNumUninitialized(Width * Height);
+			TArray<uint8> CopyOutput;
+			CopyOutput.SetNumUninitialized(Width * Height);
+			TArray<uint8> StreamOutput;
+			StreamOutput.SetNumUninitialized(Width * Height);
+
+			const double CopySeconds = TimeKernel(Iterations, [&]()
+			{
+				CameraImageKernels::CopyPlane(YPlane, PixelStride, RowStride, Width, Height, PlaneCopy.GetData());
+				CameraImageKernels::SobelEdgeDetectionPacked(PlaneCopy.GetData(), CopyOutput.GetData(), Width, Height, 1, 0);
+			});
+			const double StreamSeconds = TimeKernel(Iterations, [&]()
+			{
+				CameraImageKernels::SobelEdgeDetection(YPlane, PixelStride, RowStride, StreamOutput.GetData(), Width, Height);
+			});
+
+			// Main memory traffic per frame, ignoring the cache-resident rows:
+			// the copy path reads the plane, writes and re-reads the copy and
+			// writes the output; the row cache path skips the copy.
+			const double SourceMB = static_cast<double>(RowStride) * Height / (1024.0 * 1024.0);
+			const double FrameMB = static_cast<double>(Width) * Height / (1024.0 * 1024.0);
+			const bool bMatches = FMemory::Memcmp(CopyOutput.GetData(), StreamOutput.GetData(), Width * Height) == 0;
+
+			UE_LOG(LogComputerVision, Display, TEXT("  pixel stride %d, row stride %d:"), PixelStride, RowStride);
+			UE_LOG(LogComputerVision, Display, TEXT("    full copy: %7.3f ms/frame, %8.1f Mpixel/s, ~%.1f MB traffic/frame"),
+				CopySeconds * 1000.0, Width * Height / CopySeconds / 1.0e6, SourceMB + 3.0 * FrameMB);
+			UE_LOG(LogComputerVision, Display, TEXT("    row cache: %7.3f ms/frame, %8.1f Mpixel/s, ~%.1f MB traffic/frame%s"),
+				StreamSeconds * 1000.0, Width * Height / StreamSeconds / 1.0e6, SourceMB + FrameMB,
+				bMatches ? TEXT("") : TEXT(", OUTPUT MISMATCH"));
+		}
+	}
+
+	void BenchmarkSobelScaling(const TArray<FString>& Args)
+	{
+		const int32 Width = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1920;
+		const int32 Height = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1080;
+		const int32 Iterations = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 20;
+		if (Width <= 0 || Height <= 0 || Iterations <= 0)
+		{
+			UE_LOG(LogComputerVision, Warning, TEXT("Usage: ComputerVision.BenchmarkSobel [Width] [Height] [Iterations]"));
+			return;
+		}
+
+		const FTestFrame Frame = MakeSyntheticFrame(Width, Height, 1, Width);
+		const uint8 *YPlane = Frame.GetPlaneData();
+
+		TArray<uint8> Expected;
+		Expected.SetNumUninitialized(Width * Height);
+		CameraImageKernels::SobelEdgeDetection(YPlane, 1, Width, Expected.GetData(), Width, Height);
+
+		UE_LOG(LogComputerVision, Display, TEXT("Sobel scaling report: %dx%d, %d iterations, SIMD %s"),
+			Width, Height, Iterations, CameraImageKernels::IsSobelSimdSupported() ? TEXT("on") : TEXT("off"));
+
+		TArray<uint8> Output;
+		Output.SetNumUninitialized(Width * Height);
+		double SingleBandSeconds = 0.0;
+		for (int32 NumBands : { 1, 2, 4, 8 })
+		{
+			const double Seconds = TimeKernel(Iterations, [&]()
+			{
+				CameraImageKernels::SobelEdgeDetectionParallel(YPlane, 1, Width, Output.GetData(), Width, Height, NumBands, 0);
+			});
+			if (NumBands == 1)
+			{
+				SingleBandSeconds = Seconds;
+			}
+
+			const bool bMatches = FMemory::Memcmp(Output.GetData(), Expected.GetData(), Width * Height) == 0;
+			UE_LOG(LogComputerVision, Display, TEXT("  %d workers: %7.3f ms/frame, %8.1f Mpixel/s, speedup %.2fx%s"),
+				NumBands,
+				Seconds * 1000.0,
+				Width * Height / Seconds / 1.0e6,
+				SingleBandSeconds / Seconds,
+				bMatches ? TEXT("") : TEXT(", OUTPUT MISMATCH"));
+		}
+	}
+
+	void BenchmarkKernels(const TArray<FString>& Args)
+	{
+		const int32 Width = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1920;
+		const int32 Height = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1080;
+		FSuiteSettings Settings;
+		Settings.Iterations = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 20;
+		Settings.bColdCache = Args.Contains(TEXT("cold"));
+		if (Width <= 0 || Height <= 0 || Settings.Iterations <= 0)
+		{
+			UE_LOG(LogComputerVision, Warning, TEXT("Usage: ComputerVision.BenchmarkKernels [Width] [Height] [Iterations] [cold]"));
+			return;
+		}
+
+		const FTestFrame Frame = MakeSyntheticFrame(Width, Height, 1, GetPaddedRowStride(Width, 1));
+		LogKernelSuite(Frame, Settings, RunKernelSuite(Frame, Settings));
+	}
+}
+
+static FAutoConsoleCommand GBenchmarkKernelsCommand(
+	TEXT("ComputerVision.BenchmarkKernels"),
+	TEXT("Reports the throughput of every camera image kernel. Usage: ComputerVision.BenchmarkKernels [Width] [Height] [Iterations] [cold]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkKernels));
+
+static FAutoConsoleCommand GBenchmarkSobelCommand(
+	TEXT("ComputerVision.BenchmarkSobel"),
+	TEXT("Reports edge detection throughput with 1, 2, 4 and 8 parallel bands. Usage: ComputerVision.BenchmarkSobel [Width] [Height] [Iterations]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkSobelScaling));
+
+static FAutoConsoleCommand GBenchmarkSobelRowCacheCommand(
+	TEXT("ComputerVision.BenchmarkSobelRowCache"),
+	TEXT("Compares edge detection with a full Y-plane copy against the streaming row cache. Usage: ComputerVision.BenchmarkSobelRowCache [Width] [Height] [Iterations]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkSobelRowCache));
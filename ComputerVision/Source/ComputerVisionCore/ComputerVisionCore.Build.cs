@@ -0,0 +1,16 @@
+// Copyright 2018 Google Inc.
+
+using UnrealBuildTool;
+
+// CPU pixel kernels for camera images. Depends on Core only so that the
+// kernels can be built and benchmarked without ARCore, the renderer or a
+// device.
+public class ComputerVisionCore : ModuleRules
+{
+	public ComputerVisionCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}
@@ -0,0 +1,455 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CameraFrameRecording.h"
+
+#include "ComputerVisionCore.h"
+
+#include "Async/MappedFileHandle.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Queue.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+static const uint32 RecordingFileMagic = 0x52465643; // "CVFR"
+static const uint32 RecordingChunkMagic = 0x4D415246; // "FRAM"
+static const uint32 RecordingFileVersion = 1;
+static const int64 RecordingAlignment = 64;
+
+struct FCameraFrameFileHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 HeaderSize;
+	uint32 ChunkHeaderSize;
+};
+
+struct FCameraFramePlaneHeader
+{
+	/** Offset of the plane bytes from the start of the chunk. */
+	uint32 Offset;
+	uint32 Size;
+	int32 PixelStride;
+	int32 RowStride;
+};
+
+struct FCameraFrameChunkHeader
+{
+	uint32 Magic;
+	uint32 NumPlanes;
+
+	/** Size of the chunk including this header and the padding after the last plane. */
+	int64 ChunkSize;
+
+	double Timestamp;
+	int32 Width;
+	int32 Height;
+	FCameraFramePlaneHeader Planes[FCameraFrameView::MaxPlanes];
+};
+
+// The file header is padded to the alignment so that the first chunk is aligned.
+static const int32 RecordingFileHeaderSize = 64;
+static_assert(sizeof(FCameraFrameFileHeader) <= RecordingFileHeaderSize, "The recording file header must fit into its padded size");
+
+/**
+ * State shared between the recorder and its background writer. The writer
+ * holds a reference, so it stays valid until the last chunk is written.
+ */
+struct FCameraFrameRecorder::FWriterState
+{
+	~FWriterState()
+	{
+		TArray<uint8> *Chunk = nullptr;
+		while (PendingChunks.Dequeue(Chunk))
+		{
+			delete Chunk;
+		}
+		for (TArray<uint8> *FreeChunk : FreeChunks)
+		{
+			delete FreeChunk;
+		}
+	}
+
+	TUniquePtr<IFileHandle> FileHandle;
+
+	/** Chunks waiting to be written. Produced by the recorder, consumed by the writer. */
+	TQueue<TArray<uint8>*, EQueueMode::Spsc> PendingChunks;
+	FThreadSafeCounter64 PendingBytes;
+
+	/** 1 while a writer task is scheduled or running. */
+	FThreadSafeCounter WriterScheduled;
+
+	/**
+	 * The last writer task scheduled. Only the recorder's thread touches
+	 * it; a task only starts once the one before has stopped writing.
+	 */
+	FGraphEventRef WriterTask;
+
+	/** Written chunk buffers kept for reuse. */
+	FCriticalSection FreeChunksLock;
+	TArray<TArray<uint8>*> FreeChunks;
+
+	FThreadSafeCounter FramesWritten;
+	FThreadSafeCounter FramesDropped;
+	FThreadSafeCounter64 BytesWritten;
+	FThreadSafeCounter WriteFailed;
+
+	TArray<uint8> *AcquireChunk()
+	{
+		{
+			FScopeLock ScopeLock(&FreeChunksLock);
+			if (FreeChunks.Num() > 0)
+			{
+				return FreeChunks.Pop(false);
+			}
+		}
+		return new TArray<uint8>();
+	}
+
+	void ReleaseChunk(TArray<uint8> *Chunk)
+	{
+		FScopeLock ScopeLock(&FreeChunksLock);
+		FreeChunks.Add(Chunk);
+	}
+
+	// Writes queued chunks until the queue is empty. Only one writer runs at
+	// a time; a chunk queued while the writer is finishing reschedules it.
+	static void WritePendingChunks(TSharedRef<FWriterState, ESPMode::ThreadSafe> State)
+	{
+		do
+		{
+			TArray<uint8> *Chunk = nullptr;
+			while (State->PendingChunks.Dequeue(Chunk))
+			{
+				if (State->WriteFailed.GetValue() == 0)
+				{
+					if (State->FileHandle->Write(Chunk->GetData(), Chunk->Num()))
+					{
+						State->FramesWritten.Increment();
+						State->BytesWritten.Add(Chunk->Num());
+					}
+					else
+					{
+						UE_LOG(LogComputerVisionCore, Error, TEXT("Failed to write camera frame, recording stopped"));
+						State->WriteFailed.Set(1);
+					}
+				}
+				State->PendingBytes.Subtract(Chunk->Num());
+				State->ReleaseChunk(Chunk);
+			}
+			State->WriterScheduled.Set(0);
+		}
+		while (!State->PendingChunks.IsEmpty() && State->WriterScheduled.Set(1) == 0);
+	}
+};
+
+FCameraFrameRecorder::FCameraFrameRecorder(int64 InMaxPendingBytes)
+	: MaxPendingBytes(InMaxPendingBytes)
+{
+}
+
+FCameraFrameRecorder::~FCameraFrameRecorder()
+{
+	Close();
+}
+
+bool FCameraFrameRecorder::Open(const FString &Filename)
+{
+	Close();
+
+	IPlatformFile &PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+	TUniquePtr<IFileHandle> FileHandle(PlatformFile.OpenWrite(*Filename));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogComputerVisionCore, Error, TEXT("Failed to create camera recording %s"), *Filename);
+		return false;
+	}
+
+	uint8 HeaderBytes[RecordingFileHeaderSize] = {};
+	FCameraFrameFileHeader *Header = reinterpret_cast<FCameraFrameFileHeader*>(HeaderBytes);
+	Header->Magic = RecordingFileMagic;
+	Header->Version = RecordingFileVersion;
+	Header->HeaderSize = RecordingFileHeaderSize;
+	Header->ChunkHeaderSize = sizeof(FCameraFrameChunkHeader);
+	if (!FileHandle->Write(HeaderBytes, RecordingFileHeaderSize))
+	{
+		UE_LOG(LogComputerVisionCore, Error, TEXT("Failed to write camera recording %s"), *Filename);
+		return false;
+	}
+
+	WriterState = MakeShared<FWriterState, ESPMode::ThreadSafe>();
+	WriterState->FileHandle = MoveTemp(FileHandle);
+	return true;
+}
+
+void FCameraFrameRecorder::Close()
+{
+	if (!WriterState.IsValid())
+	{
+		return;
+	}
+
+	// Recording stops at a frame boundary, so wait for the writer rather
+	// than leave a truncated chunk behind.
+	if (WriterState->WriterTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(WriterState->WriterTask);
+		WriterState->WriterTask = nullptr;
+	}
+	WriterState->FileHandle->Flush();
+	WriterState->FileHandle.Reset();
+	WriterState.Reset();
+}
+
+bool FCameraFrameRecorder::IsOpen() const
+{
+	return WriterState.IsValid();
+}
+
+bool FCameraFrameRecorder::AddFrame(const FCameraFrameView &Frame)
+{
+	if (!WriterState.IsValid())
+	{
+		return false;
+	}
+
+	FCameraFrameChunkHeader Header = {};
+	Header.Magic = RecordingChunkMagic;
+	Header.NumPlanes = FMath::Min(Frame.NumPlanes, FCameraFrameView::MaxPlanes);
+	Header.Timestamp = Frame.Timestamp;
+	Header.Width = Frame.Width;
+	Header.Height = Frame.Height;
+
+	int64 ChunkSize = Align(static_cast<int64>(sizeof(FCameraFrameChunkHeader)), RecordingAlignment);
+	for (uint32 PlaneIndex = 0; PlaneIndex < Header.NumPlanes; PlaneIndex++)
+	{
+		const FCameraFramePlane &Plane = Frame.Planes[PlaneIndex];
+		Header.Planes[PlaneIndex].Offset = static_cast<uint32>(ChunkSize);
+		Header.Planes[PlaneIndex].Size = Plane.Size;
+		Header.Planes[PlaneIndex].PixelStride = Plane.PixelStride;
+		Header.Planes[PlaneIndex].RowStride = Plane.RowStride;
+		ChunkSize = Align(ChunkSize + Plane.Size, RecordingAlignment);
+	}
+	Header.ChunkSize = ChunkSize;
+
+	if (WriterState->WriteFailed.GetValue() != 0 ||
+		WriterState->PendingBytes.GetValue() + ChunkSize > MaxPendingBytes)
+	{
+		WriterState->FramesDropped.Increment();
+		return false;
+	}
+
+	TArray<uint8> *Chunk = WriterState->AcquireChunk();
+	Chunk->SetNumUninitialized(ChunkSize, false);
+	uint8 *ChunkData = Chunk->GetData();
+	const int64 HeaderAreaSize = Header.NumPlanes > 0 ? Header.Planes[0].Offset : ChunkSize;
+	FMemory::Memzero(ChunkData, HeaderAreaSize);
+	FMemory::Memcpy(ChunkData, &Header, sizeof(Header));
+	for (uint32 PlaneIndex = 0; PlaneIndex < Header.NumPlanes; PlaneIndex++)
+	{
+		// Only the alignment padding after each plane needs clearing.
+		const FCameraFramePlaneHeader &Plane = Header.Planes[PlaneIndex];
+		const int64 PlaneEnd = Plane.Offset + Plane.Size;
+		const int64 NextOffset = PlaneIndex + 1 < Header.NumPlanes ? Header.Planes[PlaneIndex + 1].Offset : ChunkSize;
+		FMemory::Memcpy(ChunkData + Plane.Offset, Frame.Planes[PlaneIndex].Data, Plane.Size);
+		FMemory::Memzero(ChunkData + PlaneEnd, NextOffset - PlaneEnd);
+	}
+
+	WriterState->PendingBytes.Add(ChunkSize);
+	WriterState->PendingChunks.Enqueue(Chunk);
+	if (WriterState->WriterScheduled.Set(1) == 0)
+	{
+		TSharedRef<FWriterState, ESPMode::ThreadSafe> State = WriterState.ToSharedRef();
+		WriterState->WriterTask = FFunctionGraphTask::CreateAndDispatchWhenReady([State]()
+		{
+			FWriterState::WritePendingChunks(State);
+		}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+	}
+	return true;
+}
+
+int32 FCameraFrameRecorder::GetNumFramesWritten() const
+{
+	return WriterState.IsValid() ? WriterState->FramesWritten.GetValue() : 0;
+}
+
+int32 FCameraFrameRecorder::GetNumFramesDropped() const
+{
+	return WriterState.IsValid() ? WriterState->FramesDropped.GetValue() : 0;
+}
+
+int64 FCameraFrameRecorder::GetNumBytesWritten() const
+{
+	return WriterState.IsValid() ? WriterState->BytesWritten.GetValue() : 0;
+}
+
+/**
+ * Returns true if a plane matches a Width x Height frame and every pixel
+ * of it lies within its chunk. The chroma planes of YUV_420_888 images are
+ * subsampled 2x2.
+ */
+static bool IsPlaneValid(const FCameraFramePlaneHeader &Plane, uint32 PlaneIndex, int32 Width, int32 Height, int64 ChunkSize)
+{
+	const int64 PlaneWidth = PlaneIndex == 0 ? Width : FMath::Max(Width / 2, 1);
+	const int64 PlaneHeight = PlaneIndex == 0 ? Height : FMath::Max(Height / 2, 1);
+	if (Plane.PixelStride <= 0 || Plane.RowStride < (PlaneWidth - 1) * Plane.PixelStride + 1)
+	{
+		return false;
+	}
+
+	// The kernels read every pixel of the plane, so its last row does not
+	// need the padding of the others. A plane larger than all its padded
+	// rows was recorded with another width or height.
+	const int64 MinSize = (PlaneHeight - 1) * Plane.RowStride + (PlaneWidth - 1) * Plane.PixelStride + 1;
+	const int64 MaxSize = PlaneHeight * Plane.RowStride;
+	return Plane.Size >= MinSize &&
+		Plane.Size <= MaxSize &&
+		Plane.Offset >= sizeof(FCameraFrameChunkHeader) &&
+		static_cast<int64>(Plane.Offset) + Plane.Size <= ChunkSize;
+}
+
+FCameraFrameReplay::FCameraFrameReplay()
+{
+}
+
+FCameraFrameReplay::~FCameraFrameReplay()
+{
+	Close();
+}
+
+bool FCameraFrameReplay::Open(const FString &Filename)
+{
+	Close();
+
+	IPlatformFile &PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFile.Reset(PlatformFile.OpenMapped(*Filename));
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion());
+	}
+
+	if (MappedRegion.IsValid())
+	{
+		FileData = MappedRegion->GetMappedPtr();
+		FileSize = MappedRegion->GetMappedSize();
+	}
+	else
+	{
+		MappedFile.Reset();
+		UE_LOG(LogComputerVisionCore, Log, TEXT("Memory-mapped files are not available, loading %s into memory"), *Filename);
+		if (!FFileHelper::LoadFileToArray(LoadedFile, *Filename))
+		{
+			UE_LOG(LogComputerVisionCore, Error, TEXT("Failed to open camera recording %s"), *Filename);
+			return false;
+		}
+		FileData = LoadedFile.GetData();
+		FileSize = LoadedFile.Num();
+	}
+
+	const FCameraFrameFileHeader *Header = reinterpret_cast<const FCameraFrameFileHeader*>(FileData);
+	if (FileSize < RecordingFileHeaderSize ||
+		Header->Magic != RecordingFileMagic ||
+		Header->Version != RecordingFileVersion ||
+		Header->ChunkHeaderSize != sizeof(FCameraFrameChunkHeader))
+	{
+		UE_LOG(LogComputerVisionCore, Error, TEXT("%s is not a camera recording of version %d"), *Filename, RecordingFileVersion);
+		Close();
+		return false;
+	}
+
+	int64 Offset = Header->HeaderSize;
+	while (Offset + static_cast<int64>(sizeof(FCameraFrameChunkHeader)) <= FileSize)
+	{
+		const FCameraFrameChunkHeader *Chunk = reinterpret_cast<const FCameraFrameChunkHeader*>(FileData + Offset);
+		bool bValid =
+			Chunk->Magic == RecordingChunkMagic &&
+			Chunk->NumPlanes > 0 &&
+			Chunk->NumPlanes <= FCameraFrameView::MaxPlanes &&
+			Chunk->ChunkSize >= static_cast<int64>(sizeof(FCameraFrameChunkHeader)) &&
+			Chunk->Width > 0 &&
+			Chunk->Height > 0;
+		for (uint32 PlaneIndex = 0; bValid && PlaneIndex < Chunk->NumPlanes; PlaneIndex++)
+		{
+			bValid = IsPlaneValid(Chunk->Planes[PlaneIndex], PlaneIndex, Chunk->Width, Chunk->Height, Chunk->ChunkSize);
+		}
+		if (!bValid)
+		{
+			UE_LOG(LogComputerVisionCore, Error, TEXT("%s: frame %d is corrupt"), *Filename, ChunkOffsets.Num());
+			Close();
+			return false;
+		}
+
+		// A recording that was cut off mid-write keeps its complete frames.
+		if (Offset + Chunk->ChunkSize > FileSize)
+		{
+			UE_LOG(LogComputerVisionCore, Warning, TEXT("%s: ignoring a truncated frame after frame %d"),
+				*Filename, ChunkOffsets.Num());
+			break;
+		}
+
+		ChunkOffsets.Add(Offset);
+		Offset += Chunk->ChunkSize;
+	}
+	return true;
+}
+
+void FCameraFrameReplay::Close()
+{
+	ChunkOffsets.Reset();
+	FileData = nullptr;
+	FileSize = 0;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedFile.Empty();
+}
+
+double FCameraFrameReplay::GetDuration() const
+{
+	FCameraFrameView First;
+	FCameraFrameView Last;
+	if (GetFrame(0, First) && GetFrame(GetNumFrames() - 1, Last))
+	{
+		return Last.Timestamp - First.Timestamp;
+	}
+	return 0.0;
+}
+
+bool FCameraFrameReplay::GetFrame(int32 Index, FCameraFrameView &OutFrame) const
+{
+	if (!ChunkOffsets.IsValidIndex(Index))
+	{
+		return false;
+	}
+
+	const uint8 *ChunkData = FileData + ChunkOffsets[Index];
+	const FCameraFrameChunkHeader *Chunk = reinterpret_cast<const FCameraFrameChunkHeader*>(ChunkData);
+	OutFrame.Timestamp = Chunk->Timestamp;
+	OutFrame.Width = Chunk->Width;
+	OutFrame.Height = Chunk->Height;
+	OutFrame.NumPlanes = Chunk->NumPlanes;
+	for (uint32 PlaneIndex = 0; PlaneIndex < Chunk->NumPlanes; PlaneIndex++)
+	{
+		const FCameraFramePlaneHeader &Plane = Chunk->Planes[PlaneIndex];
+		OutFrame.Planes[PlaneIndex].Data = ChunkData + Plane.Offset;
+		OutFrame.Planes[PlaneIndex].Size = Plane.Size;
+		OutFrame.Planes[PlaneIndex].PixelStride = Plane.PixelStride;
+		OutFrame.Planes[PlaneIndex].RowStride = Plane.RowStride;
+	}
+	return true;
+}
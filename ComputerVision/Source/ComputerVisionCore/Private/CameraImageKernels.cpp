@@ -0,0 +1,694 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CameraImageKernels.h"
+
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <arm_neon.h>
+#define CAMERA_IMAGE_KERNELS_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CAMERA_IMAGE_KERNELS_SSE2 1
+#endif
+
+#ifndef CAMERA_IMAGE_KERNELS_NEON
+#define CAMERA_IMAGE_KERNELS_NEON 0
+#endif
+#ifndef CAMERA_IMAGE_KERNELS_SSE2
+#define CAMERA_IMAGE_KERNELS_SSE2 0
+#endif
+
+namespace CameraImageKernels
+{
+
+// Row caches up to this width live on the stack; wider images fall back to
+// a heap allocation per band.
+static const int32 SobelInlineRowCacheWidth = 2048;
+
+void SobelEdgeDetectionReference(
+	const uint8 *InYPlaneData,
+	uint32 YPlanePixelStride,
+	uint32 YPlaneRowStride,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height)
+{
+	// We copy the image data here before running the edge detection algorithm.
+	// This is due to on some device(Exynos S8), accessing the original image
+	// buffer is extremely slow.
+	TArray<uint8> YPlaneDataCopy(InYPlaneData, YPlaneRowStride * Height);
+
+	int XKernel[3][3] = {
+		{ -1, 0, 1 },
+		{ -2, 0, 2 },
+		{ -1, 0, 1 }
+	};
+
+	int YKernel[3][3] = {
+		{ -1, -2, -1 },
+		{ 0,  0,  0 },
+		{ 1,  2,  1 }
+	};
+
+	for (int32 y = 0; y < Height; y++)
+	{
+		for (int32 x = 0; x < Width; x++)
+		{
+			int XMag = 0;
+			int YMag = 0;
+
+			for (int32 u = 0; u < 3; u++)
+			{
+				for (int32 v = 0; v < 3; v++)
+				{
+					int32 u2 = x + u - 1;
+					int32 v2 = y + v - 1;
+
+					if (u2 < 0) u2 = 0;
+					if (u2 >= Width) u2 = Width - 1;
+					if (v2 < 0) v2 = 0;
+					if (v2 >= Height) v2 = Height - 1;
+
+					uint8 SourcePixel = YPlaneDataCopy[
+						u2 * YPlanePixelStride +
+							v2 * YPlaneRowStride];
+
+					XMag += SourcePixel * XKernel[u][v];
+					YMag += SourcePixel * YKernel[u][v];
+				}
+			}
+
+			int Magnitude = XMag * XMag + YMag * YMag;
+			uint8 Output = Magnitude > SobelThreshold ? SobelEdgeValue : SobelNonEdgeValue;
+			OutPixels[y * Width + x] = Output;
+		}
+	}
+}
+
+bool IsSobelSimdSupported()
+{
+	return CAMERA_IMAGE_KERNELS_NEON || CAMERA_IMAGE_KERNELS_SSE2;
+}
+
+// Computes one output pixel from three tightly packed rows. XLeft and XRight
+// are the already clamped neighbour columns.
+static FORCEINLINE uint8 SobelPixel(
+	const uint8 *Above,
+	const uint8 *Center,
+	const uint8 *Below,
+	int32 XLeft,
+	int32 X,
+	int32 XRight)
+{
+	const int32 VerticalGradient =
+		(Below[XLeft] - Above[XLeft]) +
+		2 * (Below[X] - Above[X]) +
+		(Below[XRight] - Above[XRight]);
+	const int32 HorizontalGradient =
+		(Above[XRight] + 2 * Center[XRight] + Below[XRight]) -
+		(Above[XLeft] + 2 * Center[XLeft] + Below[XLeft]);
+	const int32 Magnitude =
+		VerticalGradient * VerticalGradient + HorizontalGradient * HorizontalGradient;
+	return Magnitude > SobelThreshold ? SobelEdgeValue : SobelNonEdgeValue;
+}
+
+#if CAMERA_IMAGE_KERNELS_SSE2
+
+// Computes 16 output pixels starting at X. Reads columns [X - 1, X + 16].
+static FORCEINLINE void SobelSpan16(
+	const uint8 *Above,
+	const uint8 *Center,
+	const uint8 *Below,
+	uint8 *Out,
+	int32 X)
+{
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i Threshold = _mm_set1_epi32(SobelThreshold);
+	const __m128i NonEdge = _mm_set1_epi8(static_cast<char>(SobelNonEdgeValue));
+
+	const __m128i AboveL = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Above + X - 1));
+	const __m128i AboveC = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Above + X));
+	const __m128i AboveR = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Above + X + 1));
+	const __m128i CenterL = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Center + X - 1));
+	const __m128i CenterR = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Center + X + 1));
+	const __m128i BelowL = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Below + X - 1));
+	const __m128i BelowC = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Below + X));
+	const __m128i BelowR = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Below + X + 1));
+
+	__m128i Mask[2];
+	for (int32 Half = 0; Half < 2; Half++)
+	{
+		auto Widen = [Half, Zero](__m128i Value)
+		{
+			return Half == 0 ? _mm_unpacklo_epi8(Value, Zero) : _mm_unpackhi_epi8(Value, Zero);
+		};
+
+		const __m128i AL = Widen(AboveL), AC = Widen(AboveC), AR = Widen(AboveR);
+		const __m128i CL = Widen(CenterL), CR = Widen(CenterR);
+		const __m128i BL = Widen(BelowL), BC = Widen(BelowC), BR = Widen(BelowR);
+
+		// Separable Sobel: a [1 2 1] smoothing across the [-1 0 1] difference.
+		const __m128i DiffC = _mm_sub_epi16(BC, AC);
+		const __m128i Vertical = _mm_add_epi16(
+			_mm_add_epi16(_mm_sub_epi16(BL, AL), _mm_sub_epi16(BR, AR)),
+			_mm_add_epi16(DiffC, DiffC));
+		const __m128i SumL = _mm_add_epi16(_mm_add_epi16(AL, BL), _mm_add_epi16(CL, CL));
+		const __m128i SumR = _mm_add_epi16(_mm_add_epi16(AR, BR), _mm_add_epi16(CR, CR));
+		const __m128i Horizontal = _mm_sub_epi16(SumR, SumL);
+
+		// Interleaving the two gradients lets madd produce V*V + H*H in 32 bits.
+		const __m128i Lo = _mm_unpacklo_epi16(Vertical, Horizontal);
+		const __m128i Hi = _mm_unpackhi_epi16(Vertical, Horizontal);
+		const __m128i MagnitudeLo = _mm_madd_epi16(Lo, Lo);
+		const __m128i MagnitudeHi = _mm_madd_epi16(Hi, Hi);
+		Mask[Half] = _mm_packs_epi32(
+			_mm_cmpgt_epi32(MagnitudeLo, Threshold),
+			_mm_cmpgt_epi32(MagnitudeHi, Threshold));
+	}
+
+	const __m128i EdgeMask = _mm_packs_epi16(Mask[0], Mask[1]);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(Out + X), _mm_or_si128(EdgeMask, NonEdge));
+}
+
+#elif CAMERA_IMAGE_KERNELS_NEON
+
+// Computes 16 output pixels starting at X. Reads columns [X - 1, X + 16].
+static FORCEINLINE void SobelSpan16(
+	const uint8 *Above,
+	const uint8 *Center,
+	const uint8 *Below,
+	uint8 *Out,
+	int32 X)
+{
+	const int32x4_t Threshold = vdupq_n_s32(SobelThreshold);
+
+	const uint8x16_t AboveL = vld1q_u8(Above + X - 1);
+	const uint8x16_t AboveC = vld1q_u8(Above + X);
+	const uint8x16_t AboveR = vld1q_u8(Above + X + 1);
+	const uint8x16_t CenterL = vld1q_u8(Center + X - 1);
+	const uint8x16_t CenterR = vld1q_u8(Center + X + 1);
+	const uint8x16_t BelowL = vld1q_u8(Below + X - 1);
+	const uint8x16_t BelowC = vld1q_u8(Below + X);
+	const uint8x16_t BelowR = vld1q_u8(Below + X + 1);
+
+	uint8x8_t Mask[2];
+	for (int32 Half = 0; Half < 2; Half++)
+	{
+		auto Widen = [Half](uint8x16_t Value)
+		{
+			return vreinterpretq_s16_u16(vmovl_u8(Half == 0 ? vget_low_u8(Value) : vget_high_u8(Value)));
+		};
+
+		const int16x8_t AL = Widen(AboveL), AC = Widen(AboveC), AR = Widen(AboveR);
+		const int16x8_t CL = Widen(CenterL), CR = Widen(CenterR);
+		const int16x8_t BL = Widen(BelowL), BC = Widen(BelowC), BR = Widen(BelowR);
+
+		// Separable Sobel: a [1 2 1] smoothing across the [-1 0 1] difference.
+		const int16x8_t DiffC = vsubq_s16(BC, AC);
+		const int16x8_t Vertical = vaddq_s16(
+			vaddq_s16(vsubq_s16(BL, AL), vsubq_s16(BR, AR)),
+			vaddq_s16(DiffC, DiffC));
+		const int16x8_t SumL = vaddq_s16(vaddq_s16(AL, BL), vaddq_s16(CL, CL));
+		const int16x8_t SumR = vaddq_s16(vaddq_s16(AR, BR), vaddq_s16(CR, CR));
+		const int16x8_t Horizontal = vsubq_s16(SumR, SumL);
+
+		int32x4_t MagnitudeLo = vmull_s16(vget_low_s16(Vertical), vget_low_s16(Vertical));
+		MagnitudeLo = vmlal_s16(MagnitudeLo, vget_low_s16(Horizontal), vget_low_s16(Horizontal));
+		int32x4_t MagnitudeHi = vmull_s16(vget_high_s16(Vertical), vget_high_s16(Vertical));
+		MagnitudeHi = vmlal_s16(MagnitudeHi, vget_high_s16(Horizontal), vget_high_s16(Horizontal));
+
+		const uint16x8_t Mask16 = vcombine_u16(
+			vmovn_u32(vcgtq_s32(MagnitudeLo, Threshold)),
+			vmovn_u32(vcgtq_s32(MagnitudeHi, Threshold)));
+		Mask[Half] = vmovn_u16(Mask16);
+	}
+
+	const uint8x16_t EdgeMask = vcombine_u8(Mask[0], Mask[1]);
+	vst1q_u8(Out + X, vorrq_u8(EdgeMask, vdupq_n_u8(SobelNonEdgeValue)));
+}
+
+#endif
+
+// Filters one row given its tightly packed neighbour rows. At the top and
+// bottom of the image the caller passes the clamped row.
+static void SobelRow(
+	const uint8 *Above,
+	const uint8 *Center,
+	const uint8 *Below,
+	uint8 *Out,
+	int32 Width)
+{
+	int32 X = 1;
+#if CAMERA_IMAGE_KERNELS_NEON || CAMERA_IMAGE_KERNELS_SSE2
+	for (; X + 16 < Width; X += 16)
+	{
+		SobelSpan16(Above, Center, Below, Out, X);
+	}
+#endif
+	for (; X < Width - 1; X++)
+	{
+		Out[X] = SobelPixel(Above, Center, Below, X - 1, X, X + 1);
+	}
+
+	// Border columns.
+	Out[0] = SobelPixel(Above, Center, Below, 0, 0, FMath::Min(1, Width - 1));
+	if (Width > 1)
+	{
+		Out[Width - 1] = SobelPixel(Above, Center, Below, Width - 2, Width - 1, Width - 1);
+	}
+}
+
+// Copies rows [FirstRow, LastRow] into tightly packed rows of Width pixels.
+static void CopyRows(
+	const uint8 *InYPlaneData,
+	uint32 YPlanePixelStride,
+	uint32 YPlaneRowStride,
+	int32 Width,
+	int32 FirstRow,
+	int32 LastRow,
+	uint8 *OutRows)
+{
+	for (int32 Y = FirstRow; Y <= LastRow; Y++)
+	{
+		const uint8 *Source = InYPlaneData + Y * YPlaneRowStride;
+		uint8 *Dest = OutRows + (Y - FirstRow) * Width;
+		if (YPlanePixelStride == 1)
+		{
+			FMemory::Memcpy(Dest, Source, Width);
+		}
+		else
+		{
+			for (int32 X = 0; X < Width; X++)
+			{
+				Dest[X] = Source[X * YPlanePixelStride];
+			}
+		}
+	}
+}
+
+// Averages Factor x Factor blocks starting at InRow into one packed row of
+// OutWidth pixels, rounding to nearest.
+template <int32 Factor>
+static void DownsampleRowBox(
+	const uint8 *InRow,
+	uint32 PixelStride,
+	uint32 RowStride,
+	int32 OutWidth,
+	uint8 *OutRow)
+{
+	static const uint32 NumSamples = Factor * Factor;
+	for (int32 X = 0; X < OutWidth; X++)
+	{
+		const uint8 *Block = InRow + X * Factor * PixelStride;
+		uint32 Sum = 0;
+		for (int32 DY = 0; DY < Factor; DY++)
+		{
+			for (int32 DX = 0; DX < Factor; DX++)
+			{
+				Sum += Block[DY * RowStride + DX * PixelStride];
+			}
+		}
+		OutRow[X] = static_cast<uint8>((Sum + NumSamples / 2) / NumSamples);
+	}
+}
+
+void DownsampleRow(
+	const uint8 *InPlaneData,
+	uint32 PixelStride,
+	uint32 RowStride,
+	int32 OutWidth,
+	int32 OutY,
+	int32 Factor,
+	uint8 *OutRow)
+{
+	const uint8 *InRow = InPlaneData + OutY * Factor * RowStride;
+	switch (Factor)
+	{
+	case 1:
+		CopyRows(InPlaneData, PixelStride, RowStride, OutWidth, OutY, OutY, OutRow);
+		break;
+	case 2:
+		DownsampleRowBox<2>(InRow, PixelStride, RowStride, OutWidth, OutRow);
+		break;
+	case 4:
+		DownsampleRowBox<4>(InRow, PixelStride, RowStride, OutWidth, OutRow);
+		break;
+	default:
+		checkf(false, TEXT("Unsupported decimation factor %d"), Factor);
+		break;
+	}
+}
+
+void CopyPlane(
+	const uint8 *InPlaneData,
+	uint32 PixelStride,
+	uint32 RowStride,
+	int32 Width,
+	int32 Height,
+	uint8 *OutPixels)
+{
+	if (Width > 0 && Height > 0)
+	{
+		CopyRows(InPlaneData, PixelStride, RowStride, Width, 0, Height - 1, OutPixels);
+	}
+}
+
+void DownsamplePlane(
+	const uint8 *InPlaneData,
+	uint32 PixelStride,
+	uint32 RowStride,
+	int32 Width,
+	int32 Height,
+	int32 Factor,
+	uint8 *OutPixels)
+{
+	const int32 OutWidth = Width / Factor;
+	const int32 OutHeight = Height / Factor;
+	for (int32 Y = 0; Y < OutHeight; Y++)
+	{
+		DownsampleRow(InPlaneData, PixelStride, RowStride, OutWidth, Y, Factor, OutPixels + Y * OutWidth);
+	}
+}
+
+// Filters output rows [RowBegin, RowEnd) of a Width x Height image whose
+// packed rows are produced on demand by ProduceRow(Row, OutRow).
+//
+// Reading the original image buffer directly is extremely slow on some
+// devices (Exynos S8), so rows are copied out of it before filtering. Only
+// a ring of three rows is kept: each source row is produced once, just
+// before the first output row that needs it, and stays in cache for the
+// three output rows that read it.
+template <typename RowProducerType>
+static void SobelEdgeDetectionStreamRows(
+	const RowProducerType &ProduceRow,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 RowBegin,
+	int32 RowEnd)
+{
+	RowBegin = FMath::Max(RowBegin, 0);
+	RowEnd = FMath::Min(RowEnd, Height);
+	if (Width <= 0 || RowBegin >= RowEnd)
+	{
+		return;
+	}
+
+	TArray<uint8, TInlineAllocator<3 * SobelInlineRowCacheWidth>> RowCache;
+	RowCache.SetNumUninitialized(3 * Width);
+	uint8 *RowCacheData = RowCache.GetData();
+	auto CachedRow = [RowCacheData, Width](int32 Row)
+	{
+		return RowCacheData + (Row % 3) * Width;
+	};
+
+	int32 NextRowToProduce = FMath::Max(RowBegin - 1, 0);
+	for (int32 Y = RowBegin; Y < RowEnd; Y++)
+	{
+		const int32 BelowRow = FMath::Min(Y + 1, Height - 1);
+		for (; NextRowToProduce <= BelowRow; NextRowToProduce++)
+		{
+			ProduceRow(NextRowToProduce, CachedRow(NextRowToProduce));
+		}
+
+		SobelRow(
+			CachedRow(FMath::Max(Y - 1, 0)), CachedRow(Y), CachedRow(BelowRow),
+			OutPixels + Y * Width, Width);
+	}
+}
+
+void SobelEdgeDetectionRows(
+	const uint8 *InYPlaneData,
+	uint32 YPlanePixelStride,
+	uint32 YPlaneRowStride,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 RowBegin,
+	int32 RowEnd)
+{
+	auto CopyRow = [=](int32 Row, uint8 *OutRow)
+	{
+		CopyRows(InYPlaneData, YPlanePixelStride, YPlaneRowStride, Width, Row, Row, OutRow);
+	};
+	SobelEdgeDetectionStreamRows(CopyRow, OutPixels, Width, Height, RowBegin, RowEnd);
+}
+
+// Filters output rows [RowBegin, RowEnd) of a tightly packed image in place,
+// without copying the input first.
+static void SobelEdgeDetectionPackedRows(
+	const uint8 *InPixels,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 RowBegin,
+	int32 RowEnd)
+{
+	RowEnd = FMath::Min(RowEnd, Height);
+	for (int32 Y = RowBegin; Y < RowEnd; Y++)
+	{
+		const uint8 *Above = InPixels + FMath::Max(Y - 1, 0) * Width;
+		const uint8 *Center = InPixels + Y * Width;
+		const uint8 *Below = InPixels + FMath::Min(Y + 1, Height - 1) * Width;
+		SobelRow(Above, Center, Below, OutPixels + Y * Width, Width);
+	}
+}
+
+void SobelEdgeDetection(
+	const uint8 *InYPlaneData,
+	uint32 YPlanePixelStride,
+	uint32 YPlaneRowStride,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height)
+{
+	SobelEdgeDetectionRows(
+		InYPlaneData, YPlanePixelStride, YPlaneRowStride, OutPixels, Width, Height, 0, Height);
+}
+
+int32 GetSobelBandCount(int32 Width, int32 Height, int32 NumBands, int32 MinPixelsPerTask)
+{
+	if (NumBands <= 0)
+	{
+		NumBands = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	}
+	if (MinPixelsPerTask > 0)
+	{
+		const int64 NumPixels = static_cast<int64>(Width) * Height;
+		NumBands = FMath::Min<int64>(NumBands, FMath::Max<int64>(NumPixels / MinPixelsPerTask, 1));
+	}
+	return FMath::Clamp(NumBands, 1, FMath::Max(Height, 1));
+}
+
+void SobelEdgeDetectionParallel(
+	const uint8 *InYPlaneData,
+	uint32 YPlanePixelStride,
+	uint32 YPlaneRowStride,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 NumBands,
+	int32 MinPixelsPerTask)
+{
+	SobelEdgeDetectionDecimated(
+		InYPlaneData, YPlanePixelStride, YPlaneRowStride, OutPixels, Width, Height,
+		1, NumBands, MinPixelsPerTask);
+}
+
+void SobelEdgeDetectionDecimated(
+	const uint8 *InYPlaneData,
+	uint32 YPlanePixelStride,
+	uint32 YPlaneRowStride,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 Factor,
+	int32 NumBands,
+	int32 MinPixelsPerTask)
+{
+	const int32 OutWidth = Width / Factor;
+	const int32 OutHeight = Height / Factor;
+	if (OutWidth <= 0 || OutHeight <= 0)
+	{
+		return;
+	}
+
+	auto ProduceRow = [=](int32 Row, uint8 *OutRow)
+	{
+		DownsampleRow(InYPlaneData, YPlanePixelStride, YPlaneRowStride, OutWidth, Row, Factor, OutRow);
+	};
+
+	// Band sizes follow the pixels actually filtered, not the source region.
+	NumBands = GetSobelBandCount(OutWidth, OutHeight, NumBands, MinPixelsPerTask);
+	if (NumBands == 1)
+	{
+		SobelEdgeDetectionStreamRows(ProduceRow, OutPixels, OutWidth, OutHeight, 0, OutHeight);
+		return;
+	}
+
+	const int32 RowsPerBand = FMath::DivideAndRoundUp(OutHeight, NumBands);
+	ParallelFor(NumBands, [=](int32 BandIndex)
+	{
+		SobelEdgeDetectionStreamRows(
+			ProduceRow, OutPixels, OutWidth, OutHeight,
+			BandIndex * RowsPerBand, (BandIndex + 1) * RowsPerBand);
+	});
+}
+
+void SobelEdgeDetectionPacked(
+	const uint8 *InPixels,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 NumBands,
+	int32 MinPixelsPerTask)
+{
+	if (Width <= 0 || Height <= 0)
+	{
+		return;
+	}
+
+	NumBands = GetSobelBandCount(Width, Height, NumBands, MinPixelsPerTask);
+	if (NumBands == 1)
+	{
+		SobelEdgeDetectionPackedRows(InPixels, OutPixels, Width, Height, 0, Height);
+		return;
+	}
+
+	const int32 RowsPerBand = FMath::DivideAndRoundUp(Height, NumBands);
+	ParallelFor(NumBands, [=](int32 BandIndex)
+	{
+		SobelEdgeDetectionPackedRows(
+			InPixels, OutPixels, Width, Height,
+			BandIndex * RowsPerBand, (BandIndex + 1) * RowsPerBand);
+	});
+}
+
+// Returns true if any of the Count bytes at A and B differ.
+static bool SpansDiffer(const uint8 *A, const uint8 *B, int32 Count)
+{
+	int32 X = 0;
+#if CAMERA_IMAGE_KERNELS_NEON
+	for (; X + 16 <= Count; X += 16)
+	{
+		const uint64x2_t Difference = vreinterpretq_u64_u8(veorq_u8(vld1q_u8(A + X), vld1q_u8(B + X)));
+		if ((vgetq_lane_u64(Difference, 0) | vgetq_lane_u64(Difference, 1)) != 0)
+		{
+			return true;
+		}
+	}
+#elif CAMERA_IMAGE_KERNELS_SSE2
+	for (; X + 16 <= Count; X += 16)
+	{
+		const __m128i Equal = _mm_cmpeq_epi8(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(A + X)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(B + X)));
+		if (_mm_movemask_epi8(Equal) != 0xFFFF)
+		{
+			return true;
+		}
+	}
+#endif
+	for (; X < Count; X++)
+	{
+		if (A[X] != B[X])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 FindDirtyTiles(
+	const uint8 *InPixels,
+	const uint8 *InPreviousPixels,
+	int32 Width,
+	int32 Height,
+	int32 TileSize,
+	uint8 *OutDirtyTiles)
+{
+	check(TileSize > 0);
+	const int32 NumTilesX = (Width + TileSize - 1) / TileSize;
+	const int32 NumTilesY = (Height + TileSize - 1) / TileSize;
+	FMemory::Memzero(OutDirtyTiles, NumTilesX * NumTilesY);
+
+	// Row by row within a row of tiles, so that both images are read
+	// sequentially, skipping the tiles already known to be dirty.
+	int32 NumDirtyTiles = 0;
+	for (int32 TileY = 0; TileY < NumTilesY; TileY++)
+	{
+		uint8 *DirtyRow = OutDirtyTiles + TileY * NumTilesX;
+		const int32 RowEnd = FMath::Min((TileY + 1) * TileSize, Height);
+		int32 NumCleanTiles = NumTilesX;
+		for (int32 Y = TileY * TileSize; Y < RowEnd && NumCleanTiles > 0; Y++)
+		{
+			const uint8 *Row = InPixels + Y * Width;
+			const uint8 *PreviousRow = InPreviousPixels + Y * Width;
+			for (int32 TileX = 0; TileX < NumTilesX; TileX++)
+			{
+				const int32 X = TileX * TileSize;
+				if (!DirtyRow[TileX] && SpansDiffer(Row + X, PreviousRow + X, FMath::Min(TileSize, Width - X)))
+				{
+					DirtyRow[TileX] = 1;
+					NumCleanTiles--;
+				}
+			}
+		}
+		NumDirtyTiles += NumTilesX - NumCleanTiles;
+	}
+	return NumDirtyTiles;
+}
+
+void CopyDirtyTiles(
+	const uint8 *InPixels,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 TileSize,
+	const uint8 *DirtyTiles)
+{
+	check(TileSize > 0);
+	const int32 NumTilesX = (Width + TileSize - 1) / TileSize;
+	const int32 NumTilesY = (Height + TileSize - 1) / TileSize;
+	for (int32 TileY = 0; TileY < NumTilesY; TileY++)
+	{
+		const uint8 *DirtyRow = DirtyTiles + TileY * NumTilesX;
+		const int32 RowEnd = FMath::Min((TileY + 1) * TileSize, Height);
+		for (int32 TileX = 0; TileX < NumTilesX; )
+		{
+			// Horizontally adjacent dirty tiles are copied as one span.
+			if (!DirtyRow[TileX])
+			{
+				TileX++;
+				continue;
+			}
+			const int32 RunBegin = TileX;
+			while (TileX < NumTilesX && DirtyRow[TileX])
+			{
+				TileX++;
+			}
+			const int32 X = RunBegin * TileSize;
+			const int32 Count = FMath::Min(TileX * TileSize, Width) - X;
+			for (int32 Y = TileY * TileSize; Y < RowEnd; Y++)
+			{
+				FMemory::Memcpy(OutPixels + Y * Width + X, InPixels + Y * Width + X, Count);
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,619 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ImageFilterGraph.h"
+#include "CameraImageKernels.h"
+
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeLock.h"
+
+FImageFilterStage FImageFilterStage::GaussianBlur()
+{
+	FImageFilterStage Stage;
+	Stage.Op = EImageFilterOp::GaussianBlur3x3;
+	return Stage;
+}
+
+FImageFilterStage FImageFilterStage::Sobel()
+{
+	FImageFilterStage Stage;
+	Stage.Op = EImageFilterOp::SobelGradient;
+	return Stage;
+}
+
+FImageFilterStage FImageFilterStage::NonMaxSuppression()
+{
+	FImageFilterStage Stage;
+	Stage.Op = EImageFilterOp::NonMaxSuppression;
+	return Stage;
+}
+
+FImageFilterStage FImageFilterStage::Threshold(int32 InThreshold, uint8 InHighValue, uint8 InLowValue)
+{
+	FImageFilterStage Stage;
+	Stage.Op = EImageFilterOp::Threshold;
+	Stage.LowThreshold = InThreshold;
+	Stage.HighThreshold = InThreshold;
+	Stage.HighValue = InHighValue;
+	Stage.LowValue = InLowValue;
+	return Stage;
+}
+
+FImageFilterStage FImageFilterStage::Hysteresis(int32 InLowThreshold, int32 InHighThreshold, uint8 InHighValue, uint8 InLowValue)
+{
+	FImageFilterStage Stage;
+	Stage.Op = EImageFilterOp::Hysteresis;
+	Stage.LowThreshold = InLowThreshold;
+	Stage.HighThreshold = InHighThreshold;
+	Stage.HighValue = InHighValue;
+	Stage.LowValue = InLowValue;
+	return Stage;
+}
+
+/**
+ * Scratch memory for one band: a ring of three rows per pass followed by
+ * one 8-bit source row. Arenas keep their capacity between calls.
+ */
+struct FImageFilterGraph::FArenaPool
+{
+	~FArenaPool()
+	{
+		for (TArray<int32> *Arena : IdleArenas)
+		{
+			delete Arena;
+		}
+	}
+
+	TArray<int32> *Acquire()
+	{
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (IdleArenas.Num() > 0)
+			{
+				return IdleArenas.Pop(false);
+			}
+		}
+		return new TArray<int32>();
+	}
+
+	void Release(TArray<int32> *Arena)
+	{
+		FScopeLock ScopeLock(&Lock);
+		IdleArenas.Add(Arena);
+	}
+
+	FCriticalSection Lock;
+	TArray<TArray<int32>*> IdleArenas;
+};
+
+struct FImageFilterGraph::FBandState
+{
+	const uint8 *InPlaneData;
+	uint32 PixelStride;
+	uint32 RowStride;
+	int32 Factor;
+	int32 Width;
+	int32 Height;
+
+	/** Pass P keeps row R at Rows + (P * 3 + R % 3) * Width. */
+	int32 *Rows;
+	uint8 *SourceRow;
+
+	/** The next row each pass produces. */
+	TArray<int32, TInlineAllocator<8>> NextRow;
+
+	int32 *GetRow(int32 PassIndex, int32 Row) const
+	{
+		return Rows + (PassIndex * 3 + Row % 3) * Width;
+	}
+};
+
+// Quantized gradient directions stored in the low bits of EFormat::Gradient.
+static const int32 DirectionHorizontal = 0;
+static const int32 DirectionDiagonalDown = 1;
+static const int32 DirectionVertical = 2;
+static const int32 DirectionDiagonalUp = 3;
+
+static const TCHAR *GetOpName(EImageFilterOp Op)
+{
+	switch (Op)
+	{
+	case EImageFilterOp::GaussianBlur3x3: return TEXT("GaussianBlur3x3");
+	case EImageFilterOp::SobelGradient: return TEXT("SobelGradient");
+	case EImageFilterOp::NonMaxSuppression: return TEXT("NonMaxSuppression");
+	case EImageFilterOp::Threshold: return TEXT("Threshold");
+	case EImageFilterOp::Hysteresis: return TEXT("Hysteresis");
+	}
+	return TEXT("Unknown");
+}
+
+static bool IsStencilOp(EImageFilterOp Op)
+{
+	return Op != EImageFilterOp::Threshold;
+}
+
+// Calls Function(XLeft, X, XRight) for every column of a row, with the
+// neighbour columns clamped to the row. The interior comes first so that
+// its loop carries no clamping.
+template <typename PixelFunctionType>
+static FORCEINLINE void ForEachStencilPixel(int32 Width, const PixelFunctionType &Function)
+{
+	for (int32 X = 1; X < Width - 1; X++)
+	{
+		Function(X - 1, X, X + 1);
+	}
+	Function(0, 0, FMath::Min(1, Width - 1));
+	if (Width > 1)
+	{
+		Function(Width - 2, Width - 1, Width - 1);
+	}
+}
+
+FImageFilterGraph::FImageFilterGraph()
+	: ArenaPool(MakeShareable(new FArenaPool()))
+{
+}
+
+void FImageFilterGraph::AddStage(const FImageFilterStage &Stage)
+{
+	Stages.Add(Stage);
+	bCompiled = false;
+}
+
+void FImageFilterGraph::Reset()
+{
+	Stages.Reset();
+	bCompiled = false;
+}
+
+bool FImageFilterGraph::Compile(FString *OutError)
+{
+	CompiledStages.Reset();
+	Passes.Reset();
+	bCompiled = false;
+
+	FPass SourcePass;
+	Passes.Add(SourcePass);
+
+	EFormat Format = EFormat::Intensity;
+	for (int32 StageIndex = 0; StageIndex < Stages.Num(); StageIndex++)
+	{
+		const FImageFilterStage &Stage = Stages[StageIndex];
+
+		FString Error;
+		if ((Stage.Op == EImageFilterOp::GaussianBlur3x3 || Stage.Op == EImageFilterOp::SobelGradient) &&
+			Format != EFormat::Intensity)
+		{
+			Error = TEXT("expects an intensity image");
+		}
+		else if (Stage.Op == EImageFilterOp::NonMaxSuppression && Format != EFormat::Gradient)
+		{
+			Error = TEXT("expects the output of SobelGradient");
+		}
+		else if (Stage.Op == EImageFilterOp::Hysteresis && Stage.LowThreshold > Stage.HighThreshold)
+		{
+			Error = TEXT("has a low threshold above its high threshold");
+		}
+
+		if (!Error.IsEmpty())
+		{
+			if (OutError != nullptr)
+			{
+				*OutError = FString::Printf(TEXT("Stage %d (%s) %s."), StageIndex, GetOpName(Stage.Op), *Error);
+			}
+			CompiledStages.Reset();
+			Passes.Reset();
+			return false;
+		}
+
+		// Gradients are compared as squared magnitudes.
+		auto ConvertThreshold = [Format](int32 Threshold)
+		{
+			if (Format == EFormat::Intensity)
+			{
+				return Threshold;
+			}
+			return Threshold < 0 ? -1 : Threshold * Threshold;
+		};
+
+		FCompiledStage CompiledStage;
+		CompiledStage.Stage = Stage;
+		CompiledStage.InputFormat = Format;
+		CompiledStage.LowThreshold = ConvertThreshold(Stage.LowThreshold);
+		CompiledStage.HighThreshold = ConvertThreshold(Stage.HighThreshold);
+		CompiledStages.Add(CompiledStage);
+
+		switch (Stage.Op)
+		{
+		case EImageFilterOp::SobelGradient:
+			Format = EFormat::Gradient;
+			break;
+		case EImageFilterOp::NonMaxSuppression:
+			Format = EFormat::GradientMagnitude;
+			break;
+		case EImageFilterOp::Threshold:
+		case EImageFilterOp::Hysteresis:
+		case EImageFilterOp::GaussianBlur3x3:
+			Format = EFormat::Intensity;
+			break;
+		}
+
+		if (IsStencilOp(Stage.Op))
+		{
+			FPass Pass;
+			Pass.StencilStage = StageIndex;
+			Pass.FirstPointStage = StageIndex + 1;
+			Passes.Add(Pass);
+		}
+		else
+		{
+			Passes.Last().NumPointStages++;
+		}
+		Passes.Last().OutputFormat = Format;
+	}
+
+	bCompiled = true;
+	return true;
+}
+
+// Extracts the value thresholds compare against from a row element.
+static FORCEINLINE int32 GetComparedValue(int32 Value, bool bIsGradient)
+{
+	return bIsGradient ? Value >> 2 : Value;
+}
+
+static void GaussianBlurRow(const int32 *Above, const int32 *Center, const int32 *Below, int32 *Out, int32 Width)
+{
+	ForEachStencilPixel(Width, [=](int32 XLeft, int32 X, int32 XRight)
+	{
+		const int32 Sum =
+			(Above[XLeft] + 2 * Above[X] + Above[XRight]) +
+			2 * (Center[XLeft] + 2 * Center[X] + Center[XRight]) +
+			(Below[XLeft] + 2 * Below[X] + Below[XRight]);
+		Out[X] = (Sum + 8) >> 4;
+	});
+}
+
+// Same gradients and magnitude as CameraImageKernels::SobelEdgeDetection().
+static FORCEINLINE int32 SobelPixelGradient(
+	const int32 *Above,
+	const int32 *Center,
+	const int32 *Below,
+	int32 XLeft,
+	int32 X,
+	int32 XRight,
+	int32 &OutVerticalGradient,
+	int32 &OutHorizontalGradient)
+{
+	OutVerticalGradient =
+		(Below[XLeft] - Above[XLeft]) +
+		2 * (Below[X] - Above[X]) +
+		(Below[XRight] - Above[XRight]);
+	OutHorizontalGradient =
+		(Above[XRight] + 2 * Center[XRight] + Below[XRight]) -
+		(Above[XLeft] + 2 * Center[XLeft] + Below[XLeft]);
+	return OutVerticalGradient * OutVerticalGradient + OutHorizontalGradient * OutHorizontalGradient;
+}
+
+// Writes the gradient without its direction. Used when the direction is
+// discarded by a fused point-wise stage anyway, which keeps the loop free
+// of branches.
+static void SobelMagnitudeRow(const int32 *Above, const int32 *Center, const int32 *Below, int32 *Out, int32 Width)
+{
+	ForEachStencilPixel(Width, [=](int32 XLeft, int32 X, int32 XRight)
+	{
+		int32 VerticalGradient;
+		int32 HorizontalGradient;
+		Out[X] = SobelPixelGradient(Above, Center, Below, XLeft, X, XRight, VerticalGradient, HorizontalGradient) << 2;
+	});
+}
+
+static void SobelGradientRow(const int32 *Above, const int32 *Center, const int32 *Below, int32 *Out, int32 Width)
+{
+	ForEachStencilPixel(Width, [=](int32 XLeft, int32 X, int32 XRight)
+	{
+		int32 VerticalGradient;
+		int32 HorizontalGradient;
+		const int32 Magnitude = SobelPixelGradient(Above, Center, Below, XLeft, X, XRight, VerticalGradient, HorizontalGradient);
+
+		// Quantize the direction to 45 degree sectors; 2/5 approximates tan(22.5).
+		const int32 AbsVertical = FMath::Abs(VerticalGradient);
+		const int32 AbsHorizontal = FMath::Abs(HorizontalGradient);
+		int32 Direction;
+		if (AbsVertical * 5 <= AbsHorizontal * 2)
+		{
+			Direction = DirectionHorizontal;
+		}
+		else if (AbsHorizontal * 5 <= AbsVertical * 2)
+		{
+			Direction = DirectionVertical;
+		}
+		else
+		{
+			Direction = (VerticalGradient > 0) == (HorizontalGradient > 0) ? DirectionDiagonalDown : DirectionDiagonalUp;
+		}
+		Out[X] = (Magnitude << 2) | Direction;
+	});
+}
+
+static void NonMaxSuppressionRow(const int32 *Above, const int32 *Center, const int32 *Below, int32 *Out, int32 Width)
+{
+	ForEachStencilPixel(Width, [=](int32 XLeft, int32 X, int32 XRight)
+	{
+		// Neighbours across the edge, i.e. along the gradient.
+		int32 Before;
+		int32 After;
+		switch (Center[X] & 3)
+		{
+		case DirectionHorizontal:
+			Before = Center[XLeft];
+			After = Center[XRight];
+			break;
+		case DirectionDiagonalDown:
+			Before = Above[XLeft];
+			After = Below[XRight];
+			break;
+		case DirectionVertical:
+			Before = Above[X];
+			After = Below[X];
+			break;
+		default:
+			Before = Above[XRight];
+			After = Below[XLeft];
+			break;
+		}
+
+		// Ties keep the first pixel of a plateau so that edges stay one pixel wide.
+		const int32 Magnitude = Center[X] >> 2;
+		Out[X] = Magnitude > (Before >> 2) && Magnitude >= (After >> 2) ? Magnitude : 0;
+	});
+}
+
+static void HysteresisRow(
+	const int32 *Above,
+	const int32 *Center,
+	const int32 *Below,
+	int32 *Out,
+	int32 Width,
+	bool bIsGradient,
+	int32 LowThreshold,
+	int32 HighThreshold,
+	int32 LowValue,
+	int32 HighValue)
+{
+	ForEachStencilPixel(Width, [=](int32 XLeft, int32 X, int32 XRight)
+	{
+		auto IsStrong = [=](int32 Value)
+		{
+			return GetComparedValue(Value, bIsGradient) >= HighThreshold;
+		};
+
+		const int32 Value = GetComparedValue(Center[X], bIsGradient);
+		bool bIsEdge = Value >= HighThreshold;
+		if (!bIsEdge && Value >= LowThreshold)
+		{
+			bIsEdge =
+				IsStrong(Above[XLeft]) || IsStrong(Above[X]) || IsStrong(Above[XRight]) ||
+				IsStrong(Center[XLeft]) || IsStrong(Center[XRight]) ||
+				IsStrong(Below[XLeft]) || IsStrong(Below[X]) || IsStrong(Below[XRight]);
+		}
+		Out[X] = bIsEdge ? HighValue : LowValue;
+	});
+}
+
+static void ThresholdRow(int32 *Row, int32 Width, bool bIsGradient, int32 Threshold, int32 LowValue, int32 HighValue)
+{
+	for (int32 X = 0; X < Width; X++)
+	{
+		Row[X] = GetComparedValue(Row[X], bIsGradient) > Threshold ? HighValue : LowValue;
+	}
+}
+
+void FImageFilterGraph::AdvancePass(FBandState &State, int32 PassIndex, int32 LastRow) const
+{
+	const FPass &Pass = Passes[PassIndex];
+	const int32 Width = State.Width;
+	for (int32 &Row = State.NextRow[PassIndex]; Row <= LastRow; Row++)
+	{
+		int32 *Out = State.GetRow(PassIndex, Row);
+		if (Pass.StencilStage == INDEX_NONE)
+		{
+			CameraImageKernels::DownsampleRow(
+				State.InPlaneData, State.PixelStride, State.RowStride, Width, Row, State.Factor, State.SourceRow);
+			for (int32 X = 0; X < Width; X++)
+			{
+				Out[X] = State.SourceRow[X];
+			}
+		}
+		else
+		{
+			const int32 BelowRow = FMath::Min(Row + 1, State.Height - 1);
+			AdvancePass(State, PassIndex - 1, BelowRow);
+
+			const int32 *Above = State.GetRow(PassIndex - 1, FMath::Max(Row - 1, 0));
+			const int32 *Center = State.GetRow(PassIndex - 1, Row);
+			const int32 *Below = State.GetRow(PassIndex - 1, BelowRow);
+
+			const FCompiledStage &Stencil = CompiledStages[Pass.StencilStage];
+			switch (Stencil.Stage.Op)
+			{
+			case EImageFilterOp::GaussianBlur3x3:
+				GaussianBlurRow(Above, Center, Below, Out, Width);
+				break;
+			case EImageFilterOp::SobelGradient:
+				if (Pass.NumPointStages > 0)
+				{
+					SobelMagnitudeRow(Above, Center, Below, Out, Width);
+				}
+				else
+				{
+					SobelGradientRow(Above, Center, Below, Out, Width);
+				}
+				break;
+			case EImageFilterOp::NonMaxSuppression:
+				NonMaxSuppressionRow(Above, Center, Below, Out, Width);
+				break;
+			case EImageFilterOp::Hysteresis:
+				HysteresisRow(
+					Above, Center, Below, Out, Width,
+					Stencil.InputFormat == EFormat::Gradient,
+					Stencil.LowThreshold, Stencil.HighThreshold,
+					Stencil.Stage.LowValue, Stencil.Stage.HighValue);
+				break;
+			default:
+				checkf(false, TEXT("%s is not a stencil stage"), GetOpName(Stencil.Stage.Op));
+				break;
+			}
+		}
+
+		// Point-wise stages run on the row while it is still in cache.
+		for (int32 StageIndex = Pass.FirstPointStage; StageIndex < Pass.FirstPointStage + Pass.NumPointStages; StageIndex++)
+		{
+			const FCompiledStage &PointStage = CompiledStages[StageIndex];
+			ThresholdRow(
+				Out, Width,
+				PointStage.InputFormat == EFormat::Gradient,
+				PointStage.HighThreshold,
+				PointStage.Stage.LowValue, PointStage.Stage.HighValue);
+		}
+	}
+}
+
+void FImageFilterGraph::ExecuteBand(
+	const uint8 *InPlaneData,
+	uint32 PixelStride,
+	uint32 RowStride,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 Factor,
+	int32 RowBegin,
+	int32 RowEnd) const
+{
+	const int32 OutWidth = Width / Factor;
+	const int32 OutHeight = Height / Factor;
+	RowBegin = FMath::Max(RowBegin, 0);
+	RowEnd = FMath::Min(RowEnd, OutHeight);
+	if (RowBegin >= RowEnd)
+	{
+		return;
+	}
+
+	const int32 NumPasses = Passes.Num();
+	const int32 NumRowElements = NumPasses * 3 * OutWidth;
+	TArray<int32> *Arena = ArenaPool->Acquire();
+	Arena->SetNumUninitialized(NumRowElements + FMath::DivideAndRoundUp(OutWidth, 4), false);
+
+	FBandState State;
+	State.InPlaneData = InPlaneData;
+	State.PixelStride = PixelStride;
+	State.RowStride = RowStride;
+	State.Factor = Factor;
+	State.Width = OutWidth;
+	State.Height = OutHeight;
+	State.Rows = Arena->GetData();
+	State.SourceRow = reinterpret_cast<uint8*>(Arena->GetData() + NumRowElements);
+
+	// Every stencil pass after this one widens the rows it needs by one on
+	// each side.
+	State.NextRow.SetNumUninitialized(NumPasses);
+	for (int32 PassIndex = 0; PassIndex < NumPasses; PassIndex++)
+	{
+		State.NextRow[PassIndex] = FMath::Max(RowBegin - (NumPasses - 1 - PassIndex), 0);
+	}
+
+	const int32 LastPass = NumPasses - 1;
+	const EFormat OutputFormat = Passes[LastPass].OutputFormat;
+	for (int32 Y = RowBegin; Y < RowEnd; Y++)
+	{
+		AdvancePass(State, LastPass, Y);
+
+		const int32 *Row = State.GetRow(LastPass, Y);
+		uint8 *Out = OutPixels + Y * OutWidth;
+		if (OutputFormat == EFormat::Intensity)
+		{
+			for (int32 X = 0; X < OutWidth; X++)
+			{
+				Out[X] = static_cast<uint8>(FMath::Clamp(Row[X], 0, 255));
+			}
+		}
+		else
+		{
+			const bool bIsGradient = OutputFormat == EFormat::Gradient;
+			for (int32 X = 0; X < OutWidth; X++)
+			{
+				const float Magnitude = FMath::Sqrt(static_cast<float>(GetComparedValue(Row[X], bIsGradient)));
+				Out[X] = static_cast<uint8>(FMath::Min(FMath::FloorToInt(Magnitude), 255));
+			}
+		}
+	}
+
+	ArenaPool->Release(Arena);
+}
+
+void FImageFilterGraph::Execute(
+	const uint8 *InPlaneData,
+	uint32 PixelStride,
+	uint32 RowStride,
+	uint8 *OutPixels,
+	int32 Width,
+	int32 Height,
+	int32 Factor,
+	int32 NumBands,
+	int32 MinPixelsPerTask) const
+{
+	checkf(bCompiled, TEXT("FImageFilterGraph::Execute() called before a successful Compile()"));
+
+	const int32 OutWidth = Width / Factor;
+	const int32 OutHeight = Height / Factor;
+	if (OutWidth <= 0 || OutHeight <= 0)
+	{
+		return;
+	}
+
+	NumBands = CameraImageKernels::GetSobelBandCount(OutWidth, OutHeight, NumBands, MinPixelsPerTask);
+	if (NumBands == 1)
+	{
+		ExecuteBand(InPlaneData, PixelStride, RowStride, OutPixels, Width, Height, Factor, 0, OutHeight);
+		return;
+	}
+
+	const int32 RowsPerBand = FMath::DivideAndRoundUp(OutHeight, NumBands);
+	ParallelFor(NumBands, [=](int32 BandIndex)
+	{
+		ExecuteBand(
+			InPlaneData, PixelStride, RowStride, OutPixels, Width, Height, Factor,
+			BandIndex * RowsPerBand, (BandIndex + 1) * RowsPerBand);
+	});
+}
+
+FImageFilterGraph FImageFilterGraph::MakeSobelEdgeDetector()
+{
+	FImageFilterGraph Graph;
+	Graph.AddStage(FImageFilterStage::Sobel());
+	Graph.AddStage(FImageFilterStage::Threshold(128, CameraImageKernels::SobelEdgeValue, CameraImageKernels::SobelNonEdgeValue));
+	Graph.Compile();
+	return Graph;
+}
+
+FImageFilterGraph FImageFilterGraph::MakeCannyEdgeDetector(int32 LowThreshold, int32 HighThreshold)
+{
+	FImageFilterGraph Graph;
+	Graph.AddStage(FImageFilterStage::GaussianBlur());
+	Graph.AddStage(FImageFilterStage::Sobel());
+	Graph.AddStage(FImageFilterStage::NonMaxSuppression());
+	Graph.AddStage(FImageFilterStage::Hysteresis(LowThreshold, HighThreshold));
+	Graph.Compile();
+	return Graph;
+}
@@ -0,0 +1,229 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ImageKernelBenchmark.h"
+
+#include "ComputerVisionCore.h"
+#include "CameraImageKernels.h"
+#include "ImageFilterGraph.h"
+
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+
+namespace ImageKernelBenchmark
+{
+
+// Larger than the last level cache of the devices and desktops we measure on.
+static const int32 CacheEvictionBytes = 64 * 1024 * 1024;
+
+int32 GetPaddedRowStride(int32 Width, int32 PixelStride)
+{
+	return Align(Width * PixelStride, 64) + 64;
+}
+
+FTestFrame MakeSyntheticFrame(int32 Width, int32 Height, int32 PixelStride, int32 RowStride)
+{
+	check(RowStride >= (Width - 1) * PixelStride + 1);
+
+	FTestFrame Frame;
+	Frame.Width = Width;
+	Frame.Height = Height;
+	Frame.PixelStride = PixelStride;
+	Frame.RowStride = RowStride;
+	Frame.Data.SetNumUninitialized(RowStride * Height);
+
+	FRandomStream RandomStream(0x5eed);
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		for (int32 Offset = 0; Offset < RowStride; Offset++)
+		{
+			const int32 X = Offset / PixelStride;
+			const int32 Base = ((X / 64) + (Y / 64)) % 2 == 0 ? 48 : 208;
+			Frame.Data[Y * RowStride + Offset] = static_cast<uint8>(Base + RandomStream.RandRange(-32, 32));
+		}
+	}
+	return Frame;
+}
+
+bool LoadFrame(
+	const FString &Filename,
+	int32 Width,
+	int32 Height,
+	int32 PixelStride,
+	int32 RowStride,
+	FTestFrame &OutFrame)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *Filename))
+	{
+		UE_LOG(LogComputerVisionCore, Error, TEXT("Failed to read frame %s"), *Filename);
+		return false;
+	}
+	if (FileData.Num() < Width * Height)
+	{
+		UE_LOG(LogComputerVisionCore, Error, TEXT("Frame %s holds %d bytes, a %dx%d Y plane needs %d"),
+			*Filename, FileData.Num(), Width, Height, Width * Height);
+		return false;
+	}
+
+	// Start from a synthetic frame so that the padding holds plausible bytes.
+	OutFrame = MakeSyntheticFrame(Width, Height, PixelStride, RowStride);
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		for (int32 X = 0; X < Width; X++)
+		{
+			OutFrame.Data[Y * RowStride + X * PixelStride] = FileData[Y * Width + X];
+		}
+	}
+	return true;
+}
+
+TArray<FKernelResult> RunKernelSuite(const FTestFrame &Frame, const FSuiteSettings &Settings)
+{
+	const int32 Width = Frame.Width;
+	const int32 Height = Frame.Height;
+	const uint8 *PlaneData = Frame.GetPlaneData();
+	const uint32 PixelStride = Frame.PixelStride;
+	const uint32 RowStride = Frame.RowStride;
+	const int32 Iterations = FMath::Max(Settings.Iterations, 1);
+	const int32 NumBands = Settings.NumBands;
+
+	TArray<uint8> EvictionBuffer;
+	if (Settings.bColdCache)
+	{
+		EvictionBuffer.SetNumUninitialized(CacheEvictionBytes);
+	}
+	uint8 EvictionValue = 0;
+	auto Prepare = [&EvictionBuffer, &EvictionValue]()
+	{
+		if (EvictionBuffer.Num() > 0)
+		{
+			FMemory::Memset(EvictionBuffer.GetData(), EvictionValue++, EvictionBuffer.Num());
+		}
+	};
+
+	// Expected outputs at each decimation factor.
+	TArray<uint8> Expected[3];
+	TArray<uint8> Packed;
+	for (int32 FactorIndex = 0; FactorIndex < 3; FactorIndex++)
+	{
+		const int32 Factor = 1 << FactorIndex;
+		const int32 OutWidth = Width / Factor;
+		const int32 OutHeight = Height / Factor;
+		Packed.SetNumUninitialized(OutWidth * OutHeight);
+		Expected[FactorIndex].SetNumUninitialized(OutWidth * OutHeight);
+		CameraImageKernels::DownsamplePlane(PlaneData, PixelStride, RowStride, Width, Height, Factor, Packed.GetData());
+		CameraImageKernels::SobelEdgeDetectionReference(
+			Packed.GetData(), 1, OutWidth, Expected[FactorIndex].GetData(), OutWidth, OutHeight);
+	}
+
+	TArray<uint8> Output;
+	Output.SetNumUninitialized(Width * Height);
+	Packed.SetNumUninitialized(Width * Height);
+
+	TArray<FKernelResult> Results;
+	auto Run = [&](const TCHAR *Name, int32 Factor, bool bChecked, TFunctionRef<void()> Function)
+	{
+		FKernelResult Result;
+		Result.Name = Name;
+		Result.SecondsPerFrame = TimeKernel(Iterations, Function, Prepare);
+		Result.bChecked = bChecked;
+		if (bChecked)
+		{
+			const TArray<uint8> &ExpectedOutput = Expected[FMath::FloorLog2(Factor)];
+			Result.bMatchesReference = FMemory::Memcmp(Output.GetData(), ExpectedOutput.GetData(), ExpectedOutput.Num()) == 0;
+		}
+		Results.Add(Result);
+	};
+
+	if (Settings.bIncludeReference)
+	{
+		Run(TEXT("Sobel reference"), 1, true, [&]()
+		{
+			CameraImageKernels::SobelEdgeDetectionReference(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height);
+		});
+	}
+	Run(TEXT("Sobel full copy"), 1, true, [&]()
+	{
+		CameraImageKernels::CopyPlane(PlaneData, PixelStride, RowStride, Width, Height, Packed.GetData());
+		CameraImageKernels::SobelEdgeDetectionPacked(Packed.GetData(), Output.GetData(), Width, Height, 1, 0);
+	});
+	Run(TEXT("Sobel row cache"), 1, true, [&]()
+	{
+		CameraImageKernels::SobelEdgeDetection(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height);
+	});
+	Run(TEXT("Sobel parallel"), 1, true, [&]()
+	{
+		CameraImageKernels::SobelEdgeDetectionParallel(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height, NumBands, 0);
+	});
+	Run(TEXT("Sobel half resolution"), 2, true, [&]()
+	{
+		CameraImageKernels::SobelEdgeDetectionDecimated(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height, 2, 1, 0);
+	});
+	Run(TEXT("Sobel quarter resolution"), 4, true, [&]()
+	{
+		CameraImageKernels::SobelEdgeDetectionDecimated(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height, 4, 1, 0);
+	});
+
+	// Diffing an edge map against an identical copy compares every pixel,
+	// the worst case for partial texture uploads.
+	const int32 DirtyTileSize = 64;
+	TArray<uint8> DirtyTiles;
+	DirtyTiles.SetNumUninitialized(((Width + DirtyTileSize - 1) / DirtyTileSize) * ((Height + DirtyTileSize - 1) / DirtyTileSize));
+	FMemory::Memcpy(Output.GetData(), Expected[0].GetData(), Expected[0].Num());
+	Run(TEXT("Dirty tiles 64x64"), 1, false, [&]()
+	{
+		CameraImageKernels::FindDirtyTiles(Expected[0].GetData(), Output.GetData(), Width, Height, DirtyTileSize, DirtyTiles.GetData());
+	});
+
+	const FImageFilterGraph SobelGraph = FImageFilterGraph::MakeSobelEdgeDetector();
+	Run(TEXT("Filter graph Sobel"), 1, true, [&]()
+	{
+		SobelGraph.Execute(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height, 1, 1, 0);
+	});
+
+	const FImageFilterGraph CannyGraph = FImageFilterGraph::MakeCannyEdgeDetector(40, 100);
+	Run(TEXT("Filter graph Canny"), 1, false, [&]()
+	{
+		CannyGraph.Execute(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height, 1, 1, 0);
+	});
+	Run(TEXT("Filter graph Canny parallel"), 1, false, [&]()
+	{
+		CannyGraph.Execute(PlaneData, PixelStride, RowStride, Output.GetData(), Width, Height, 1, NumBands, 0);
+	});
+
+	return Results;
+}
+
+void LogKernelSuite(const FTestFrame &Frame, const FSuiteSettings &Settings, const TArray<FKernelResult> &Results)
+{
+	const int64 NumFramePixels = static_cast<int64>(Frame.Width) * Frame.Height;
+	UE_LOG(LogComputerVisionCore, Display, TEXT("%dx%d, pixel stride %d, row stride %d, %s cache, %d iterations, SIMD %s:"),
+		Frame.Width, Frame.Height, Frame.PixelStride, Frame.RowStride,
+		Settings.bColdCache ? TEXT("cold") : TEXT("warm"), Settings.Iterations,
+		CameraImageKernels::IsSobelSimdSupported() ? TEXT("on") : TEXT("off"));
+
+	for (const FKernelResult &Result : Results)
+	{
+		const TCHAR *Check = !Result.bChecked ? TEXT("") : Result.bMatchesReference ? TEXT(", matches") : TEXT(", OUTPUT MISMATCH");
+		UE_LOG(LogComputerVisionCore, Display, TEXT("  %-28s %8.3f ms/frame %9.1f Mpixel/s %7.2f ns/pixel%s"),
+			*Result.Name,
+			Result.SecondsPerFrame * 1000.0,
+			Result.GetMegapixelsPerSecond(NumFramePixels),
+			Result.GetNanosecondsPerPixel(NumFramePixels),
+			Check);
+	}
+}
+
+}
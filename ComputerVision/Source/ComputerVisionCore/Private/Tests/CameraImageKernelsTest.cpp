@@ -0,0 +1,298 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CameraImageKernels.h"
+#include "ImageFilterGraph.h"
+
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	struct FSobelTestCase
+	{
+		int32 Width;
+		int32 Height;
+		int32 PixelStride;
+		int32 RowPadding;
+	};
+
+	/**
+	 * Fills a strided plane with noisy blocks, so that the frame has both
+	 * flat areas and strong edges, and the padding with unrelated bytes.
+	 */
+	TArray<uint8> MakeRandomPlane(FRandomStream &RandomStream, int32 Width, int32 Height, int32 PixelStride, int32 RowStride)
+	{
+		TArray<uint8> Plane;
+		Plane.SetNumUninitialized(RowStride * Height);
+		const int32 BlockSize = RandomStream.RandRange(1, 16);
+		const int32 Noise = RandomStream.RandRange(0, 128);
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			for (int32 Offset = 0; Offset < RowStride; Offset++)
+			{
+				const int32 X = Offset / PixelStride;
+				const int32 Base = ((X / BlockSize) + (Y / BlockSize)) % 2 == 0 ? 48 : 208;
+				Plane[Y * RowStride + Offset] = static_cast<uint8>(FMath::Clamp(Base + RandomStream.RandRange(-Noise, Noise), 0, 255));
+			}
+		}
+		return Plane;
+	}
+
+	/** Box-filters a strided plane down by Factor, one rounded block mean per output pixel. */
+	TArray<uint8> DownsampleReference(const TArray<uint8> &Plane, int32 PixelStride, int32 RowStride, int32 Width, int32 Height, int32 Factor)
+	{
+		const int32 OutWidth = Width / Factor;
+		const int32 OutHeight = Height / Factor;
+		const int32 NumSamples = Factor * Factor;
+		TArray<uint8> Downsampled;
+		Downsampled.SetNumUninitialized(OutWidth * OutHeight);
+		for (int32 Y = 0; Y < OutHeight; Y++)
+		{
+			for (int32 X = 0; X < OutWidth; X++)
+			{
+				int32 Sum = 0;
+				for (int32 DY = 0; DY < Factor; DY++)
+				{
+					for (int32 DX = 0; DX < Factor; DX++)
+					{
+						Sum += Plane[(Y * Factor + DY) * RowStride + (X * Factor + DX) * PixelStride];
+					}
+				}
+				Downsampled[Y * OutWidth + X] = static_cast<uint8>((Sum + NumSamples / 2) / NumSamples);
+			}
+		}
+		return Downsampled;
+	}
+
+	// Sizes that are not multiples of the decimation factor leave source
+	// rows and columns that no output pixel covers.
+	const FSobelTestCase DecimationCases[] = {
+		{ 12, 12, 1, 0 },
+		{ 37, 23, 1, 5 },
+		{ 130, 66, 1, 64 },
+		{ 640, 480, 1, 0 },
+		{ 14, 13, 2, 0 },
+		{ 75, 41, 2, 3 },
+		{ 640, 480, 2, 0 },
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCameraImageKernelsSobelTest, "ComputerVision.CameraImageKernels.Sobel",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCameraImageKernelsSobelTest::RunTest(const FString &Parameters)
+{
+	// Odd sizes leave a partial SIMD block and unaligned rows; strides
+	// above the width must never be read as pixels.
+	const FSobelTestCase Cases[] = {
+		{ 3, 3, 1, 0 },
+		{ 17, 5, 1, 0 },
+		{ 33, 31, 1, 7 },
+		{ 64, 48, 1, 64 },
+		{ 127, 65, 1, 1 },
+		{ 640, 480, 1, 0 },
+		{ 3, 3, 2, 0 },
+		{ 19, 9, 2, 3 },
+		{ 255, 129, 2, 64 },
+		{ 640, 480, 2, 0 },
+	};
+
+	FRandomStream RandomStream(0x50be1);
+	for (const FSobelTestCase &Case : Cases)
+	{
+		for (int32 Frame = 0; Frame < 4; Frame++)
+		{
+			const int32 RowStride = (Case.Width - 1) * Case.PixelStride + 1 + Case.RowPadding;
+			const TArray<uint8> Plane = MakeRandomPlane(RandomStream, Case.Width, Case.Height, Case.PixelStride, RowStride);
+
+			TArray<uint8> Expected;
+			TArray<uint8> Output;
+			Expected.SetNumUninitialized(Case.Width * Case.Height);
+			Output.SetNumZeroed(Case.Width * Case.Height);
+			CameraImageKernels::SobelEdgeDetectionReference(
+				Plane.GetData(), Case.PixelStride, RowStride, Expected.GetData(), Case.Width, Case.Height);
+
+			const FString What = FString::Printf(TEXT("%dx%d, pixel stride %d, row stride %d, frame %d"),
+				Case.Width, Case.Height, Case.PixelStride, RowStride, Frame);
+
+			CameraImageKernels::SobelEdgeDetection(
+				Plane.GetData(), Case.PixelStride, RowStride, Output.GetData(), Case.Width, Case.Height);
+			TestTrue(FString::Printf(TEXT("SobelEdgeDetection matches the reference (%s)"), *What), Output == Expected);
+
+			FMemory::Memzero(Output.GetData(), Output.Num());
+			CameraImageKernels::SobelEdgeDetectionParallel(
+				Plane.GetData(), Case.PixelStride, RowStride, Output.GetData(), Case.Width, Case.Height, 4, 0);
+			TestTrue(FString::Printf(TEXT("SobelEdgeDetectionParallel matches the reference (%s)"), *What), Output == Expected);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCameraImageKernelsPackedTest, "ComputerVision.CameraImageKernels.Packed",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCameraImageKernelsPackedTest::RunTest(const FString &Parameters)
+{
+	const FSobelTestCase Cases[] = {
+		{ 3, 3, 1, 0 },
+		{ 17, 5, 1, 0 },
+		{ 33, 31, 1, 7 },
+		{ 127, 65, 1, 1 },
+		{ 19, 9, 2, 3 },
+		{ 640, 480, 2, 0 },
+	};
+
+	FRandomStream RandomStream(0x9ac4ed);
+	for (const FSobelTestCase &Case : Cases)
+	{
+		const int32 RowStride = (Case.Width - 1) * Case.PixelStride + 1 + Case.RowPadding;
+		const TArray<uint8> Plane = MakeRandomPlane(RandomStream, Case.Width, Case.Height, Case.PixelStride, RowStride);
+		const FString What = FString::Printf(TEXT("%dx%d, pixel stride %d, row stride %d"),
+			Case.Width, Case.Height, Case.PixelStride, RowStride);
+
+		TArray<uint8> ExpectedPacked;
+		ExpectedPacked.SetNumUninitialized(Case.Width * Case.Height);
+		for (int32 Y = 0; Y < Case.Height; Y++)
+		{
+			for (int32 X = 0; X < Case.Width; X++)
+			{
+				ExpectedPacked[Y * Case.Width + X] = Plane[Y * RowStride + X * Case.PixelStride];
+			}
+		}
+		TArray<uint8> Packed;
+		Packed.SetNumZeroed(Case.Width * Case.Height);
+		CameraImageKernels::CopyPlane(Plane.GetData(), Case.PixelStride, RowStride, Case.Width, Case.Height, Packed.GetData());
+		TestTrue(FString::Printf(TEXT("CopyPlane packs the plane (%s)"), *What), Packed == ExpectedPacked);
+
+		TArray<uint8> Expected;
+		Expected.SetNumUninitialized(Case.Width * Case.Height);
+		CameraImageKernels::SobelEdgeDetectionReference(
+			Plane.GetData(), Case.PixelStride, RowStride, Expected.GetData(), Case.Width, Case.Height);
+
+		// One band runs on the calling thread only, four split the rows.
+		for (int32 NumBands : { 1, 4 })
+		{
+			TArray<uint8> Output;
+			Output.SetNumZeroed(Case.Width * Case.Height);
+			CameraImageKernels::SobelEdgeDetectionPacked(Packed.GetData(), Output.GetData(), Case.Width, Case.Height, NumBands, 0);
+			TestTrue(FString::Printf(TEXT("SobelEdgeDetectionPacked with %d bands matches the reference (%s)"), NumBands, *What), Output == Expected);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCameraImageKernelsDecimatedTest, "ComputerVision.CameraImageKernels.Decimated",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCameraImageKernelsDecimatedTest::RunTest(const FString &Parameters)
+{
+	FRandomStream RandomStream(0xdec1);
+	for (const FSobelTestCase &Case : DecimationCases)
+	{
+		const int32 RowStride = (Case.Width - 1) * Case.PixelStride + 1 + Case.RowPadding;
+		const TArray<uint8> Plane = MakeRandomPlane(RandomStream, Case.Width, Case.Height, Case.PixelStride, RowStride);
+		for (int32 Factor : { 1, 2, 4 })
+		{
+			const int32 OutWidth = Case.Width / Factor;
+			const int32 OutHeight = Case.Height / Factor;
+			const FString What = FString::Printf(TEXT("%dx%d, pixel stride %d, row stride %d, factor %d"),
+				Case.Width, Case.Height, Case.PixelStride, RowStride, Factor);
+
+			const TArray<uint8> ExpectedDownsampled = DownsampleReference(Plane, Case.PixelStride, RowStride, Case.Width, Case.Height, Factor);
+			TArray<uint8> Downsampled;
+			Downsampled.SetNumZeroed(OutWidth * OutHeight);
+			CameraImageKernels::DownsamplePlane(Plane.GetData(), Case.PixelStride, RowStride, Case.Width, Case.Height, Factor, Downsampled.GetData());
+			TestTrue(FString::Printf(TEXT("DownsamplePlane matches the reference (%s)"), *What), Downsampled == ExpectedDownsampled);
+
+			TArray<uint8> Expected;
+			Expected.SetNumUninitialized(OutWidth * OutHeight);
+			CameraImageKernels::SobelEdgeDetectionReference(
+				ExpectedDownsampled.GetData(), 1, OutWidth, Expected.GetData(), OutWidth, OutHeight);
+
+			for (int32 NumBands : { 1, 4 })
+			{
+				TArray<uint8> Output;
+				Output.SetNumZeroed(OutWidth * OutHeight);
+				CameraImageKernels::SobelEdgeDetectionDecimated(
+					Plane.GetData(), Case.PixelStride, RowStride, Output.GetData(), Case.Width, Case.Height, Factor, NumBands, 0);
+				TestTrue(FString::Printf(TEXT("SobelEdgeDetectionDecimated with %d bands matches the reference (%s)"), NumBands, *What), Output == Expected);
+			}
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FImageFilterGraphTest, "ComputerVision.ImageFilterGraph.Sobel",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FImageFilterGraphTest::RunTest(const FString &Parameters)
+{
+	const FImageFilterGraph SobelGraph = FImageFilterGraph::MakeSobelEdgeDetector();
+	const FImageFilterGraph CannyGraph = FImageFilterGraph::MakeCannyEdgeDetector(64, 128);
+	TestTrue(TEXT("The Sobel graph compiles"), SobelGraph.IsCompiled());
+	TestTrue(TEXT("The Canny graph compiles"), CannyGraph.IsCompiled());
+	TestEqual(TEXT("The Sobel graph fuses the threshold into one pass"), SobelGraph.GetNumPasses(), 2);
+
+	FImageFilterGraph InvalidGraph;
+	InvalidGraph.AddStage(FImageFilterStage::NonMaxSuppression());
+	TestFalse(TEXT("Non-maximum suppression of an intensity image does not compile"), InvalidGraph.Compile());
+
+	FRandomStream RandomStream(0x6ea9);
+	for (const FSobelTestCase &Case : DecimationCases)
+	{
+		const int32 RowStride = (Case.Width - 1) * Case.PixelStride + 1 + Case.RowPadding;
+		const TArray<uint8> Plane = MakeRandomPlane(RandomStream, Case.Width, Case.Height, Case.PixelStride, RowStride);
+		for (int32 Factor : { 1, 2, 4 })
+		{
+			const int32 OutWidth = Case.Width / Factor;
+			const int32 OutHeight = Case.Height / Factor;
+			const FString What = FString::Printf(TEXT("%dx%d, pixel stride %d, row stride %d, factor %d"),
+				Case.Width, Case.Height, Case.PixelStride, RowStride, Factor);
+
+			const TArray<uint8> Downsampled = DownsampleReference(Plane, Case.PixelStride, RowStride, Case.Width, Case.Height, Factor);
+			TArray<uint8> Expected;
+			Expected.SetNumUninitialized(OutWidth * OutHeight);
+			CameraImageKernels::SobelEdgeDetectionReference(
+				Downsampled.GetData(), 1, OutWidth, Expected.GetData(), OutWidth, OutHeight);
+
+			TArray<uint8> SingleBandCanny;
+			for (int32 NumBands : { 1, 4 })
+			{
+				TArray<uint8> Output;
+				Output.SetNumZeroed(OutWidth * OutHeight);
+				SobelGraph.Execute(Plane.GetData(), Case.PixelStride, RowStride, Output.GetData(), Case.Width, Case.Height, Factor, NumBands, 0);
+				TestTrue(FString::Printf(TEXT("The Sobel graph with %d bands matches the reference (%s)"), NumBands, *What), Output == Expected);
+
+				// There is no scalar Canny reference; its bands must at least
+				// join without seams.
+				Output.SetNumZeroed(OutWidth * OutHeight);
+				CannyGraph.Execute(Plane.GetData(), Case.PixelStride, RowStride, Output.GetData(), Case.Width, Case.Height, Factor, NumBands, 0);
+				if (NumBands == 1)
+				{
+					SingleBandCanny = Output;
+				}
+				else
+				{
+					TestTrue(FString::Printf(TEXT("The Canny graph gives the same image with %d bands as with one (%s)"), NumBands, *What), Output == SingleBandCanny);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,150 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** One plane of a camera image, as returned by UGoogleARCoreCameraImage::GetPlaneData(). */
+struct FCameraFramePlane
+{
+	const uint8 *Data = nullptr;
+	int32 Size = 0;
+	int32 PixelStride = 0;
+	int32 RowStride = 0;
+};
+
+/**
+ * A camera image that does not own its pixels: either a live ARCore
+ * image or a frame of a memory-mapped recording.
+ */
+struct FCameraFrameView
+{
+	static const int32 MaxPlanes = 3;
+
+	/** Capture time in seconds. Only differences between frames are meaningful. */
+	double Timestamp = 0.0;
+	int32 Width = 0;
+	int32 Height = 0;
+
+	/** Y, U and V for YUV_420_888 images. */
+	int32 NumPlanes = 0;
+	FCameraFramePlane Planes[MaxPlanes];
+};
+
+/**
+ * Appends camera frames to a recording file.
+ *
+ * The file is a small header followed by one chunk per frame. A chunk
+ * holds the frame size, timestamp and plane strides followed by the raw
+ * plane bytes, each starting on a 64-byte boundary so that a replay can
+ * run SIMD kernels straight from the mapped file. Values are stored in
+ * native (little) endian.
+ *
+ * AddFrame() only copies the planes into a recycled chunk buffer; a
+ * background task writes the chunks sequentially behind the caller. If
+ * the writer falls more than MaxPendingBytes behind, frames are dropped
+ * rather than stalling the game thread.
+ */
+class COMPUTERVISIONCORE_API FCameraFrameRecorder
+{
+public:
+
+	/**
+	 * @param InMaxPendingBytes	The most bytes queued for writing before frames are dropped.
+	 */
+	explicit FCameraFrameRecorder(int64 InMaxPendingBytes = 64 * 1024 * 1024);
+
+	/** Flushes and closes the file. */
+	~FCameraFrameRecorder();
+
+	/** Creates or truncates Filename and writes the file header. */
+	bool Open(const FString &Filename);
+
+	/** Waits for all queued frames to be written and closes the file. */
+	void Close();
+
+	bool IsOpen() const;
+
+	/**
+	 * Queues a frame for writing. Returns false if the frame was dropped
+	 * because the writer is too far behind or a write failed.
+	 */
+	bool AddFrame(const FCameraFrameView &Frame);
+
+	int32 GetNumFramesWritten() const;
+	int32 GetNumFramesDropped() const;
+	int64 GetNumBytesWritten() const;
+
+	struct FWriterState;
+
+private:
+
+	TSharedPtr<FWriterState, ESPMode::ThreadSafe> WriterState;
+	int64 MaxPendingBytes;
+};
+
+/**
+ * Reads a file written by FCameraFrameRecorder. The file is memory-mapped
+ * where the platform supports it, so frames are handed out as views into
+ * the mapping without copying.
+ */
+class COMPUTERVISIONCORE_API FCameraFrameReplay
+{
+public:
+
+	FCameraFrameReplay();
+	~FCameraFrameReplay();
+
+	/**
+	 * Maps Filename and indexes its frames. A truncated last frame is
+	 * ignored. Fails if any frame has no planes, or a size, strides or
+	 * planes that do not fit its chunk, so every frame handed out has a
+	 * luma plane the kernels can read without leaving the mapping.
+	 */
+	bool Open(const FString &Filename);
+
+	void Close();
+
+	bool IsOpen() const { return FileData != nullptr; }
+
+	int32 GetNumFrames() const { return ChunkOffsets.Num(); }
+
+	/** Returns the time between the first and the last frame in seconds. */
+	double GetDuration() const;
+
+	/**
+	 * Returns a view of frame Index. The view points into the mapped file
+	 * and stays valid until Close().
+	 */
+	bool GetFrame(int32 Index, FCameraFrameView &OutFrame) const;
+
+	/** True if the file is memory-mapped, false if the platform made us load it into memory. */
+	bool IsMemoryMapped() const { return MappedRegion != nullptr; }
+
+private:
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	/** Fallback storage on platforms without memory-mapped files. */
+	TArray<uint8> LoadedFile;
+
+	const uint8 *FileData = nullptr;
+	int64 FileSize = 0;
+	TArray<int64> ChunkOffsets;
+};
@@ -0,0 +1,209 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * CPU pixel kernels used to process ARCore camera images.
+ *
+ * The kernels read 8-bit luminance data with an explicit pixel and row
+ * stride and write a tightly packed Width x Height output image.
+ */
+namespace CameraImageKernels
+{
+	/** Squared gradient magnitude above which a pixel is classified as an edge. */
+	static const int32 SobelThreshold = 128 * 128;
+
+	/** Output value written for edge pixels. */
+	static const uint8 SobelEdgeValue = 0xFF;
+
+	/** Output value written for non-edge pixels. */
+	static const uint8 SobelNonEdgeValue = 0x1F;
+
+	/**
+	 * Scalar reference implementation of the thresholded 3x3 Sobel filter.
+	 * Border pixels are handled by clamping the sample coordinates to the
+	 * image. Every other Sobel kernel must produce bit-identical output.
+	 */
+	COMPUTERVISIONCORE_API void SobelEdgeDetectionReference(
+		const uint8 *InYPlaneData,
+		uint32 YPlanePixelStride,
+		uint32 YPlaneRowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height);
+
+	/**
+	 * Optimized thresholded 3x3 Sobel filter. The interior is computed
+	 * separably 16 pixels at a time with NEON or SSE2 and the one-pixel
+	 * border is handled by a scalar pass.
+	 *
+	 * The input is streamed through a three-row cache: each source row is
+	 * copied (and packed, for any pixel stride) exactly once, right before
+	 * it is first needed, instead of copying the whole plane up front.
+	 */
+	COMPUTERVISIONCORE_API void SobelEdgeDetection(
+		const uint8 *InYPlaneData,
+		uint32 YPlanePixelStride,
+		uint32 YPlaneRowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height);
+
+	/**
+	 * Same as SobelEdgeDetection(), but only writes output rows
+	 * [RowBegin, RowEnd). Input rows RowBegin - 1 and RowEnd are read as
+	 * well, so disjoint row ranges can be processed concurrently.
+	 */
+	COMPUTERVISIONCORE_API void SobelEdgeDetectionRows(
+		const uint8 *InYPlaneData,
+		uint32 YPlanePixelStride,
+		uint32 YPlaneRowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height,
+		int32 RowBegin,
+		int32 RowEnd);
+
+	/**
+	 * Splits the image into horizontal bands and filters them with
+	 * ParallelFor. The output is identical to SobelEdgeDetection().
+	 *
+	 * @param NumBands			Number of bands, or 0 for one per task graph worker plus the calling thread.
+	 * @param MinPixelsPerTask	Bands are merged until each covers at least this many pixels. 0 disables the limit.
+	 */
+	COMPUTERVISIONCORE_API void SobelEdgeDetectionParallel(
+		const uint8 *InYPlaneData,
+		uint32 YPlanePixelStride,
+		uint32 YPlaneRowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height,
+		int32 NumBands,
+		int32 MinPixelsPerTask);
+
+	/**
+	 * Filters a tightly packed Width x Height image that the caller
+	 * already owns, such as the output of CopyPlane(). Unlike the other
+	 * variants this neither copies the input nor allocates memory.
+	 *
+	 * @param NumBands			Number of parallel bands as in SobelEdgeDetectionParallel(). 1 runs on the calling thread only.
+	 * @param MinPixelsPerTask	Minimum pixels per band as in SobelEdgeDetectionParallel().
+	 */
+	COMPUTERVISIONCORE_API void SobelEdgeDetectionPacked(
+		const uint8 *InPixels,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height,
+		int32 NumBands,
+		int32 MinPixelsPerTask);
+
+	/**
+	 * Same as SobelEdgeDetectionParallel(), but filters the image after
+	 * box-filtering it down by Factor. Width and Height describe the
+	 * source region; the output is (Width / Factor) x (Height / Factor)
+	 * pixels. The decimated rows are produced inside the row cache, so the
+	 * source is read in a single pass and the decimated image is never
+	 * stored as a whole.
+	 *
+	 * @param Factor	Decimation factor: 1, 2 or 4.
+	 */
+	COMPUTERVISIONCORE_API void SobelEdgeDetectionDecimated(
+		const uint8 *InYPlaneData,
+		uint32 YPlanePixelStride,
+		uint32 YPlaneRowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height,
+		int32 Factor,
+		int32 NumBands,
+		int32 MinPixelsPerTask);
+
+	/** Returns the number of bands SobelEdgeDetectionParallel() uses for the given settings. */
+	COMPUTERVISIONCORE_API int32 GetSobelBandCount(int32 Width, int32 Height, int32 NumBands, int32 MinPixelsPerTask);
+
+	/**
+	 * Copies a strided 8-bit plane into a tightly packed Width x Height
+	 * buffer.
+	 */
+	COMPUTERVISIONCORE_API void CopyPlane(
+		const uint8 *InPlaneData,
+		uint32 PixelStride,
+		uint32 RowStride,
+		int32 Width,
+		int32 Height,
+		uint8 *OutPixels);
+
+	/**
+	 * Box-filters a strided Width x Height plane down by Factor (1, 2 or 4)
+	 * into a tightly packed (Width / Factor) x (Height / Factor) buffer in
+	 * a single pass. Each output pixel is the rounded mean of its block.
+	 */
+	COMPUTERVISIONCORE_API void DownsamplePlane(
+		const uint8 *InPlaneData,
+		uint32 PixelStride,
+		uint32 RowStride,
+		int32 Width,
+		int32 Height,
+		int32 Factor,
+		uint8 *OutPixels);
+
+	/**
+	 * Produces packed row OutY of a plane box-filtered down by Factor
+	 * (1, 2 or 4). OutWidth is the decimated width.
+	 */
+	COMPUTERVISIONCORE_API void DownsampleRow(
+		const uint8 *InPlaneData,
+		uint32 PixelStride,
+		uint32 RowStride,
+		int32 OutWidth,
+		int32 OutY,
+		int32 Factor,
+		uint8 *OutRow);
+
+	/**
+	 * Compares two tightly packed Width x Height images in TileSize x
+	 * TileSize tiles and flags the tiles in which any pixel differs. Rows
+	 * are compared 16 pixels at a time with NEON or SSE2, and a tile is no
+	 * longer compared once a difference is found.
+	 *
+	 * @param OutDirtyTiles	One byte per tile, row by row: ceil(Width / TileSize) x ceil(Height / TileSize) bytes. Set to 1 for dirty tiles and 0 otherwise.
+	 * @return The number of dirty tiles.
+	 */
+	COMPUTERVISIONCORE_API int32 FindDirtyTiles(
+		const uint8 *InPixels,
+		const uint8 *InPreviousPixels,
+		int32 Width,
+		int32 Height,
+		int32 TileSize,
+		uint8 *OutDirtyTiles);
+
+	/**
+	 * Copies the tiles flagged by FindDirtyTiles() from one tightly packed
+	 * Width x Height image to another, e.g. to keep a copy of what was
+	 * uploaded to a texture.
+	 */
+	COMPUTERVISIONCORE_API void CopyDirtyTiles(
+		const uint8 *InPixels,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height,
+		int32 TileSize,
+		const uint8 *DirtyTiles);
+
+	/** Returns true if SobelEdgeDetection() uses a SIMD kernel on this platform. */
+	COMPUTERVISIONCORE_API bool IsSobelSimdSupported();
+}
@@ -0,0 +1,190 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Operations supported by FImageFilterGraph. */
+enum class EImageFilterOp : uint8
+{
+	/** 3x3 binomial blur. Stencil; intensity in, intensity out. */
+	GaussianBlur3x3,
+
+	/** 3x3 Sobel gradient. Stencil; intensity in, gradient out. */
+	SobelGradient,
+
+	/**
+	 * Keeps gradient pixels that are a local maximum across the gradient
+	 * direction. Stencil; gradient in, gradient magnitude out.
+	 */
+	NonMaxSuppression,
+
+	/** Maps values above HighThreshold to HighValue and all others to LowValue. Point-wise. */
+	Threshold,
+
+	/**
+	 * Maps values at or above HighThreshold, and values at or above
+	 * LowThreshold with such a strong pixel among their 8 neighbours, to
+	 * HighValue; all others to LowValue. This is a single-step
+	 * approximation of Canny hysteresis. Stencil.
+	 */
+	Hysteresis,
+};
+
+/**
+ * One node of an FImageFilterGraph. Thresholds on gradients and gradient
+ * magnitudes are given in magnitude units, e.g. 128 for the Sobel
+ * threshold used by AGoogleARCoreEdgeDetector.
+ */
+struct COMPUTERVISIONCORE_API FImageFilterStage
+{
+	EImageFilterOp Op = EImageFilterOp::Threshold;
+	int32 LowThreshold = 0;
+	int32 HighThreshold = 0;
+	uint8 LowValue = 0x00;
+	uint8 HighValue = 0xFF;
+
+	static FImageFilterStage GaussianBlur();
+	static FImageFilterStage Sobel();
+	static FImageFilterStage NonMaxSuppression();
+	static FImageFilterStage Threshold(int32 InThreshold, uint8 InHighValue = 0xFF, uint8 InLowValue = 0x00);
+	static FImageFilterStage Hysteresis(int32 InLowThreshold, int32 InHighThreshold, uint8 InHighValue = 0xFF, uint8 InLowValue = 0x00);
+};
+
+/**
+ * A chain of point-wise and 3x3 stencil filters over an 8-bit image.
+ *
+ * Compile() fuses the chain into passes: every stencil stage starts a pass
+ * and the point-wise stages after it run on its output rows while they
+ * are still in cache. All passes then advance together, row by row, with
+ * each pass keeping only a ring of three rows. The frame is traversed once
+ * regardless of the number of stages and no intermediate image is ever
+ * stored in full.
+ *
+ * Ring rows come from arenas that are recycled across calls, so Execute()
+ * does not allocate in steady state. A compiled graph may be executed from
+ * several threads at once.
+ */
+class COMPUTERVISIONCORE_API FImageFilterGraph
+{
+public:
+
+	FImageFilterGraph();
+
+	/** Appends a stage. Call Compile() before the next Execute(). */
+	void AddStage(const FImageFilterStage &Stage);
+
+	/** Removes all stages. */
+	void Reset();
+
+	const TArray<FImageFilterStage>& GetStages() const { return Stages; }
+
+	/**
+	 * Validates the stage formats and groups the stages into fused passes.
+	 *
+	 * @param OutError	Receives a description of the first invalid stage, if any.
+	 * @return True if the graph can be executed.
+	 */
+	bool Compile(FString *OutError = nullptr);
+
+	/** Returns true if the last Compile() succeeded. */
+	bool IsCompiled() const { return bCompiled; }
+
+	/** The number of traversals over the image after fusion. */
+	int32 GetNumPasses() const { return Passes.Num(); }
+
+	/**
+	 * Runs the graph on a Width x Height region of a strided 8-bit plane,
+	 * optionally box-filtered down by Factor first, and writes the
+	 * (Width / Factor) x (Height / Factor) result to OutPixels.
+	 *
+	 * @param NumBands			Number of parallel bands, or 0 for one per task graph worker. See CameraImageKernels::GetSobelBandCount().
+	 * @param MinPixelsPerTask	Minimum pixels per band.
+	 */
+	void Execute(
+		const uint8 *InPlaneData,
+		uint32 PixelStride,
+		uint32 RowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height,
+		int32 Factor,
+		int32 NumBands,
+		int32 MinPixelsPerTask) const;
+
+	/** Sobel followed by the threshold used by AGoogleARCoreEdgeDetector. */
+	static FImageFilterGraph MakeSobelEdgeDetector();
+
+	/** Blur, Sobel, non-maximum suppression and hysteresis. */
+	static FImageFilterGraph MakeCannyEdgeDetector(int32 LowThreshold, int32 HighThreshold);
+
+private:
+
+	/** The value encoding of the rows flowing between stages. */
+	enum class EFormat : uint8
+	{
+		/** Plain 8-bit values. */
+		Intensity,
+
+		/** Squared gradient magnitude shifted left by two, with the quantized direction in the low bits. */
+		Gradient,
+
+		/** Squared gradient magnitude. */
+		GradientMagnitude,
+	};
+
+	/** A stage with its thresholds converted to the units of its input. */
+	struct FCompiledStage
+	{
+		FImageFilterStage Stage;
+		EFormat InputFormat;
+		int32 LowThreshold;
+		int32 HighThreshold;
+	};
+
+	/** A stencil stage and the point-wise stages fused after it. */
+	struct FPass
+	{
+		/** Index of the stencil stage, or INDEX_NONE for the first pass, which reads the source image. */
+		int32 StencilStage = INDEX_NONE;
+		int32 FirstPointStage = 0;
+		int32 NumPointStages = 0;
+		EFormat OutputFormat = EFormat::Intensity;
+	};
+
+	struct FArenaPool;
+	struct FBandState;
+
+	void ExecuteBand(
+		const uint8 *InPlaneData,
+		uint32 PixelStride,
+		uint32 RowStride,
+		uint8 *OutPixels,
+		int32 Width,
+		int32 Height,
+		int32 Factor,
+		int32 RowBegin,
+		int32 RowEnd) const;
+
+	/** Produces the rows of a pass up to and including LastRow. */
+	void AdvancePass(FBandState &State, int32 PassIndex, int32 LastRow) const;
+
+	TArray<FImageFilterStage> Stages;
+	TArray<FCompiledStage> CompiledStages;
+	TArray<FPass> Passes;
+	bool bCompiled = false;
+
+	TSharedRef<FArenaPool, ESPMode::ThreadSafe> ArenaPool;
+};
@@ -0,0 +1,142 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Helpers for measuring the CameraImageKernels and FImageFilterGraph
+ * without a device. Used by the ComputerVision console commands and the
+ * ImageKernelBenchmark commandlet.
+ */
+namespace ImageKernelBenchmark
+{
+	/** A Y plane laid out with an explicit pixel and row stride, like the planes ARCore hands out. */
+	struct FTestFrame
+	{
+		TArray<uint8> Data;
+		int32 Width = 0;
+		int32 Height = 0;
+		int32 PixelStride = 1;
+		int32 RowStride = 0;
+
+		const uint8 *GetPlaneData() const { return Data.GetData(); }
+	};
+
+	/** Timing of one kernel on one frame layout. */
+	struct FKernelResult
+	{
+		FString Name;
+
+		double SecondsPerFrame = 0.0;
+
+		/** True if the kernel has a reference output to compare against. */
+		bool bChecked = false;
+
+		/** False if the output differs from the reference kernel. */
+		bool bMatchesReference = true;
+
+		/**
+		 * Frame pixels processed per second, in millions. Decimating kernels
+		 * count the source pixels they read, not the pixels they write.
+		 */
+		double GetMegapixelsPerSecond(int64 NumFramePixels) const { return NumFramePixels / SecondsPerFrame / 1.0e6; }
+
+		/** Nanoseconds per frame pixel. */
+		double GetNanosecondsPerPixel(int64 NumFramePixels) const { return SecondsPerFrame * 1.0e9 / NumFramePixels; }
+	};
+
+	struct FSuiteSettings
+	{
+		int32 Iterations = 20;
+
+		/** Parallel bands for the multi-threaded kernels, or 0 for one per worker. */
+		int32 NumBands = 0;
+
+		/**
+		 * Evicts the frame from the CPU caches before every timed call, the
+		 * way a fresh camera image arrives. Eviction is not timed.
+		 */
+		bool bColdCache = false;
+
+		/** Also times the scalar reference kernel, which is slow on large frames. */
+		bool bIncludeReference = true;
+	};
+
+	/**
+	 * Returns the row stride camera HALs typically use: the packed row
+	 * size rounded up to 64 bytes plus one extra cache line.
+	 */
+	COMPUTERVISIONCORE_API int32 GetPaddedRowStride(int32 Width, int32 PixelStride);
+
+	/**
+	 * Creates a frame of noise on top of a checkerboard of hard edges so
+	 * that both edge and non-edge outputs are exercised. The bytes between
+	 * pixels and past the end of each row are filled as well.
+	 */
+	COMPUTERVISIONCORE_API FTestFrame MakeSyntheticFrame(int32 Width, int32 Height, int32 PixelStride, int32 RowStride);
+
+	/**
+	 * Loads the Y plane of a raw Width x Height YUV file, e.g. an I420,
+	 * NV12 or NV21 dump, whose first Width * Height bytes are the packed Y
+	 * plane, and lays it out with the given strides.
+	 *
+	 * @return False if the file cannot be read or is too small.
+	 */
+	COMPUTERVISIONCORE_API bool LoadFrame(
+		const FString &Filename,
+		int32 Width,
+		int32 Height,
+		int32 PixelStride,
+		int32 RowStride,
+		FTestFrame &OutFrame);
+
+	/**
+	 * Runs every kernel on Frame and checks the Sobel outputs against
+	 * SobelEdgeDetectionReference().
+	 */
+	COMPUTERVISIONCORE_API TArray<FKernelResult> RunKernelSuite(const FTestFrame &Frame, const FSuiteSettings &Settings);
+
+	/** Logs the results of RunKernelSuite() as a table. */
+	COMPUTERVISIONCORE_API void LogKernelSuite(const FTestFrame &Frame, const FSuiteSettings &Settings, const TArray<FKernelResult> &Results);
+
+	/**
+	 * Runs Function Iterations times after one warm-up call and returns the
+	 * average time per call in seconds. Prepare() runs before every call and
+	 * is not timed.
+	 */
+	template <typename FunctionType, typename PrepareFunctionType>
+	double TimeKernel(int32 Iterations, FunctionType Function, PrepareFunctionType Prepare)
+	{
+		Prepare();
+		Function();
+		double TotalSeconds = 0.0;
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			Prepare();
+			const double StartTime = FPlatformTime::Seconds();
+			Function();
+			TotalSeconds += FPlatformTime::Seconds() - StartTime;
+		}
+		return TotalSeconds / Iterations;
+	}
+
+	/** Runs Function Iterations times after one warm-up call and returns the average time per call in seconds. */
+	template <typename FunctionType>
+	double TimeKernel(int32 Iterations, FunctionType Function)
+	{
+		return TimeKernel(Iterations, Function, []() {});
+	}
+}
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class HelloARUnreal : ModuleRules
@@ -22,6 +23,9 @@ public class HelloARUnreal : ModuleRules
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
 
+		// Header-only code shared between the samples, e.g. PlaneMeshBuilder.h.
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "..", "..", "..", "Shared"));
+
 		PrivateDependencyModuleNames.AddRange(new string[] {
 			"AugmentedReality",
 			"ProceduralMeshComponent",
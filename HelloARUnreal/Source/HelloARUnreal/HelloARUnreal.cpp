@@ -16,3 +16,5 @@
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, HelloARUnreal, "HelloARUnreal" );
+
+CSV_DEFINE_CATEGORY(HelloARUnreal, true);
@@ -15,4 +15,23 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
 
+DECLARE_STATS_GROUP(TEXT("HelloARUnreal"), STATGROUP_HelloARUnreal, STATCAT_Advanced);
+CSV_DECLARE_CATEGORY_EXTERN(HelloARUnreal);
+
+/**
+ * Times the enclosing scope as the cycle stat STAT_<Name>, the CSV
+ * profiler stat HelloARUnreal/<Name> and a named event for external
+ * profilers. None of them are compiled into Shipping builds.
+ */
+#define HELLOAR_SCOPED_STAT(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_##Name); \
+	CSV_SCOPED_TIMING_STAT(HelloARUnreal, Name); \
+	SCOPED_NAMED_EVENT(Name, FColor::Emerald)
+
+/** Adds Value to the per-frame counter stat STAT_<Name> and the CSV profiler stat HelloARUnreal/<Name>. */
+#define HELLOAR_INC_STAT(Name, Value) \
+	INC_DWORD_STAT_BY(STAT_##Name, Value); \
+	CSV_CUSTOM_STAT(HelloARUnreal, Name, static_cast<int32>(Value), ECsvCustomStatOp::Accumulate)
@@ -13,8 +13,40 @@
 // limitations under the License.
 
 #include "ARPlaneActor.h"
+#include "HelloARUnreal.h"
 #include "ProceduralMeshComponent.h"
 #include "Components/InstancedStaticMeshComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/Engine.h"
+#include "Engine/GameViewportClient.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/Crc.h"
+
+DECLARE_CYCLE_STAT(TEXT("Plane Actor Tick"), STAT_PlaneActorTick, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Actor Ticks Visible"), STAT_PlaneActorTicksVisible, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Actor Ticks Distant"), STAT_PlaneActorTicksDistant, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Actor Ticks Off Screen"), STAT_PlaneActorTicksOffScreen, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Actor Ticks Dormant"), STAT_PlaneActorTicksDormant, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Actor Pose Updates"), STAT_PlaneActorPoseUpdates, STATGROUP_HelloARUnreal);
+DECLARE_CYCLE_STAT(TEXT("Plane Actor Update Mesh"), STAT_PlaneActorUpdateMesh, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Planes Visited"), STAT_PlanesVisited, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Planes Rebuilt"), STAT_PlanesRebuilt, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Vertices Generated"), STAT_PlaneVerticesGenerated, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Indices Generated"), STAT_PlaneIndicesGenerated, STATGROUP_HelloARUnreal);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plane Bytes Allocated"), STAT_PlaneBytesAllocated, STATGROUP_HelloARUnreal);
+
+// A plane counts as on screen if it was rendered within this many seconds.
+static const float PlaneRecentlyRenderedSeconds = 0.5f;
+
+struct FPlaneActorTickBucketCounts
+{
+	int32 NumPlaneActors[static_cast<int32>(EARPlaneActorTickBucket::Count)] = {};
+	int32 NumTotal = 0;
+};
+
+// Plane actors in play per world and tick bucket, game thread only. A
+// world's entry goes away with its last plane actor.
+static TMap<const UWorld*, FPlaneActorTickBucketCounts> NumPlaneActorsInTickBucket;
 
 // Sets default values
 AARPlaneActor::AARPlaneActor()
@@ -27,95 +59,200 @@ AARPlaneActor::AARPlaneActor()
 
 }
 
+void AARPlaneActor::BeginPlay()
+{
+	Super::BeginPlay();
+	SetTickBucket(EARPlaneActorTickBucket::Visible);
+}
+
+void AARPlaneActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	SetTickBucket(EARPlaneActorTickBucket::Count);
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void AARPlaneActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-	PlanePolygonMeshComponent->SetWorldTransform(ARCorePlaneObject->GetLocalToWorldTransform());
-}
+	HELLOAR_SCOPED_STAT(PlaneActorTick);
 
-void AARPlaneActor::UpdatePlanePolygonMesh()
-{
-	// Update polygon mesh vertex indices, using triangle fan due to its convex.
-	TArray<FVector> BoundaryVertices;
-	BoundaryVertices = ARCorePlaneObject->GetBoundaryPolygonInLocalSpace();
-	int BoundaryVerticesNum = BoundaryVertices.Num();
+	switch (TickBucket)
+	{
+	case EARPlaneActorTickBucket::Visible:
+		HELLOAR_INC_STAT(PlaneActorTicksVisible, 1);
+		break;
+	case EARPlaneActorTickBucket::Distant:
+		HELLOAR_INC_STAT(PlaneActorTicksDistant, 1);
+		break;
+	case EARPlaneActorTickBucket::OffScreen:
+		HELLOAR_INC_STAT(PlaneActorTicksOffScreen, 1);
+		break;
+	case EARPlaneActorTickBucket::Dormant:
+		HELLOAR_INC_STAT(PlaneActorTicksDormant, 1);
+		break;
+	default:
+		break;
+	}
 
-	if (BoundaryVerticesNum < 3)
+	if (ARCorePlaneObject == nullptr || ARCorePlaneObject->GetTrackingState() != EARTrackingState::Tracking)
 	{
-		PlanePolygonMeshComponent->ClearMeshSection(0);
+		// The pose of a paused plane does not change, and a stopped plane is about to go away.
+		SetTickBucket(EARPlaneActorTickBucket::Dormant);
 		return;
 	}
 
-	int PolygonMeshVerticesNum = BoundaryVerticesNum * 2;
-	// Triangle number is interior(n-2 for convex polygon) plus perimeter (EdgeNum * 2);
-	int TriangleNum = BoundaryVerticesNum - 2 + BoundaryVerticesNum * 2;
-
-	TArray<FVector> PolygonMeshVertices;
-	TArray<FLinearColor> PolygonMeshVertexColors;
-	TArray<int> PolygonMeshIndices;
-	TArray<FVector> PolygonMeshNormals;
-	TArray<FVector2D> PolygonMeshUVs;
+	const FTransform LocalToWorld = ARCorePlaneObject->GetLocalToWorldTransform();
+	if (!IsPoseUnchanged(LocalToWorld))
+	{
+		PlanePolygonMeshComponent->SetWorldTransform(LocalToWorld);
+		PushedLocalToWorld = LocalToWorld;
+		bHasPushedLocalToWorld = true;
+		HELLOAR_INC_STAT(PlaneActorPoseUpdates, 1);
+	}
 
-	PolygonMeshVertices.Empty(PolygonMeshVerticesNum);
-	PolygonMeshVertexColors.Empty(PolygonMeshVerticesNum);
-	PolygonMeshIndices.Empty(TriangleNum * 3);
-	PolygonMeshNormals.Empty(PolygonMeshVerticesNum);
+	SetTickBucket(ChooseTickBucket());
+}
 
+bool AARPlaneActor::IsPoseUnchanged(const FTransform& LocalToWorld) const
+{
+	return bHasPushedLocalToWorld
+		&& FVector::DistSquared(LocalToWorld.GetLocation(), PushedLocalToWorld.GetLocation()) <= FMath::Square(PoseLocationTolerance)
+		&& FMath::RadiansToDegrees(LocalToWorld.GetRotation().AngularDistance(PushedLocalToWorld.GetRotation())) <= PoseRotationToleranceDegrees;
+}
 
-	FVector PlaneNormal = ARCorePlaneObject->GetLocalToWorldTransform().GetRotation().GetUpVector();
-	for (int i = 0; i < BoundaryVerticesNum; i++)
+EARPlaneActorTickBucket AARPlaneActor::ChooseTickBucket() const
+{
+	if (!bThrottleTick)
 	{
-		FVector BoundaryPoint = BoundaryVertices[i];
-		float BoundaryToCenterDist = BoundaryPoint.Size();
-		float FeatheringDist = FMath::Min(BoundaryToCenterDist, EdgeFeatheringDistance);
-		FVector InteriorPoint = BoundaryPoint - BoundaryPoint.GetUnsafeNormal() * FeatheringDist;
-
-		PolygonMeshVertices.Add(BoundaryPoint);
-		PolygonMeshVertices.Add(InteriorPoint);
+		return EARPlaneActorTickBucket::Visible;
+	}
+	if (!PlanePolygonMeshComponent->WasRecentlyRendered(PlaneRecentlyRenderedSeconds))
+	{
+		return EARPlaneActorTickBucket::OffScreen;
+	}
 
-		PolygonMeshUVs.Add(FVector2D(BoundaryPoint.X, BoundaryPoint.Y));
-		PolygonMeshUVs.Add(FVector2D(InteriorPoint.X, InteriorPoint.Y));
+	APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0);
+	if (CameraManager != nullptr)
+	{
+		// Distance to the nearest point the plane could have.
+		const float Distance = FVector::Dist(CameraManager->GetCameraLocation(), PushedLocalToWorld.GetLocation()) - ARCorePlaneObject->GetExtent().Size();
+		if (Distance > DistantPlaneDistance)
+		{
+			return EARPlaneActorTickBucket::Distant;
+		}
+	}
+	return EARPlaneActorTickBucket::Visible;
+}
 
-		PolygonMeshNormals.Add(PlaneNormal);
-		PolygonMeshNormals.Add(PlaneNormal);
+void AARPlaneActor::SetTickBucket(EARPlaneActorTickBucket NewBucket)
+{
+	if (NewBucket == TickBucket)
+	{
+		return;
+	}
 
-		PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 0.f));
-		PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 1.f));
+	const UWorld* World = GetWorld();
+	if (TickBucket != EARPlaneActorTickBucket::Count)
+	{
+		FPlaneActorTickBucketCounts& Counts = NumPlaneActorsInTickBucket.FindChecked(World);
+		Counts.NumPlaneActors[static_cast<int32>(TickBucket)]--;
+		if (--Counts.NumTotal == 0)
+		{
+			NumPlaneActorsInTickBucket.Remove(World);
+		}
+	}
+	if (NewBucket != EARPlaneActorTickBucket::Count)
+	{
+		FPlaneActorTickBucketCounts& Counts = NumPlaneActorsInTickBucket.FindOrAdd(World);
+		Counts.NumPlaneActors[static_cast<int32>(NewBucket)]++;
+		Counts.NumTotal++;
+	}
+	TickBucket = NewBucket;
 
+	switch (NewBucket)
+	{
+	case EARPlaneActorTickBucket::Visible:
+		SetActorTickInterval(0.0f);
+		break;
+	case EARPlaneActorTickBucket::Distant:
+		SetActorTickInterval(DistantTickInterval);
+		break;
+	case EARPlaneActorTickBucket::OffScreen:
+		SetActorTickInterval(OffScreenTickInterval);
+		break;
+	case EARPlaneActorTickBucket::Dormant:
+		// Keep ticking slowly, so that a plane that tracks again without
+		// an UpdatePlanePolygonMesh() call still catches up.
+		SetActorTickInterval(DormantTickInterval);
+		break;
+	default:
+		break;
 	}
+}
+
+int32 AARPlaneActor::GetNumPlaneActorsInTickBucket(const UObject* WorldContextObject, EARPlaneActorTickBucket Bucket)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	const FPlaneActorTickBucketCounts* Counts = World != nullptr ? NumPlaneActorsInTickBucket.Find(World) : nullptr;
+	return Counts != nullptr && Bucket < EARPlaneActorTickBucket::Count ? Counts->NumPlaneActors[static_cast<int32>(Bucket)] : 0;
+}
 
-	// Generate triangle indices
+void AARPlaneActor::UpdatePlanePolygonMesh()
+{
+	HELLOAR_SCOPED_STAT(PlaneActorUpdateMesh);
+	HELLOAR_INC_STAT(PlanesVisited, 1);
 
-	// Perimeter triangles
-	for (int i = 0; i < BoundaryVerticesNum - 1; i++)
+	if (ARCorePlaneObject == nullptr)
 	{
-		PolygonMeshIndices.Add(i * 2);
-		PolygonMeshIndices.Add(i * 2 + 2);
-		PolygonMeshIndices.Add(i * 2 + 1);
+		return;
+	}
 
-		PolygonMeshIndices.Add(i * 2 + 1);
-		PolygonMeshIndices.Add(i * 2 + 2);
-		PolygonMeshIndices.Add(i * 2 + 3);
+	// The plane changed, so it may have started tracking again.
+	if (TickBucket == EARPlaneActorTickBucket::Dormant && ARCorePlaneObject->GetTrackingState() == EARTrackingState::Tracking)
+	{
+		SetTickBucket(EARPlaneActorTickBucket::Visible);
 	}
 
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2);
-	PolygonMeshIndices.Add(0);
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
+	const TArray<FVector>& SourceBoundaryVertices = ARCorePlaneObject->GetBoundaryPolygonInLocalSpace();
+	const uint32 SourceBoundaryHash = FCrc::MemCrc32(SourceBoundaryVertices.GetData(), SourceBoundaryVertices.Num() * sizeof(FVector));
+	const TArray<FVector>& BoundaryVertices = PlaneBoundarySimplifier::GetBoundary(
+		SimplifiedBoundary, SourceBoundaryVertices, SourceBoundaryHash, GetBoundaryLOD(), MinSimplifyTolerance, SimplificationScratch);
 
+	// The mesh is in plane space, where the plane normal is always up; the
+	// component already carries the plane's rotation.
+	// Update polygon mesh vertex indices, using triangle fan due to its convex.
+	if (!PlaneMeshBuilder::Build(BoundaryVertices, EdgeFeatheringDistance, FVector::UpVector, MeshBuffers))
+	{
+		PlanePolygonMeshComponent->ClearMeshSection(0);
+		return;
+	}
+
+	// No need to fill tangents.
+	PlanePolygonMeshComponent->CreateMeshSection_LinearColor(0, MeshBuffers.Vertices, MeshBuffers.Indices, MeshBuffers.Normals, MeshBuffers.UVs, MeshBuffers.VertexColors, TArray<FProcMeshTangent>(), false);
+	HELLOAR_INC_STAT(PlanesRebuilt, 1);
+	HELLOAR_INC_STAT(PlaneVerticesGenerated, MeshBuffers.Vertices.Num());
+	HELLOAR_INC_STAT(PlaneIndicesGenerated, MeshBuffers.Indices.Num());
+	HELLOAR_INC_STAT(PlaneBytesAllocated, MeshBuffers.Vertices.Num() * sizeof(FProcMeshVertex) + MeshBuffers.Indices.Num() * sizeof(uint32));
+}
 
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
-	PolygonMeshIndices.Add(0);
-	PolygonMeshIndices.Add(1);
+int32 AARPlaneActor::GetBoundaryLOD() const
+{
+	APlayerCameraManager* CameraManager = bSimplifyBoundary ? UGameplayStatics::GetPlayerCameraManager(this, 0) : nullptr;
+	if (CameraManager == nullptr)
+	{
+		return 0;
+	}
 
-	// interior triangles
-	for (int i = 3; i < PolygonMeshVerticesNum - 1; i += 2)
+	FVector2D ViewportSize(1920.0f, 1080.0f);
+	if (GEngine->GameViewport != nullptr)
 	{
-		PolygonMeshIndices.Add(1);
-		PolygonMeshIndices.Add(i);
-		PolygonMeshIndices.Add(i + 2);
+		GEngine->GameViewport->GetViewportSize(ViewportSize);
 	}
 
-	// No need to fill uv and tangent;
-	PlanePolygonMeshComponent->CreateMeshSection_LinearColor(0, PolygonMeshVertices, PolygonMeshIndices, PolygonMeshNormals, PolygonMeshUVs, PolygonMeshVertexColors, TArray<FProcMeshTangent>(), false);
+	// Distance to the nearest point the plane could have.
+	const FVector PlaneLocation = ARCorePlaneObject->GetLocalToWorldTransform().GetLocation();
+	const float Distance = FMath::Max(FVector::Dist(CameraManager->GetCameraLocation(), PlaneLocation) - ARCorePlaneObject->GetExtent().Size(), 0.0f);
+	const float WorldUnitsPerPixel = PlaneBoundarySimplifier::GetWorldUnitsPerPixel(CameraManager->GetFOVAngle(), ViewportSize.X);
+	return PlaneBoundarySimplifier::GetLOD(Distance, WorldUnitsPerPixel, BoundaryPixelTolerance, MinSimplifyTolerance, SimplifiedBoundary.LastLOD);
 }
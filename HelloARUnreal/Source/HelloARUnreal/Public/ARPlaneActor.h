@@ -17,9 +17,29 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "ARTrackable.h"
+#include "PlaneBoundarySimplifier.h"
+#include "PlaneMeshBuilder.h"
 
 #include "ARPlaneActor.generated.h"
 
+/**
+ * How often a plane actor ticks, decided from the plane's tracking state
+ * and its distance to the camera.
+ */
+UENUM(BlueprintType)
+enum class EARPlaneActorTickBucket : uint8
+{
+	/** Near and on screen; ticks every frame. */
+	Visible,
+	/** On screen but farther than DistantPlaneDistance; ticks every DistantTickInterval. */
+	Distant,
+	/** Not rendered recently; ticks every OffScreenTickInterval. */
+	OffScreen,
+	/** Not tracking or without a plane; ticks every DormantTickInterval, or sooner once UpdatePlanePolygonMesh() is called. */
+	Dormant,
+	Count UMETA(Hidden)
+};
+
 UCLASS()
 class HELLOARUNREAL_API AARPlaneActor : public AActor
 {
@@ -41,12 +61,79 @@ public:
 	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite)
 	float EdgeFeatheringDistance = 10.0f;
 
+	/** When set to true, the boundary is simplified more coarsely the farther the plane is from the camera. */
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite)
+	bool bSimplifyBoundary = false;
+
+	/** The most the simplified boundary may deviate from the real one, in screen pixels. Default to 2 pixels*/
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bSimplifyBoundary", ClampMin = "0"))
+	float BoundaryPixelTolerance = 2.0f;
+
+	/** The boundary is not simplified where BoundaryPixelTolerance is less than this distance. Default to 0.5 cm*/
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bSimplifyBoundary", ClampMin = "0.01"))
+	float MinSimplifyTolerance = 0.5f;
+
+	/** When set to true, distant and off-screen planes tick less often. */
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite)
+	bool bThrottleTick = true;
+
+	/** Planes farther than this from the camera tick every DistantTickInterval. Default to 5 m*/
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bThrottleTick", ClampMin = "0"))
+	float DistantPlaneDistance = 500.0f;
+
+	/** The tick interval of distant planes, in seconds. */
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bThrottleTick", ClampMin = "0"))
+	float DistantTickInterval = 0.1f;
+
+	/** The tick interval of planes that were not rendered recently, in seconds. */
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "bThrottleTick", ClampMin = "0"))
+	float OffScreenTickInterval = 0.25f;
+
+	/** The tick interval of planes that are not tracking, in seconds. They only wait to track again. */
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float DormantTickInterval = 1.0f;
+
+	/** The plane mesh is only moved once the plane moved more than this distance. Default to 0.1 cm*/
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float PoseLocationTolerance = 0.1f;
+
+	/** The plane mesh is only moved once the plane turned more than this angle. Default to 0.1 degrees*/
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float PoseRotationToleranceDegrees = 0.1f;
 
 public:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	UFUNCTION(BlueprintPure, Category = "GoogleARCorePlaneActor", meta = (Keywords = "googlear arcore plane"))
+	EARPlaneActorTickBucket GetTickBucket() const { return TickBucket; }
+
+	/** Returns the number of plane actors in play in the world of WorldContextObject that are currently in Bucket. */
+	UFUNCTION(BlueprintPure, Category = "GoogleARCorePlaneActor", meta = (WorldContext = "WorldContextObject", Keywords = "googlear arcore plane"))
+	static int32 GetNumPlaneActorsInTickBucket(const UObject* WorldContextObject, EARPlaneActorTickBucket Bucket);
+
 	UFUNCTION(BlueprintCallable, Category = "GoogleARCorePlaneActor", meta = (Keywords = "googlear arcore plane"))
 	void UpdatePlanePolygonMesh();
 
+private:
+	/** Kept between updates so that rebuilding the mesh does not allocate. */
+	PlaneMeshBuilder::FPlaneMeshBuffers MeshBuffers;
+
+	int32 GetBoundaryLOD() const;
+
+	PlaneBoundarySimplifier::FCache SimplifiedBoundary;
+	PlaneBoundarySimplifier::FScratch SimplificationScratch;
+
+	void SetTickBucket(EARPlaneActorTickBucket NewBucket);
+	EARPlaneActorTickBucket ChooseTickBucket() const;
+	bool IsPoseUnchanged(const FTransform& LocalToWorld) const;
+
+	EARPlaneActorTickBucket TickBucket = EARPlaneActorTickBucket::Count;
+
+	/** The transform last pushed to PlanePolygonMeshComponent. */
+	FTransform PushedLocalToWorld;
+	bool bHasPushedLocalToWorld = false;
 };
@@ -0,0 +1,245 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Simplifies AR plane boundaries before PlaneMeshBuilder turns them into
+ * meshes, with an error bound chosen per plane from its distance to the
+ * camera.
+ *
+ * The error bound is given in screen pixels and converted to plane space
+ * centimeters at the plane's distance. It is rounded down to a power of
+ * two times MinTolerance, so that a plane keeps the same LOD while the
+ * camera moves a little and its cached boundary stays valid. A plane only
+ * leaves its LOD once the error bound is LODHysteresis past the LOD's
+ * range, so that it does not flip between two LODs at their border.
+ *
+ * Simplification keeps a subset of the boundary vertices in their
+ * original order, so a convex boundary stays convex and can still be
+ * drawn as a triangle fan.
+ */
+namespace PlaneBoundarySimplifier
+{
+	/** LOD 0 draws the boundary as it is. */
+	static const int32 MaxLOD = 10;
+
+	/** How far, as a fraction of its range, the error bound must move past a plane's LOD before it changes. */
+	static const float LODHysteresis = 0.25f;
+
+	/**
+	 * Returns the size in world units of one screen pixel at a distance of
+	 * one world unit from the camera.
+	 */
+	FORCEINLINE float GetWorldUnitsPerPixel(float HorizontalFOVDegrees, float ViewportWidth)
+	{
+		return 2.0f * FMath::Tan(FMath::DegreesToRadians(HorizontalFOVDegrees) * 0.5f) / FMath::Max(ViewportWidth, 1.0f);
+	}
+
+	/**
+	 * Returns the LOD for a plane at Distance from the camera: 0 if
+	 * PixelTolerance pixels at that distance are less than MinTolerance,
+	 * otherwise 1 + log2 of their ratio, rounded down.
+	 *
+	 * @param PreviousLOD	The plane's LOD so far, e.g. FCache::LastLOD. It is
+	 *						kept while the ratio stays within LODHysteresis of
+	 *						its range. INDEX_NONE for a new plane.
+	 */
+	FORCEINLINE int32 GetLOD(float Distance, float WorldUnitsPerPixel, float PixelTolerance, float MinTolerance, int32 PreviousLOD = INDEX_NONE)
+	{
+		if (MinTolerance <= 0.0f)
+		{
+			return 0;
+		}
+		const float Ratio = Distance * WorldUnitsPerPixel * PixelTolerance / MinTolerance;
+		if (PreviousLOD >= 0 && PreviousLOD <= MaxLOD)
+		{
+			const float LowerRatio = PreviousLOD > 0 ? static_cast<float>(1 << (PreviousLOD - 1)) : 0.0f;
+			const float UpperRatio = static_cast<float>(1 << PreviousLOD);
+			if (Ratio >= LowerRatio * (1.0f - LODHysteresis)
+				&& (PreviousLOD == MaxLOD || Ratio < UpperRatio * (1.0f + LODHysteresis)))
+			{
+				return PreviousLOD;
+			}
+		}
+		if (Ratio < 1.0f)
+		{
+			return 0;
+		}
+		return FMath::Min(1 + FMath::FloorLog2(static_cast<uint32>(FMath::Min(Ratio, static_cast<float>(1 << MaxLOD)))), MaxLOD);
+	}
+
+	/**
+	 * Returns the plane space error bound of LOD. It never exceeds the pixel
+	 * tolerance the LOD was chosen for by more than the LODHysteresis margin.
+	 */
+	FORCEINLINE float GetLODTolerance(int32 LOD, float MinTolerance)
+	{
+		return LOD > 0 ? MinTolerance * static_cast<float>(1 << (LOD - 1)) : 0.0f;
+	}
+
+	/** Working memory for Simplify(), kept between calls. */
+	struct FScratch
+	{
+		TArray<int32> Stack;
+		TArray<uint8> Keep;
+	};
+
+	/**
+	 * Douglas-Peucker simplification of a closed polygon: removes vertices
+	 * that lie within Tolerance of the simplified outline. The result has
+	 * at least three vertices.
+	 */
+	inline void Simplify(const TArray<FVector>& Boundary, float Tolerance, TArray<FVector>& OutBoundary, FScratch& Scratch)
+	{
+		const int32 NumVertices = Boundary.Num();
+		if (NumVertices <= 3 || Tolerance <= 0.0f)
+		{
+			OutBoundary = Boundary;
+			return;
+		}
+
+		// Split the closed polygon into two open chains at vertex 0 and the vertex farthest from it.
+		int32 Farthest = 1;
+		float FarthestDistSquared = 0.0f;
+		for (int32 Index = 1; Index < NumVertices; Index++)
+		{
+			const float DistSquared = FVector::DistSquared(Boundary[0], Boundary[Index]);
+			if (DistSquared > FarthestDistSquared)
+			{
+				Farthest = Index;
+				FarthestDistSquared = DistSquared;
+			}
+		}
+
+		// SetNumZeroed() only clears the flags it adds; the scratch is shared
+		// between planes, so the whole array has to be cleared.
+		Scratch.Keep.SetNumUninitialized(NumVertices, false);
+		FMemory::Memzero(Scratch.Keep.GetData(), NumVertices);
+		Scratch.Keep[0] = 1;
+		Scratch.Keep[Farthest] = 1;
+
+		// Index NumVertices stands for vertex 0 closing the second chain.
+		Scratch.Stack.Reset();
+		Scratch.Stack.Add(0);
+		Scratch.Stack.Add(Farthest);
+		Scratch.Stack.Add(Farthest);
+		Scratch.Stack.Add(NumVertices);
+
+		const float ToleranceSquared = Tolerance * Tolerance;
+		while (Scratch.Stack.Num() > 0)
+		{
+			const int32 Last = Scratch.Stack.Pop(false);
+			const int32 First = Scratch.Stack.Pop(false);
+			const FVector& Start = Boundary[First];
+			const FVector& End = Boundary[Last % NumVertices];
+
+			int32 Split = INDEX_NONE;
+			float SplitDistSquared = ToleranceSquared;
+			for (int32 Index = First + 1; Index < Last; Index++)
+			{
+				const FVector ClosestPoint = FMath::ClosestPointOnSegment(Boundary[Index], Start, End);
+				const float DistSquared = FVector::DistSquared(Boundary[Index], ClosestPoint);
+				if (DistSquared > SplitDistSquared)
+				{
+					Split = Index;
+					SplitDistSquared = DistSquared;
+				}
+			}
+
+			if (Split != INDEX_NONE)
+			{
+				Scratch.Keep[Split] = 1;
+				Scratch.Stack.Add(First);
+				Scratch.Stack.Add(Split);
+				Scratch.Stack.Add(Split);
+				Scratch.Stack.Add(Last);
+			}
+		}
+
+		// A boundary that is thinner than the tolerance keeps its widest triangle.
+		int32 NumKept = 0;
+		for (int32 Index = 0; Index < NumVertices; Index++)
+		{
+			NumKept += Scratch.Keep[Index];
+		}
+		if (NumKept < 3)
+		{
+			int32 Widest = INDEX_NONE;
+			float WidestDistSquared = -1.0f;
+			for (int32 Index = 1; Index < NumVertices; Index++)
+			{
+				const float DistSquared = FVector::DistSquared(Boundary[Index], FMath::ClosestPointOnSegment(Boundary[Index], Boundary[0], Boundary[Farthest]));
+				if (Index != Farthest && DistSquared > WidestDistSquared)
+				{
+					Widest = Index;
+					WidestDistSquared = DistSquared;
+				}
+			}
+			Scratch.Keep[Widest] = 1;
+		}
+
+		OutBoundary.Reset(NumVertices);
+		for (int32 Index = 0; Index < NumVertices; Index++)
+		{
+			if (Scratch.Keep[Index])
+			{
+				OutBoundary.Add(Boundary[Index]);
+			}
+		}
+	}
+
+	/** A plane's simplified boundary, valid until its source boundary or LOD changes. */
+	struct FCache
+	{
+		uint32 SourceHash = 0;
+		int32 SourceNum = INDEX_NONE;
+		int32 LOD = INDEX_NONE;
+		TArray<FVector> Boundary;
+
+		/** The LOD of the last GetBoundary() call, including 0, to pass to GetLOD(). */
+		int32 LastLOD = INDEX_NONE;
+	};
+
+	/**
+	 * Returns the boundary to draw at LOD, simplifying Boundary only if it
+	 * or the LOD changed since the last call with this cache.
+	 *
+	 * @param BoundaryHash	A hash of Boundary, e.g. FCrc::MemCrc32() of its vertices.
+	 */
+	inline const TArray<FVector>& GetBoundary(
+		FCache& Cache,
+		const TArray<FVector>& Boundary,
+		uint32 BoundaryHash,
+		int32 LOD,
+		float MinTolerance,
+		FScratch& Scratch)
+	{
+		Cache.LastLOD = LOD;
+		if (LOD == 0)
+		{
+			return Boundary;
+		}
+		if (Cache.LOD != LOD || Cache.SourceHash != BoundaryHash || Cache.SourceNum != Boundary.Num())
+		{
+			Simplify(Boundary, GetLODTolerance(LOD, MinTolerance), Cache.Boundary, Scratch);
+			Cache.SourceHash = BoundaryHash;
+			Cache.SourceNum = Boundary.Num();
+			Cache.LOD = LOD;
+		}
+		return Cache.Boundary;
+	}
+}
@@ -0,0 +1,196 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Builds the feathered polygon mesh the samples draw for AR planes.
+ *
+ * The boundary polygon, given in plane space, becomes a ring of boundary
+ * and interior vertex pairs: every interior vertex is pulled towards the
+ * plane center by the feathering distance. The ring is stitched with two
+ * triangles per edge and the interior is closed with a triangle fan,
+ * which works because ARCore and ARKit boundaries are convex.
+ *
+ * Vertex i * 2 is boundary vertex i with alpha 0 and vertex i * 2 + 1 is
+ * its interior vertex with alpha 1, so materials can fade the edge out.
+ *
+ * This file only depends on Core so that both samples and headless tools
+ * can include it. Add the repository's Shared directory to a module's
+ * include paths to use it.
+ */
+namespace PlaneMeshBuilder
+{
+	/** Returns the number of mesh vertices for a boundary of NumBoundaryVertices, or 0 if it is not a polygon. */
+	FORCEINLINE int32 GetNumVertices(int32 NumBoundaryVertices)
+	{
+		return NumBoundaryVertices >= 3 ? NumBoundaryVertices * 2 : 0;
+	}
+
+	/** Returns the number of triangle indices for a boundary of NumBoundaryVertices, or 0 if it is not a polygon. */
+	FORCEINLINE int32 GetNumIndices(int32 NumBoundaryVertices)
+	{
+		// Interior fan (n - 2 triangles) plus two triangles per edge.
+		return NumBoundaryVertices >= 3 ? (NumBoundaryVertices - 2 + NumBoundaryVertices * 2) * 3 : 0;
+	}
+
+	/**
+	 * Writes the positions and UVs of the mesh. UVs are the plane space X
+	 * and Y in centimeters. OutVertices and OutUVs must hold
+	 * GetNumVertices(NumBoundaryVertices) elements.
+	 */
+	inline void WriteVertices(
+		const FVector* RESTRICT BoundaryVertices,
+		int32 NumBoundaryVertices,
+		float FeatheringDistance,
+		FVector* RESTRICT OutVertices,
+		FVector2D* RESTRICT OutUVs)
+	{
+		// No calls and no branches in the loop body, so that compilers can
+		// vectorize it. A boundary vertex at the center stays where it is.
+		for (int32 Index = 0; Index < NumBoundaryVertices; Index++)
+		{
+			const FVector BoundaryPoint = BoundaryVertices[Index];
+			const float BoundaryToCenterDist = FMath::Sqrt(BoundaryPoint.X * BoundaryPoint.X + BoundaryPoint.Y * BoundaryPoint.Y + BoundaryPoint.Z * BoundaryPoint.Z);
+			const float FeatheringDist = FMath::Min(BoundaryToCenterDist, FeatheringDistance);
+			const float InteriorScale = 1.0f - FeatheringDist / FMath::Max(BoundaryToCenterDist, SMALL_NUMBER);
+			const FVector InteriorPoint(BoundaryPoint.X * InteriorScale, BoundaryPoint.Y * InteriorScale, BoundaryPoint.Z * InteriorScale);
+
+			OutVertices[Index * 2] = BoundaryPoint;
+			OutVertices[Index * 2 + 1] = InteriorPoint;
+			OutUVs[Index * 2] = FVector2D(BoundaryPoint.X, BoundaryPoint.Y);
+			OutUVs[Index * 2 + 1] = FVector2D(InteriorPoint.X, InteriorPoint.Y);
+		}
+	}
+
+	/** Writes the edge fade colors. OutColors must hold GetNumVertices(NumBoundaryVertices) elements. */
+	inline void WriteVertexColors(int32 NumBoundaryVertices, FLinearColor* RESTRICT OutColors)
+	{
+		for (int32 Index = 0; Index < NumBoundaryVertices; Index++)
+		{
+			OutColors[Index * 2] = FLinearColor(0.0f, 0.0f, 0.0f, 0.0f);
+			OutColors[Index * 2 + 1] = FLinearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+	}
+
+	/** Writes Normal for every vertex. OutNormals must hold GetNumVertices(NumBoundaryVertices) elements. */
+	inline void WriteNormals(int32 NumBoundaryVertices, const FVector& Normal, FVector* RESTRICT OutNormals)
+	{
+		const int32 NumVertices = NumBoundaryVertices * 2;
+		for (int32 Index = 0; Index < NumVertices; Index++)
+		{
+			OutNormals[Index] = Normal;
+		}
+	}
+
+	/** Writes the triangle list. OutIndices must hold GetNumIndices(NumBoundaryVertices) elements. */
+	inline void WriteIndices(int32 NumBoundaryVertices, int32* RESTRICT OutIndices)
+	{
+		check(NumBoundaryVertices >= 3);
+		int32* Out = OutIndices;
+
+		// Perimeter triangles, the last edge wrapping around to vertex 0.
+		for (int32 Index = 0; Index < NumBoundaryVertices; Index++)
+		{
+			const int32 Boundary = Index * 2;
+			const int32 NextBoundary = Index + 1 < NumBoundaryVertices ? Boundary + 2 : 0;
+
+			*Out++ = Boundary;
+			*Out++ = NextBoundary;
+			*Out++ = Boundary + 1;
+
+			*Out++ = Boundary + 1;
+			*Out++ = NextBoundary;
+			*Out++ = NextBoundary + 1;
+		}
+
+		// Interior triangle fan around the first interior vertex.
+		const int32 NumVertices = NumBoundaryVertices * 2;
+		for (int32 Interior = 3; Interior < NumVertices - 1; Interior += 2)
+		{
+			*Out++ = 1;
+			*Out++ = Interior;
+			*Out++ = Interior + 2;
+		}
+
+		check(Out - OutIndices == GetNumIndices(NumBoundaryVertices));
+	}
+
+	/**
+	 * Mesh arrays in the layout CreateMeshSection_LinearColor() expects.
+	 * Keep one around and pass it to every Build() call: the arrays are
+	 * sized exactly for each plane but never shrink, so after the first few
+	 * planes building a mesh allocates nothing.
+	 */
+	struct FPlaneMeshBuffers
+	{
+		TArray<FVector> Vertices;
+		TArray<FVector2D> UVs;
+		TArray<FLinearColor> VertexColors;
+		TArray<FVector> Normals;
+		TArray<int32> Indices;
+
+		/** Returns the memory held by the arrays, in bytes. */
+		SIZE_T GetAllocatedSize() const
+		{
+			return Vertices.GetAllocatedSize() + UVs.GetAllocatedSize() + VertexColors.GetAllocatedSize()
+				+ Normals.GetAllocatedSize() + Indices.GetAllocatedSize();
+		}
+	};
+
+	/**
+	 * Fills only the vertex positions and UVs of Buffers, for updating a
+	 * mesh section whose vertex count did not change.
+	 *
+	 * @return False if the boundary has fewer than three vertices.
+	 */
+	inline bool BuildVertices(const TArray<FVector>& BoundaryVertices, float FeatheringDistance, FPlaneMeshBuffers& Buffers)
+	{
+		const int32 NumBoundaryVertices = BoundaryVertices.Num();
+		const int32 NumVertices = GetNumVertices(NumBoundaryVertices);
+		Buffers.Vertices.SetNumUninitialized(NumVertices, false);
+		Buffers.UVs.SetNumUninitialized(NumVertices, false);
+		if (NumVertices == 0)
+		{
+			return false;
+		}
+		WriteVertices(BoundaryVertices.GetData(), NumBoundaryVertices, FeatheringDistance, Buffers.Vertices.GetData(), Buffers.UVs.GetData());
+		return true;
+	}
+
+	/**
+	 * Fills all arrays of Buffers for a new mesh section.
+	 *
+	 * @return False if the boundary has fewer than three vertices.
+	 */
+	inline bool Build(const TArray<FVector>& BoundaryVertices, float FeatheringDistance, const FVector& Normal, FPlaneMeshBuffers& Buffers)
+	{
+		const int32 NumBoundaryVertices = BoundaryVertices.Num();
+		const int32 NumVertices = GetNumVertices(NumBoundaryVertices);
+		const int32 NumIndices = GetNumIndices(NumBoundaryVertices);
+		Buffers.VertexColors.SetNumUninitialized(NumVertices, false);
+		Buffers.Normals.SetNumUninitialized(NumVertices, false);
+		Buffers.Indices.SetNumUninitialized(NumIndices, false);
+		if (!BuildVertices(BoundaryVertices, FeatheringDistance, Buffers))
+		{
+			return false;
+		}
+		WriteVertexColors(NumBoundaryVertices, Buffers.VertexColors.GetData());
+		WriteNormals(NumBoundaryVertices, Normal, Buffers.Normals.GetData());
+		WriteIndices(NumBoundaryVertices, Buffers.Indices.GetData());
+		return true;
+	}
+}
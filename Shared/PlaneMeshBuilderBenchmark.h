@@ -0,0 +1,195 @@
+// Copyright 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "PlaneMeshBuilder.h"
+
+/**
+ * Checks and times PlaneMeshBuilder against the per-call TArray code the
+ * samples used before. Only depends on Core, so it runs headless, e.g.
+ * from the PlaneMeshBenchmark commandlet on a Linux build machine.
+ */
+namespace PlaneMeshBuilderBenchmark
+{
+	struct FResult
+	{
+		int32 NumBoundaryVertices = 0;
+
+		/** Average time to build one mesh with fresh arrays and Add(), in seconds. */
+		double ReferenceSeconds = 0.0;
+
+		/** Average time to build one mesh into reused FPlaneMeshBuffers, in seconds. */
+		double BuilderSeconds = 0.0;
+
+		/** Average time to rebuild only the positions and UVs, in seconds. */
+		double VerticesOnlySeconds = 0.0;
+
+		/** False if the builder's mesh differs from the reference mesh. */
+		bool bMatchesReference = true;
+	};
+
+	/** A convex polygon of NumVertices around the origin with some radial noise, like an ARCore plane boundary. */
+	inline TArray<FVector> MakeBoundary(int32 NumVertices, int32 Seed)
+	{
+		FRandomStream RandomStream(Seed);
+		TArray<FVector> Boundary;
+		Boundary.SetNumUninitialized(NumVertices);
+		for (int32 Index = 0; Index < NumVertices; Index++)
+		{
+			const float Angle = 2.0f * PI * Index / NumVertices;
+			const float Radius = 100.0f + RandomStream.FRandRange(-2.0f, 2.0f);
+			Boundary[Index] = FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.0f);
+		}
+		return Boundary;
+	}
+
+	/** The mesh generation the samples used before PlaneMeshBuilder, kept as the reference. */
+	inline void BuildReference(const TArray<FVector>& BoundaryVertices, float EdgeFeatheringDistance, const FVector& PlaneNormal, PlaneMeshBuilder::FPlaneMeshBuffers& Out)
+	{
+		int BoundaryVerticesNum = BoundaryVertices.Num();
+		int PolygonMeshVerticesNum = BoundaryVerticesNum * 2;
+		int TriangleNum = BoundaryVerticesNum - 2 + BoundaryVerticesNum * 2;
+
+		TArray<FVector> PolygonMeshVertices;
+		TArray<FLinearColor> PolygonMeshVertexColors;
+		TArray<int> PolygonMeshIndices;
+		TArray<FVector> PolygonMeshNormals;
+		TArray<FVector2D> PolygonMeshUVs;
+
+		PolygonMeshVertices.Empty(PolygonMeshVerticesNum);
+		PolygonMeshVertexColors.Empty(PolygonMeshVerticesNum);
+		PolygonMeshIndices.Empty(TriangleNum * 3);
+		PolygonMeshNormals.Empty(PolygonMeshVerticesNum);
+
+		for (int i = 0; i < BoundaryVerticesNum; i++)
+		{
+			FVector BoundaryPoint = BoundaryVertices[i];
+			float BoundaryToCenterDist = BoundaryPoint.Size();
+			float FeatheringDist = FMath::Min(BoundaryToCenterDist, EdgeFeatheringDistance);
+			FVector InteriorPoint = BoundaryPoint - BoundaryPoint.GetUnsafeNormal() * FeatheringDist;
+
+			PolygonMeshVertices.Add(BoundaryPoint);
+			PolygonMeshVertices.Add(InteriorPoint);
+
+			PolygonMeshUVs.Add(FVector2D(BoundaryPoint.X, BoundaryPoint.Y));
+			PolygonMeshUVs.Add(FVector2D(InteriorPoint.X, InteriorPoint.Y));
+
+			PolygonMeshNormals.Add(PlaneNormal);
+			PolygonMeshNormals.Add(PlaneNormal);
+
+			PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 0.f));
+			PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 1.f));
+		}
+
+		for (int i = 0; i < BoundaryVerticesNum - 1; i++)
+		{
+			PolygonMeshIndices.Add(i * 2);
+			PolygonMeshIndices.Add(i * 2 + 2);
+			PolygonMeshIndices.Add(i * 2 + 1);
+
+			PolygonMeshIndices.Add(i * 2 + 1);
+			PolygonMeshIndices.Add(i * 2 + 2);
+			PolygonMeshIndices.Add(i * 2 + 3);
+		}
+
+		PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2);
+		PolygonMeshIndices.Add(0);
+		PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
+
+		PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
+		PolygonMeshIndices.Add(0);
+		PolygonMeshIndices.Add(1);
+
+		for (int i = 3; i < PolygonMeshVerticesNum - 1; i += 2)
+		{
+			PolygonMeshIndices.Add(1);
+			PolygonMeshIndices.Add(i);
+			PolygonMeshIndices.Add(i + 2);
+		}
+
+		Out.Vertices = MoveTemp(PolygonMeshVertices);
+		Out.UVs = MoveTemp(PolygonMeshUVs);
+		Out.VertexColors = MoveTemp(PolygonMeshVertexColors);
+		Out.Normals = MoveTemp(PolygonMeshNormals);
+		Out.Indices = MoveTemp(PolygonMeshIndices);
+	}
+
+	/**
+	 * Compares two meshes. Positions may differ by Tolerance because the
+	 * reference normalizes with an approximate reciprocal square root.
+	 */
+	inline bool MeshesMatch(const PlaneMeshBuilder::FPlaneMeshBuffers& A, const PlaneMeshBuilder::FPlaneMeshBuffers& B, float Tolerance)
+	{
+		if (A.Vertices.Num() != B.Vertices.Num() || A.Indices != B.Indices || A.VertexColors != B.VertexColors || A.Normals != B.Normals)
+		{
+			return false;
+		}
+		for (int32 Index = 0; Index < A.Vertices.Num(); Index++)
+		{
+			if (!A.Vertices[Index].Equals(B.Vertices[Index], Tolerance)
+				|| !A.UVs[Index].Equals(B.UVs[Index], Tolerance))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Runs Function Iterations times after one warm-up call and returns the average time per call in seconds. */
+	template <typename FunctionType>
+	double Time(int32 Iterations, FunctionType Function)
+	{
+		Function();
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			Function();
+		}
+		return (FPlatformTime::Seconds() - StartTime) / Iterations;
+	}
+
+	/** Checks and times all three ways of building the mesh for one boundary size. */
+	inline FResult Run(int32 NumBoundaryVertices, int32 Iterations)
+	{
+		const TArray<FVector> Boundary = MakeBoundary(NumBoundaryVertices, NumBoundaryVertices);
+		const float FeatheringDistance = 10.0f;
+		const FVector Normal = FVector::UpVector;
+
+		FResult Result;
+		Result.NumBoundaryVertices = NumBoundaryVertices;
+
+		PlaneMeshBuilder::FPlaneMeshBuffers Reference;
+		PlaneMeshBuilder::FPlaneMeshBuffers Buffers;
+		BuildReference(Boundary, FeatheringDistance, Normal, Reference);
+		PlaneMeshBuilder::Build(Boundary, FeatheringDistance, Normal, Buffers);
+		Result.bMatchesReference = MeshesMatch(Reference, Buffers, 0.01f);
+
+		Result.ReferenceSeconds = Time(Iterations, [&]()
+		{
+			BuildReference(Boundary, FeatheringDistance, Normal, Reference);
+		});
+		Result.BuilderSeconds = Time(Iterations, [&]()
+		{
+			PlaneMeshBuilder::Build(Boundary, FeatheringDistance, Normal, Buffers);
+		});
+		Result.VerticesOnlySeconds = Time(Iterations, [&]()
+		{
+			PlaneMeshBuilder::BuildVertices(Boundary, FeatheringDistance, Buffers);
+		});
+		return Result;
+	}
+}